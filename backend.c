@@ -371,6 +371,10 @@ SR_API int sr_init(struct sr_context **ctx)
 	}
 #endif
 
+	context->scan_cache = g_key_file_new();
+	g_mutex_init(&context->scan_mutex);
+	g_cond_init(&context->scan_cond);
+
 	*ctx = context;
 	context = NULL;
 	session = NULL;
@@ -399,12 +403,23 @@ SR_API int sr_exit(struct sr_context *ctx)
 		return SR_ERR;
 	}
 
+	/* Let scans that missed their deadline finish first. */
+	g_mutex_lock(&ctx->scan_mutex);
+	while (ctx->scan_jobs)
+		g_cond_wait(&ctx->scan_cond, &ctx->scan_mutex);
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	sr_hotplug_monitor_stop(ctx);
+
 	sr_hw_cleanup_all();
 
 #ifdef HAVE_LIBUSB_1_0
 	libusb_exit(ctx->libusb_ctx);
 #endif
 
+	g_key_file_free(ctx->scan_cache);
+	g_mutex_clear(&ctx->scan_mutex);
+	g_cond_clear(&ctx->scan_cond);
 	g_free(ctx);
 
 	return SR_OK;
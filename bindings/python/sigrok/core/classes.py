@@ -23,6 +23,13 @@ from collections import OrderedDict
 from .lowlevel import *
 from . import lowlevel
 import itertools
+import sys
+from struct import unpack
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
 
 __all__ = ['Error', 'Context', 'Driver', 'Device', 'Session', 'Packet', 'Log',
     'LogLevel', 'PacketType', 'Quantity', 'Unit', 'QuantityFlag', 'ConfigKey',
@@ -79,7 +86,19 @@ def python_to_gvariant(value):
 def callback_wrapper(session, callback, device_ptr, packet_ptr):
     device = session.context._devices[int(device_ptr.this)]
     packet = Packet(session, packet_ptr)
-    callback(device, packet)
+    refs = sys.getrefcount(packet)
+    try:
+        callback(device, packet)
+    finally:
+        # The payload holds a reference to the packet once it exists.
+        if packet._payload is not None:
+            refs += 1
+        packet._detach(sys.getrefcount(packet) > refs)
+
+def _release(view):
+    if view is not None and cdata_view_release(view) != SR_OK:
+        raise BufferError(
+            "A view of packet data was kept past the datafeed callback")
 
 class Context(object):
 
@@ -328,9 +347,21 @@ class Session(object):
     def open_device(self, device):
         check(sr_dev_open(device.struct))
 
-    def add_callback(self, callback):
+    def add_callback(self, callback, batch_samples=0, batch_msec=0):
+        """Add a datafeed callback.
+
+        If batch_samples or batch_msec is given, consecutive logic and analog
+        packets are merged, and the callback receives them once that many
+        samples or milliseconds have accumulated, or when any other packet
+        arrives. The time limit is only checked as packets arrive: if a
+        device stops sending, the last batch is held back until its next
+        packet, at the latest until the end of the acquisition."""
         wrapper = partial(callback_wrapper, self, callback)
-        check(sr_session_datafeed_python_callback_add(wrapper))
+        if batch_samples or batch_msec:
+            check(sr_session_datafeed_python_batch_callback_add(wrapper,
+                batch_samples, batch_msec))
+        else:
+            check(sr_session_datafeed_python_callback_add(wrapper))
 
     def start(self):
         check(sr_session_start())
@@ -348,10 +379,19 @@ class Packet(object):
         self.struct = struct
         self._payload = None
 
+    def _detach(self, kept):
+        # The packet memory goes away once the callback returns.
+        if self._payload is not None:
+            self._payload._detach(kept or sys.getrefcount(self._payload) > 2)
+
     @property
     def type(self):
         return PacketType(self.struct.type)
 
+    @property
+    def sample_offset(self):
+        return self.struct.sample_offset
+
     @property
     def payload(self):
         if self._payload is None:
@@ -373,6 +413,15 @@ class Logic(object):
         self.packet = packet
         self.struct = struct
         self._data = None
+        self._view = None
+        self._detached = False
+
+    def _detach(self, kept):
+        if kept and self._data is None:
+            self._data = cdata(self.struct.data, self.struct.length)
+        view, self._view = self._view, None
+        self._detached = True
+        _release(view)
 
     @property
     def data(self):
@@ -380,17 +429,63 @@ class Logic(object):
             self._data = cdata(self.struct.data, self.struct.length)
         return self._data
 
+    @property
+    def unitsize(self):
+        return self.struct.unitsize
+
+    @property
+    def view(self):
+        """Read-only buffer over the packet data, without copying it.
+
+        Only valid within the datafeed callback. If the Logic object itself
+        is kept past the callback, it takes a copy of the data then, and
+        later views are over that copy."""
+        if self._view is None:
+            if self._detached:
+                self._view = memoryview(self.data)
+            else:
+                self._view = cdata_view(self.struct.data, self.struct.length)
+        return self._view
+
+    def array(self, copy=False):
+        """NumPy array of samples, one row of unitsize bytes per sample.
+
+        Unless copy is set, the array is a read-only view of the buffer
+        behind the view property, and must not be kept past the callback."""
+        if numpy is None:
+            raise NotImplementedError("NumPy is not available")
+        array = numpy.frombuffer(self.view, dtype=numpy.uint8)
+        array = array.reshape(-1, self.struct.unitsize)
+        return array.copy() if copy else array
+
 class Analog(object):
 
     def __init__(self, packet, struct):
         self.packet = packet
         self.struct = struct
         self._data = None
+        self._view = None
+        self._samples = None
+
+    def _detach(self, kept):
+        if kept:
+            self._samples = cdata(self.struct.data, self._size)
+        view, self._view = self._view, None
+        _release(view)
 
     @property
     def num_samples(self):
         return self.struct.num_samples
 
+    @property
+    def num_probes(self):
+        count = 0
+        probe_list = self.struct.probes
+        while (probe_list):
+            count += 1
+            probe_list = probe_list.next
+        return count
+
     @property
     def mq(self):
         return Quantity(self.struct.mq)
@@ -409,6 +504,44 @@ class Analog(object):
             self._data = float_array.frompointer(self.struct.data)
         return self._data
 
+    @property
+    def view(self):
+        """Read-only buffer over the float samples, without copying them.
+
+        Only valid within the datafeed callback. If the Analog object itself
+        is kept past the callback, it takes a copy of the samples then, and
+        later views are over that copy."""
+        if self._view is None:
+            if self._samples is not None:
+                self._view = memoryview(self._samples)
+            else:
+                self._view = cdata_view(self.struct.data, self._size)
+        return self._view
+
+    @property
+    def _size(self):
+        return 4 * self.num_samples * self.num_probes
+
+    def array(self, copy=False):
+        """NumPy float32 array of samples, one column per probe.
+
+        Unless copy is set, the array is a read-only view of the buffer
+        behind the view property, and must not be kept past the callback."""
+        if numpy is None:
+            raise NotImplementedError("NumPy is not available")
+        array = numpy.frombuffer(self.view, dtype=numpy.float32)
+        array = array.reshape(-1, self.num_probes)
+        return array.copy() if copy else array
+
+    @property
+    def timestamps(self):
+        """Per-sample timestamps in microseconds since the Unix epoch, or
+        None if the device doesn't provide them."""
+        if not self.struct.timestamps:
+            return None
+        data = cdata(self.struct.timestamps, 8 * self.num_samples)
+        return list(unpack('%dq' % self.num_samples, data))
+
 class Log(object):
 
     @property
@@ -19,21 +19,27 @@
 
 %module lowlevel
 
+/* Let other Python threads run while the session runs. */
+%thread sr_session_run;
+
+/* These use the Python API, so must keep the GIL. */
+%nothread cdata;
+%nothread cdata_view;
+%nothread cdata_view_release;
+
 %include "../../../swig/libsigrok.i"
 
 %{
 
-void sr_datafeed_python_callback(const struct sr_dev_inst *sdi,
-        const struct sr_datafeed_packet *packet, void *cb_data)
+static void python_call(PyObject *callback, const struct sr_dev_inst *sdi,
+        const struct sr_datafeed_packet *packet)
 {
     PyObject *sdi_obj;
     PyObject *packet_obj;
     PyObject *arglist;
     PyObject *result;
     PyGILState_STATE gstate;
-    PyObject *python_callback;
 
-    python_callback = (PyObject *) cb_data;
     gstate = PyGILState_Ensure();
 
     sdi_obj = SWIG_NewPointerObj(SWIG_as_voidptr(sdi),
@@ -44,7 +50,7 @@ void sr_datafeed_python_callback(const struct sr_dev_inst *sdi,
 
     arglist = Py_BuildValue("(OO)", sdi_obj, packet_obj);
 
-    result = PyEval_CallObject(python_callback, arglist);
+    result = PyEval_CallObject(callback, arglist);
 
     Py_XDECREF(arglist);
     Py_XDECREF(sdi_obj);
@@ -54,6 +60,12 @@ void sr_datafeed_python_callback(const struct sr_dev_inst *sdi,
     PyGILState_Release(gstate);
 }
 
+void sr_datafeed_python_callback(const struct sr_dev_inst *sdi,
+        const struct sr_datafeed_packet *packet, void *cb_data)
+{
+    python_call((PyObject *) cb_data, sdi, packet);
+}
+
 int sr_session_datafeed_python_callback_add(PyObject *cb)
 {
     int ret;
@@ -69,6 +81,214 @@ int sr_session_datafeed_python_callback_add(PyObject *cb)
     }
 }
 
+/*
+ * Batched callbacks: logic and analog packets are accumulated without
+ * holding the GIL, and handed to Python as one larger packet of the same
+ * type once enough samples or time have accumulated. Any other packet
+ * flushes the batch first, and is then passed on as is.
+ *
+ * There is no timer: the time limit is only checked when a packet comes
+ * in. The buffers are freed at the end of each acquisition, only the
+ * small struct itself stays around with the callback.
+ */
+struct python_batch {
+    PyObject *callback;
+    unsigned long max_samples;
+    gint64 max_usec;
+    const struct sr_dev_inst *sdi;
+    int type;
+    gint64 start_time;
+    uint64_t num_samples;
+    /* Logic: concatenated sample data. */
+    GByteArray *logic;
+    uint16_t unitsize;
+    /* Analog: interleaved values, and the format they share. */
+    GArray *analog;
+    GSList *probes;
+    int mq;
+    int unit;
+    uint64_t mqflags;
+    /* Per-sample timestamps, if the packets carry them. */
+    GArray *timestamps;
+    gboolean has_timestamps;
+};
+
+static void python_batch_flush(struct python_batch *batch)
+{
+    struct sr_datafeed_packet packet;
+    struct sr_datafeed_logic logic;
+    struct sr_datafeed_analog analog;
+
+    if (!batch->num_samples)
+        return;
+
+    packet.type = batch->type;
+    if (batch->type == SR_DF_LOGIC) {
+        logic.length = batch->logic->len;
+        logic.unitsize = batch->unitsize;
+        logic.data = batch->logic->data;
+        packet.payload = &logic;
+    } else {
+        analog.probes = batch->probes;
+        analog.num_samples = batch->num_samples;
+        analog.mq = batch->mq;
+        analog.unit = batch->unit;
+        analog.mqflags = batch->mqflags;
+        analog.data = (float *)batch->analog->data;
+        analog.timestamps = batch->has_timestamps ?
+            (int64_t *)batch->timestamps->data : NULL;
+        packet.payload = &analog;
+    }
+
+    python_call(batch->callback, batch->sdi, &packet);
+
+    g_byte_array_set_size(batch->logic, 0);
+    g_array_set_size(batch->analog, 0);
+    g_array_set_size(batch->timestamps, 0);
+    g_slist_free(batch->probes);
+    batch->probes = NULL;
+    batch->num_samples = 0;
+}
+
+static gboolean python_batch_probes_equal(GSList *a, GSList *b)
+{
+    for (; a && b; a = a->next, b = b->next) {
+        if (a->data != b->data)
+            return FALSE;
+    }
+
+    return !a && !b;
+}
+
+static void python_batch_alloc(struct python_batch *batch)
+{
+    if (batch->logic)
+        return;
+
+    batch->logic = g_byte_array_new();
+    batch->analog = g_array_new(FALSE, FALSE, sizeof(float));
+    batch->timestamps = g_array_new(FALSE, FALSE, sizeof(int64_t));
+}
+
+/* Free the buffers, they are allocated again when needed. */
+static void python_batch_release(struct python_batch *batch)
+{
+    if (!batch->logic)
+        return;
+
+    g_byte_array_free(batch->logic, TRUE);
+    g_array_free(batch->analog, TRUE);
+    g_array_free(batch->timestamps, TRUE);
+    batch->logic = NULL;
+    batch->analog = NULL;
+    batch->timestamps = NULL;
+}
+
+/* Begin a new batch if the batch is empty. */
+static void python_batch_start(struct python_batch *batch,
+        const struct sr_dev_inst *sdi, int type)
+{
+    if (batch->num_samples)
+        return;
+
+    batch->sdi = sdi;
+    batch->type = type;
+    batch->start_time = g_get_monotonic_time();
+}
+
+void sr_datafeed_python_batch_callback(const struct sr_dev_inst *sdi,
+        const struct sr_datafeed_packet *packet, void *cb_data)
+{
+    struct python_batch *batch;
+    const struct sr_datafeed_logic *logic;
+    const struct sr_datafeed_analog *analog;
+
+    batch = cb_data;
+
+    /* Flush whenever the new packet can't be appended. */
+    if (batch->num_samples && (sdi != batch->sdi
+            || packet->type != batch->type))
+        python_batch_flush(batch);
+
+    if (packet->type == SR_DF_LOGIC || packet->type == SR_DF_ANALOG)
+        python_batch_alloc(batch);
+
+    switch (packet->type) {
+    case SR_DF_LOGIC:
+        logic = packet->payload;
+        if (batch->num_samples && logic->unitsize != batch->unitsize)
+            python_batch_flush(batch);
+        if (!logic->unitsize)
+            return;
+        python_batch_start(batch, sdi, packet->type);
+        batch->unitsize = logic->unitsize;
+        g_byte_array_append(batch->logic, logic->data, logic->length);
+        batch->num_samples += logic->length / logic->unitsize;
+        break;
+    case SR_DF_ANALOG:
+        analog = packet->payload;
+        if (batch->num_samples && (analog->mq != batch->mq
+                || analog->unit != batch->unit
+                || analog->mqflags != batch->mqflags
+                || !analog->timestamps != !batch->has_timestamps
+                || !python_batch_probes_equal(analog->probes,
+                    batch->probes)))
+            python_batch_flush(batch);
+        if (!batch->num_samples) {
+            python_batch_start(batch, sdi, packet->type);
+            batch->probes = g_slist_copy(analog->probes);
+            batch->mq = analog->mq;
+            batch->unit = analog->unit;
+            batch->mqflags = analog->mqflags;
+            batch->has_timestamps = analog->timestamps != NULL;
+        }
+        g_array_append_vals(batch->analog, analog->data,
+                analog->num_samples * g_slist_length(analog->probes));
+        if (analog->timestamps)
+            g_array_append_vals(batch->timestamps, analog->timestamps,
+                    analog->num_samples);
+        batch->num_samples += analog->num_samples;
+        break;
+    default:
+        python_batch_flush(batch);
+        python_call(batch->callback, sdi, packet);
+        if (packet->type == SR_DF_END)
+            python_batch_release(batch);
+        return;
+    }
+
+    if ((batch->max_samples && batch->num_samples >= batch->max_samples)
+            || (batch->max_usec && g_get_monotonic_time()
+                - batch->start_time >= batch->max_usec))
+        python_batch_flush(batch);
+}
+
+int sr_session_datafeed_python_batch_callback_add(PyObject *cb,
+        unsigned long max_samples, unsigned long max_msec)
+{
+    struct python_batch *batch;
+    int ret;
+
+    if (!PyCallable_Check(cb))
+        return SR_ERR_ARG;
+
+    if (!(batch = g_try_malloc0(sizeof(struct python_batch))))
+        return SR_ERR_MALLOC;
+
+    batch->callback = cb;
+    batch->max_samples = max_samples;
+    batch->max_usec = (gint64)max_msec * 1000;
+
+    ret = sr_session_datafeed_callback_add(
+        sr_datafeed_python_batch_callback, batch);
+    if (ret == SR_OK)
+        Py_XINCREF(cb);
+    else
+        g_free(batch);
+
+    return ret;
+}
+
 PyObject *cdata(const void *data, unsigned long size)
 {
 #if PY_MAJOR_VERSION < 3
@@ -78,6 +298,51 @@ PyObject *cdata(const void *data, unsigned long size)
 #endif
 }
 
+/*
+ * Expose a C buffer without copying it. The view must be released with
+ * cdata_view_release() before the buffer goes away. Python 2 can't release
+ * views, so it gets a copy instead.
+ */
+PyObject *cdata_view(const void *data, unsigned long size)
+{
+#if PY_MAJOR_VERSION < 3
+    return cdata(data, size);
+#else
+    return PyMemoryView_FromMemory((char *)data, size, PyBUF_READ);
+#endif
+}
+
+/*
+ * Release a view from cdata_view(). This fails if a slice of the view, or
+ * an array over it, is still around: those would keep pointing into the
+ * buffer after it's gone.
+ */
+int cdata_view_release(PyObject *view)
+{
+#if PY_MAJOR_VERSION < 3
+    (void)view;
+
+    return SR_OK;
+#else
+    PyMemoryViewObject *mv;
+    PyObject *result;
+
+    if (!PyMemoryView_Check(view))
+        return SR_ERR_ARG;
+
+    /* The view itself is one of the managed buffer's exports. */
+    mv = (PyMemoryViewObject *)view;
+    if (mv->exports > 0 || mv->mbuf->exports > 1)
+        return SR_ERR;
+
+    if (!(result = PyObject_CallMethod(view, "release", NULL)))
+        return SR_ERR;
+    Py_DECREF(result);
+
+    return SR_OK;
+#endif
+}
+
 GSList *python_to_gslist(PyObject *pylist)
 {
     if (PyList_Check(pylist)) {
@@ -106,8 +371,12 @@ PyObject *gslist_to_python(GSList *gslist)
 %}
 
 int sr_session_datafeed_python_callback_add(PyObject *cb);
+int sr_session_datafeed_python_batch_callback_add(PyObject *cb,
+        unsigned long max_samples, unsigned long max_msec);
 
 PyObject *cdata(const void *data, unsigned long size);
+PyObject *cdata_view(const void *data, unsigned long size);
+int cdata_view_release(PyObject *view);
 
 GSList *python_to_gslist(PyObject *pylist);
 PyObject *gslist_to_python(GSList *gslist);
@@ -140,6 +140,10 @@ SR_API int sr_dev_probe_enable(const struct sr_dev_inst *sdi, int probenum,
 		}
 	}
 
+	/* Some lists, e.g. samplerates, depend on the enabled probes. */
+	if (ret == SR_OK)
+		sr_config_list_cache_invalidate(sdi->driver, sdi);
+
 	return ret;
 }
 
@@ -209,8 +213,8 @@ SR_API gboolean sr_dev_has_option(const struct sr_dev_inst *sdi, int key)
 	if (!sdi || !sdi->driver || !sdi->driver->config_list)
 		return FALSE;
 
-	if (sdi->driver->config_list(SR_CONF_DEVICE_OPTIONS,
-				&gvar, NULL, NULL) != SR_OK)
+	if (sr_config_list(sdi->driver, NULL, NULL, SR_CONF_DEVICE_OPTIONS,
+				&gvar) != SR_OK)
 		return FALSE;
 
 	ret = FALSE;
@@ -272,6 +276,8 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	struct sr_probe *probe;
 	GSList *l;
 
+	sr_config_list_cache_invalidate(NULL, sdi);
+
 	for (l = sdi->probes; l; l = l->next) {
 		probe = l->data;
 		g_free(probe->name);
@@ -420,10 +426,17 @@ SR_PRIV void sr_usbtmc_dev_inst_free(struct sr_usbtmc_dev_inst *usbtmc)
  */
 SR_API GSList *sr_dev_list(const struct sr_dev_driver *driver)
 {
-	if (driver && driver->dev_list)
-		return driver->dev_list();
-	else
+	GSList *l;
+
+	if (!driver || !driver->dev_list)
 		return NULL;
+
+	/* Don't read the list while a background scan adds to it. */
+	sr_driver_lock(driver);
+	l = driver->dev_list();
+	sr_driver_unlock(driver);
+
+	return l;
 }
 
 /**
@@ -437,10 +450,16 @@ SR_API GSList *sr_dev_list(const struct sr_dev_driver *driver)
  */
 SR_API int sr_dev_clear(const struct sr_dev_driver *driver)
 {
-	if (driver && driver->dev_clear)
-		return driver->dev_clear();
-	else
+	int ret;
+
+	if (!driver || !driver->dev_clear)
 		return SR_OK;
+
+	sr_driver_lock(driver);
+	ret = driver->dev_clear();
+	sr_driver_unlock(driver);
+
+	return ret;
 }
 
 /**
@@ -460,6 +479,7 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 		return SR_ERR;
 
 	ret = sdi->driver->dev_open(sdi);
+	sr_config_list_cache_invalidate(sdi->driver, sdi);
 
 	return ret;
 }
@@ -481,6 +501,7 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 		return SR_ERR;
 
 	ret = sdi->driver->dev_close(sdi);
+	sr_config_list_cache_invalidate(sdi->driver, sdi);
 
 	return ret;
 }
@@ -92,7 +92,6 @@ SR_PRIV int agdmm_receive_data(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_serial_dev_inst *serial;
-	int len;
 
 	(void)fd;
 
@@ -105,17 +104,13 @@ SR_PRIV int agdmm_receive_data(int fd, int revents, void *cb_data)
 	serial = sdi->conn;
 	if (revents == G_IO_IN) {
 		/* Serial data arrived. */
-		while(AGDMM_BUFSIZE - devc->buflen - 1 > 0) {
-			len = serial_read(serial, devc->buf + devc->buflen, 1);
-			if (len < 1)
+		while (1) {
+			devc->buflen = AGDMM_BUFSIZE;
+			if (serial_readline_nonblocking(serial,
+					(char *)devc->buf, &devc->buflen) != SR_OK
+					|| !devc->buflen)
 				break;
-			devc->buflen += len;
-			*(devc->buf + devc->buflen) = '\0';
-			if (*(devc->buf + devc->buflen - 1) == '\n') {
-				/* End of line */
-				receive_line(sdi);
-				break;
-			}
+			receive_line(sdi);
 		}
 	}
 
@@ -33,6 +33,13 @@ static const int32_t hwcaps[] = {
 	SR_CONF_CONTINUOUS,
 };
 
+/* Native sample formats, in order of preference. */
+static const snd_pcm_format_t formats[] = {
+	SND_PCM_FORMAT_FLOAT,
+	SND_PCM_FORMAT_S32,
+	SND_PCM_FORMAT_S16,
+};
+
 SR_PRIV struct sr_dev_driver alsa_driver_info;
 static struct sr_dev_driver *di = &alsa_driver_info;
 
@@ -211,11 +218,19 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+static void free_buffers(struct dev_context *devc)
+{
+	g_free(devc->analog_buf);
+	devc->analog_buf = NULL;
+	g_free(devc->raw_buf);
+	devc->raw_buf = NULL;
+}
+
 static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 {
 	struct dev_context *devc;
+	unsigned int i;
 	int count, ret;
-	char *endianness;
 
 	if (sdi->status != SR_ST_ACTIVE)
 		return SR_ERR_DEV_CLOSED;
@@ -224,23 +239,40 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	devc->cb_data = cb_data;
 	devc->num_samples = 0;
 
-	sr_dbg("Setting audio access type to RW/interleaved.");
+	/*
+	 * Prefer mmap access, which lets us convert samples straight out of
+	 * the ALSA ring buffer. Fall back to read() for devices without it.
+	 */
+	sr_dbg("Setting audio access type to MMAP/interleaved.");
+	devc->use_mmap = TRUE;
 	ret = snd_pcm_hw_params_set_access(devc->capture_handle,
-			devc->hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+			devc->hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+	if (ret < 0) {
+		sr_dbg("Falling back to audio access type RW/interleaved.");
+		devc->use_mmap = FALSE;
+		ret = snd_pcm_hw_params_set_access(devc->capture_handle,
+				devc->hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+	}
 	if (ret < 0) {
 		sr_err("Can't set audio access type: %s.", snd_strerror(ret));
 		return SR_ERR;
 	}
 
-	/* FIXME: Hardcoded for 16bits. */
-	if (SND_PCM_FORMAT_S16 == SND_PCM_FORMAT_S16_LE)
-		endianness = "little endian";
-	else
-		endianness = "big endian";
-	sr_dbg("Setting audio sample format to signed 16bit (%s).", endianness);
+	for (i = 0; i < ARRAY_SIZE(formats); i++) {
+		if (snd_pcm_hw_params_test_format(devc->capture_handle,
+				devc->hw_params, formats[i]) == 0)
+			break;
+	}
+	if (i == ARRAY_SIZE(formats)) {
+		sr_err("No supported audio sample format found.");
+		return SR_ERR;
+	}
+	devc->format = formats[i];
+
+	sr_dbg("Setting audio sample format to %s.",
+	       snd_pcm_format_name(devc->format));
 	ret = snd_pcm_hw_params_set_format(devc->capture_handle,
-					   devc->hw_params,
-					   SND_PCM_FORMAT_S16);
+					   devc->hw_params, devc->format);
 	if (ret < 0) {
 		sr_err("Can't set audio sample format: %s.", snd_strerror(ret));
 		return SR_ERR;
@@ -278,14 +310,38 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 		return SR_ERR;
 	}
 
+	/* Preallocate the sample buffers used for every period. */
+	devc->analog_buf = g_try_malloc(CHUNK_FRAMES * devc->num_probes *
+					sizeof(float));
+	if (!devc->use_mmap)
+		devc->raw_buf = g_try_malloc(CHUNK_FRAMES * devc->num_probes *
+			snd_pcm_format_physical_width(devc->format) / 8);
+	if (!devc->analog_buf || (!devc->use_mmap && !devc->raw_buf)) {
+		sr_err("Failed to malloc sample buffers.");
+		free_buffers(devc);
+		return SR_ERR_MALLOC;
+	}
+
+	if (devc->use_mmap) {
+		ret = snd_pcm_start(devc->capture_handle);
+		if (ret < 0) {
+			sr_err("Can't start audio capture: %s.",
+			       snd_strerror(ret));
+			free_buffers(devc);
+			return SR_ERR;
+		}
+	}
+
 	count = snd_pcm_poll_descriptors_count(devc->capture_handle);
 	if (count < 1) {
 		sr_err("Unable to obtain poll descriptors count.");
+		free_buffers(devc);
 		return SR_ERR;
 	}
 
 	if (!(devc->ufds = g_try_malloc(count * sizeof(struct pollfd)))) {
 		sr_err("Failed to malloc ufds.");
+		free_buffers(devc);
 		return SR_ERR_MALLOC;
 	}
 
@@ -295,6 +351,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 		sr_err("Unable to obtain poll descriptors: %s.",
 		       snd_strerror(ret));
 		g_free(devc->ufds);
+		free_buffers(devc);
 		return SR_ERR;
 	}
 
@@ -320,6 +377,9 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 
 	sr_source_remove(devc->ufds[0].fd);
 
+	snd_pcm_drop(devc->capture_handle);
+	free_buffers(devc);
+
 	/* Send end packet to the session bus. */
 	sr_dbg("Sending SR_DF_END packet.");
 	packet.type = SR_DF_END;
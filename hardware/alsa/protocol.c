@@ -325,16 +325,106 @@ SR_PRIV int alsa_set_samplerate(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
-SR_PRIV int alsa_receive_data(int fd, int revents, void *cb_data)
+/*
+ * It's impossible to know what voltage levels the soundcard handles.
+ * Some handle 0 dBV rms, some 0dBV peak-to-peak, +4dbmW (600 ohm), etc
+ * Each of these corresponds to a different voltage, and there is no
+ * mechanism to determine this voltage. The best solution is to send all
+ * audio data as a normalized float, and let the frontend or user worry
+ * about the calibration.
+ *
+ * The loops below are kept free of per-channel logic so the compiler can
+ * vectorize them.
+ */
+static void convert_samples(const struct dev_context *devc, const void *src,
+			    float *dst, size_t num_values)
+{
+	const int16_t *s16;
+	const int32_t *s32;
+	const float s16norm = 1 / (float)(1 << 15);
+	const float s32norm = 1 / (float)(1U << 31);
+	size_t i;
+
+	switch (devc->format) {
+	case SND_PCM_FORMAT_FLOAT:
+		memcpy(dst, src, num_values * sizeof(float));
+		break;
+	case SND_PCM_FORMAT_S32:
+		s32 = src;
+		for (i = 0; i < num_values; i++)
+			dst[i] = s32[i] * s32norm;
+		break;
+	default:
+		s16 = src;
+		for (i = 0; i < num_values; i++)
+			dst[i] = s16[i] * s16norm;
+		break;
+	}
+}
+
+static void send_samples(const struct sr_dev_inst *sdi, int count)
 {
-	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
-	int16_t inbuf[4096];
-	int i, x, count, offset, samples_to_get;
-	int16_t tmp16;
-	const float s16norm = 1 / (float)(1 << 15);
+
+	devc = sdi->priv;
+
+	memset(&analog, 0, sizeof(struct sr_datafeed_analog));
+
+	/* Send a sample packet with the analog values. */
+	analog.probes = sdi->probes;
+	analog.num_samples = count;
+	analog.mq = SR_MQ_VOLTAGE; /* FIXME */
+	analog.unit = SR_UNIT_VOLT; /* FIXME */
+	analog.data = devc->analog_buf;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(devc->cb_data, &packet);
+
+	devc->num_samples += count;
+}
+
+/* Convert up to max_frames frames straight out of the mmap'ed ALSA ring. */
+static int read_mmap(const struct sr_dev_inst *sdi, int max_frames)
+{
+	struct dev_context *devc;
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, frames;
+	snd_pcm_sframes_t avail, committed;
+	const uint8_t *src;
+	int ret;
+
+	devc = sdi->priv;
+
+	if ((avail = snd_pcm_avail_update(devc->capture_handle)) < 0)
+		return avail;
+	if (avail == 0)
+		return 0;
+
+	frames = MIN((snd_pcm_uframes_t)avail, (snd_pcm_uframes_t)max_frames);
+	ret = snd_pcm_mmap_begin(devc->capture_handle, &areas, &offset, &frames);
+	if (ret < 0)
+		return ret;
+
+	/* Interleaved access: all channels share the first area. */
+	src = (const uint8_t *)areas[0].addr +
+		(areas[0].first + offset * areas[0].step) / 8;
+	convert_samples(devc, src, devc->analog_buf,
+			frames * devc->num_probes);
+
+	committed = snd_pcm_mmap_commit(devc->capture_handle, offset, frames);
+	if (committed < 0)
+		return committed;
+
+	return frames;
+}
+
+SR_PRIV int alsa_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	int count, samples_to_get;
 
 	(void)fd;
 	(void)revents;
@@ -342,55 +432,38 @@ SR_PRIV int alsa_receive_data(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 	devc = sdi->priv;
 
-	memset(&analog, 0, sizeof(struct sr_datafeed_analog));
-	memset(inbuf, 0, sizeof(inbuf));
-
-	samples_to_get = MIN(4096 / 4, devc->limit_samples);
+	samples_to_get = CHUNK_FRAMES;
+	if (devc->limit_samples)
+		samples_to_get = MIN((uint64_t)samples_to_get,
+				     devc->limit_samples - devc->num_samples);
 
 	sr_spew("Getting %d samples from audio device.", samples_to_get);
-	count = snd_pcm_readi(devc->capture_handle, inbuf, samples_to_get);
+	if (devc->use_mmap) {
+		count = read_mmap(sdi, samples_to_get);
+	} else {
+		count = snd_pcm_readi(devc->capture_handle, devc->raw_buf,
+				      samples_to_get);
+		if (count > 0)
+			convert_samples(devc, devc->raw_buf, devc->analog_buf,
+					count * devc->num_probes);
+	}
 
 	if (count < 0) {
+		/* Try to recover from overruns before giving up. */
+		if (snd_pcm_recover(devc->capture_handle, count, 1) == 0 &&
+		    (!devc->use_mmap ||
+		     snd_pcm_start(devc->capture_handle) == 0)) {
+			sr_warn("Recovered from audio overrun.");
+			return TRUE;
+		}
 		sr_err("Failed to read samples: %s.", snd_strerror(count));
 		return FALSE;
 	} else if (count != samples_to_get) {
 		sr_spew("Only got %d/%d samples.", count, samples_to_get);
 	}
 
-	analog.data = g_try_malloc0(count * sizeof(float) * devc->num_probes);
-	if (!analog.data) {
-		sr_err("Failed to malloc sample buffer.");
-		return FALSE;
-	}
-
-	offset = 0;
-	/*
-	 * It's impossible to know what voltage levels the soundcard handles.
-	 * Some handle 0 dBV rms, some 0dBV peak-to-peak, +4dbmW (600 ohm), etc
-	 * Each of these corresponds to a different voltage, and there is no
-	 * mechanism to determine this voltage. The best solution is to send all
-	 * audio data as a normalized float, and let the frontend or user worry
-	 * about the calibration.
-	 */
-	for (i = 0; i < count; i += devc->num_probes) {
-		for (x = 0; x < devc->num_probes; x++) {
-			tmp16 = inbuf[i + x];
-			analog.data[offset++] = tmp16 * s16norm;
-		}
-	}
-
-	/* Send a sample packet with the analog values. */
-	analog.probes = sdi->probes;
-	analog.num_samples = count;
-	analog.mq = SR_MQ_VOLTAGE; /* FIXME */
-	analog.unit = SR_UNIT_VOLT; /* FIXME */
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
-	sr_session_send(devc->cb_data, &packet);
-
-	g_free(analog.data);
-
-	devc->num_samples += count;
+	if (count > 0)
+		send_samples(sdi, count);
 
 	/* Stop acquisition if we acquired enough samples. */
 	if (devc->limit_samples && devc->num_samples >= devc->limit_samples) {
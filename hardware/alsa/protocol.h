@@ -30,6 +30,9 @@
 
 #define LOG_PREFIX "alsa"
 
+/* Maximum number of frames fetched and sent per period. */
+#define CHUNK_FRAMES 1024
+
 /** Private, per-device-instance driver context. */
 struct dev_context {
 	uint64_t cur_samplerate;
@@ -41,6 +44,11 @@ struct dev_context {
 	snd_pcm_t *capture_handle;
 	snd_pcm_hw_params_t *hw_params;
 	struct pollfd *ufds;
+	snd_pcm_format_t format;
+	gboolean use_mmap;
+	/* Preallocated buffers, CHUNK_FRAMES frames each. */
+	float *analog_buf;
+	void *raw_buf;
 	void *cb_data;
 };
 
@@ -218,24 +218,28 @@ static void appa_55ii_log_end(struct sr_dev_inst *sdi)
 	sdi->driver->dev_acquisition_stop(sdi, devc->session_cb_data);
 }
 
-static const uint8_t *appa_55ii_parse_data(struct sr_dev_inst *sdi,
-		const uint8_t *buf, int len)
+static const uint8_t appa_55ii_sync[] = { 0x55, 0x55 };
+
+/* Header, payload of up to 32 bytes as given in the header, checksum. */
+static const struct serial_packet_desc appa_55ii_packet = {
+	.sync = appa_55ii_sync,
+	.sync_len = sizeof(appa_55ii_sync),
+	.packet_size = 4 + 1,
+	.max_size = APPA_55II_BUF_SIZE,
+	.length_offset = 3,
+	.length_extra = 4 + 1,
+	.terminator = -1,
+	.is_valid = appa_55ii_packet_valid,
+};
+
+static void appa_55ii_handle_packet(const uint8_t *buf, size_t len,
+		void *cb_data)
 {
-	if (len < 5)
-		/* Need more data. */
-		return NULL;
-
-	if (buf[0] != 0x55 || buf[1] != 0x55)
-		/* Try to re-synchronize on a packet start. */
-		return buf + 1;
+	struct sr_dev_inst *sdi;
 
-	if (len < 5 + buf[3])
-		/* Need more data. */
-		return NULL;
+	(void)len;
 
-	if (!appa_55ii_checksum(buf))
-		/* Skip broken packet. */
-		return buf + 4 + buf[3] + 1;
+	sdi = cb_data;
 
 	switch ((packet_type)buf[2]) {
 	case LIVE_DATA:
@@ -256,47 +260,24 @@ static const uint8_t *appa_55ii_parse_data(struct sr_dev_inst *sdi,
 		sr_warn("Invalid packet type: 0x%02x.", buf[2]);
 		break;
 	}
-
-	return buf + 4 + buf[3] + 1;
 }
 
 SR_PRIV int appa_55ii_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct sr_serial_dev_inst *serial;
 	int64_t time;
-	const uint8_t *ptr, *next_ptr, *end_ptr;
-	int len;
+	int ret;
 
 	(void)fd;
 
 	if (!(sdi = cb_data) || !(devc = sdi->priv) || revents != G_IO_IN)
 		return TRUE;
-	serial = sdi->conn;
-
-	/* Try to get as much data as the buffer can hold. */
-	len = sizeof(devc->buf) - devc->buf_len;
-	len = serial_read(serial, devc->buf + devc->buf_len, len);
-	if (len < 1) {
-		sr_err("Serial port read error: %d.", len);
-		return FALSE;
-	}
-	devc->buf_len += len;
-
-	/* Now look for packets in that data. */
-	ptr = devc->buf;
-	end_ptr = ptr + devc->buf_len;
-	while ((next_ptr = appa_55ii_parse_data(sdi, ptr, end_ptr - ptr)))
-		ptr = next_ptr;
-
-	/* If we have any data left, move it to the beginning of our buffer. */
-	memmove(devc->buf, ptr, end_ptr - ptr);
-	devc->buf_len -= ptr - devc->buf;
 
-	/* If buffer is full and no valid packet was found, wipe buffer. */
-	if (devc->buf_len >= sizeof(devc->buf)) {
-		devc->buf_len = 0;
+	ret = serial_receive(sdi->conn, &appa_55ii_packet,
+			appa_55ii_handle_packet, sdi);
+	if (ret < 0) {
+		sr_err("Serial port read error: %d.", ret);
 		return FALSE;
 	}
 
@@ -49,8 +49,6 @@ struct dev_context {
 	int64_t start_time;       /**< The time at which sampling started. */
 
 	/* Temporary state across callbacks */
-	uint8_t buf[APPA_55II_BUF_SIZE];
-	unsigned int buf_len;
 	uint8_t log_buf[64];
 	unsigned int log_buf_len;
 	unsigned int num_log_records;
@@ -99,6 +99,10 @@ static const char *firmware_files[] = {
 	"asix-sigma-phasor.fw",	/* Frequency counter */
 };
 
+/* Bitbang streams for the above, see bitbang_get(). */
+static GBytes *bitbang_cache[ARRAY_SIZE(firmware_files)];
+G_LOCK_DEFINE_STATIC(bitbang_cache);
+
 static int sigma_read(void *buf, size_t size, struct dev_context *devc)
 {
 	int ret;
@@ -208,13 +212,22 @@ static int sigma_read_pos(uint32_t *stoppos, uint32_t *triggerpos,
 	return 1;
 }
 
-static int sigma_read_dram(uint16_t startchunk, size_t numchunks,
-			   uint8_t *data, struct dev_context *devc)
+/*
+ * Send the command to read numchunks DRAM chunks starting at startchunk.
+ * The FPGA alternates between its two block caches, so it copies the next
+ * chunk from DRAM while the current one is being transferred. The data has
+ * to be read with sigma_read_dram() before any other register access.
+ */
+static int sigma_request_dram(uint16_t startchunk, size_t numchunks,
+			      struct dev_context *devc)
 {
 	size_t i;
-	uint8_t buf[4096];
+	uint8_t buf[2 + 3 * CHUNKS_PER_READ];
 	int idx = 0;
 
+	if (numchunks == 0 || numchunks > CHUNKS_PER_READ)
+		return SR_ERR_ARG;
+
 	/* Send the startchunk. Index start with 1. */
 	buf[0] = startchunk >> 8;
 	buf[1] = startchunk & 0xff;
@@ -235,9 +248,39 @@ static int sigma_read_dram(uint16_t startchunk, size_t numchunks,
 			buf[idx++] = REG_DRAM_WAIT_ACK;
 	}
 
-	sigma_write(buf, idx, devc);
+	if (sigma_write(buf, idx, devc) != idx)
+		return SR_ERR;
 
-	return sigma_read(data, numchunks * CHUNK_SIZE, devc);
+	return SR_OK;
+}
+
+/* Read numchunks chunks previously requested with sigma_request_dram(). */
+static int sigma_read_dram(size_t numchunks, uint8_t *data,
+			   struct dev_context *devc)
+{
+	size_t size, got;
+	int ret, retries;
+
+	size = numchunks * CHUNK_SIZE;
+	got = 0;
+	retries = 0;
+
+	/* The FTDI may return short reads while the FPGA waits for DRAM. */
+	while (got < size) {
+		if ((ret = sigma_read(data + got, size - got, devc)) < 0)
+			return SR_ERR;
+		if (ret == 0) {
+			if (++retries > 100) {
+				sr_err("Timeout reading DRAM chunks.");
+				return SR_ERR;
+			}
+			continue;
+		}
+		retries = 0;
+		got += ret;
+	}
+
+	return SR_OK;
 }
 
 /* Upload trigger look-up tables to Sigma. */
@@ -300,84 +343,57 @@ static int sigma_write_trigger_lut(struct triggerlut *lut, struct dev_context *d
 }
 
 /* Generate the bitbang stream for programming the FPGA. */
-static int bin2bitbang(const char *filename,
-		       unsigned char **buf, size_t *buf_size)
+static GBytes *bin2bitbang(const char *filename)
 {
-	FILE *f;
-	unsigned long file_size;
-	unsigned long offset = 0;
-	unsigned char *p;
-	uint8_t *firmware;
-	unsigned long fwsize = 0;
-	const int buffer_size = 65536;
-	size_t i;
-	int c, bit, v;
+	GBytes *fw;
+	const uint8_t *firmware;
+	uint8_t *buf, *p, c;
+	gsize fwsize, buf_size, i;
+	int bit, v;
 	uint32_t imm = 0x3f6df2ab;
 
-	f = g_fopen(filename, "rb");
-	if (!f) {
-		sr_err("g_fopen(\"%s\", \"rb\")", filename);
-		return SR_ERR;
-	}
-
-	if (-1 == fseek(f, 0, SEEK_END)) {
-		sr_err("fseek on %s failed", filename);
-		fclose(f);
-		return SR_ERR;
-	}
-
-	file_size = ftell(f);
-
-	fseek(f, 0, SEEK_SET);
-
-	if (!(firmware = g_try_malloc(buffer_size))) {
-		sr_err("%s: firmware malloc failed", __func__);
-		fclose(f);
-		return SR_ERR_MALLOC;
-	}
-
-	while ((c = getc(f)) != EOF) {
-		imm = (imm + 0xa853753) % 177 + (imm * 0x8034052);
-		firmware[fwsize++] = c ^ imm;
-	}
-	fclose(f);
-
-	if(fwsize != file_size) {
-	    sr_err("%s: Error reading firmware", filename);
-	    fclose(f);
-	    g_free(firmware);
-	    return SR_ERR;
-	}
-
-	*buf_size = fwsize * 2 * 8;
+	if (!(fw = sr_firmware_get(filename)))
+		return NULL;
+	firmware = g_bytes_get_data(fw, &fwsize);
 
-	*buf = p = (unsigned char *)g_try_malloc(*buf_size);
-	if (!p) {
+	buf_size = fwsize * 2 * 8;
+	if (!(buf = p = g_try_malloc(buf_size))) {
 		sr_err("%s: buf/p malloc failed", __func__);
-		g_free(firmware);
-		return SR_ERR_MALLOC;
+		g_bytes_unref(fw);
+		return NULL;
 	}
 
 	for (i = 0; i < fwsize; ++i) {
+		imm = (imm + 0xa853753) % 177 + (imm * 0x8034052);
+		c = firmware[i] ^ imm;
 		for (bit = 7; bit >= 0; --bit) {
-			v = firmware[i] & 1 << bit ? 0x40 : 0x00;
-			p[offset++] = v | 0x01;
-			p[offset++] = v;
+			v = c & 1 << bit ? 0x40 : 0x00;
+			*p++ = v | 0x01;
+			*p++ = v;
 		}
 	}
+	g_bytes_unref(fw);
 
-	g_free(firmware);
+	return g_bytes_new_take(buf, buf_size);
+}
 
-	if (offset != *buf_size) {
-		g_free(*buf);
-		sr_err("Error reading firmware %s "
-		       "offset=%ld, file_size=%ld, buf_size=%zd.",
-		       filename, offset, file_size, *buf_size);
+/* The bitbang stream for a firmware file, generated only once. */
+static GBytes *bitbang_get(int firmware_idx)
+{
+	char firmware_path[128];
+	GBytes *bitbang;
 
-		return SR_ERR;
+	G_LOCK(bitbang_cache);
+	if (!bitbang_cache[firmware_idx]) {
+		snprintf(firmware_path, sizeof(firmware_path), "%s/%s",
+			 FIRMWARE_DIR, firmware_files[firmware_idx]);
+		bitbang_cache[firmware_idx] = bin2bitbang(firmware_path);
 	}
+	if ((bitbang = bitbang_cache[firmware_idx]))
+		g_bytes_ref(bitbang);
+	G_UNLOCK(bitbang_cache);
 
-	return SR_OK;
+	return bitbang;
 }
 
 static void clear_helper(void *priv)
@@ -452,6 +468,8 @@ static GSList *scan(GSList *options)
 	devc->cur_firmware = -1;
 	devc->num_probes = 0;
 	devc->samples_per_event = 0;
+	devc->samples = NULL;
+	devc->num_samples = 0;
 	devc->capture_ratio = 50;
 	devc->use_triggers = 0;
 
@@ -493,11 +511,11 @@ static GSList *dev_list(void)
 static int upload_firmware(int firmware_idx, struct dev_context *devc)
 {
 	int ret;
-	unsigned char *buf;
+	GBytes *bitbang;
+	const void *buf;
 	unsigned char pins;
-	size_t buf_size;
+	gsize buf_size;
 	unsigned char result[32];
-	char firmware_path[128];
 
 	/* Make sure it's an ASIX SIGMA. */
 	if ((ret = ftdi_usb_open_desc(&devc->ftdic,
@@ -539,20 +557,18 @@ static int upload_firmware(int firmware_idx, struct dev_context *devc)
 	}
 
 	/* Prepare firmware. */
-	snprintf(firmware_path, sizeof(firmware_path), "%s/%s", FIRMWARE_DIR,
-		 firmware_files[firmware_idx]);
-
-	if ((ret = bin2bitbang(firmware_path, &buf, &buf_size)) != SR_OK) {
+	if (!(bitbang = bitbang_get(firmware_idx))) {
 		sr_err("An error occured while reading the firmware: %s",
-		       firmware_path);
-		return ret;
+		       firmware_files[firmware_idx]);
+		return SR_ERR;
 	}
+	buf = g_bytes_get_data(bitbang, &buf_size);
 
 	/* Upload firmare. */
 	sr_info("Uploading firmware file '%s'.", firmware_files[firmware_idx]);
-	sigma_write(buf, buf_size, devc);
+	sigma_write((void *)buf, buf_size, devc);
 
-	g_free(buf);
+	g_bytes_unref(bitbang);
 
 	if ((ret = ftdi_set_bitmode(&devc->ftdic, 0x00, BITMODE_RESET)) < 0) {
 		sr_err("ftdi_set_bitmode failed: %s",
@@ -606,6 +622,37 @@ static int dev_open(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/*
+ * Build the lookup table used to demultiplex events into samples. In
+ * 100 and 200 MHz mode, bit (probe * samples_per_event + sample) of an
+ * event holds the given sample of that probe.
+ */
+static void build_sample_lut(struct dev_context *devc)
+{
+	int k, byte, value, bit, event_bit, probe;
+	uint16_t sample;
+
+	memset(devc->sample_lut, 0, sizeof(devc->sample_lut));
+
+	for (k = 0; k < devc->samples_per_event; ++k) {
+		for (byte = 0; byte < 2; ++byte) {
+			for (value = 0; value < 256; ++value) {
+				sample = 0;
+				for (bit = 0; bit < 8; ++bit) {
+					event_bit = byte * 8 + bit;
+					if (event_bit % devc->samples_per_event != k)
+						continue;
+					probe = event_bit / devc->samples_per_event;
+					if (probe < devc->num_probes &&
+					    (value & (1 << bit)))
+						sample |= 1 << probe;
+				}
+				devc->sample_lut[k][byte][value] = sample;
+			}
+		}
+	}
+}
+
 static int set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate)
 {
 	struct dev_context *devc;
@@ -639,6 +686,7 @@ static int set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate)
 	devc->period_ps = 1000000000000ULL / samplerate;
 	devc->samples_per_event = 16 / devc->num_probes;
 	devc->state.state = SIGMA_IDLE;
+	build_sample_lut(devc);
 
 	return ret;
 }
@@ -741,6 +789,16 @@ static int dev_close(struct sr_dev_inst *sdi)
 
 static int cleanup(void)
 {
+	unsigned int i;
+
+	G_LOCK(bitbang_cache);
+	for (i = 0; i < ARRAY_SIZE(bitbang_cache); i++) {
+		if (bitbang_cache[i])
+			g_bytes_unref(bitbang_cache[i]);
+		bitbang_cache[i] = NULL;
+	}
+	G_UNLOCK(bitbang_cache);
+
 	return dev_clear();
 }
 
@@ -832,12 +890,12 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 }
 
 /* Software trigger to determine exact trigger position. */
-static int get_trigger_offset(uint16_t *samples, uint16_t last_sample,
-			      struct sigma_trigger *t)
+static int get_trigger_offset(uint16_t *samples, int num_samples,
+			      uint16_t last_sample, struct sigma_trigger *t)
 {
 	int i;
 
-	for (i = 0; i < 8; ++i) {
+	for (i = 0; i < MIN(num_samples, 8); ++i) {
 		if (i > 0)
 			last_sample = samples[i-1];
 
@@ -862,6 +920,63 @@ static int get_trigger_offset(uint16_t *samples, uint16_t last_sample,
 	return i & 0x7;
 }
 
+/* Send the samples collected so far to the session bus. */
+static void flush_samples(struct dev_context *devc)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	if (devc->num_samples == 0)
+		return;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = devc->num_samples * sizeof(uint16_t);
+	logic.unitsize = 2;
+	logic.data = devc->samples;
+	sr_session_send(devc->cb_data, &packet);
+
+	devc->num_samples = 0;
+}
+
+/* Send a run of identical samples as a single RLE packet. */
+static void send_run(struct dev_context *devc, uint16_t value, uint64_t length)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
+
+	flush_samples(devc);
+
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	rle.num_runs = 1;
+	rle.unitsize = 2;
+	rle.values = &value;
+	rle.lengths = &length;
+	sr_session_send(devc->cb_data, &packet);
+}
+
+/* Append a run of identical samples to the sample buffer. */
+static void fill_samples(struct dev_context *devc, uint16_t value, size_t count)
+{
+	uint16_t *dst;
+	size_t done, len;
+
+	if (count == 0)
+		return;
+
+	if (devc->num_samples + count > SAMPLE_BUF_SIZE)
+		flush_samples(devc);
+
+	dst = devc->samples + devc->num_samples;
+	dst[0] = value;
+	for (done = 1; done < count; done += len) {
+		len = MIN(done, count - done);
+		memcpy(dst + done, dst, len * sizeof(uint16_t));
+	}
+	devc->num_samples += count;
+}
+
 /*
  * Decode chunk of 1024 bytes, 64 clusters, 7 events per cluster.
  * Each event is 20ns apart, and can contain multiple samples.
@@ -870,6 +985,10 @@ static int get_trigger_offset(uint16_t *samples, uint16_t last_sample,
  * For 100 MHz, events contain 2 samples for each channel, spread 10 ns apart.
  * For 50 MHz and below, events contain one sample for each channel,
  * spread 20 ns apart.
+ *
+ * Samples are collected in devc->samples and sent in large packets. Gaps
+ * between clusters repeat the last sample; long gaps are sent as a single
+ * RLE run instead of being expanded.
  */
 static int decode_chunk_ts(uint8_t *buf, uint16_t *lastts,
 			   uint16_t *lastsample, int triggerpos,
@@ -878,14 +997,10 @@ static int decode_chunk_ts(uint8_t *buf, uint16_t *lastts,
 	struct sr_dev_inst *sdi = cb_data;
 	struct dev_context *devc = sdi->priv;
 	uint16_t tsdiff, ts;
-	uint16_t samples[65536 * devc->samples_per_event];
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	int i, j, k, l, numpad, tosend;
-	size_t n = 0, sent = 0;
+	int i, j, k, numpad, tosend;
 	int clustersize = EVENTS_PER_CLUSTER * devc->samples_per_event;
-	uint16_t *event;
-	uint16_t cur_sample;
+	uint16_t *event, *cluster, last;
 	int triggerts = -1;
 
 	/* Check if trigger is in this chunk. */
@@ -901,7 +1016,7 @@ static int decode_chunk_ts(uint8_t *buf, uint16_t *lastts,
 	}
 
 	/* For each ts. */
-	for (i = 0; i < 64; ++i) {
+	for (i = 0; i < CLUSTERS_PER_CHUNK; ++i) {
 		ts = *(uint16_t *) &buf[i * 16];
 		tsdiff = ts - *lastts;
 		*lastts = ts;
@@ -912,50 +1027,27 @@ static int decode_chunk_ts(uint8_t *buf, uint16_t *lastts,
 
 		/* Pad last sample up to current point. */
 		numpad = tsdiff * devc->samples_per_event - clustersize;
-		if (numpad > 0) {
-			for (j = 0; j < numpad; ++j)
-				samples[j] = *lastsample;
+		if (numpad >= MIN_RUN_LENGTH)
+			send_run(devc, *lastsample, numpad);
+		else if (numpad > 0)
+			fill_samples(devc, *lastsample, numpad);
 
-			n = numpad;
-		}
-
-		/* Send samples between previous and this timestamp to sigrok. */
-		sent = 0;
-		while (sent < n) {
-			tosend = MIN(2048, n - sent);
-
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = tosend * sizeof(uint16_t);
-			logic.unitsize = 2;
-			logic.data = samples + sent;
-			sr_session_send(devc->cb_data, &packet);
-
-			sent += tosend;
-		}
-		n = 0;
+		if (devc->num_samples + clustersize > SAMPLE_BUF_SIZE)
+			flush_samples(devc);
 
 		event = (uint16_t *) &buf[i * 16 + 2];
-		cur_sample = 0;
-
-		/* For each event in cluster. */
-		for (j = 0; j < 7; ++j) {
+		cluster = devc->samples + devc->num_samples;
 
-			/* For each sample in event. */
-			for (k = 0; k < devc->samples_per_event; ++k) {
-				cur_sample = 0;
-
-				/* For each probe. */
-				for (l = 0; l < devc->num_probes; ++l)
-					cur_sample |= (!!(event[j] & (1 << (l *
-					   devc->samples_per_event + k)))) << l;
-
-				samples[n++] = cur_sample;
-			}
+		/* For each event in cluster, for each sample in event. */
+		for (j = 0; j < EVENTS_PER_CLUSTER; ++j) {
+			for (k = 0; k < devc->samples_per_event; ++k)
+				*cluster++ = devc->sample_lut[k][0][event[j] & 0xff] |
+					devc->sample_lut[k][1][event[j] >> 8];
 		}
+		cluster = devc->samples + devc->num_samples;
+		last = cluster[clustersize - 1];
 
 		/* Send data up to trigger point (if triggered). */
-		sent = 0;
 		if (i == triggerts) {
 			/*
 			 * Trigger is not always accurate to sample because of
@@ -963,133 +1055,190 @@ static int decode_chunk_ts(uint8_t *buf, uint16_t *lastts,
 			 * the actual event. We therefore look at the next
 			 * samples to pinpoint the exact position of the trigger.
 			 */
-			tosend = get_trigger_offset(samples, *lastsample,
-						    &devc->trigger);
-
-			if (tosend > 0) {
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				logic.length = tosend * sizeof(uint16_t);
-				logic.unitsize = 2;
-				logic.data = samples;
-				sr_session_send(devc->cb_data, &packet);
+			tosend = get_trigger_offset(cluster, clustersize,
+						    *lastsample, &devc->trigger);
 
-				sent += tosend;
-			}
+			devc->num_samples += tosend;
+			flush_samples(devc);
+			memmove(devc->samples, cluster + tosend,
+				(clustersize - tosend) * sizeof(uint16_t));
+			devc->num_samples = clustersize - tosend;
 
 			/* Only send trigger if explicitly enabled. */
 			if (devc->use_triggers) {
 				packet.type = SR_DF_TRIGGER;
+				packet.payload = NULL;
 				sr_session_send(devc->cb_data, &packet);
 			}
+		} else {
+			devc->num_samples += clustersize;
 		}
 
-		/* Send rest of the chunk to sigrok. */
-		tosend = n - sent;
+		*lastsample = last;
+	}
 
-		if (tosend > 0) {
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = tosend * sizeof(uint16_t);
-			logic.unitsize = 2;
-			logic.data = samples + sent;
-			sr_session_send(devc->cb_data, &packet);
-		}
+	return SR_OK;
+}
+
+/* All of the capture was sent, or the download failed. */
+static void download_capture_end(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc = sdi->priv;
+	struct sr_datafeed_packet packet;
+
+	if (devc->samples)
+		flush_samples(devc);
+	g_free(devc->samples);
+	devc->samples = NULL;
+	g_free(devc->dl_buf);
+	devc->dl_buf = NULL;
 
-		*lastsample = samples[n - 1];
+	/* End of samples. */
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	sr_session_send(devc->cb_data, &packet);
+
+	sr_source_remove(0);
+	devc->state.state = SIGMA_IDLE;
+}
+
+/*
+ * Set up downloading the capture from DRAM, and send the read command for
+ * the first batch of chunks. The download itself is driven by
+ * receive_data(), one batch per call, so the session keeps running
+ * between batches.
+ */
+static int download_capture_start(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc = sdi->priv;
+
+	devc->state.state = SIGMA_DOWNLOAD;
+	devc->dl_numchunks = (devc->state.stoppos + 511) / 512;
+	devc->dl_pending = 0;
+
+	if (!(devc->dl_buf = g_try_malloc(CHUNKS_PER_READ * CHUNK_SIZE))) {
+		sr_err("Download buffer malloc failed.");
+		download_capture_end(sdi);
+		return SR_ERR_MALLOC;
 	}
+	if (!(devc->samples = g_try_malloc(SAMPLE_BUF_SIZE * sizeof(uint16_t)))) {
+		sr_err("Sample buffer malloc failed.");
+		download_capture_end(sdi);
+		return SR_ERR_MALLOC;
+	}
+	devc->num_samples = 0;
+
+	devc->dl_pending = MIN(CHUNKS_PER_READ, devc->dl_numchunks);
+	if (devc->dl_pending > 0 &&
+	    sigma_request_dram(0, devc->dl_pending, devc) != SR_OK)
+		devc->dl_pending = 0;
+
+	if (devc->dl_pending == 0)
+		download_capture_end(sdi);
 
 	return SR_OK;
 }
 
-static int receive_data(int fd, int revents, void *cb_data)
+/*
+ * Read and decode the batch of chunks requested last. The read blocks
+ * until the whole batch has arrived. The command for the next batch is
+ * sent before decoding; its data is read by the next call.
+ */
+static void download_capture_step(struct sr_dev_inst *sdi)
 {
-	struct sr_dev_inst *sdi = cb_data;
 	struct dev_context *devc = sdi->priv;
-	struct sr_datafeed_packet packet;
-	const int chunks_per_read = 32;
-	unsigned char buf[chunks_per_read * CHUNK_SIZE];
-	int bufsz, numchunks, i, newchunks;
-	uint64_t running_msec;
-	struct timeval tv;
+	uint8_t *buf;
+	int numchunks, newchunks, nextchunks, i, limit_chunk;
 
-	(void)fd;
-	(void)revents;
+	buf = devc->dl_buf;
+	numchunks = devc->dl_numchunks;
+	newchunks = devc->dl_pending;
 
-	/* Get the current position. */
-	sigma_read_pos(&devc->state.stoppos, &devc->state.triggerpos, devc);
+	sr_info("Downloading sample data: %.0f %%.",
+		100.0 * devc->state.chunks_downloaded / numchunks);
 
-	numchunks = (devc->state.stoppos + 511) / 512;
+	if (sigma_read_dram(newchunks, buf, devc) != SR_OK) {
+		download_capture_end(sdi);
+		return;
+	}
 
-	if (devc->state.state == SIGMA_IDLE)
-		return TRUE;
+	/* Request the next batch, it is read on the next call. */
+	nextchunks = MIN(CHUNKS_PER_READ, numchunks -
+			 devc->state.chunks_downloaded - newchunks);
+	if (nextchunks > 0 &&
+	    sigma_request_dram(devc->state.chunks_downloaded + newchunks,
+			       nextchunks, devc) != SR_OK)
+		nextchunks = 0;
+
+	/* Find first ts. */
+	if (devc->state.chunks_downloaded == 0) {
+		devc->state.lastts = RL16(buf) - 1;
+		devc->state.lastsample = 0;
+	}
 
-	if (devc->state.state == SIGMA_CAPTURE) {
-		/* Check if the timer has expired, or memory is full. */
-		gettimeofday(&tv, 0);
-		running_msec = (tv.tv_sec - devc->start_tv.tv_sec) * 1000 +
-			(tv.tv_usec - devc->start_tv.tv_usec) / 1000;
+	/* Decode chunks and send them to sigrok. */
+	for (i = 0; i < newchunks; ++i) {
+		limit_chunk = 0;
 
-		if (running_msec < devc->limit_msec && numchunks < 32767)
-			return TRUE; /* While capturing... */
+		/* The last chunk may potentially be only in part. */
+		if (devc->state.chunks_downloaded == numchunks - 1) {
+			/* Find the last valid timestamp */
+			limit_chunk = devc->state.stoppos % 512 + devc->state.lastts;
+		}
+
+		if (devc->state.chunks_downloaded == devc->state.triggerchunk)
+			decode_chunk_ts(buf + (i * CHUNK_SIZE),
+					&devc->state.lastts,
+					&devc->state.lastsample,
+					devc->state.triggerpos & 0x1ff,
+					limit_chunk, sdi);
 		else
-			dev_acquisition_stop(sdi, sdi);
+			decode_chunk_ts(buf + (i * CHUNK_SIZE),
+					&devc->state.lastts,
+					&devc->state.lastsample,
+					-1, limit_chunk, sdi);
 
+		++devc->state.chunks_downloaded;
 	}
 
-	if (devc->state.state == SIGMA_DOWNLOAD) {
-		if (devc->state.chunks_downloaded >= numchunks) {
-			/* End of samples. */
-			packet.type = SR_DF_END;
-			sr_session_send(devc->cb_data, &packet);
+	devc->dl_pending = nextchunks;
+	if (devc->dl_pending == 0)
+		download_capture_end(sdi);
+}
 
-			devc->state.state = SIGMA_IDLE;
+static int receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi = cb_data;
+	struct dev_context *devc = sdi->priv;
+	int numchunks;
+	uint64_t running_msec;
+	struct timeval tv;
 
-			return TRUE;
-		}
+	(void)fd;
+	(void)revents;
 
-		newchunks = MIN(chunks_per_read,
-				numchunks - devc->state.chunks_downloaded);
+	if (devc->state.state == SIGMA_DOWNLOAD) {
+		download_capture_step(sdi);
+		return TRUE;
+	}
 
-		sr_info("Downloading sample data: %.0f %%.",
-			100.0 * devc->state.chunks_downloaded / numchunks);
+	if (devc->state.state != SIGMA_CAPTURE)
+		return TRUE;
 
-		bufsz = sigma_read_dram(devc->state.chunks_downloaded,
-					newchunks, buf, devc);
-		/* TODO: Check bufsz. For now, just avoid compiler warnings. */
-		(void)bufsz;
+	/* Get the current position. */
+	sigma_read_pos(&devc->state.stoppos, &devc->state.triggerpos, devc);
 
-		/* Find first ts. */
-		if (devc->state.chunks_downloaded == 0) {
-			devc->state.lastts = RL16(buf) - 1;
-			devc->state.lastsample = 0;
-		}
+	numchunks = (devc->state.stoppos + 511) / 512;
 
-		/* Decode chunks and send them to sigrok. */
-		for (i = 0; i < newchunks; ++i) {
-			int limit_chunk = 0;
+	/* Check if the timer has expired, or memory is full. */
+	gettimeofday(&tv, 0);
+	running_msec = (tv.tv_sec - devc->start_tv.tv_sec) * 1000 +
+		(tv.tv_usec - devc->start_tv.tv_usec) / 1000;
 
-			/* The last chunk may potentially be only in part. */
-			if (devc->state.chunks_downloaded == numchunks - 1) {
-				/* Find the last valid timestamp */
-				limit_chunk = devc->state.stoppos % 512 + devc->state.lastts;
-			}
+	if (running_msec < devc->limit_msec && numchunks < 32767)
+		return TRUE; /* While capturing... */
 
-			if (devc->state.chunks_downloaded + i == devc->state.triggerchunk)
-				decode_chunk_ts(buf + (i * CHUNK_SIZE),
-						&devc->state.lastts,
-						&devc->state.lastsample,
-						devc->state.triggerpos & 0x1ff,
-						limit_chunk, sdi);
-			else
-				decode_chunk_ts(buf + (i * CHUNK_SIZE),
-						&devc->state.lastts,
-						&devc->state.lastsample,
-						-1, limit_chunk, sdi);
-
-			++devc->state.chunks_downloaded;
-		}
-	}
+	dev_acquisition_stop(sdi, sdi);
 
 	return TRUE;
 }
@@ -1368,13 +1517,15 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 
 	(void)cb_data;
 
-	sr_source_remove(0);
-
 	if (!(devc = sdi->priv)) {
 		sr_err("%s: sdi->priv was NULL", __func__);
 		return SR_ERR_BUG;
 	}
 
+	/* A download in progress ends by itself. */
+	if (devc->state.state != SIGMA_CAPTURE)
+		return SR_OK;
+
 	/* Stop acquisition. */
 	sigma_set_register(WRITE_MODE, 0x11, devc);
 
@@ -1393,9 +1544,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 
 	devc->state.chunks_downloaded = 0;
 
-	devc->state.state = SIGMA_DOWNLOAD;
-
-	return SR_OK;
+	/* The capture source stays, to drive the download. */
+	return download_capture_start(sdi);
 }
 
 SR_PRIV struct sr_dev_driver asix_sigma_driver_info = {
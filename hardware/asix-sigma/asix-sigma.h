@@ -73,9 +73,19 @@ enum sigma_read_register {
 #define NEXT_REG		1
 
 #define EVENTS_PER_CLUSTER	7
+#define CLUSTERS_PER_CHUNK	64
 
 #define CHUNK_SIZE		1024
 
+/* Number of DRAM chunks fetched per FTDI transfer. */
+#define CHUNKS_PER_READ		256
+
+/* Size (in samples) of the buffer decoded samples are collected in. */
+#define SAMPLE_BUF_SIZE		(32 * 1024)
+
+/* Gaps of at least this many samples are sent as a single RLE run. */
+#define MIN_RUN_LENGTH		256
+
 struct clockselect_50 {
 	uint8_t async;
 	uint8_t fraction;
@@ -189,6 +199,14 @@ struct dev_context {
 	struct sigma_trigger trigger;
 	int use_triggers;
 	struct sigma_state state;
+	/* Event bit to sample lookup, indexed by [sample][byte][value]. */
+	uint16_t sample_lut[4][2][256];
+	uint16_t *samples;
+	size_t num_samples;
+	/* Capture download: buffer, total and requested number of chunks. */
+	uint8_t *dl_buf;
+	int dl_numchunks;
+	int dl_pending;
 	void *cb_data;
 };
 
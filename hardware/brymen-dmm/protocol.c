@@ -34,6 +34,7 @@ static void handle_packet(const uint8_t *buf, struct sr_dev_inst *sdi)
 
 	analog.num_samples = 1;
 	analog.mq = -1;
+	analog.timestamps = NULL;
 
 	sr_brymen_parse(buf, &floatval, &analog, NULL);
 	analog.data = &floatval;
@@ -158,43 +158,42 @@ static int handle_packet(const uint8_t *buf, struct sr_dev_inst *sdi, int idx)
 	return SR_OK;
 }
 
+struct packet_context {
+	struct sr_dev_inst *sdi;
+	int idx;
+};
+
+static void packet_handler(const uint8_t *buf, size_t len, void *cb_data)
+{
+	struct packet_context *ctx;
+
+	(void)len;
+
+	ctx = cb_data;
+	handle_packet(buf, ctx->sdi, ctx->idx);
+}
+
 /* Return TRUE if a full packet was parsed, FALSE otherwise. */
 static gboolean handle_new_data(struct sr_dev_inst *sdi, int idx)
 {
-	struct dev_context *devc;
-	struct sr_serial_dev_inst *serial;
-	int len, i, offset = 0, ret = FALSE;
+	struct packet_context ctx;
+	struct serial_packet_desc desc = {
+		.packet_size = center_devs[idx].packet_size,
+		.length_offset = -1,
+		.terminator = -1,
+		.is_valid = center_devs[idx].packet_valid,
+	};
+	int ret;
 
-	devc = sdi->priv;
-	serial = sdi->conn;
+	ctx.sdi = sdi;
+	ctx.idx = idx;
 
-	/* Try to get as much data as the buffer can hold. */
-	len = SERIAL_BUFSIZE - devc->buflen;
-	len = serial_read(serial, devc->buf + devc->buflen, len);
-	if (len < 1) {
-		sr_err("Serial port read error: %d.", len);
+	if ((ret = serial_receive(sdi->conn, &desc, packet_handler, &ctx)) < 0) {
+		sr_err("Serial port read error: %d.", ret);
 		return FALSE;
 	}
 
-	devc->buflen += len;
-
-	/* Now look for packets in that data. */
-	while ((devc->buflen - offset) >= center_devs[idx].packet_size) {
-		if (center_devs[idx].packet_valid(devc->buf + offset)) {
-			handle_packet(devc->buf + offset, sdi, idx);
-			offset += center_devs[idx].packet_size;
-			ret = TRUE;
-		} else {
-			offset++;
-		}
-	}
-
-	/* If we have any data left, move it to the beginning of our buffer. */
-	for (i = 0; i < devc->buflen - offset; i++)
-		devc->buf[i] = devc->buf[offset + i];
-	devc->buflen -= offset;
-
-	return ret;
+	return ret > 0;
 }
 
 static int receive_data(int fd, int revents, int idx, void *cb_data)
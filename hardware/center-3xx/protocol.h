@@ -53,8 +53,6 @@ struct center_dev_info {
 
 extern SR_PRIV const struct center_dev_info center_devs[CENTER_DEV_COUNT];
 
-#define SERIAL_BUFSIZE 256
-
 /** Private, per-device-instance driver context. */
 struct dev_context {
 	/** The current sampling limit (in number of samples). */
@@ -70,10 +68,6 @@ struct dev_context {
 	uint64_t num_samples;
 
 	int64_t starttime;
-
-	uint8_t buf[SERIAL_BUFSIZE];
-	int bufoffset;
-	int buflen;
 };
 
 SR_PRIV gboolean center_3xx_packet_valid(const uint8_t *buf);
@@ -545,40 +545,27 @@ static void handle_flags(struct sr_datafeed_analog *analog,
 		sr_spew("Low-pass filter feature is active.");
 }
 
+/*
+ * The flags are all 0 or 1, so the checks below just add them up instead
+ * of branching on each. This doesn't log, as it also runs while the
+ * receive path resyncs.
+ */
 static gboolean flags_valid(const struct es519xx_info *info)
 {
-	int count;
+	int multipliers, types;
 
 	/* Does the packet have more than one multiplier? */
-	count  = (info->is_micro) ? 1 : 0;
-	count += (info->is_milli) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one multiplier detected in packet.");
-		return FALSE;
-	}
+	multipliers = info->is_micro + info->is_milli;
 
 	/* Does the packet "measure" more than one type of value? */
-	count  = (info->is_voltage) ? 1 : 0;
-	count += (info->is_current) ? 1 : 0;
-	count += (info->is_resistance) ? 1 : 0;
-	count += (info->is_frequency) ? 1 : 0;
-	count += (info->is_capacitance) ? 1 : 0;
-	count += (info->is_temperature) ? 1 : 0;
-	count += (info->is_continuity) ? 1 : 0;
-	count += (info->is_diode) ? 1 : 0;
-	count += (info->is_rpm) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one measurement type detected in packet.");
-		return FALSE;
-	}
+	types = info->is_voltage + info->is_current + info->is_resistance
+		+ info->is_frequency + info->is_capacitance
+		+ info->is_temperature + info->is_continuity
+		+ info->is_diode + info->is_rpm;
 
 	/* Both AC and DC set? */
-	if (info->is_ac && info->is_dc) {
-		sr_err("Both AC and DC flags detected in packet.");
-		return FALSE;
-	}
-
-	return TRUE;
+	return (multipliers <= 1) & (types <= 1)
+		& !(info->is_ac & info->is_dc);
 }
 
 static gboolean sr_es519xx_packet_valid(const uint8_t *buf,
@@ -588,10 +575,11 @@ static gboolean sr_es519xx_packet_valid(const uint8_t *buf,
 
 	s = info->packet_size;
 
-	if (s == 11 && memcmp(buf, buf + s, s))
+	/* Check the line ending first, it rules out most offsets. */
+	if ((buf[s - 2] != '\r') | (buf[s - 1] != '\n'))
 		return FALSE;
 
-	if (buf[s - 2] != '\r' || buf[s - 1] != '\n')
+	if (s == 11 && memcmp(buf, buf + s, s))
 		return FALSE;
 
 	parse_flags(buf, info);
@@ -40,98 +40,77 @@
 
 #define LOG_PREFIX "fs9721"
 
-static int parse_digit(uint8_t b)
-{
-	switch (b) {
-	case 0x7d:
-		return 0;
-	case 0x05:
-		return 1;
-	case 0x5b:
-		return 2;
-	case 0x1f:
-		return 3;
-	case 0x27:
-		return 4;
-	case 0x3e:
-		return 5;
-	case 0x7e:
-		return 6;
-	case 0x15:
-		return 7;
-	case 0x7f:
-		return 8;
-	case 0x3f:
-		return 9;
-	default:
-		sr_err("Invalid digit byte: 0x%02x.", b);
-		return -1;
-	}
-}
+/*
+ * Digit value for each 7-segment pattern (bit 7 masked off), -1 for
+ * patterns that aren't a digit. Generated from the patterns
+ * 0x7d (0), 0x05 (1), 0x5b (2), 0x1f (3), 0x27 (4), 0x3e (5), 0x7e (6),
+ * 0x15 (7), 0x7f (8) and 0x3f (9).
+ */
+static const int8_t digit_lut[128] = {
+	/* 0x00 */ -1, -1, -1, -1, -1,  1, -1, -1,
+	/* 0x08 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x10 */ -1, -1, -1, -1, -1,  7, -1, -1,
+	/* 0x18 */ -1, -1, -1, -1, -1, -1, -1,  3,
+	/* 0x20 */ -1, -1, -1, -1, -1, -1, -1,  4,
+	/* 0x28 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x30 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x38 */ -1, -1, -1, -1, -1, -1,  5,  9,
+	/* 0x40 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x48 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x50 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x58 */ -1, -1, -1,  2, -1, -1, -1, -1,
+	/* 0x60 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x68 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x70 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x78 */ -1, -1, -1, -1, -1,  0,  6,  8,
+};
+
+/* Upper nibble of each packet byte: 1 for byte 0, 2 for byte 1, etc. */
+static const uint8_t sync_nibbles[FS9721_PACKET_SIZE] = {
+	0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70,
+	0x80, 0x90, 0xa0, 0xb0, 0xc0, 0xd0, 0xe0,
+};
+
+/*
+ * The validators below run at every byte offset while the receive path
+ * resyncs, so they don't log and don't branch on the packet contents.
+ */
 
 static gboolean sync_nibbles_valid(const uint8_t *buf)
 {
+	uint8_t diff;
 	int i;
 
 	/* Check the synchronization nibbles, and make sure they all match. */
-	for (i = 0; i < FS9721_PACKET_SIZE; i++) {
-		if (((buf[i] >> 4) & 0x0f) != (i + 1)) {
-			sr_err("Sync nibble in byte %d (0x%02x) is invalid.",
-			       i, buf[i]);
-			return FALSE;
-		}
-	}
+	diff = 0;
+	for (i = 0; i < FS9721_PACKET_SIZE; i++)
+		diff |= (buf[i] & 0xf0) ^ sync_nibbles[i];
 
-	return TRUE;
+	return diff == 0;
 }
 
-static gboolean flags_valid(const struct fs9721_info *info)
+static gboolean flags_valid(const uint8_t *buf)
 {
-	int count;
-
-	/* Does the packet have more than one multiplier? */
-	count = 0;
-	count += (info->is_nano) ? 1 : 0;
-	count += (info->is_micro) ? 1 : 0;
-	count += (info->is_milli) ? 1 : 0;
-	count += (info->is_kilo) ? 1 : 0;
-	count += (info->is_mega) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one multiplier detected in packet.");
-		return FALSE;
-	}
+	unsigned int multipliers, types;
 
-	/* Does the packet "measure" more than one type of value? */
-	count = 0;
-	count += (info->is_hz) ? 1 : 0;
-	count += (info->is_ohm) ? 1 : 0;
-	count += (info->is_farad) ? 1 : 0;
-	count += (info->is_ampere) ? 1 : 0;
-	count += (info->is_volt) ? 1 : 0;
-	count += (info->is_percent) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one measurement type detected in packet.");
-		return FALSE;
-	}
+	/* Byte 9: micro, nano, kilo. Byte 10: milli, mega. */
+	multipliers = (buf[9] & 0x0e) | ((buf[10] & 0x0a) << 4);
 
-	/* Both AC and DC set? */
-	if (info->is_ac && info->is_dc) {
-		sr_err("Both AC and DC flags detected in packet.");
-		return FALSE;
-	}
-
-	/* RS232 flag not set? */
-	if (!info->is_rs232) {
-		sr_err("No RS232 flag detected in packet.");
-		return FALSE;
-	}
+	/* Byte 10: percent. Byte 11: farad, ohm. Byte 12: A, V, Hz. */
+	types = ((buf[10] & 0x04) << 8) | (buf[11] & 0x0c)
+		| ((buf[12] & 0x0e) << 4);
 
-	return TRUE;
+	/*
+	 * At most one multiplier, at most one measurement type, not both
+	 * AC and DC (byte 0, bits 3 and 2), and the RS232 flag must be set.
+	 */
+	return ONE_BIT_MAX(multipliers) & ONE_BIT_MAX(types)
+		& ((buf[0] & 0x0c) != 0x0c) & (buf[0] & 0x01);
 }
 
 static int parse_value(const uint8_t *buf, float *result)
 {
-	int i, sign, intval = 0, digits[4];
+	int i, sign, intval = 0, digits[4], invalid;
 	uint8_t digit_bytes[4];
 	float floatval;
 
@@ -162,8 +141,17 @@ static int parse_value(const uint8_t *buf, float *result)
 	}
 
 	/* Parse the digits. */
-	for (i = 0; i < 4; i++)
-		digits[i] = parse_digit(digit_bytes[i]);
+	invalid = 0;
+	for (i = 0; i < 4; i++) {
+		digits[i] = digit_lut[digit_bytes[i]];
+		invalid |= digits[i];
+	}
+	if (invalid < 0) {
+		sr_dbg("Invalid digit bytes: %02x %02x %02x %02x.",
+		       digit_bytes[0], digit_bytes[1], digit_bytes[2],
+		       digit_bytes[3]);
+		return SR_ERR;
+	}
 	sr_spew("Digits: %02x %02x %02x %02x (%d%d%d%d).",
 		digit_bytes[0], digit_bytes[1], digit_bytes[2], digit_bytes[3],
 		digits[0], digits[1], digits[2], digits[3]);
@@ -323,11 +311,7 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 
 SR_PRIV gboolean sr_fs9721_packet_valid(const uint8_t *buf)
 {
-	struct fs9721_info info;
-
-	parse_flags(buf, &info);
-
-	return (sync_nibbles_valid(buf) && flags_valid(&info));
+	return sync_nibbles_valid(buf) & flags_valid(buf);
 }
 
 /**
@@ -31,60 +31,34 @@
 
 #define LOG_PREFIX "fs9922"
 
-static gboolean flags_valid(const struct fs9922_info *info)
+/*
+ * This runs at every byte offset while the receive path resyncs, so it
+ * doesn't log and doesn't branch on the packet contents.
+ */
+static gboolean flags_valid(const uint8_t *buf)
 {
-	int count;
-
-	/* Does the packet have more than one multiplier? */
-	count = 0;
-	count += (info->is_nano) ? 1 : 0;
-	count += (info->is_micro) ? 1 : 0;
-	count += (info->is_milli) ? 1 : 0;
-	count += (info->is_kilo) ? 1 : 0;
-	count += (info->is_mega) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one multiplier detected in packet.");
-		return FALSE;
-	}
+	unsigned int multipliers, types;
+
+	/* Byte 8: nano. Byte 9: micro, milli, kilo, mega. */
+	multipliers = (buf[8] & 0x02) | (buf[9] & 0xf0);
 
 	/*
-	 * Does the packet "measure" more than one type of value?
+	 * Byte 9: percent. Byte 10: V, A, ohm, hFE, Hz, F, C, F.
 	 *
 	 * Note: In "diode mode", both is_diode and is_volt will be set.
-	 * That is a valid use-case, so we don't want to error out below
-	 * if it happens. Thus, we don't check for is_diode here.
+	 * That is a valid use-case, so we don't check for is_diode here.
+	 * Celsius and Fahrenheit are both in here, so they can't both be set.
 	 */
-	count = 0;
-	// count += (info->is_diode) ? 1 : 0;
-	count += (info->is_percent) ? 1 : 0;
-	count += (info->is_volt) ? 1 : 0;
-	count += (info->is_ampere) ? 1 : 0;
-	count += (info->is_ohm) ? 1 : 0;
-	count += (info->is_hfe) ? 1 : 0;
-	count += (info->is_hertz) ? 1 : 0;
-	count += (info->is_farad) ? 1 : 0;
-	count += (info->is_celsius) ? 1 : 0;
-	count += (info->is_fahrenheit) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one measurement type detected in packet.");
-		return FALSE;
-	}
-
-	/* Both AC and DC set? */
-	if (info->is_ac && info->is_dc) {
-		sr_err("Both AC and DC flags detected in packet.");
-		return FALSE;
-	}
-
-	/* Both Celsius and Fahrenheit set? */
-	if (info->is_celsius && info->is_fahrenheit) {
-		sr_err("Both Celsius and Fahrenheit flags detected in packet.");
-		return FALSE;
-	}
+	types = ((buf[9] & 0x02) << 8) | buf[10];
 
-	return TRUE;
+	/* At most one of each, and not both AC and DC (byte 7, bits 4/3). */
+	return ONE_BIT_MAX(multipliers) & ONE_BIT_MAX(types)
+		& ((buf[7] & 0x18) != 0x18);
 }
 
+/* Divisor for decimal point position bytes '0'-'4', 0 for invalid ones. */
+static const int dp_divisors[5] = { 1, 1000, 100, 0, 10 };
+
 static int parse_value(const uint8_t *buf, float *result)
 {
 	int sign, intval;
@@ -132,18 +106,11 @@ static int parse_value(const uint8_t *buf, float *result)
 	 * an error/typo here. They claim that the values '0'/'1'/'2'/'3' are
 	 * used, but '0'/'1'/'2'/'4' is actually correct.
 	 */
-	if (buf[6] != '0' && buf[6] != '1' && buf[6] != '2' && buf[6] != '4') {
+	if (buf[6] < '0' || buf[6] > '4' || !dp_divisors[buf[6] - '0']) {
 		sr_err("Invalid decimal point value: 0x%02x.", buf[6]);
 		return SR_ERR;
 	}
-	if (buf[6] == '0')
-		floatval /= 1;
-	else if (buf[6] == '1')
-		floatval /= 1000;
-	else if (buf[6] == '2')
-		floatval /= 100;
-	else if (buf[6] == '4')
-		floatval /= 10;
+	floatval /= dp_divisors[buf[6] - '0'];
 
 	/* Apply sign. */
 	floatval *= sign;
@@ -319,20 +286,13 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 
 SR_PRIV gboolean sr_fs9922_packet_valid(const uint8_t *buf)
 {
-	struct fs9922_info info;
-
-	/* Byte 0: Sign (must be '+' or '-') */
-	if (buf[0] != '+' && buf[0] != '-')
-		return FALSE;
-
-	/* Byte 12: Always '\r' (carriage return, 0x0d, 13) */
-	/* Byte 13: Always '\n' (newline, 0x0a, 10) */
-	if (buf[12] != '\r' || buf[13] != '\n')
-		return FALSE;
-
-	parse_flags(buf, &info);
-
-	return flags_valid(&info);
+	/*
+	 * Byte 0: Sign (must be '+' or '-')
+	 * Byte 12: Always '\r' (carriage return, 0x0d, 13)
+	 * Byte 13: Always '\n' (newline, 0x0a, 10)
+	 */
+	return ((buf[0] == '+') | (buf[0] == '-')) & (buf[12] == '\r')
+		& (buf[13] == '\n') & flags_valid(buf);
 }
 
 /**
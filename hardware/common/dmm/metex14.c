@@ -207,44 +207,28 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 		analog->mqflags |= SR_MQFLAG_DIODE;
 }
 
+/*
+ * The flags are all 0 or 1, so the checks below just add them up instead
+ * of branching on each. This doesn't log, as it also runs while the
+ * receive path resyncs.
+ */
 static gboolean flags_valid(const struct metex14_info *info)
 {
-	int count;
+	int multipliers, types;
 
 	/* Does the packet have more than one multiplier? */
-	count = 0;
-	count += (info->is_pico) ? 1 : 0;
-	count += (info->is_nano) ? 1 : 0;
-	count += (info->is_micro) ? 1 : 0;
-	count += (info->is_milli) ? 1 : 0;
-	count += (info->is_kilo) ? 1 : 0;
-	count += (info->is_mega) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one multiplier detected in packet.");
-		return FALSE;
-	}
-
-	/* Does the packet "measure" more than one type of value? */
-	count = 0;
-	count += (info->is_ac) ? 1 : 0;
-	count += (info->is_dc) ? 1 : 0;
-	count += (info->is_resistance) ? 1 : 0;
-	count += (info->is_capacity) ? 1 : 0;
-	count += (info->is_temperature) ? 1 : 0;
-	count += (info->is_diode) ? 1 : 0;
-	count += (info->is_frequency) ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one measurement type detected in packet.");
-		return FALSE;
-	}
+	multipliers = info->is_pico + info->is_nano + info->is_micro
+		+ info->is_milli + info->is_kilo + info->is_mega;
 
-	/* Both AC and DC set? */
-	if (info->is_ac && info->is_dc) {
-		sr_err("Both AC and DC flags detected in packet.");
-		return FALSE;
-	}
+	/*
+	 * Does the packet "measure" more than one type of value? This also
+	 * rules out AC and DC both being set.
+	 */
+	types = info->is_ac + info->is_dc + info->is_resistance
+		+ info->is_capacity + info->is_temperature + info->is_diode
+		+ info->is_frequency;
 
-	return TRUE;
+	return (multipliers <= 1) & (types <= 1);
 }
 
 #ifdef HAVE_LIBSERIALPORT
@@ -262,16 +246,14 @@ SR_PRIV gboolean sr_metex14_packet_valid(const uint8_t *buf)
 {
 	struct metex14_info info;
 
-	memset(&info, 0x00, sizeof(struct metex14_info));
-	parse_flags((const char *)buf, &info);
-
-	if (!flags_valid(&info))
-		return FALSE;
-
+	/* Check the terminator first, it rules out most offsets. */
 	if (buf[13] != '\r')
 		return FALSE;
 
-	return TRUE;
+	memset(&info, 0x00, sizeof(struct metex14_info));
+	parse_flags((const char *)buf, &info);
+
+	return flags_valid(&info);
 }
 
 /**
@@ -138,6 +138,10 @@ struct rs9lcd_packet {
 	uint8_t checksum;
 };
 
+/*
+ * The validators run at every byte offset while the receive path resyncs,
+ * so they don't log and don't branch on the packet contents.
+ */
 static gboolean checksum_valid(const struct rs9lcd_packet *rs_packet)
 {
 	uint8_t *raw;
@@ -157,37 +161,22 @@ static gboolean checksum_valid(const struct rs9lcd_packet *rs_packet)
 
 static gboolean selection_good(const struct rs9lcd_packet *rs_packet)
 {
-	int count;
-
-	/* Does the packet have more than one multiplier? */
-	count = 0;
-	count += (rs_packet->indicatrix1 & IND1_KILO)  ? 1 : 0;
-	count += (rs_packet->indicatrix1 & IND1_MEGA)  ? 1 : 0;
-	count += (rs_packet->indicatrix1 & IND1_MILI)  ? 1 : 0;
-	count += (rs_packet->indicatrix2 & IND2_MICRO) ? 1 : 0;
-	count += (rs_packet->indicatrix2 & IND2_NANO)  ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one multiplier detected in packet.");
-		return FALSE;
-	}
+	unsigned int multipliers, types;
 
-	/* Does the packet "measure" more than one type of value? */
-	count = 0;
-	count += (rs_packet->indicatrix1 & IND1_HZ)    ? 1 : 0;
-	count += (rs_packet->indicatrix1 & IND1_OHM)   ? 1 : 0;
-	count += (rs_packet->indicatrix1 & IND1_FARAD) ? 1 : 0;
-	count += (rs_packet->indicatrix1 & IND1_AMP)   ? 1 : 0;
-	count += (rs_packet->indicatrix1 & IND1_VOLT)  ? 1 : 0;
-	count += (rs_packet->indicatrix2 & IND2_DBM)   ? 1 : 0;
-	count += (rs_packet->indicatrix2 & IND2_SEC)   ? 1 : 0;
-	count += (rs_packet->indicatrix2 & IND2_DUTY)  ? 1 : 0;
-	count += (rs_packet->indicatrix2 & IND2_HFE)   ? 1 : 0;
-	if (count > 1) {
-		sr_err("More than one measurement type detected in packet.");
-		return FALSE;
-	}
+	multipliers = (rs_packet->indicatrix1
+			& (IND1_KILO | IND1_MEGA | IND1_MILI))
+		| ((rs_packet->indicatrix2 & (IND2_MICRO | IND2_NANO)) << 8);
 
-	return TRUE;
+	types = (rs_packet->indicatrix1 & (IND1_HZ | IND1_OHM | IND1_FARAD
+			| IND1_AMP | IND1_VOLT))
+		| ((rs_packet->indicatrix2 & (IND2_DBM | IND2_SEC | IND2_DUTY
+			| IND2_HFE)) << 8);
+
+	/*
+	 * At most one multiplier, and the packet may not "measure" more
+	 * than one type of value.
+	 */
+	return ONE_BIT_MAX(multipliers) & ONE_BIT_MAX(types);
 }
 
 /*
@@ -207,50 +196,61 @@ SR_PRIV gboolean sr_rs9lcd_packet_valid(const uint8_t *buf)
 	if (!(rs_packet->mode < MODE_INVALID))
 		return FALSE;
 
-	if (!checksum_valid(rs_packet)) {
-		sr_spew("Packet with invalid checksum. Discarding.");
-		return FALSE;
-	}
-
-	if (!selection_good(rs_packet)) {
-		sr_spew("Packet with invalid selection bits. Discarding.");
-		return FALSE;
-	}
-
-	return TRUE;
+	return checksum_valid(rs_packet) & selection_good(rs_packet);
 }
 
+/*
+ * Digit value for each LCD pattern (decimal point masked off), -1 for
+ * patterns that aren't a digit. Generated from LCD_0 to LCD_9; a blank
+ * digit (0x00) reads as 0.
+ */
+static const int8_t digit_lut[256] = {
+	/* 0x00 */  0, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x08 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x10 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x18 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x20 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x28 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x30 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x38 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x40 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x48 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x50 */  1,  7, -1, -1, -1, -1, -1, -1,
+	/* 0x58 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x60 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x68 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x70 */ -1, -1,  4, -1, -1, -1, -1, -1,
+	/* 0x78 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x80 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x88 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x90 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0x98 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xa0 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xa8 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xb0 */ -1, -1, -1, -1, -1,  2, -1, -1,
+	/* 0xb8 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xc0 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xc8 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xd0 */ -1, -1, -1, -1, -1, -1, -1,  0,
+	/* 0xd8 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xe0 */ -1, -1, -1,  5, -1, -1, -1,  6,
+	/* 0xe8 */ -1, -1, -1, -1, -1, -1, -1, -1,
+	/* 0xf0 */ -1,  3, -1,  9, -1, -1, -1,  8,
+	/* 0xf8 */ -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
 static uint8_t decode_digit(uint8_t raw_digit)
 {
-	/* Take out the decimal point, so we can use a simple switch(). */
-	raw_digit &= ~DP_MASK;
-
-	switch (raw_digit) {
-	case 0x00:
-	case LCD_0:
-		return 0;
-	case LCD_1:
-		return 1;
-	case LCD_2:
-		return 2;
-	case LCD_3:
-		return 3;
-	case LCD_4:
-		return 4;
-	case LCD_5:
-		return 5;
-	case LCD_6:
-		return 6;
-	case LCD_7:
-		return 7;
-	case LCD_8:
-		return 8;
-	case LCD_9:
-		return 9;
-	default:
-		sr_err("Invalid digit byte: 0x%02x.", raw_digit);
+	int8_t digit;
+
+	/* Take out the decimal point. */
+	digit = digit_lut[raw_digit & ~DP_MASK];
+	if (digit < 0) {
+		sr_dbg("Invalid digit byte: 0x%02x.", raw_digit & ~DP_MASK);
 		return 0xff;
 	}
+
+	return digit;
 }
 
 static double lcd_to_double(const struct rs9lcd_packet *rs_packet, int type)
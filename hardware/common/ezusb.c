@@ -49,39 +49,41 @@ SR_PRIV int ezusb_reset(struct libusb_device_handle *hdl, int set_clear)
 	return ret;
 }
 
+/*
+ * usbfs limits control transfers to a page, so this is as large as an
+ * upload chunk can get.
+ */
+#define FW_CHUNKSIZE 4096
+
 SR_PRIV int ezusb_install_firmware(libusb_device_handle *hdl,
 				   const char *filename)
 {
-	FILE *fw;
-	int offset, chunksize, ret, result;
-	unsigned char buf[4096];
+	GBytes *fw;
+	const unsigned char *data;
+	gsize size, offset;
+	int chunksize, ret, result;
 
 	sr_info("Uploading firmware at %s", filename);
-	if ((fw = g_fopen(filename, "rb")) == NULL) {
-		sr_err("Unable to open firmware file %s for reading: %s",
-		       filename, strerror(errno));
+	if (!(fw = sr_firmware_get(filename)))
 		return SR_ERR;
-	}
+	data = g_bytes_get_data(fw, &size);
 
 	result = SR_OK;
-	offset = 0;
-	while (1) {
-		chunksize = fread(buf, 1, 4096, fw);
-		if (chunksize == 0)
-			break;
+	for (offset = 0; offset < size; offset += chunksize) {
+		chunksize = MIN(size - offset, FW_CHUNKSIZE);
 		ret = libusb_control_transfer(hdl, LIBUSB_REQUEST_TYPE_VENDOR |
 					      LIBUSB_ENDPOINT_OUT, 0xa0, offset,
-					      0x0000, buf, chunksize, 100);
+					      0x0000, (unsigned char *)data + offset,
+					      chunksize, 100);
 		if (ret < 0) {
 			sr_err("Unable to send firmware to device: %s.",
 					libusb_error_name(ret));
 			result = SR_ERR;
 			break;
 		}
-		sr_info("Uploaded %d bytes", chunksize);
-		offset += chunksize;
+		sr_spew("Uploaded %d bytes", chunksize);
 	}
-	fclose(fw);
+	g_bytes_unref(fw);
 	sr_info("Firmware upload done");
 
 	return result;
@@ -91,7 +93,7 @@ SR_PRIV int ezusb_upload_firmware(libusb_device *dev, int configuration,
 				  const char *filename)
 {
 	struct libusb_device_handle *hdl;
-	int ret;
+	int ret, result;
 
 	sr_info("uploading firmware to device on %d.%d",
 		libusb_get_bus_number(dev), libusb_get_device_address(dev));
@@ -101,6 +103,8 @@ SR_PRIV int ezusb_upload_firmware(libusb_device *dev, int configuration,
 		return SR_ERR;
 	}
 
+	result = SR_ERR;
+
 /*
  * The libusbx darwin backend is broken: it can report a kernel driver being
  * active, but detaching it always returns an error.
@@ -110,7 +114,7 @@ SR_PRIV int ezusb_upload_firmware(libusb_device *dev, int configuration,
 		if ((ret = libusb_detach_kernel_driver(hdl, 0)) < 0) {
 			sr_err("failed to detach kernel driver: %s",
 					libusb_error_name(ret));
-			return SR_ERR;
+			goto done;
 		}
 	}
 #endif
@@ -118,19 +122,102 @@ SR_PRIV int ezusb_upload_firmware(libusb_device *dev, int configuration,
 	if ((ret = libusb_set_configuration(hdl, configuration)) < 0) {
 		sr_err("Unable to set configuration: %s",
 				libusb_error_name(ret));
-		return SR_ERR;
+		goto done;
 	}
 
 	if ((ezusb_reset(hdl, 1)) < 0)
-		return SR_ERR;
+		goto done;
 
 	if (ezusb_install_firmware(hdl, filename) < 0)
-		return SR_ERR;
+		goto done;
 
 	if ((ezusb_reset(hdl, 0)) < 0)
-		return SR_ERR;
+		goto done;
 
+	result = SR_OK;
+
+done:
 	libusb_close(hdl);
 
-	return SR_OK;
+	return result;
+}
+
+static gpointer upload_thread(gpointer data)
+{
+	struct ezusb_upload *upload;
+
+	upload = data;
+	upload->result = ezusb_upload_firmware(upload->dev,
+			upload->configuration, upload->filename);
+
+	return NULL;
+}
+
+/**
+ * Start uploading firmware to a device in the background.
+ *
+ * This lets a driver upload firmware to all devices it finds during a scan
+ * at once. Each upload must be completed with ezusb_upload_firmware_finish().
+ *
+ * @param dev The device. A reference is held until the upload finishes.
+ * @param configuration The USB configuration to set.
+ * @param filename The firmware file, must stay valid until finished.
+ * @param user_data Driver data, e.g. the device instance.
+ *
+ * @return The upload, or NULL upon memory allocation failure.
+ */
+SR_PRIV struct ezusb_upload *ezusb_upload_firmware_start(libusb_device *dev,
+		int configuration, const char *filename, void *user_data)
+{
+	struct ezusb_upload *upload;
+	GError *error;
+	GBytes *fw;
+
+	if (!(upload = g_try_malloc0(sizeof(struct ezusb_upload)))) {
+		sr_err("Upload malloc failed.");
+		return NULL;
+	}
+	upload->dev = libusb_ref_device(dev);
+	upload->configuration = configuration;
+	upload->filename = filename;
+	upload->user_data = user_data;
+
+	/* Load the file here, so the threads don't all race to do it. */
+	if ((fw = sr_firmware_get(filename)))
+		g_bytes_unref(fw);
+
+	error = NULL;
+	upload->thread = g_thread_try_new("ezusb", upload_thread, upload,
+			&error);
+	if (!upload->thread) {
+		sr_dbg("Can't start upload thread, uploading now: %s.",
+				error->message);
+		g_error_free(error);
+		upload_thread(upload);
+	}
+
+	return upload;
+}
+
+/**
+ * Wait for an upload started by ezusb_upload_firmware_start() and free it.
+ *
+ * @param upload The upload. Can be NULL, in which case SR_ERR is returned.
+ *
+ * @return The result of the upload, SR_OK upon success.
+ */
+SR_PRIV int ezusb_upload_firmware_finish(struct ezusb_upload *upload)
+{
+	int result;
+
+	if (!upload)
+		return SR_ERR;
+
+	if (upload->thread)
+		g_thread_join(upload->thread);
+	result = upload->result;
+	libusb_unref_device(upload->dev);
+	g_free(upload);
+
+	return result;
 }
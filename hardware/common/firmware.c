@@ -0,0 +1,136 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * In-memory cache of firmware and FPGA bitstream files.
+ *
+ * Every device of a kind gets the same file uploaded, often more than once
+ * (on every plug, or whenever a mode change needs another bitstream), so
+ * each file is read from disk only once and shared between devices and
+ * threads. The cache is emptied by sr_exit().
+ */
+
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "firmware"
+
+/* Filename -> GBytes. */
+static GHashTable *firmware_cache;
+G_LOCK_DEFINE_STATIC(firmware_cache);
+
+static GBytes *firmware_load(const char *filename, gboolean quiet)
+{
+	GError *error;
+	gchar *data;
+	gsize size;
+
+	error = NULL;
+	if (!g_file_get_contents(filename, &data, &size, &error)) {
+		if (quiet)
+			sr_dbg("Unable to read %s: %s.", filename,
+					error->message);
+		else
+			sr_err("Unable to read firmware file %s: %s.",
+					filename, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+	sr_dbg("Loaded %s (%" G_GSIZE_FORMAT " bytes).", filename, size);
+
+	return g_bytes_new_take(data, size);
+}
+
+static GBytes *firmware_get(const char *filename, gboolean quiet)
+{
+	GBytes *fw, *loaded;
+
+	G_LOCK(firmware_cache);
+	fw = firmware_cache ? g_hash_table_lookup(firmware_cache, filename)
+			: NULL;
+	if (fw)
+		g_bytes_ref(fw);
+	G_UNLOCK(firmware_cache);
+	if (fw)
+		return fw;
+
+	/* Don't hold the lock over disk I/O, other files may be cached. */
+	if (!(loaded = firmware_load(filename, quiet)))
+		return NULL;
+
+	G_LOCK(firmware_cache);
+	if (!firmware_cache)
+		firmware_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, (GDestroyNotify)g_bytes_unref);
+	/* Someone else may have loaded it in the meantime. */
+	if (!(fw = g_hash_table_lookup(firmware_cache, filename))) {
+		fw = loaded;
+		loaded = NULL;
+		g_hash_table_insert(firmware_cache, g_strdup(filename), fw);
+	}
+	g_bytes_ref(fw);
+	G_UNLOCK(firmware_cache);
+
+	if (loaded)
+		g_bytes_unref(loaded);
+
+	return fw;
+}
+
+/**
+ * Get the contents of a firmware file, reading it only if not yet cached.
+ *
+ * @param filename The file's full path. Must not be NULL.
+ *
+ * @return A new reference to the contents, to be released with
+ *         g_bytes_unref(), or NULL if the file could not be read.
+ */
+SR_PRIV GBytes *sr_firmware_get(const char *filename)
+{
+	return firmware_get(filename, FALSE);
+}
+
+/**
+ * Read firmware files into the cache ahead of their first use.
+ *
+ * Files that cannot be read are skipped quietly, as drivers list the
+ * firmware of all models they support, most of which are not installed.
+ *
+ * @param filenames NULL-terminated array of full paths.
+ */
+SR_PRIV void sr_firmware_preload(const char **filenames)
+{
+	GBytes *fw;
+	int i;
+
+	for (i = 0; filenames[i]; i++) {
+		if ((fw = firmware_get(filenames[i], TRUE)))
+			g_bytes_unref(fw);
+	}
+}
+
+/** Drop all cached files. Outstanding references stay valid. */
+SR_PRIV void sr_firmware_cache_clear(void)
+{
+	G_LOCK(firmware_cache);
+	if (firmware_cache) {
+		g_hash_table_destroy(firmware_cache);
+		firmware_cache = NULL;
+	}
+	G_UNLOCK(firmware_cache);
+}
@@ -28,6 +28,44 @@
 #define SCPI_READ_RETRIES 100
 #define SCPI_READ_RETRY_TIMEOUT 10000
 
+/* How long synchronous reads wait for more response data (µs). */
+#define SCPI_READ_TIMEOUT (5 * G_USEC_PER_SEC)
+/* Initial poll interval while waiting, doubled up to the retry timeout. */
+#define SCPI_READ_POLL_INTERVAL 100
+
+/* Maximum number of queries sent in one compound program message. */
+#define SCPI_BATCH_MAX_QUERIES 16
+
+/* Most bytes discarded after a block before giving up on the response. */
+#define SCPI_DISCARD_MAX 256
+
+enum scpi_batch_type {
+	SCPI_BATCH_STRING,
+	SCPI_BATCH_BOOL,
+	SCPI_BATCH_INT,
+	SCPI_BATCH_FLOAT,
+};
+
+struct scpi_batch_query {
+	char *command;
+	enum scpi_batch_type type;
+	void *result;
+};
+
+/* A parsed reply, until it is known that all replies of a message parse. */
+union scpi_batch_value {
+	char *s;
+	gboolean b;
+	int i;
+	float f;
+};
+
+struct sr_scpi_batch {
+	struct sr_scpi_dev_inst *scpi;
+	gboolean compound;
+	GArray *queries;
+};
+
 /**
  * Parse a string representation of a boolean-like value into a gboolean.
  * Similar to sr_parse_boolstring but rejects strings which do not represent
@@ -115,7 +153,8 @@ SR_PRIV int sr_scpi_source_remove(struct sr_scpi_dev_inst *scpi)
  * @param scpi Previously initialized SCPI device structure.
  * @param format Format string, to be followed by any necessary arguments.
  *
- * @return SR_OK on success, SR_ERR on failure.
+ * @return SR_OK on success, SR_ERR on failure, SR_ERR_TIMEOUT if the
+ *         device stopped accepting data.
  */
 SR_PRIV int sr_scpi_send(struct sr_scpi_dev_inst *scpi,
 			 const char *format, ...)
@@ -137,7 +176,8 @@ SR_PRIV int sr_scpi_send(struct sr_scpi_dev_inst *scpi,
  * @param format Format string.
  * @param args Argument list.
  *
- * @return SR_OK on success, SR_ERR on failure.
+ * @return SR_OK on success, SR_ERR on failure, SR_ERR_TIMEOUT if the
+ *         device stopped accepting data.
  */
 SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 			 const char *format, va_list args)
@@ -167,18 +207,32 @@ SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 /**
  * Begin receiving an SCPI reply.
  *
+ * Any data left over from a previous reply is discarded.
+ *
  * @param scpi Previously initialised SCPI device structure.
  *
  * @return SR_OK on success, SR_ERR on failure.
  */
 SR_PRIV int sr_scpi_read_begin(struct sr_scpi_dev_inst *scpi)
 {
+	if (scpi->read_pos < scpi->read_len)
+		sr_dbg("Discarding %zu unread bytes of previous response.",
+		       scpi->read_len - scpi->read_pos);
+	scpi->read_pos = scpi->read_len = 0;
+
 	return scpi->read_begin(scpi->priv);
 }
 
 /**
  * Read part of a response from SCPI device.
  *
+ * On TCP and serial connections this doesn't block: if no data is
+ * available yet, 0 is returned and the caller should try again, e.g. when
+ * its event source fires. USBTMC reads do block, until the device sends
+ * data or the kernel driver's timeout expires. Small reads are served from
+ * the connection's receive buffer, which is refilled with reads sized to
+ * suit the underlying link.
+ *
  * @param scpi Previously initialised SCPI device structure.
  * @param buf Buffer to store result.
  * @param maxlen Maximum number of bytes to read.
@@ -188,7 +242,33 @@ SR_PRIV int sr_scpi_read_begin(struct sr_scpi_dev_inst *scpi)
 SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi,
 			char *buf, int maxlen)
 {
-	return scpi->read_data(scpi->priv, buf, maxlen);
+	int len;
+
+	if (scpi->read_pos == scpi->read_len) {
+		scpi->read_pos = scpi->read_len = 0;
+
+		/* Large reads go straight to the caller's buffer. */
+		if ((size_t)maxlen >= scpi->read_size)
+			return scpi->read_data(scpi->priv, buf, maxlen);
+
+		if (!scpi->read_buf &&
+		    !(scpi->read_buf = g_try_malloc(scpi->read_size))) {
+			sr_err("Receive buffer malloc failed.");
+			return SR_ERR;
+		}
+
+		len = scpi->read_data(scpi->priv, scpi->read_buf,
+				scpi->read_size);
+		if (len <= 0)
+			return len;
+		scpi->read_len = len;
+	}
+
+	len = MIN((size_t)maxlen, scpi->read_len - scpi->read_pos);
+	memcpy(buf, scpi->read_buf + scpi->read_pos, len);
+	scpi->read_pos += len;
+
+	return len;
 }
 
 /**
@@ -200,7 +280,43 @@ SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi,
  */
 SR_PRIV int sr_scpi_read_complete(struct sr_scpi_dev_inst *scpi)
 {
-	return scpi->read_complete(scpi->priv);
+	return (scpi->read_pos == scpi->read_len &&
+			scpi->read_complete(scpi->priv));
+}
+
+/**
+ * Read part of a response, waiting for data to arrive if none is
+ * available yet.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param buf Buffer to store result.
+ * @param maxlen Maximum number of bytes to read.
+ *
+ * @return Number of bytes read, or SR_ERR upon failure or timeout.
+ */
+static int read_wait(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen)
+{
+	gint64 deadline;
+	gulong interval;
+	int len;
+
+	deadline = 0;
+	interval = SCPI_READ_POLL_INTERVAL;
+
+	while ((len = sr_scpi_read_data(scpi, buf, maxlen)) == 0) {
+		if (sr_scpi_read_complete(scpi))
+			break;
+		if (!deadline) {
+			deadline = g_get_monotonic_time() + SCPI_READ_TIMEOUT;
+		} else if (g_get_monotonic_time() > deadline) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR;
+		}
+		g_usleep(interval);
+		interval = MIN(interval * 2, SCPI_READ_RETRY_TIMEOUT);
+	}
+
+	return len;
 }
 
 /**
@@ -225,6 +341,7 @@ SR_PRIV int sr_scpi_close(struct sr_scpi_dev_inst *scpi)
 SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi)
 {
 	scpi->free(scpi->priv);
+	g_free(scpi->read_buf);
 	g_free(scpi);
 }
 
@@ -240,9 +357,9 @@ SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi)
 SR_PRIV int sr_scpi_get_string(struct sr_scpi_dev_inst *scpi,
 			       const char *command, char **scpi_response)
 {
-	char buf[256];
-	int len;
 	GString *response;
+	gsize offset;
+	int len;
 
 	if (command)
 		if (sr_scpi_send(scpi, command) != SR_OK)
@@ -251,17 +368,20 @@ SR_PRIV int sr_scpi_get_string(struct sr_scpi_dev_inst *scpi,
 	if (sr_scpi_read_begin(scpi) != SR_OK)
 		return SR_ERR;
 
-	response = g_string_new("");
+	response = g_string_sized_new(scpi->read_size);
 
 	*scpi_response = NULL;
 
 	while (!sr_scpi_read_complete(scpi)) {
-		len = sr_scpi_read_data(scpi, buf, sizeof(buf));
+		/* Read straight into the string, growing it as needed. */
+		offset = response->len;
+		g_string_set_size(response, offset + scpi->read_size);
+		len = read_wait(scpi, response->str + offset, scpi->read_size);
 		if (len < 0) {
 			g_string_free(response, TRUE);
 			return SR_ERR;
 		}
-		g_string_append_len(response, buf, len);
+		g_string_set_size(response, offset + len);
 	}
 
 	*scpi_response = response->str;
@@ -536,6 +656,586 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/**
+ * Create a new batch of SCPI queries.
+ *
+ * Queries are added with the sr_scpi_batch_add_*() functions and sent with
+ * sr_scpi_batch_run(). If compound is TRUE, up to SCPI_BATCH_MAX_QUERIES
+ * queries are joined with ';' into a single program message and the
+ * multiplexed response is split up again, saving a round trip per query.
+ * Otherwise, or if the instrument's response does not match the queries,
+ * the queries are sent one at a time.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param compound TRUE if the instrument supports compound queries.
+ *
+ * @return The new batch, or NULL on failure. It must be freed by the caller
+ *         using sr_scpi_batch_free().
+ */
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(struct sr_scpi_dev_inst *scpi,
+						gboolean compound)
+{
+	struct sr_scpi_batch *batch;
+
+	if (!(batch = g_try_malloc(sizeof(struct sr_scpi_batch))))
+		return NULL;
+
+	batch->scpi = scpi;
+	batch->compound = compound;
+	batch->queries = g_array_new(FALSE, FALSE,
+				     sizeof(struct scpi_batch_query));
+
+	return batch;
+}
+
+/**
+ * Free a batch of SCPI queries.
+ *
+ * Results already stored by sr_scpi_batch_run() are not affected.
+ *
+ * @param batch The batch to free. Can be NULL.
+ */
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch)
+{
+	unsigned int i;
+
+	if (!batch)
+		return;
+
+	for (i = 0; i < batch->queries->len; i++)
+		g_free(g_array_index(batch->queries,
+				     struct scpi_batch_query, i).command);
+	g_array_free(batch->queries, TRUE);
+	g_free(batch);
+}
+
+static void batch_add(struct sr_scpi_batch *batch, const char *command,
+		      enum scpi_batch_type type, void *result)
+{
+	struct scpi_batch_query query;
+
+	query.command = g_strdup(command);
+	query.type = type;
+	query.result = result;
+	g_array_append_val(batch->queries, query);
+}
+
+/**
+ * Add a query to a batch, storing the reply as a string.
+ *
+ * @param batch The batch to add the query to.
+ * @param command The SCPI query.
+ * @param result Pointer where to store the newly allocated reply, which must
+ *               be freed by the caller using g_free().
+ */
+SR_PRIV void sr_scpi_batch_add_string(struct sr_scpi_batch *batch,
+				      const char *command, char **result)
+{
+	batch_add(batch, command, SCPI_BATCH_STRING, result);
+}
+
+/**
+ * Add a query to a batch, parsing the reply as a bool value.
+ *
+ * @param batch The batch to add the query to.
+ * @param command The SCPI query.
+ * @param result Pointer where to store the parsed result.
+ */
+SR_PRIV void sr_scpi_batch_add_bool(struct sr_scpi_batch *batch,
+				    const char *command, gboolean *result)
+{
+	batch_add(batch, command, SCPI_BATCH_BOOL, result);
+}
+
+/**
+ * Add a query to a batch, parsing the reply as an integer.
+ *
+ * @param batch The batch to add the query to.
+ * @param command The SCPI query.
+ * @param result Pointer where to store the parsed result.
+ */
+SR_PRIV void sr_scpi_batch_add_int(struct sr_scpi_batch *batch,
+				   const char *command, int *result)
+{
+	batch_add(batch, command, SCPI_BATCH_INT, result);
+}
+
+/**
+ * Add a query to a batch, parsing the reply as a float.
+ *
+ * @param batch The batch to add the query to.
+ * @param command The SCPI query.
+ * @param result Pointer where to store the parsed result.
+ */
+SR_PRIV void sr_scpi_batch_add_float(struct sr_scpi_batch *batch,
+				     const char *command, float *result)
+{
+	batch_add(batch, command, SCPI_BATCH_FLOAT, result);
+}
+
+/* Parse a single reply into a value, without touching the result yet. */
+static int batch_parse(const struct scpi_batch_query *query, char *reply,
+		       union scpi_batch_value *value)
+{
+	g_strstrip(reply);
+
+	switch (query->type) {
+	case SCPI_BATCH_STRING:
+		value->s = g_strdup(reply);
+		return SR_OK;
+	case SCPI_BATCH_BOOL:
+		return parse_strict_bool(reply, &value->b);
+	case SCPI_BATCH_INT:
+		return sr_atoi(reply, &value->i);
+	case SCPI_BATCH_FLOAT:
+		return sr_atof(reply, &value->f);
+	}
+
+	return SR_ERR_BUG;
+}
+
+/* Store a parsed value in the query's result. */
+static void batch_store(const struct scpi_batch_query *query,
+			const union scpi_batch_value *value)
+{
+	switch (query->type) {
+	case SCPI_BATCH_STRING:
+		*(char **)query->result = value->s;
+		break;
+	case SCPI_BATCH_BOOL:
+		*(gboolean *)query->result = value->b;
+		break;
+	case SCPI_BATCH_INT:
+		*(int *)query->result = value->i;
+		break;
+	case SCPI_BATCH_FLOAT:
+		*(float *)query->result = value->f;
+		break;
+	}
+}
+
+/* Send num queries starting at first as one compound program message. */
+static int batch_run_compound(struct sr_scpi_batch *batch, unsigned int first,
+			      unsigned int num)
+{
+	struct scpi_batch_query *query;
+	union scpi_batch_value values[SCPI_BATCH_MAX_QUERIES];
+	GString *command;
+	char *response;
+	gchar **replies;
+	unsigned int i;
+	int ret;
+
+	command = g_string_new("");
+	for (i = first; i < first + num; i++) {
+		query = &g_array_index(batch->queries, struct scpi_batch_query, i);
+		if (i > first)
+			g_string_append_c(command, ';');
+		g_string_append(command, query->command);
+	}
+
+	response = NULL;
+	ret = sr_scpi_get_string(batch->scpi, command->str, &response);
+	g_string_free(command, TRUE);
+	if (ret != SR_OK) {
+		g_free(response);
+		return SR_ERR;
+	}
+
+	replies = g_strsplit(response, ";", 0);
+	g_free(response);
+
+	if (g_strv_length(replies) != num) {
+		sr_dbg("Compound query returned %u replies, expected %u.",
+		       g_strv_length(replies), num);
+		g_strfreev(replies);
+		return SR_ERR;
+	}
+
+	/*
+	 * Only store the results once all replies parse. Otherwise the
+	 * sequential fallback would store them again, leaking strings.
+	 */
+	memset(values, 0, sizeof(values));
+	ret = SR_OK;
+	for (i = 0; i < num && ret == SR_OK; i++) {
+		query = &g_array_index(batch->queries, struct scpi_batch_query,
+				       first + i);
+		if (batch_parse(query, replies[i], &values[i]) != SR_OK) {
+			sr_dbg("Failed to parse reply '%s' to '%s'.",
+			       replies[i], query->command);
+			ret = SR_ERR;
+		}
+	}
+	g_strfreev(replies);
+
+	for (i = 0; i < num; i++) {
+		query = &g_array_index(batch->queries, struct scpi_batch_query,
+				       first + i);
+		if (ret == SR_OK)
+			batch_store(query, &values[i]);
+		else if (query->type == SCPI_BATCH_STRING)
+			g_free(values[i].s);
+	}
+
+	return ret;
+}
+
+/* Send num queries starting at first one at a time. */
+static int batch_run_sequential(struct sr_scpi_batch *batch,
+				unsigned int first, unsigned int num)
+{
+	struct scpi_batch_query *query;
+	union scpi_batch_value value;
+	char *response;
+	unsigned int i;
+	int ret;
+
+	for (i = first; i < first + num; i++) {
+		query = &g_array_index(batch->queries, struct scpi_batch_query, i);
+		response = NULL;
+		if (sr_scpi_get_string(batch->scpi, query->command,
+				       &response) != SR_OK) {
+			g_free(response);
+			return SR_ERR;
+		}
+		ret = batch_parse(query, response, &value);
+		g_free(response);
+		if (ret != SR_OK) {
+			sr_dbg("Failed to parse reply to '%s'.", query->command);
+			return SR_ERR;
+		}
+		batch_store(query, &value);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Send all queries of a batch and store the parsed replies.
+ *
+ * If a compound query fails, the remaining queries of the batch are sent
+ * one at a time.
+ *
+ * @param batch The batch to run.
+ *
+ * @return SR_OK if all replies were received and parsed, SR_ERR otherwise.
+ */
+SR_PRIV int sr_scpi_batch_run(struct sr_scpi_batch *batch)
+{
+	unsigned int first, num;
+
+	for (first = 0; first < batch->queries->len; first += num) {
+		num = MIN(batch->queries->len - first, SCPI_BATCH_MAX_QUERIES);
+
+		if (batch->compound) {
+			if (batch_run_compound(batch, first, num) == SR_OK)
+				continue;
+			sr_info("Compound query failed, falling back to "
+				"sequential queries.");
+			batch->compound = FALSE;
+		}
+
+		if (batch_run_sequential(batch, first, num) != SR_OK)
+			return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read exactly len bytes of a response from an SCPI device.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param buf Buffer to store the data.
+ * @param len Number of bytes to read.
+ *
+ * @return SR_OK on success, SR_ERR on failure.
+ */
+static int read_exact(struct sr_scpi_dev_inst *scpi, char *buf, size_t len)
+{
+	size_t got;
+	int ret;
+
+	got = 0;
+
+	while (got < len) {
+		ret = read_wait(scpi, buf + got,
+				MIN(len - got, (size_t)G_MAXINT));
+		if (ret <= 0)
+			return SR_ERR;
+		got += ret;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read exactly len bytes of a response and discard them, waiting for them
+ * to arrive if need be.
+ *
+ * The response must have been started with sr_scpi_read_begin().
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param len Number of bytes to discard.
+ *
+ * @return SR_OK on success, SR_ERR on failure.
+ */
+SR_PRIV int sr_scpi_read_skip(struct sr_scpi_dev_inst *scpi, size_t len)
+{
+	char buf[256];
+	size_t n;
+
+	while (len > 0) {
+		n = MIN(len, sizeof(buf));
+		if (read_exact(scpi, buf, n) != SR_OK)
+			return SR_ERR;
+		len -= n;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read the rest of a response (e.g. the terminator after a block) and
+ * discard it.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ *
+ * @return SR_OK on success, SR_ERR on failure or if more than
+ *         SCPI_DISCARD_MAX bytes remain.
+ */
+static int read_discard(struct sr_scpi_dev_inst *scpi)
+{
+	char buf[16];
+	int len, discarded;
+
+	discarded = 0;
+
+	while (!sr_scpi_read_complete(scpi)) {
+		if ((len = read_wait(scpi, buf, sizeof(buf))) < 0)
+			return SR_ERR;
+		if ((discarded += len) > SCPI_DISCARD_MAX) {
+			sr_err("Too much trailing data after block.");
+			return SR_ERR;
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read the header of an IEEE 488.2 definite length arbitrary block,
+ * i.e. '#' followed by one digit n and n digits giving the block length.
+ *
+ * The response must have been started with sr_scpi_read_begin().
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ *
+ * @return The length of the block data in bytes, or SR_ERR on failure.
+ */
+SR_PRIV int sr_scpi_read_block_header(struct sr_scpi_dev_inst *scpi)
+{
+	char start[3], length[10];
+	int digits, len;
+
+	/* Read the hashsign and length digit. */
+	if (read_exact(scpi, start, 2) != SR_OK) {
+		sr_err("Failed to read data block header start.");
+		return SR_ERR;
+	}
+	start[2] = '\0';
+	if (start[0] != '#' || !g_ascii_isdigit(start[1]) || start[1] == '0') {
+		sr_err("Received invalid data block header start '%s'.", start);
+		return SR_ERR;
+	}
+	digits = start[1] - '0';
+
+	/* Read the data length. */
+	if (read_exact(scpi, length, digits) != SR_OK) {
+		sr_err("Failed to read %d bytes of data block length.", digits);
+		return SR_ERR;
+	}
+	length[digits] = '\0';
+	if (sr_atoi(length, &len) != SR_OK || len < 0) {
+		sr_err("Received invalid data block length '%s'.", length);
+		return SR_ERR;
+	}
+
+	sr_dbg("Received data block header: %s%s -> block length %d.",
+	       start, length, len);
+
+	return len;
+}
+
+/**
+ * Send a SCPI command, read the header of the IEEE 488.2 definite length
+ * block in the reply and return the length of the block data.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ *
+ * @return The length of the block data in bytes, or SR_ERR on failure.
+ */
+static int get_block_header(struct sr_scpi_dev_inst *scpi, const char *command)
+{
+	if (command)
+		if (sr_scpi_send(scpi, command) != SR_OK)
+			return SR_ERR;
+
+	if (sr_scpi_read_begin(scpi) != SR_OK)
+		return SR_ERR;
+
+	return sr_scpi_read_block_header(scpi);
+}
+
+/**
+ * Send a SCPI command, read the reply as an IEEE 488.2 definite length
+ * block and store the block data in scpi_response.
+ *
+ * The data is read straight into the array in as few reads as the
+ * transport allows. If *scpi_response is not NULL, that array is reused
+ * (and resized), so callers can keep one buffer across acquisitions.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ * @param scpi_response Pointer where to store the block data.
+ *
+ * @return SR_OK on success, SR_ERR on failure. The array must be freed by
+ *         the caller in both cases, if it is not NULL.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			      const char *command, GByteArray **scpi_response)
+{
+	int len;
+
+	if ((len = get_block_header(scpi, command)) < 0)
+		return SR_ERR;
+
+	if (!*scpi_response)
+		*scpi_response = g_byte_array_sized_new(len);
+	g_byte_array_set_size(*scpi_response, len);
+
+	if (read_exact(scpi, (char *)(*scpi_response)->data, len) != SR_OK) {
+		sr_err("Failed to read %d bytes of block data.", len);
+		return SR_ERR;
+	}
+
+	return read_discard(scpi);
+}
+
+/**
+ * Read a block of values of size elem_size into a (possibly reused) GArray
+ * and convert them to host byte order.
+ */
+static int get_block_typed(struct sr_scpi_dev_inst *scpi,
+			   const char *command, unsigned int elem_size,
+			   gboolean big_endian, GArray **scpi_response)
+{
+	uint16_t *u16;
+	uint32_t *u32;
+	unsigned int i, num;
+	int len;
+
+	if ((len = get_block_header(scpi, command)) < 0)
+		return SR_ERR;
+
+	if (len % elem_size) {
+		sr_err("Block length %d is not a multiple of %u.", len, elem_size);
+		return SR_ERR;
+	}
+	num = len / elem_size;
+
+	if (!*scpi_response)
+		*scpi_response = g_array_sized_new(FALSE, FALSE, elem_size, num);
+	g_array_set_size(*scpi_response, num);
+
+	if (read_exact(scpi, (*scpi_response)->data, len) != SR_OK) {
+		sr_err("Failed to read %d bytes of block data.", len);
+		return SR_ERR;
+	}
+
+	if (elem_size > 1 && big_endian != (G_BYTE_ORDER == G_BIG_ENDIAN)) {
+		if (elem_size == 2) {
+			u16 = (uint16_t *)(*scpi_response)->data;
+			for (i = 0; i < num; i++)
+				u16[i] = GUINT16_SWAP_LE_BE(u16[i]);
+		} else {
+			u32 = (uint32_t *)(*scpi_response)->data;
+			for (i = 0; i < num; i++)
+				u32[i] = GUINT32_SWAP_LE_BE(u32[i]);
+		}
+	}
+
+	return read_discard(scpi);
+}
+
+/**
+ * Send a SCPI command, read the reply as an IEEE 488.2 definite length
+ * block of signed 8 bit integers and store them in scpi_response.
+ *
+ * If *scpi_response is not NULL, that array is reused.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ * @param scpi_response Pointer where to store the values.
+ *
+ * @return SR_OK on success, SR_ERR on failure. The array must be freed by
+ *         the caller in both cases, if it is not NULL.
+ */
+SR_PRIV int sr_scpi_get_block_int8v(struct sr_scpi_dev_inst *scpi,
+			const char *command, GArray **scpi_response)
+{
+	return get_block_typed(scpi, command, sizeof(int8_t), FALSE,
+			       scpi_response);
+}
+
+/**
+ * Send a SCPI command, read the reply as an IEEE 488.2 definite length
+ * block of signed 16 bit integers and store them in host byte order in
+ * scpi_response.
+ *
+ * If *scpi_response is not NULL, that array is reused.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ * @param big_endian TRUE if the device sends the values big endian.
+ * @param scpi_response Pointer where to store the values.
+ *
+ * @return SR_OK on success, SR_ERR on failure. The array must be freed by
+ *         the caller in both cases, if it is not NULL.
+ */
+SR_PRIV int sr_scpi_get_block_int16v(struct sr_scpi_dev_inst *scpi,
+			const char *command, gboolean big_endian,
+			GArray **scpi_response)
+{
+	return get_block_typed(scpi, command, sizeof(int16_t), big_endian,
+			       scpi_response);
+}
+
+/**
+ * Send a SCPI command, read the reply as an IEEE 488.2 definite length
+ * block of 32 bit IEEE 754 floats and store them in host byte order in
+ * scpi_response.
+ *
+ * If *scpi_response is not NULL, that array is reused.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ * @param big_endian TRUE if the device sends the values big endian.
+ * @param scpi_response Pointer where to store the values.
+ *
+ * @return SR_OK on success, SR_ERR on failure. The array must be freed by
+ *         the caller in both cases, if it is not NULL.
+ */
+SR_PRIV int sr_scpi_get_block_float32v(struct sr_scpi_dev_inst *scpi,
+			const char *command, gboolean big_endian,
+			GArray **scpi_response)
+{
+	return get_block_typed(scpi, command, sizeof(float), big_endian,
+			       scpi_response);
+}
+
 /**
  * Send the *IDN? SCPI command, receive the reply, parse it and store the
  * reply as a sr_scpi_hw_info structure in the supplied scpi_response pointer.
@@ -26,8 +26,8 @@
 
 #define LOG_PREFIX "scpi_serial"
 
-#define SCPI_READ_RETRIES 100
-#define SCPI_READ_RETRY_TIMEOUT 10000
+/* Size of bulk reads from the serial port. */
+#define READ_SIZE 1024
 
 struct scpi_serial {
 	struct sr_serial_dev_inst *serial;
@@ -92,60 +92,6 @@ SR_PRIV int scpi_serial_send(void *priv, const char *command)
 	return SR_OK;
 }
 
-SR_PRIV int scpi_serial_receive(void *priv, char **scpi_response)
-{
-	int len, ret;
-	char buf[256];
-	unsigned int i;
-	GString *response;
-	struct scpi_serial *sscpi = priv;
-	struct sr_serial_dev_inst *serial = sscpi->serial;
-
-	response = g_string_sized_new(1024);
-
-	for (i = 0; i <= SCPI_READ_RETRIES; i++) {
-		while ((len = serial_read(serial, buf, sizeof(buf))) > 0)
-			response = g_string_append_len(response, buf, len);
-
-		if (response->len > 0 &&
-		    response->str[response->len-1] == '\n') {
-			sr_spew("Fetched full SCPI response.");
-			break;
-		}
-
-		g_usleep(SCPI_READ_RETRY_TIMEOUT);
-	}
-
-	if (response->len == 0) {
-		sr_dbg("No SCPI response received.");
-		g_string_free(response, TRUE);
-		*scpi_response = NULL;
-		return SR_ERR;
-	} else if (response->str[response->len - 1] == '\n') {
-		/*
-		 * The SCPI response contains a LF ('\n') at the end and we
-		 * don't need this so replace it with a '\0' and decrement
-		 * the length.
-		 */
-		response->str[--response->len] = '\0';
-		ret = SR_OK;
-	} else {
-		sr_warn("Incomplete SCPI response received!");
-		ret = SR_ERR;
-	}
-
-	/* Minor optimization: steal the string instead of copying. */
-	*scpi_response = response->str;
-
-	/* A SCPI response can be quite large, print at most 50 characters. */
-	sr_dbg("SCPI response received (length %d): '%.50s'",
-	       response->len, response->str);
-
-	g_string_free(response, FALSE);
-
-	return ret;
-}
-
 SR_PRIV int scpi_serial_read_begin(void *priv)
 {
 	struct scpi_serial *sscpi = priv;
@@ -208,11 +154,11 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_serial_dev_inst_new(const char *port,
 	if (!(serial = sr_serial_dev_inst_new(port, serialcomm)))
 		return NULL;
 
-	sscpi = g_malloc(sizeof(struct scpi_serial));
+	sscpi = g_malloc0(sizeof(struct scpi_serial));
 
 	sscpi->serial = serial;
 
-	scpi = g_malloc(sizeof(struct sr_scpi_dev_inst));
+	scpi = g_malloc0(sizeof(struct sr_scpi_dev_inst));
 
 	scpi->open = scpi_serial_open;
 	scpi->source_add = scpi_serial_source_add;
@@ -224,6 +170,7 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_serial_dev_inst_new(const char *port,
 	scpi->close = scpi_serial_close;
 	scpi->free = scpi_serial_free;
 	scpi->priv = sscpi;
+	scpi->read_size = READ_SIZE;
 
 	return scpi;
 }
@@ -36,11 +36,26 @@
 #include <netdb.h>
 #endif
 #include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
 
 #define LOG_PREFIX "scpi_tcp"
 
 #define LENGTH_BYTES 4
 
+/* Size of bulk reads from the socket. */
+#define READ_SIZE (64 * 1024)
+
+/* How long a command may wait for room in the socket's send buffer (µs). */
+#define SEND_TIMEOUT (5 * G_USEC_PER_SEC)
+
+#ifdef _WIN32
+#define WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#define WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+#endif
+
 struct scpi_tcp {
 	char *address;
 	char *port;
@@ -51,6 +66,50 @@ struct scpi_tcp {
 	int response_bytes_read;
 };
 
+static int set_nonblocking(int fd)
+{
+#ifdef _WIN32
+	u_long mode = 1;
+
+	if (ioctlsocket(fd, FIONBIO, &mode) != 0)
+		return SR_ERR;
+#else
+	int flags;
+
+	if ((flags = fcntl(fd, F_GETFL)) < 0)
+		return SR_ERR;
+	if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return SR_ERR;
+#endif
+
+	return SR_OK;
+}
+
+/*
+ * Receive up to len bytes without blocking. Returns the number of bytes
+ * received, 0 if none are available yet, or SR_ERR.
+ */
+static int receive(struct scpi_tcp *tcp, char *buf, int len)
+{
+	int ret;
+
+	ret = recv(tcp->socket, buf, len, 0);
+
+	if (ret < 0) {
+		if (WOULD_BLOCK())
+			return 0;
+		sr_err("Receive error: %s", strerror(errno));
+		return SR_ERR;
+	}
+
+	if (ret == 0 && len > 0) {
+		sr_err("Connection closed by device.");
+		return SR_ERR;
+	}
+
+	return ret;
+}
+
 SR_PRIV int scpi_tcp_open(void *priv)
 {
 	struct scpi_tcp *tcp = priv;
@@ -91,6 +150,14 @@ SR_PRIV int scpi_tcp_open(void *priv)
 		return SR_ERR;
 	}
 
+	if (set_nonblocking(tcp->socket) != SR_OK) {
+		sr_err("Failed to make socket non-blocking: %s",
+				strerror(errno));
+		close(tcp->socket);
+		tcp->socket = -1;
+		return SR_ERR;
+	}
+
 	return SR_OK;
 }
 
@@ -112,23 +179,44 @@ SR_PRIV int scpi_tcp_source_remove(void *priv)
 SR_PRIV int scpi_tcp_send(void *priv, const char *command)
 {
 	struct scpi_tcp *tcp = priv;
-	int len, out;
+	int len, out, sent;
 	char *terminated_command;
+	gint64 deadline;
 
 	terminated_command = g_strdup_printf("%s\r\n", command);
 	len = strlen(terminated_command);
-	out = send(tcp->socket, terminated_command, len, 0);
-	g_free(terminated_command);
 
-	if (out < 0) {
-		sr_err("Send error: %s", strerror(errno));
-		return SR_ERR;
+	/*
+	 * The socket is non-blocking, so keep going until all is sent, but
+	 * give up on a peer that stopped reading.
+	 */
+	deadline = 0;
+	for (sent = 0; sent < len; sent += out) {
+		out = send(tcp->socket, terminated_command + sent,
+				len - sent, 0);
+		if (out < 0) {
+			if (WOULD_BLOCK()) {
+				out = 0;
+				if (!deadline)
+					deadline = g_get_monotonic_time()
+							+ SEND_TIMEOUT;
+				else if (g_get_monotonic_time() > deadline) {
+					sr_err("Timeout sending SCPI command.");
+					g_free(terminated_command);
+					return SR_ERR_TIMEOUT;
+				}
+				g_usleep(1000);
+				continue;
+			}
+			sr_err("Send error: %s", strerror(errno));
+			g_free(terminated_command);
+			return SR_ERR;
+		}
+		/* Progress, the peer is still reading. */
+		deadline = 0;
 	}
 
-	if (out < len) {
-		sr_dbg("Only sent %d/%d bytes of SCPI command: '%s'.", out,
-		       len, command);
-	}
+	g_free(terminated_command);
 
 	sr_spew("Successfully sent SCPI command: '%s'.", command);
 
@@ -151,12 +239,10 @@ SR_PRIV int scpi_tcp_read_data(void *priv, char *buf, int maxlen)
 	int len;
 
 	if (tcp->length_bytes_read < LENGTH_BYTES) {
-		len = recv(tcp->socket, tcp->length_buf + tcp->length_bytes_read,
-				LENGTH_BYTES - tcp->length_bytes_read, 0);
-		if (len < 0) {
-			sr_err("Receive error: %s", strerror(errno));
+		len = receive(tcp, tcp->length_buf + tcp->length_bytes_read,
+				LENGTH_BYTES - tcp->length_bytes_read);
+		if (len < 0)
 			return SR_ERR;
-		}
 
 		tcp->length_bytes_read += len;
 
@@ -169,12 +255,12 @@ SR_PRIV int scpi_tcp_read_data(void *priv, char *buf, int maxlen)
 	if (tcp->response_bytes_read >= tcp->response_length)
 		return SR_ERR;
 
-	len = recv(tcp->socket, buf, maxlen, 0);
+	/* Don't read past this response into the next one. */
+	if (maxlen > tcp->response_length - tcp->response_bytes_read)
+		maxlen = tcp->response_length - tcp->response_bytes_read;
 
-	if (len < 0) {
-		sr_err("Receive error: %s", strerror(errno));
+	if ((len = receive(tcp, buf, maxlen)) < 0)
 		return SR_ERR;
-	}
 
 	tcp->response_bytes_read += len;
 
@@ -214,7 +300,7 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_tcp_dev_inst_new(const char *address,
 	struct sr_scpi_dev_inst *scpi;
 	struct scpi_tcp *tcp;
 
-	scpi = g_malloc(sizeof(struct sr_scpi_dev_inst));
+	scpi = g_malloc0(sizeof(struct sr_scpi_dev_inst));
 	tcp = g_malloc0(sizeof(struct scpi_tcp));
 
 	tcp->address = g_strdup(address);
@@ -231,6 +317,7 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_tcp_dev_inst_new(const char *address,
 	scpi->close = scpi_tcp_close;
 	scpi->free = scpi_tcp_free;
 	scpi->priv = tcp;
+	scpi->read_size = READ_SIZE;
 
 	return scpi;
 }
@@ -25,26 +25,49 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/ioctl.h>
 
 #define LOG_PREFIX "scpi_usbtmc"
 
-#define MAX_READ_LENGTH 2048
+/*
+ * Size of bulk reads from the usbtmc device: a multiple of the high-speed
+ * bulk endpoint packet size, so the kernel can transfer whole packets.
+ */
+#define MAX_PACKET_SIZE 512
+#define READ_SIZE (32 * MAX_PACKET_SIZE)
+
+/*
+ * Get the bmTransferAttributes of the last DEV_DEP_MSG_IN transfer, as
+ * defined in <linux/usb/tmc.h> since Linux 4.20. Bit 0 is the end of
+ * message (EOM) flag.
+ */
+#ifndef USBTMC_IOCTL_MSG_IN_ATTR
+#define USBTMC_IOCTL_MSG_IN_ATTR _IOR(91, 24, uint8_t)
+#endif
+#define USBTMC_MSG_IN_ATTR_EOM 0x01
 
 struct usbtmc_scpi {
 	struct sr_usbtmc_dev_inst *usbtmc;
-	char response_buffer[MAX_READ_LENGTH];
-	int response_length;
-	int response_bytes_read;
+	/* The kernel driver reports the EOM flag of bulk-in transfers. */
+	gboolean has_msg_in_attr;
+	gboolean response_complete;
 };
 
 SR_PRIV int scpi_usbtmc_open(void *priv)
 {
 	struct usbtmc_scpi *uscpi = priv;
 	struct sr_usbtmc_dev_inst *usbtmc = uscpi->usbtmc;
+	uint8_t attr;
 
 	if ((usbtmc->fd = open(usbtmc->device, O_RDWR)) < 0)
 		return SR_ERR;
 
+	uscpi->has_msg_in_attr =
+		ioctl(usbtmc->fd, USBTMC_IOCTL_MSG_IN_ATTR, &attr) == 0;
+	if (!uscpi->has_msg_in_attr)
+		sr_dbg("No EOM flag from the usbtmc driver, using the "
+		       "response terminator instead.");
+
 	return SR_OK;
 }
 
@@ -92,18 +115,8 @@ SR_PRIV int scpi_usbtmc_send(void *priv, const char *command)
 SR_PRIV int scpi_usbtmc_read_begin(void *priv)
 {
 	struct usbtmc_scpi *uscpi = priv;
-	struct sr_usbtmc_dev_inst *usbtmc = uscpi->usbtmc;
-	int len;
-
-	len = read(usbtmc->fd, uscpi->response_buffer, MAX_READ_LENGTH);
-
-	if (len < 0) {
-		sr_err("Read error: %s", strerror(errno));
-		return SR_ERR;
-	}
 
-	uscpi->response_length = len;
-	uscpi->response_bytes_read = 0;
+	uscpi->response_complete = FALSE;
 
 	return SR_OK;
 }
@@ -111,37 +124,49 @@ SR_PRIV int scpi_usbtmc_read_begin(void *priv)
 SR_PRIV int scpi_usbtmc_read_data(void *priv, char *buf, int maxlen)
 {
 	struct usbtmc_scpi *uscpi = priv;
-	int read_length;
-
-	if (uscpi->response_length == MAX_READ_LENGTH
-	    && uscpi->response_bytes_read == uscpi->response_length)
-		if (scpi_usbtmc_read_begin(uscpi) != SR_OK)
-			return SR_ERR;
+	struct sr_usbtmc_dev_inst *usbtmc = uscpi->usbtmc;
+	uint8_t attr;
+	int len;
 
-	if (uscpi->response_bytes_read >= uscpi->response_length)
+	if (uscpi->response_complete)
 		return SR_ERR;
 
-	read_length = uscpi->response_length - uscpi->response_bytes_read;
-
-	if (read_length > maxlen)
-		read_length = maxlen;
+	len = read(usbtmc->fd, buf, maxlen);
 
-	memcpy(buf, uscpi->response_buffer + uscpi->response_bytes_read, read_length);
+	if (len < 0) {
+		sr_err("Read error: %s", strerror(errno));
+		return SR_ERR;
+	}
 
-	uscpi->response_bytes_read += read_length;
+	/*
+	 * The kernel driver stops a read at the end of the message, so a
+	 * short read ends the response. A read that filled the buffer may
+	 * have ended exactly at the end of the message too. Reading again
+	 * would then block until the driver times out, so check the EOM flag
+	 * of the last transfer. Without that, a full read that ends in the
+	 * response terminator is taken as the end.
+	 */
+	if (len < maxlen) {
+		uscpi->response_complete = TRUE;
+	} else if (uscpi->has_msg_in_attr) {
+		if (ioctl(usbtmc->fd, USBTMC_IOCTL_MSG_IN_ATTR, &attr) < 0) {
+			sr_err("Failed to get transfer attributes: %s",
+			       strerror(errno));
+			return SR_ERR;
+		}
+		uscpi->response_complete = attr & USBTMC_MSG_IN_ATTR_EOM;
+	} else {
+		uscpi->response_complete = len > 0 && buf[len - 1] == '\n';
+	}
 
-	return read_length;
+	return len;
 }
 
 SR_PRIV int scpi_usbtmc_read_complete(void *priv)
 {
 	struct usbtmc_scpi *uscpi = priv;
 
-	if (uscpi->response_length == MAX_READ_LENGTH
-	    && uscpi->response_bytes_read == uscpi->response_length)
-		scpi_usbtmc_read_begin(uscpi);
-
-	return (uscpi->response_bytes_read >= uscpi->response_length);
+	return uscpi->response_complete;
 }
 
 SR_PRIV int scpi_usbtmc_close(void *priv)
@@ -173,11 +198,11 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_usbtmc_dev_inst_new(const char *device)
 	if (!(usbtmc = sr_usbtmc_dev_inst_new(device)))
 		return NULL;
 
-	uscpi = g_malloc(sizeof(struct usbtmc_scpi));
+	uscpi = g_malloc0(sizeof(struct usbtmc_scpi));
 
 	uscpi->usbtmc = usbtmc;
 
-	scpi = g_malloc(sizeof(struct sr_scpi_dev_inst));
+	scpi = g_malloc0(sizeof(struct sr_scpi_dev_inst));
 
 	scpi->open = scpi_usbtmc_open;
 	scpi->source_add = scpi_usbtmc_source_add;
@@ -189,6 +214,7 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_usbtmc_dev_inst_new(const char *device)
 	scpi->close = scpi_usbtmc_close;
 	scpi->free = scpi_usbtmc_free;
 	scpi->priv = uscpi;
+	scpi->read_size = READ_SIZE;
 
 	return scpi;
 }
@@ -28,6 +28,19 @@
 
 #define LOG_PREFIX "serial"
 
+/* Size of the per-port receive buffer. */
+#define SERIAL_RXBUF_SIZE 4096
+
+static void serial_rx_free(struct sr_serial_dev_inst *serial)
+{
+	if (serial->rx_event_set)
+		sp_free_event_set(serial->rx_event_set);
+	serial->rx_event_set = NULL;
+	g_free(serial->rxbuf);
+	serial->rxbuf = NULL;
+	serial->rxbuf_pos = serial->rxbuf_len = 0;
+}
+
 /**
  * Open the specified serial port.
  *
@@ -76,6 +89,28 @@ SR_PRIV int serial_open(struct sr_serial_dev_inst *serial, int flags)
 		return SR_ERR;
 	}
 
+	/* Reuse whatever an earlier open of this port left behind. */
+	if (serial->rx_event_set) {
+		sp_free_event_set(serial->rx_event_set);
+		serial->rx_event_set = NULL;
+	}
+	serial->rxbuf_pos = serial->rxbuf_len = 0;
+	if (!serial->rxbuf
+			&& !(serial->rxbuf = g_try_malloc(SERIAL_RXBUF_SIZE))) {
+		sr_err("Serial receive buffer malloc failed.");
+		sp_close(serial->data);
+		return SR_ERR_MALLOC;
+	}
+
+	if (sp_new_event_set(&serial->rx_event_set) != SP_OK
+			|| sp_add_port_events(serial->rx_event_set, serial->data,
+				SP_EVENT_RX_READY) != SP_OK) {
+		sr_err("Failed to set up serial port events.");
+		serial_rx_free(serial);
+		sp_close(serial->data);
+		return SR_ERR;
+	}
+
 	if (serial->serialcomm)
 		return serial_set_paramstr(serial, serial->serialcomm);
 	else
@@ -106,6 +141,8 @@ SR_PRIV int serial_close(struct sr_serial_dev_inst *serial)
 
 	sr_spew("Closing serial port %s.", serial->port);
 
+	serial_rx_free(serial);
+
 	ret = sp_close(serial->data);
 
 	switch (ret) {
@@ -150,6 +187,8 @@ SR_PRIV int serial_flush(struct sr_serial_dev_inst *serial)
 
 	sr_spew("Flushing serial port %s.", serial->port);
 
+	serial->rxbuf_pos = serial->rxbuf_len = 0;
+
 	ret = sp_flush(serial->data, SP_BUF_BOTH);
 
 	switch (ret) {
@@ -231,22 +270,12 @@ SR_PRIV int serial_write_nonblocking(struct sr_serial_dev_inst *serial,
 	return _serial_write(serial, buf, count, 1);
 }
 
-static int _serial_read(struct sr_serial_dev_inst *serial, void *buf,
+static int serial_port_read(struct sr_serial_dev_inst *serial, void *buf,
 		size_t count, int nonblocking)
 {
 	ssize_t ret;
 	char *error;
 
-	if (!serial) {
-		sr_dbg("Invalid serial port.");
-		return SR_ERR;
-	}
-
-	if (!serial->data) {
-		sr_dbg("Cannot use unopened serial port %s.", serial->port);
-		return SR_ERR;
-	}
-
 	if (nonblocking)
 		ret = sp_nonblocking_read(serial->data, buf, count);
 	else
@@ -269,6 +298,97 @@ static int _serial_read(struct sr_serial_dev_inst *serial, void *buf,
 	return ret;
 }
 
+/* Drop count bytes from the front of the receive buffer. */
+static void rx_consume(struct sr_serial_dev_inst *serial, size_t count)
+{
+	serial->rxbuf_pos += count;
+	serial->rxbuf_len -= count;
+	if (!serial->rxbuf_len)
+		serial->rxbuf_pos = 0;
+}
+
+/* Move up to count buffered bytes into buf. */
+static size_t rx_take(struct sr_serial_dev_inst *serial, void *buf,
+		size_t count)
+{
+	count = MIN(count, serial->rxbuf_len);
+	if (count) {
+		memcpy(buf, serial->rxbuf + serial->rxbuf_pos, count);
+		rx_consume(serial, count);
+	}
+
+	return count;
+}
+
+/* Append whatever the port has available to the receive buffer. */
+static int rx_fill(struct sr_serial_dev_inst *serial)
+{
+	size_t space;
+	int ret;
+
+	space = SERIAL_RXBUF_SIZE - serial->rxbuf_pos - serial->rxbuf_len;
+	if (serial->rxbuf_pos && space < SERIAL_RXBUF_SIZE / 2) {
+		memmove(serial->rxbuf, serial->rxbuf + serial->rxbuf_pos,
+				serial->rxbuf_len);
+		serial->rxbuf_pos = 0;
+		space = SERIAL_RXBUF_SIZE - serial->rxbuf_len;
+	}
+	if (!space)
+		return 0;
+
+	ret = serial_port_read(serial,
+			serial->rxbuf + serial->rxbuf_pos + serial->rxbuf_len,
+			space, 1);
+	if (ret > 0)
+		serial->rxbuf_len += ret;
+
+	return ret;
+}
+
+/* Wait until the port has data to read, or timeout_ms (0 = forever). */
+static int rx_wait(struct sr_serial_dev_inst *serial, unsigned int timeout_ms)
+{
+	if (sp_wait(serial->rx_event_set, timeout_ms) != SP_OK) {
+		sr_err("Error waiting for data on %s.", serial->port);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Data read ahead by the line and packet readers is handed out first.
+ * Plain reads never read ahead themselves, so that whatever they leave
+ * unread stays in the OS buffer and keeps the port's poll source firing.
+ */
+static int _serial_read(struct sr_serial_dev_inst *serial, void *buf,
+		size_t count, int nonblocking)
+{
+	size_t done;
+	int ret;
+
+	if (!serial) {
+		sr_dbg("Invalid serial port.");
+		return SR_ERR;
+	}
+
+	if (!serial->data) {
+		sr_dbg("Cannot use unopened serial port %s.", serial->port);
+		return SR_ERR;
+	}
+
+	done = rx_take(serial, buf, count);
+	if (done == count || (done && nonblocking))
+		return done;
+
+	ret = serial_port_read(serial, (uint8_t *)buf + done, count - done,
+			nonblocking);
+	if (ret < 0)
+		return done ? (int)done : ret;
+
+	return done + ret;
+}
+
 /**
  * Read a number of bytes from the specified serial port.
  *
@@ -489,6 +609,35 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
 	}
 }
 
+/*
+ * Extract a CR/LF terminated line from the receive buffer, stripping the
+ * terminator. If the line doesn't fit, as much as fits is returned. With
+ * partial set, any buffered data counts as a line.
+ */
+static gboolean rx_getline(struct sr_serial_dev_inst *serial, char *buf,
+		int maxlen, int *len, gboolean partial)
+{
+	const uint8_t *p;
+	size_t n, i;
+
+	n = MIN(serial->rxbuf_len, (size_t)maxlen - 1);
+	p = serial->rxbuf + serial->rxbuf_pos;
+	for (i = 0; i < n; i++) {
+		if (p[i] == '\r' || p[i] == '\n')
+			break;
+	}
+	if (i == n && !partial && n < (size_t)maxlen - 1
+			&& serial->rxbuf_len < SERIAL_RXBUF_SIZE)
+		return FALSE;
+
+	memcpy(buf, p, i);
+	buf[i] = '\0';
+	*len = i;
+	rx_consume(serial, i < n ? i + 1 : i);
+
+	return TRUE;
+}
+
 /**
  * Read a line from the specified serial port.
  *
@@ -505,8 +654,8 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
 SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial, char **buf,
 		int *buflen, gint64 timeout_ms)
 {
-	gint64 start;
-	int maxlen, len;
+	gint64 start, elapsed;
+	int maxlen, ret;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -518,31 +667,23 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial, char **buf,
 		return -1;
 	}
 
-	timeout_ms *= 1000;
 	start = g_get_monotonic_time();
 
 	maxlen = *buflen;
-	*buflen = len = 0;
-	while(1) {
-		len = maxlen - *buflen - 1;
-		if (len < 1)
+	*buflen = 0;
+	if (maxlen < 1)
+		return SR_OK;
+
+	while (!rx_getline(serial, *buf, maxlen, buflen, FALSE)) {
+		if ((ret = rx_fill(serial)) > 0)
+			continue;
+		elapsed = (g_get_monotonic_time() - start) / 1000;
+		if (ret < 0 || elapsed >= timeout_ms
+				|| rx_wait(serial, timeout_ms - elapsed) != SR_OK) {
+			/* Timeout, hand out what we have. */
+			rx_getline(serial, *buf, maxlen, buflen, TRUE);
 			break;
-		len = serial_read(serial, *buf + *buflen, 1);
-		if (len > 0) {
-			*buflen += len;
-			*(*buf + *buflen) = '\0';
-			if (*buflen > 0 && (*(*buf + *buflen - 1) == '\r'
-					|| *(*buf + *buflen - 1) == '\n')) {
-				/* Strip CR/LF and terminate. */
-				*(*buf + --*buflen) = '\0';
-				break;
-			}
 		}
-		if (g_get_monotonic_time() - start > timeout_ms)
-			/* Timeout */
-			break;
-		if (len < 1)
-			g_usleep(2000);
 	}
 	if (*buflen)
 		sr_dbg("Received %d: '%s'.", *buflen, *buf);
@@ -550,6 +691,54 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial, char **buf,
 	return SR_OK;
 }
 
+/**
+ * Read a line from the specified serial port, without blocking.
+ *
+ * This is meant to be called from a session source callback. All data
+ * the port has available is read in one go; call it repeatedly until no
+ * line is returned, since complete lines may already be buffered without
+ * the port signalling new data.
+ *
+ * Reading stops when CR or LF is found, which is stripped from the buffer.
+ * Empty lines are skipped.
+ *
+ * @param serial Previously initialized serial port structure.
+ * @param buf Buffer where to store the line, NUL-terminated.
+ * @param buflen Size of the buffer on input; length of the line on output,
+ *               or 0 if no complete line is available yet.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ * @retval SR_ERR Read failure.
+ */
+SR_PRIV int serial_readline_nonblocking(struct sr_serial_dev_inst *serial,
+		char *buf, int *buflen)
+{
+	int maxlen, ret;
+
+	if (!serial || !serial->data) {
+		sr_dbg("Invalid serial port.");
+		return SR_ERR;
+	}
+
+	maxlen = *buflen;
+	*buflen = 0;
+	if (maxlen < 2)
+		return SR_ERR_ARG;
+
+	while (1) {
+		if (rx_getline(serial, buf, maxlen, buflen, FALSE)) {
+			if (*buflen)
+				return SR_OK;
+			continue;
+		}
+		if ((ret = rx_fill(serial)) < 0)
+			return SR_ERR;
+		if (ret == 0)
+			return SR_OK;
+	}
+}
+
 /**
  * Try to find a valid packet in a serial data stream.
  *
@@ -572,7 +761,7 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 				 size_t packet_size, packet_valid_t is_valid,
 				 uint64_t timeout_ms, int baudrate)
 {
-	uint64_t start, time, byte_delay_us;
+	uint64_t start, time;
 	size_t ibuf, i, maxlen;
 	int len;
 
@@ -586,45 +775,35 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 		return SR_ERR;
 	}
 
-	/* Assume 8n1 transmission. That is 10 bits for every byte. */
-	byte_delay_us = 10 * (1000000 / baudrate);
 	start = g_get_monotonic_time();
 
-	i = ibuf = len = 0;
+	i = ibuf = 0;
 	while (ibuf < maxlen) {
-		len = serial_read(serial, &buf[ibuf], 1);
-		if (len > 0) {
-			ibuf += len;
-		} else if (len == 0) {
-			/* No logging, already done in serial_read(). */
-		} else {
-			/* Error reading byte, but continuing anyway. */
-		}
+		/* Take everything that has arrived so far. */
+		len = rx_fill(serial);
+		ibuf += rx_take(serial, &buf[ibuf], maxlen - ibuf);
 
 		time = g_get_monotonic_time() - start;
 		time /= 1000;
 
-		if ((ibuf - i) >= packet_size) {
-			/* We have at least a packet's worth of data. */
+		/* Try every offset that has a packet's worth of data. */
+		for (; ibuf - i >= packet_size; i++) {
 			if (is_valid(&buf[i])) {
-				sr_spew("Found valid %d-byte packet after "
-					"%" PRIu64 "ms.", (ibuf - i), time);
+				sr_spew("Found valid %d-byte packet at offset "
+					"%d after %" PRIu64 "ms.", packet_size,
+					i, time);
 				*buflen = ibuf;
 				return SR_OK;
-			} else {
-				sr_spew("Got %d bytes, but not a valid "
-					"packet.", (ibuf - i));
 			}
-			/* Not a valid packet. Continue searching. */
-			i++;
 		}
+
 		if (time >= timeout_ms) {
 			/* Timeout */
 			sr_dbg("Detection timed out after %dms.", time);
 			break;
 		}
-		if (len < 1)
-			g_usleep(byte_delay_us);
+		if (len < 1 && rx_wait(serial, timeout_ms - time) != SR_OK)
+			break;
 	}
 
 	*buflen = ibuf;
@@ -634,6 +813,170 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 	return SR_ERR;
 }
 
+/**
+ * Read a packet from the specified serial port, without blocking.
+ *
+ * All data the port has available is read, and searched for a valid packet.
+ * Data in front of the packet is discarded. This is meant to be called from
+ * a session source callback, repeatedly until no packet is returned.
+ *
+ * @param serial Previously initialized serial port structure.
+ * @param buf Buffer where to store the packet.
+ * @param[in] packet_size Size, in bytes, of a valid packet.
+ * @param is_valid Callback that assesses whether the packet is valid or not.
+ *
+ * @return The packet size if a packet was found, 0 if not, or a negative
+ *         error code upon failure.
+ */
+SR_PRIV int serial_read_packet(struct sr_serial_dev_inst *serial,
+		uint8_t *buf, size_t packet_size, packet_valid_t is_valid)
+{
+	int ret;
+
+	if (!serial || !serial->data) {
+		sr_dbg("Invalid serial port.");
+		return SR_ERR;
+	}
+
+	if (packet_size > SERIAL_RXBUF_SIZE)
+		return SR_ERR_ARG;
+
+	while (1) {
+		while (serial->rxbuf_len >= packet_size) {
+			if (is_valid(serial->rxbuf + serial->rxbuf_pos)) {
+				rx_take(serial, buf, packet_size);
+				return packet_size;
+			}
+			rx_consume(serial, 1);
+		}
+		if ((ret = rx_fill(serial)) <= 0)
+			return ret;
+	}
+}
+
+/*
+ * Find the next packet in buf. Returns the packet's size, or 0 if more data
+ * is needed. In both cases *skip is set to the number of garbage bytes in
+ * front, which the caller should discard.
+ */
+static size_t packet_find(const struct serial_packet_desc *desc,
+		const uint8_t *buf, size_t len, size_t *skip)
+{
+	const uint8_t *p, *end, *term;
+	size_t size, max_size;
+
+	max_size = MAX(desc->packet_size, desc->max_size);
+	p = buf;
+	end = buf + len;
+	while (p < end) {
+		if (desc->sync_len) {
+			/* Jump straight to the next candidate sync byte. */
+			if (!(p = memchr(p, desc->sync[0], end - p))) {
+				p = end;
+				break;
+			}
+			if ((size_t)(end - p) < desc->sync_len)
+				break;
+			if (memcmp(p, desc->sync, desc->sync_len)) {
+				p++;
+				continue;
+			}
+		}
+
+		if ((size_t)(end - p) < desc->packet_size)
+			break;
+
+		if (desc->length_offset >= 0) {
+			size = p[desc->length_offset] + desc->length_extra;
+		} else if (desc->terminator >= 0) {
+			term = memchr(p + desc->sync_len, desc->terminator,
+					MIN((size_t)(end - p), max_size)
+					- desc->sync_len);
+			if (!term) {
+				if ((size_t)(end - p) < max_size)
+					break;
+				/* Overlong, not a packet. */
+				p++;
+				continue;
+			}
+			size = term - p + 1;
+		} else {
+			size = desc->packet_size;
+		}
+
+		if (size < desc->packet_size || size > max_size) {
+			p++;
+			continue;
+		}
+		if ((size_t)(end - p) < size)
+			break;
+		if (desc->is_valid && !desc->is_valid(p)) {
+			p++;
+			continue;
+		}
+
+		*skip = p - buf;
+		return size;
+	}
+
+	*skip = p - buf;
+
+	return 0;
+}
+
+/**
+ * Receive packets from the specified serial port, without blocking.
+ *
+ * All data the port has available is read, split into packets as described
+ * by desc, and each valid packet is handed to the handler. Data that doesn't
+ * belong to a valid packet is skipped. This is meant to be called from a
+ * session source callback when the port signals new data.
+ *
+ * @param serial Previously initialized serial port structure.
+ * @param desc Description of the packet framing.
+ * @param handler Callback that is called with each valid packet.
+ * @param cb_data Opaque pointer passed to the handler.
+ *
+ * @return The number of packets handled, or a negative error code upon
+ *         failure.
+ */
+SR_PRIV int serial_receive(struct sr_serial_dev_inst *serial,
+		const struct serial_packet_desc *desc,
+		packet_handler_t handler, void *cb_data)
+{
+	size_t size, skip;
+	int ret, count;
+
+	if (!serial || !serial->data) {
+		sr_dbg("Invalid serial port.");
+		return SR_ERR;
+	}
+
+	if (!desc->packet_size || desc->packet_size < desc->sync_len
+			|| MAX(desc->packet_size, desc->max_size) > SERIAL_RXBUF_SIZE
+			|| (int)desc->packet_size <= desc->length_offset)
+		return SR_ERR_ARG;
+
+	count = 0;
+	do {
+		if ((ret = rx_fill(serial)) < 0)
+			return ret;
+		while ((size = packet_find(desc, serial->rxbuf + serial->rxbuf_pos,
+				serial->rxbuf_len, &skip))) {
+			rx_consume(serial, skip);
+			handler(serial->rxbuf + serial->rxbuf_pos, size, cb_data);
+			count++;
+			/* The handler may have stopped acquisition. */
+			if (!serial->rxbuf)
+				return count;
+			rx_consume(serial, size);
+		}
+		rx_consume(serial, skip);
+	} while (ret > 0);
+
+	return count;
+}
+
 /**
  * Extract the serial device and options from the options linked list.
  *
@@ -36,8 +36,14 @@
 #define DEFAULT_NUM_LOGIC_PROBES     8
 #define DEFAULT_NUM_ANALOG_PROBES    4
 
-/* The size in bytes of chunks to send through the session bus. */
+/* The default size in bytes of chunks to send through the session bus. */
 #define LOGIC_BUFSIZE        4096
+/* The maximum configurable size in bytes of logic chunks. */
+#define MAX_LOGIC_BUFSIZE    (64 * 1024 * 1024)
+/* Number of samples after which the random pattern repeats. */
+#define RANDOM_PERIOD        (64 * 1024)
+/* Maximum time in us spent sending data per callback when unthrottled. */
+#define MAX_SEND_TIME        20000
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE       4096
 
@@ -102,12 +108,26 @@ struct dev_context {
 	uint64_t limit_msec;
 	uint64_t samples_counter;
 	int64_t starttime;
-	uint64_t step;
+	gboolean throttle;
 	/* Logic */
 	int32_t num_logic_probes;
 	unsigned int logic_unitsize;
 	uint8_t logic_pattern;
-	unsigned char logic_data[LOGIC_BUFSIZE];
+	uint64_t logic_bufsize;
+	gboolean rle;
+	/*
+	 * One period of the logic pattern, followed by enough repetitions
+	 * that a packet starting anywhere in the first period is contiguous.
+	 */
+	uint8_t *logic_ring;
+	uint64_t ring_period;
+	uint64_t ring_pos;
+	/* The pattern period as runs, and the runs of the current packet. */
+	uint8_t *period_values;
+	uint64_t *period_lengths;
+	uint64_t num_period_runs;
+	uint8_t *rle_values;
+	uint64_t *rle_lengths;
 	/* Analog */
 	int32_t num_analog_probes;
 	GSList *analog_probe_groups;
@@ -116,6 +136,7 @@ struct dev_context {
 static const int32_t hwopts[] = {
 	SR_CONF_NUM_LOGIC_PROBES,
 	SR_CONF_NUM_ANALOG_PROBES,
+	SR_CONF_NUM_DEVICES,
 };
 
 static const int hwcaps[] = {
@@ -125,6 +146,9 @@ static const int hwcaps[] = {
 	SR_CONF_PATTERN_MODE,
 	SR_CONF_LIMIT_SAMPLES,
 	SR_CONF_LIMIT_MSEC,
+	SR_CONF_BUFFERSIZE,
+	SR_CONF_RLE,
+	SR_CONF_THROTTLE,
 };
 
 static const uint64_t samplerates[] = {
@@ -197,13 +221,14 @@ static GSList *scan(GSList *options)
 	struct sr_config *src;
 	struct analog_gen *ag;
 	GSList *devices, *l;
-	int num_logic_probes, num_analog_probes, i;
+	int num_logic_probes, num_analog_probes, num_devices, i, dev;
 	char probe_name[16];
 
 	drvc = di->priv;
 
 	num_logic_probes = DEFAULT_NUM_LOGIC_PROBES;
 	num_analog_probes = DEFAULT_NUM_ANALOG_PROBES;
+	num_devices = 1;
 	for (l = options; l; l = l->next) {
 		src = l->data;
 		switch (src->key) {
@@ -213,77 +238,85 @@ static GSList *scan(GSList *options)
 		case SR_CONF_NUM_ANALOG_PROBES:
 			num_analog_probes = g_variant_get_int32(src->data);
 			break;
+		case SR_CONF_NUM_DEVICES:
+			num_devices = g_variant_get_int32(src->data);
+			break;
 		}
 	}
 
 	devices = NULL;
-	sdi = sr_dev_inst_new(0, SR_ST_ACTIVE, "Demo device", NULL, NULL);
-	if (!sdi) {
-		sr_err("Device instance creation failed.");
-		return NULL;
-	}
-	sdi->driver = di;
-
-	if (!(devc = g_try_malloc(sizeof(struct dev_context)))) {
-		sr_err("Device context malloc failed.");
-		return NULL;
-	}
-	devc->cur_samplerate = SR_KHZ(200);
-	devc->limit_samples = 0;
-	devc->limit_msec = 0;
-	devc->step = 0;
-	devc->num_logic_probes = num_logic_probes;
-	devc->logic_unitsize = (devc->num_logic_probes + 7) / 8;
-	devc->logic_pattern = PATTERN_SIGROK;
-	devc->num_analog_probes = num_analog_probes;
-	devc->analog_probe_groups = NULL;
-
-	/* Logic probes, all in one probe group. */
-	if (!(pg = g_try_malloc(sizeof(struct sr_probe_group))))
-		return NULL;
-	pg->name = g_strdup("Logic");
-	pg->probes = NULL;
-	pg->priv = NULL;
-	for (i = 0; i < num_logic_probes; i++) {
-		sprintf(probe_name, "D%d", i);
-		if (!(probe = sr_probe_new(i, SR_PROBE_LOGIC, TRUE, probe_name)))
-			return NULL;
-		sdi->probes = g_slist_append(sdi->probes, probe);
-		pg->probes = g_slist_append(pg->probes, probe);
-	}
-	sdi->probe_groups = g_slist_append(NULL, pg);
-
-	/* Analog probes, probe groups and pattern generators. */
-	for (i = 0; i < num_analog_probes; i++) {
-		sprintf(probe_name, "A%d", i);
-		if (!(probe = sr_probe_new(i, SR_PROBE_ANALOG, TRUE, probe_name)))
-			return NULL;
-		sdi->probes = g_slist_append(sdi->probes, probe);
+	for (dev = 0; dev < num_devices; dev++) {
+		sdi = sr_dev_inst_new(dev, SR_ST_ACTIVE, "Demo device", NULL, NULL);
+		if (!sdi) {
+			sr_err("Device instance creation failed.");
+			return devices;
+		}
+		sdi->driver = di;
 
-		/* Every analog probe gets its own probe group. */
+		if (!(devc = g_try_malloc0(sizeof(struct dev_context)))) {
+			sr_err("Device context malloc failed.");
+			return devices;
+		}
+		devc->cur_samplerate = SR_KHZ(200);
+		devc->limit_samples = 0;
+		devc->limit_msec = 0;
+		devc->throttle = TRUE;
+		devc->num_logic_probes = num_logic_probes;
+		devc->logic_unitsize = (devc->num_logic_probes + 7) / 8;
+		devc->logic_pattern = PATTERN_SIGROK;
+		devc->logic_bufsize = LOGIC_BUFSIZE;
+		devc->rle = FALSE;
+		devc->num_analog_probes = num_analog_probes;
+		devc->analog_probe_groups = NULL;
+
+		/* Logic probes, all in one probe group. */
 		if (!(pg = g_try_malloc(sizeof(struct sr_probe_group))))
-			return NULL;
-		pg->name = g_strdup(probe_name);
-		pg->probes = g_slist_append(NULL, probe);
-
-		/* Every probe group gets a generator struct. */
-		if (!(ag = g_try_malloc(sizeof(struct analog_gen))))
-			return NULL;
-		ag->packet.probes = pg->probes;
-		ag->packet.mq = 0;
-		ag->packet.mqflags = 0;
-		ag->packet.unit = SR_UNIT_VOLT;
-		ag->packet.data = ag->pattern_data;
-		pg->priv = ag;
-		set_analog_pattern(pg, PATTERN_SQUARE);
-
-		sdi->probe_groups = g_slist_append(sdi->probe_groups, pg);
-		devc->analog_probe_groups = g_slist_append(devc->analog_probe_groups, pg);
-	}
+			return devices;
+		pg->name = g_strdup("Logic");
+		pg->probes = NULL;
+		pg->priv = NULL;
+		for (i = 0; i < num_logic_probes; i++) {
+			sprintf(probe_name, "D%d", i);
+			if (!(probe = sr_probe_new(i, SR_PROBE_LOGIC, TRUE, probe_name)))
+				return devices;
+			sdi->probes = g_slist_append(sdi->probes, probe);
+			pg->probes = g_slist_append(pg->probes, probe);
+		}
+		sdi->probe_groups = g_slist_append(NULL, pg);
+
+		/* Analog probes, probe groups and pattern generators. */
+		for (i = 0; i < num_analog_probes; i++) {
+			sprintf(probe_name, "A%d", i);
+			if (!(probe = sr_probe_new(i, SR_PROBE_ANALOG, TRUE, probe_name)))
+				return devices;
+			sdi->probes = g_slist_append(sdi->probes, probe);
+
+			/* Every analog probe gets its own probe group. */
+			if (!(pg = g_try_malloc(sizeof(struct sr_probe_group))))
+				return devices;
+			pg->name = g_strdup(probe_name);
+			pg->probes = g_slist_append(NULL, probe);
+
+			/* Every probe group gets a generator struct. */
+			if (!(ag = g_try_malloc(sizeof(struct analog_gen))))
+				return devices;
+			ag->packet.probes = pg->probes;
+			ag->packet.mq = 0;
+			ag->packet.mqflags = 0;
+			ag->packet.unit = SR_UNIT_VOLT;
+			ag->packet.data = ag->pattern_data;
+			ag->packet.timestamps = NULL;
+			pg->priv = ag;
+			set_analog_pattern(pg, PATTERN_SQUARE);
+
+			sdi->probe_groups = g_slist_append(sdi->probe_groups, pg);
+			devc->analog_probe_groups = g_slist_append(devc->analog_probe_groups, pg);
+		}
 
-	sdi->priv = devc;
-	devices = g_slist_append(devices, sdi);
-	drvc->instances = g_slist_append(drvc->instances, sdi);
+		sdi->priv = devc;
+		devices = g_slist_append(devices, sdi);
+		drvc->instances = g_slist_append(drvc->instances, sdi);
+	}
 
 	return devices;
 }
@@ -339,6 +372,15 @@ static int config_get(int id, GVariant **data, const struct sr_dev_inst *sdi,
 	case SR_CONF_NUM_ANALOG_PROBES:
 		*data = g_variant_new_int32(devc->num_analog_probes);
 		break;
+	case SR_CONF_BUFFERSIZE:
+		*data = g_variant_new_uint64(devc->logic_bufsize);
+		break;
+	case SR_CONF_RLE:
+		*data = g_variant_new_boolean(devc->rle);
+		break;
+	case SR_CONF_THROTTLE:
+		*data = g_variant_new_boolean(devc->throttle);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -354,6 +396,7 @@ static int config_set(int id, GVariant *data, const struct sr_dev_inst *sdi,
 	GSList *l;
 	int logic_pattern, analog_pattern, ret;
 	unsigned int i;
+	uint64_t bufsize;
 	const char *stropt;
 
 	devc = sdi->priv;
@@ -377,6 +420,21 @@ static int config_set(int id, GVariant *data, const struct sr_dev_inst *sdi,
 		devc->limit_samples = 0;
 		sr_dbg("Setting time limit to %" PRIu64"ms", devc->limit_msec);
 		ret = SR_OK;
+	} else if (id == SR_CONF_BUFFERSIZE) {
+		bufsize = g_variant_get_uint64(data);
+		if (bufsize < devc->logic_unitsize || bufsize > MAX_LOGIC_BUFSIZE)
+			return SR_ERR_ARG;
+		devc->logic_bufsize = bufsize;
+		sr_dbg("Setting logic packet size to %" PRIu64, bufsize);
+		ret = SR_OK;
+	} else if (id == SR_CONF_RLE) {
+		devc->rle = g_variant_get_boolean(data);
+		sr_dbg("%s RLE packets", devc->rle ? "Enabling" : "Disabling");
+		ret = SR_OK;
+	} else if (id == SR_CONF_THROTTLE) {
+		devc->throttle = g_variant_get_boolean(data);
+		sr_dbg("%s throttling", devc->throttle ? "Enabling" : "Disabling");
+		ret = SR_OK;
 	} else if (id == SR_CONF_PATTERN_MODE) {
 		stropt = g_variant_get_string(data, NULL);
 		logic_pattern = analog_pattern = -1;
@@ -398,11 +456,6 @@ static int config_set(int id, GVariant *data, const struct sr_dev_inst *sdi,
 		}
 		if (logic_pattern > -1) {
 			devc->logic_pattern = logic_pattern;
-			/* Might as well do this now. */
-			if (logic_pattern == PATTERN_ALL_LOW)
-				memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
-			else if (logic_pattern == PATTERN_ALL_HIGH)
-				memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
 			ret = SR_OK;
 			sr_dbg("Setting logic pattern to %s", logic_pattern_str[logic_pattern]);
 		} else if (analog_pattern > -1) {
@@ -462,40 +515,38 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+/* Write one period of the current logic pattern to the start of the ring. */
+static void logic_generator(struct dev_context *devc)
 {
-	struct dev_context *devc;
-	uint64_t i, j;
+	uint64_t i, j, size;
 	uint8_t pat;
 
-	devc = sdi->priv;
+	size = devc->ring_period * devc->logic_unitsize;
 
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
-		for (i = 0; i < size; i += devc->logic_unitsize) {
+		for (i = 0; i < devc->ring_period; i++) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
-				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				pat = pattern_sigrok[(i + j) % sizeof(pattern_sigrok)] >> 1;
+				devc->logic_ring[i * devc->logic_unitsize + j] = ~pat;
 			}
-			devc->step++;
 		}
 		break;
 	case PATTERN_RANDOM:
 		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+			devc->logic_ring[i] = (uint8_t)(rand() & 0xff);
 		break;
 	case PATTERN_INC:
-		for (i = 0; i < size; i++) {
-			for (j = 0; j < devc->logic_unitsize; j++) {
-				devc->logic_data[i + j] = devc->step;
-			}
-			devc->step++;
+		for (i = 0; i < devc->ring_period; i++) {
+			for (j = 0; j < devc->logic_unitsize; j++)
+				devc->logic_ring[i * devc->logic_unitsize + j] = i;
 		}
 		break;
 	case PATTERN_ALL_LOW:
+		memset(devc->logic_ring, 0x00, size);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(devc->logic_ring, 0xff, size);
 		break;
 	default:
 		sr_err("Unknown pattern: %d.", devc->logic_pattern);
@@ -503,17 +554,190 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	}
 }
 
-/* Callback handling data */
-static int prepare_data(int fd, int revents, void *cb_data)
+static uint64_t pattern_period(uint8_t pattern)
+{
+	switch (pattern) {
+	case PATTERN_SIGROK:
+		return sizeof(pattern_sigrok);
+	case PATTERN_RANDOM:
+		return RANDOM_PERIOD;
+	case PATTERN_INC:
+		return 256;
+	default:
+		return 1;
+	}
+}
+
+static void free_logic_buffers(struct dev_context *devc)
+{
+	g_free(devc->logic_ring);
+	devc->logic_ring = NULL;
+	g_free(devc->period_values);
+	devc->period_values = NULL;
+	g_free(devc->period_lengths);
+	devc->period_lengths = NULL;
+	g_free(devc->rle_values);
+	devc->rle_values = NULL;
+	g_free(devc->rle_lengths);
+	devc->rle_lengths = NULL;
+}
+
+/*
+ * Precompute the logic pattern ring, so that sending a packet is just a
+ * matter of pointing into it. In RLE mode, one period of the pattern is
+ * also stored as runs.
+ */
+static int prepare_logic_ring(struct dev_context *devc)
+{
+	uint64_t packet_samples, ring_size, filled, len, i, max_runs;
+	unsigned int us;
+	uint8_t *sample;
+
+	if (devc->num_logic_probes == 0)
+		return SR_OK;
+
+	us = devc->logic_unitsize;
+	packet_samples = devc->logic_bufsize / us;
+	devc->ring_period = pattern_period(devc->logic_pattern);
+	devc->ring_pos = 0;
+	ring_size = (devc->ring_period + packet_samples) * us;
+
+	if (!(devc->logic_ring = g_try_malloc(ring_size))) {
+		sr_err("Logic pattern ring malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+
+	logic_generator(devc);
+	filled = devc->ring_period * us;
+	while (filled < ring_size) {
+		len = MIN(filled, ring_size - filled);
+		memcpy(devc->logic_ring + filled, devc->logic_ring, len);
+		filled += len;
+	}
+
+	if (!devc->rle)
+		return SR_OK;
+
+	devc->period_values = g_try_malloc(devc->ring_period * us);
+	devc->period_lengths = g_try_malloc(devc->ring_period * sizeof(uint64_t));
+	max_runs = MIN(packet_samples, (packet_samples / devc->ring_period + 2) *
+		       devc->ring_period);
+	devc->rle_values = g_try_malloc(max_runs * us);
+	devc->rle_lengths = g_try_malloc(max_runs * sizeof(uint64_t));
+	if (!devc->period_values || !devc->period_lengths ||
+	    !devc->rle_values || !devc->rle_lengths) {
+		sr_err("RLE buffer malloc failed.");
+		free_logic_buffers(devc);
+		return SR_ERR_MALLOC;
+	}
+
+	devc->num_period_runs = 0;
+	for (i = 0; i < devc->ring_period; i++) {
+		sample = devc->logic_ring + i * us;
+		if (devc->num_period_runs > 0 && !memcmp(sample, devc->period_values +
+				(devc->num_period_runs - 1) * us, us)) {
+			devc->period_lengths[devc->num_period_runs - 1]++;
+			continue;
+		}
+		memcpy(devc->period_values + devc->num_period_runs * us, sample, us);
+		devc->period_lengths[devc->num_period_runs++] = 1;
+	}
+
+	return SR_OK;
+}
+
+/* Fill the packet runs for count samples starting at the ring position. */
+static uint64_t logic_runs(struct dev_context *devc, uint64_t count)
+{
+	uint64_t idx, pos, len, n;
+	unsigned int us;
+
+	us = devc->logic_unitsize;
+
+	/* A constant pattern is a single run. */
+	if (devc->num_period_runs == 1) {
+		memcpy(devc->rle_values, devc->period_values, us);
+		devc->rle_lengths[0] = count;
+		return 1;
+	}
+
+	idx = 0;
+	pos = devc->ring_pos;
+	while (pos >= devc->period_lengths[idx])
+		pos -= devc->period_lengths[idx++];
+
+	n = 0;
+	while (count > 0) {
+		len = MIN(devc->period_lengths[idx] - pos, count);
+		memcpy(devc->rle_values + n * us, devc->period_values + idx * us, us);
+		devc->rle_lengths[n++] = len;
+		count -= len;
+		pos = 0;
+		idx = (idx + 1) % devc->num_period_runs;
+	}
+
+	return n;
+}
+
+static void send_logic(struct sr_dev_inst *sdi, uint64_t count)
 {
-	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle rle;
+
+	devc = sdi->priv;
+
+	if (devc->rle) {
+		packet.type = SR_DF_LOGIC_RLE;
+		packet.payload = &rle;
+		rle.num_runs = logic_runs(devc, count);
+		rle.unitsize = devc->logic_unitsize;
+		rle.values = devc->rle_values;
+		rle.lengths = devc->rle_lengths;
+	} else {
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = count * devc->logic_unitsize;
+		logic.unitsize = devc->logic_unitsize;
+		logic.data = devc->logic_ring + devc->ring_pos * devc->logic_unitsize;
+	}
+	sr_session_send(sdi, &packet);
+
+	devc->ring_pos = (devc->ring_pos + count) % devc->ring_period;
+}
+
+static void send_analog(struct sr_dev_inst *sdi, uint64_t count)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
 	struct sr_probe_group *pg;
 	struct analog_gen *ag;
 	GSList *l;
-	uint64_t samples_to_send, expected_samplenum, analog_samples, sending_now;
+	uint64_t sent, sending_now;
+
+	devc = sdi->priv;
+
+	/* Analog, one probe at a time */
+	for (l = devc->analog_probe_groups; l; l = l->next) {
+		pg = l->data;
+		ag = pg->priv;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &ag->packet;
+		for (sent = 0; sent < count; sent += sending_now) {
+			sending_now = MIN(count - sent, ag->num_samples);
+			ag->packet.num_samples = sending_now;
+			sr_session_send(sdi, &packet);
+		}
+	}
+}
+
+/* Callback handling data */
+static int prepare_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	uint64_t samples_to_send, expected_samplenum, sending_now, chunk;
 	int64_t time, elapsed;
 
 	(void)fd;
@@ -522,52 +746,51 @@ static int prepare_data(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 	devc = sdi->priv;
 
-	/* How many "virtual" samples should we have collected by now? */
 	time = g_get_monotonic_time();
 	elapsed = time - devc->starttime;
-	expected_samplenum = elapsed * devc->cur_samplerate / 1000000;
-	/* Of those, how many do we still have to send? */
-	samples_to_send = expected_samplenum - devc->samples_counter;
+
+	if (devc->limit_msec && (uint64_t)elapsed >= devc->limit_msec * 1000) {
+		sr_info("Requested time limit reached.");
+		dev_acquisition_stop(sdi, cb_data);
+		return TRUE;
+	}
+
+	if (devc->throttle) {
+		/*
+		 * How many "virtual" samples should we have collected by now?
+		 * Split the calculation to avoid overflowing at high rates.
+		 */
+		expected_samplenum = (elapsed / 1000000) * devc->cur_samplerate +
+			(elapsed % 1000000) * devc->cur_samplerate / 1000000;
+		/* Of those, how many do we still have to send? */
+		samples_to_send = expected_samplenum - devc->samples_counter;
+	} else {
+		samples_to_send = UINT64_MAX;
+	}
 
 	if (devc->limit_samples) {
 		samples_to_send = MIN(samples_to_send,
 				devc->limit_samples - devc->samples_counter);
 	}
 
+	chunk = devc->logic_bufsize;
+	if (devc->num_logic_probes > 0)
+		chunk /= devc->logic_unitsize;
 	while (samples_to_send > 0) {
-		sending_now = 0;
-
-		/* Logic */
-		if (devc->num_logic_probes > 0) {
-			sending_now = MIN(samples_to_send,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = sending_now * devc->logic_unitsize;
-			logic.unitsize = devc->logic_unitsize;
-			logic.data = devc->logic_data;
-			sr_session_send(sdi, &packet);
-		}
+		sending_now = MIN(samples_to_send, chunk);
 
-		/* Analog, one probe at a time */
-		if (devc->num_analog_probes > 0) {
-			sending_now = 0;
-			for (l = devc->analog_probe_groups; l; l = l->next) {
-				pg = l->data;
-				ag = pg->priv;
-				packet.type = SR_DF_ANALOG;
-				packet.payload = &ag->packet;
-				analog_samples = MIN(samples_to_send, ag->num_samples);
-				/* Whichever probe group gets there first. */
-				sending_now = MAX(sending_now, analog_samples);
-				ag->packet.num_samples = analog_samples;
-				sr_session_send(sdi, &packet);
-			}
-		}
+		if (devc->num_logic_probes > 0)
+			send_logic(sdi, sending_now);
+		if (devc->num_analog_probes > 0)
+			send_analog(sdi, sending_now);
 
 		samples_to_send -= sending_now;
 		devc->samples_counter += sending_now;
+
+		/* Give the session a chance to stop us when unthrottled. */
+		if (!devc->throttle &&
+		    g_get_monotonic_time() - time >= MAX_SEND_TIME)
+			break;
 	}
 
 	if (devc->limit_samples &&
@@ -591,6 +814,9 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	devc = sdi->priv;
 	devc->samples_counter = 0;
 
+	if (prepare_logic_ring(devc) != SR_OK)
+		return SR_ERR_MALLOC;
+
 	/*
 	 * Setting two channels connected by a pipe is a remnant from when the
 	 * demo driver generated data in a thread, and collected and sent the
@@ -600,6 +826,19 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	 */
 	if (pipe(devc->pipe_fds)) {
 		sr_err("%s: pipe() failed", __func__);
+		free_logic_buffers(devc);
+		return SR_ERR;
+	}
+
+	/*
+	 * When unthrottled, keep the pipe readable so the callback runs on
+	 * every iteration of the session loop instead of on the timeout.
+	 */
+	if (!devc->throttle && write(devc->pipe_fds[1], "", 1) != 1) {
+		sr_err("%s: write() failed", __func__);
+		close(devc->pipe_fds[0]);
+		close(devc->pipe_fds[1]);
+		free_logic_buffers(devc);
 		return SR_ERR;
 	}
 
@@ -639,6 +878,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 	g_io_channel_shutdown(devc->channel, FALSE, NULL);
 	g_io_channel_unref(devc->channel);
 	devc->channel = NULL;
+	close(devc->pipe_fds[1]);
+	free_logic_buffers(devc);
 
 	/* Send last packet. */
 	packet.type = SR_DF_END;
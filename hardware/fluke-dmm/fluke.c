@@ -393,6 +393,7 @@ static void handle_qm_19x_data(const struct sr_dev_inst *sdi, char **tokens)
 			fvalue = 1.0;
 	}
 
+	memset(&analog, 0, sizeof(struct sr_datafeed_analog));
 	analog.probes = sdi->probes;
 	analog.num_samples = 1;
 	analog.data = &fvalue;
@@ -483,7 +484,6 @@ SR_PRIV int fluke_receive_data(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_serial_dev_inst *serial;
-	int len;
 	int64_t now, elapsed;
 
 	(void)fd;
@@ -497,17 +497,13 @@ SR_PRIV int fluke_receive_data(int fd, int revents, void *cb_data)
 	serial = sdi->conn;
 	if (revents == G_IO_IN) {
 		/* Serial data arrived. */
-		while(FLUKEDMM_BUFSIZE - devc->buflen - 1 > 0) {
-			len = serial_read(serial, devc->buf + devc->buflen, 1);
-			if (len < 1)
+		while (!devc->limit_samples
+				|| devc->num_samples < devc->limit_samples) {
+			devc->buflen = FLUKEDMM_BUFSIZE;
+			if (serial_readline_nonblocking(serial, devc->buf,
+					&devc->buflen) != SR_OK || !devc->buflen)
 				break;
-			devc->buflen++;
-			*(devc->buf + devc->buflen) = '\0';
-			if (*(devc->buf + devc->buflen - 1) == '\r') {
-				*(devc->buf + --devc->buflen) = '\0';
-				handle_line(sdi);
-				break;
-			}
+			handle_line(sdi);
 		}
 	}
 
@@ -133,8 +133,9 @@ static GSList *scan(GSList *options)
 	struct sr_usb_dev_inst *usb;
 	struct sr_probe *probe;
 	struct sr_config *src;
+	struct ezusb_upload *upload;
 	const struct fx2lafw_profile *prof;
-	GSList *l, *devices, *conn_devices;
+	GSList *l, *devices, *conn_devices, *uploads;
 	struct libusb_device_descriptor des;
 	libusb_device **devlist;
 	int devcnt, num_logic_probes, ret, i, j;
@@ -158,6 +159,7 @@ static GSList *scan(GSList *options)
 
 	/* Find all fx2lafw compatible devices and upload firmware to them. */
 	devices = NULL;
+	uploads = NULL;
 	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
@@ -222,18 +224,31 @@ static GSList *scan(GSList *options)
 			sdi->conn = sr_usb_dev_inst_new(libusb_get_bus_number(devlist[i]),
 					libusb_get_device_address(devlist[i]), NULL);
 		} else {
-			if (ezusb_upload_firmware(devlist[i], USB_CONFIGURATION,
-				prof->firmware) == SR_OK)
-				/* Store when this device's FW was updated. */
-				devc->fw_updated = g_get_monotonic_time();
+			/* Upload to all devices at once, see below. */
+			if ((upload = ezusb_upload_firmware_start(devlist[i],
+					USB_CONFIGURATION, prof->firmware, sdi)))
+				uploads = g_slist_append(uploads, upload);
 			else
 				sr_err("Firmware upload failed for "
-				       "device %d.", devcnt);
+				       "device %d.", sdi->index);
 			sdi->inst_type = SR_INST_USB;
 			sdi->conn = sr_usb_dev_inst_new(libusb_get_bus_number(devlist[i]),
 					0xff, NULL);
 		}
 	}
+
+	for (l = uploads; l; l = l->next) {
+		upload = l->data;
+		sdi = upload->user_data;
+		devc = sdi->priv;
+		if (ezusb_upload_firmware_finish(upload) == SR_OK)
+			/* Store when this device's FW was updated. */
+			devc->fw_updated = g_get_monotonic_time();
+		else
+			sr_err("Firmware upload failed for "
+			       "device %d.", sdi->index);
+	}
+	g_slist_free(uploads);
 	libusb_free_device_list(devlist, 1);
 	g_slist_free_full(conn_devices, (GDestroyNotify)sr_usb_dev_inst_free);
 
@@ -415,6 +430,7 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 {
 	GVariant *gvar;
 	GVariantBuilder gvb;
+	int i;
 
 	(void)sdi;
 	(void)probe_group;
@@ -424,6 +440,14 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 		*data = g_variant_new_fixed_array(G_VARIANT_TYPE_INT32,
 				hwopts, ARRAY_SIZE(hwopts), sizeof(int32_t));
 		break;
+	case SR_CONF_USB_IDS:
+		g_variant_builder_init(&gvb, G_VARIANT_TYPE("au"));
+		for (i = 0; supported_fx2[i].vid; i++)
+			g_variant_builder_add(&gvb, "u",
+					((uint32_t)supported_fx2[i].vid << 16)
+					| supported_fx2[i].pid);
+		*data = g_variant_builder_end(&gvb);
+		break;
 	case SR_CONF_DEVICE_OPTIONS:
 		*data = g_variant_new_fixed_array(G_VARIANT_TYPE_INT32,
 				hwcaps, ARRAY_SIZE(hwcaps), sizeof(int32_t));
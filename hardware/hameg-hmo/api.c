@@ -886,6 +886,12 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 
 	g_slist_free(devc->enabled_probes);
 	devc->enabled_probes = NULL;
+	if (devc->analog_data)
+		g_array_free(devc->analog_data, TRUE);
+	devc->analog_data = NULL;
+	if (devc->logic_data)
+		g_byte_array_free(devc->logic_data, TRUE);
+	devc->logic_data = NULL;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(scpi);
 
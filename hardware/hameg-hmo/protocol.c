@@ -20,12 +20,12 @@
 #include "protocol.h"
 
 static const char *hameg_scpi_dialect[] = {
-	[SCPI_CMD_GET_DIG_DATA]		    = ":POD%d:DATA?",
+	[SCPI_CMD_GET_DIG_DATA]		    = ":FORM UINT,8;:POD%d:DATA?",
 	[SCPI_CMD_GET_TIMEBASE]		    = ":TIM:SCAL?",
 	[SCPI_CMD_SET_TIMEBASE]		    = ":TIM:SCAL %E",
 	[SCPI_CMD_GET_COUPLING]		    = ":CHAN%d:COUP?",
 	[SCPI_CMD_SET_COUPLING]		    = ":CHAN%d:COUP %s",
-	[SCPI_CMD_GET_ANALOG_DATA]	    = ":CHAN%d:DATA?",
+	[SCPI_CMD_GET_ANALOG_DATA]	    = ":FORM:BORD LSBF;:FORM REAL,32;:CHAN%d:DATA?",
 	[SCPI_CMD_GET_VERTICAL_DIV]	    = ":CHAN%d:SCAL?",
 	[SCPI_CMD_SET_VERTICAL_DIV]	    = ":CHAN%d:SCAL %E",
 	[SCPI_CMD_GET_DIG_POD_STATE]	    = ":POD%d:STAT?",
@@ -282,37 +282,25 @@ static void scope_state_dump(struct scope_config *config,
 		state->horiz_triggerpos);
 }
 
-static int scope_state_get_array_option(struct sr_scpi_dev_inst *scpi,
-		const char *command, const char *(*array)[], int *result)
+static int array_option_get(const char *value, const char *(*array)[],
+			    int *result)
 {
-	char *tmp;
 	unsigned int i;
 
-	if (sr_scpi_get_string(scpi, command, &tmp) != SR_OK) {
-		g_free(tmp);
-		return SR_ERR;
-	}
-
 	for (i = 0; (*array)[i]; ++i) {
-		if (!g_strcmp0(tmp, (*array)[i])) {
+		if (!g_strcmp0(value, (*array)[i])) {
 			*result = i;
-			g_free(tmp);
-			tmp = NULL;
-			break;
+			return SR_OK;
 		}
 	}
 
-	if (tmp) {
-		g_free(tmp);
-		return SR_ERR;
-	}
-
-	return SR_OK;
+	return SR_ERR;
 }
 
-static int analog_channel_state_get(struct sr_scpi_dev_inst *scpi,
-				    struct scope_config *config,
-				    struct scope_state *state)
+static void analog_channel_state_query(struct sr_scpi_batch *batch,
+				       struct scope_config *config,
+				       struct scope_state *state,
+				       char **coupling)
 {
 	unsigned int i;
 	char command[MAX_COMMAND_SIZE];
@@ -321,42 +309,31 @@ static int analog_channel_state_get(struct sr_scpi_dev_inst *scpi,
 		g_snprintf(command, sizeof(command),
 			   (*config->scpi_dialect)[SCPI_CMD_GET_ANALOG_CHAN_STATE],
 			   i + 1);
-
-		if (sr_scpi_get_bool(scpi, command,
-				     &state->analog_channels[i].state) != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_add_bool(batch, command,
+				       &state->analog_channels[i].state);
 
 		g_snprintf(command, sizeof(command),
 			   (*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_DIV],
 			   i + 1);
-
-		if (sr_scpi_get_float(scpi, command,
-				     &state->analog_channels[i].vdiv) != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_add_float(batch, command,
+					&state->analog_channels[i].vdiv);
 
 		g_snprintf(command, sizeof(command),
 			   (*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_OFFSET],
 			   i + 1);
-
-		if (sr_scpi_get_float(scpi, command,
-				     &state->analog_channels[i].vertical_offset) != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_add_float(batch, command,
+					&state->analog_channels[i].vertical_offset);
 
 		g_snprintf(command, sizeof(command),
 			   (*config->scpi_dialect)[SCPI_CMD_GET_COUPLING],
 			   i + 1);
-
-		if (scope_state_get_array_option(scpi, command, config->coupling_options,
-					 &state->analog_channels[i].coupling) != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_add_string(batch, command, &coupling[i]);
 	}
-
-	return SR_OK;
 }
 
-static int digital_channel_state_get(struct sr_scpi_dev_inst *scpi,
-				     struct scope_config *config,
-				     struct scope_state *state)
+static void digital_channel_state_query(struct sr_scpi_batch *batch,
+					struct scope_config *config,
+					struct scope_state *state)
 {
 	unsigned int i;
 	char command[MAX_COMMAND_SIZE];
@@ -365,23 +342,17 @@ static int digital_channel_state_get(struct sr_scpi_dev_inst *scpi,
 		g_snprintf(command, sizeof(command),
 			   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_CHAN_STATE],
 			   i);
-
-		if (sr_scpi_get_bool(scpi, command,
-				     &state->digital_channels[i]) != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_add_bool(batch, command,
+				       &state->digital_channels[i]);
 	}
 
 	for (i = 0; i < config->digital_pods; ++i) {
 		g_snprintf(command, sizeof(command),
 			   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_STATE],
 			   i + 1);
-
-		if (sr_scpi_get_bool(scpi, command,
-				     &state->digital_pods[i]) != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_add_bool(batch, command,
+				       &state->digital_pods[i]);
 	}
-
-	return SR_OK;
 }
 
 SR_PRIV int hmo_scope_state_get(struct sr_dev_inst *sdi)
@@ -389,36 +360,66 @@ SR_PRIV int hmo_scope_state_get(struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct scope_state *state;
 	struct scope_config *config;
+	struct sr_scpi_batch *batch;
+	char **coupling, *trigger_source, *trigger_slope;
+	unsigned int i;
+	int ret;
 
 	devc = sdi->priv;
 	config = devc->model_config;
 	state = devc->model_state;
 
-	if (analog_channel_state_get(sdi->conn, config, state) != SR_OK)
-		return SR_ERR;
+	if (!(coupling = g_try_malloc0_n(config->analog_channels,
+					 sizeof(char *))))
+		return SR_ERR_MALLOC;
 
-	if (digital_channel_state_get(sdi->conn, config, state) != SR_OK)
-		return SR_ERR;
+	/* Query the whole state in as few round trips as possible. */
+	if (!(batch = sr_scpi_batch_new(sdi->conn, TRUE))) {
+		g_free(coupling);
+		return SR_ERR_MALLOC;
+	}
+
+	trigger_source = trigger_slope = NULL;
+
+	analog_channel_state_query(batch, config, state, coupling);
+	digital_channel_state_query(batch, config, state);
 
 	/* TODO: Check if value is sensible. */
-	if (sr_scpi_get_float(sdi->conn,
+	sr_scpi_batch_add_float(batch,
 			(*config->scpi_dialect)[SCPI_CMD_GET_TIMEBASE],
-			&state->timebase) != SR_OK)
-		return SR_ERR;
-
-	if (sr_scpi_get_float(sdi->conn,
+			&state->timebase);
+	sr_scpi_batch_add_float(batch,
 			(*config->scpi_dialect)[SCPI_CMD_GET_HORIZ_TRIGGERPOS],
-			&state->horiz_triggerpos) != SR_OK)
-		return SR_ERR;
-
-	if (scope_state_get_array_option(sdi->conn,
+			&state->horiz_triggerpos);
+	sr_scpi_batch_add_string(batch,
 			(*config->scpi_dialect)[SCPI_CMD_GET_TRIGGER_SOURCE],
-			config->trigger_sources, &state->trigger_source) != SR_OK)
-		return SR_ERR;
+			&trigger_source);
+	sr_scpi_batch_add_string(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_TRIGGER_SLOPE],
+			&trigger_slope);
 
-	if (scope_state_get_array_option(sdi->conn,
-		(*config->scpi_dialect)[SCPI_CMD_GET_TRIGGER_SLOPE],
-		config->trigger_slopes, &state->trigger_slope) != SR_OK)
+	ret = sr_scpi_batch_run(batch);
+	sr_scpi_batch_free(batch);
+
+	for (i = 0; i < config->analog_channels; ++i) {
+		if (ret == SR_OK)
+			ret = array_option_get(coupling[i],
+					config->coupling_options,
+					&state->analog_channels[i].coupling);
+		g_free(coupling[i]);
+	}
+	g_free(coupling);
+
+	if (ret == SR_OK)
+		ret = array_option_get(trigger_source, config->trigger_sources,
+				       &state->trigger_source);
+	if (ret == SR_OK)
+		ret = array_option_get(trigger_slope, config->trigger_slopes,
+				       &state->trigger_slope);
+	g_free(trigger_source);
+	g_free(trigger_slope);
+
+	if (ret != SR_OK)
 		return SR_ERR;
 
 	scope_state_dump(config, state);
@@ -552,7 +553,6 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
-	GArray *data;
 	struct sr_datafeed_analog analog;
 	struct sr_datafeed_logic logic;
 
@@ -569,45 +569,39 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 
 		switch (probe->type) {
 		case SR_PROBE_ANALOG:
-			if (sr_scpi_get_floatv(sdi->conn, NULL, &data) != SR_OK) {
-				if (data)
-					g_array_free(data, TRUE);
-
+			if (sr_scpi_get_block_float32v(sdi->conn, NULL, FALSE,
+					&devc->analog_data) != SR_OK)
 				return TRUE;
-			}
 
 			packet.type = SR_DF_FRAME_BEGIN;
 			sr_session_send(sdi, &packet);
 
 			analog.probes = g_slist_append(NULL, probe);
-			analog.num_samples = data->len;
-			analog.data = (float *) data->data;
+			analog.num_samples = devc->analog_data->len;
+			analog.data = (float *) devc->analog_data->data;
 			analog.mq = SR_MQ_VOLTAGE;
 			analog.unit = SR_UNIT_VOLT;
 			analog.mqflags = 0;
+			analog.timestamps = NULL;
 			packet.type = SR_DF_ANALOG;
 			packet.payload = &analog;
 			sr_session_send(cb_data, &packet);
 			g_slist_free(analog.probes);
-			g_array_free(data, TRUE);
 			break;
 		case SR_PROBE_LOGIC:
-			if (sr_scpi_get_uint8v(sdi->conn, NULL, &data) != SR_OK) {
-				if (data)
-					g_free(data);
+			if (sr_scpi_get_block(sdi->conn, NULL,
+					&devc->logic_data) != SR_OK)
 				return TRUE;
-			}
 
 			packet.type = SR_DF_FRAME_BEGIN;
 			sr_session_send(sdi, &packet);
 
-			logic.length = data->len;
+			logic.length = devc->logic_data->len;
 			logic.unitsize = 1;
-			logic.data = data->data;
+			logic.data = devc->logic_data->data;
 			packet.type = SR_DF_LOGIC;
 			packet.payload = &logic;
 			sr_session_send(cb_data, &packet);
-			g_array_free(data, TRUE);
 			break;
 		default:
 			sr_err("Invalid probe type.");
@@ -29,7 +29,7 @@
 #define LOG_PREFIX "hameg-hmo"
 
 #define MAX_INSTRUMENT_VERSIONS 10
-#define MAX_COMMAND_SIZE 31
+#define MAX_COMMAND_SIZE 63
 
 struct scope_config {
 	const char *name[MAX_INSTRUMENT_VERSIONS];
@@ -100,6 +100,10 @@ struct dev_context {
 	uint64_t num_frames;
 
 	uint64_t frame_limit;
+
+	/* Binary block buffers, reused for every frame. */
+	GArray *analog_data;
+	GByteArray *logic_data;
 };
 
 SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi);
@@ -241,7 +241,7 @@ static void clear_dev_context(void *priv)
 	devc = priv;
 	g_free(devc->triggersource);
 	g_slist_free(devc->enabled_probes);
-
+	dso_free_frame(devc);
 }
 
 static int dev_clear(void)
@@ -261,8 +261,9 @@ static GSList *scan(GSList *options)
 	struct sr_dev_inst *sdi;
 	struct sr_usb_dev_inst *usb;
 	struct sr_config *src;
+	struct ezusb_upload *upload;
 	const struct dso_profile *prof;
-	GSList *l, *devices, *conn_devices;
+	GSList *l, *devices, *conn_devices, *uploads;
 	struct libusb_device_descriptor des;
 	libusb_device **devlist;
 	int devcnt, ret, i, j;
@@ -272,6 +273,7 @@ static GSList *scan(GSList *options)
 
 	devcnt = 0;
 	devices = 0;
+	uploads = NULL;
 
 	conn = NULL;
 	for (l = options; l; l = l->next) {
@@ -318,14 +320,13 @@ static GSList *scan(GSList *options)
 				sr_dbg("Found a %s %s.", prof->vendor, prof->model);
 				sdi = dso_dev_new(devcnt, prof);
 				devices = g_slist_append(devices, sdi);
-				devc = sdi->priv;
-				if (ezusb_upload_firmware(devlist[i], USB_CONFIGURATION,
-						prof->firmware) == SR_OK)
-					/* Remember when the firmware on this device was updated */
-					devc->fw_updated = g_get_monotonic_time();
+				/* Upload to all devices at once, see below. */
+				if ((upload = ezusb_upload_firmware_start(devlist[i],
+						USB_CONFIGURATION, prof->firmware, sdi)))
+					uploads = g_slist_append(uploads, upload);
 				else
 					sr_err("Firmware upload failed for "
-					        "device %d.", devcnt);
+					       "device %d.", sdi->index);
 				/* Dummy USB address of 0xff will get overwritten later. */
 				sdi->conn = sr_usb_dev_inst_new(
 						libusb_get_bus_number(devlist[i]), 0xff, NULL);
@@ -352,6 +353,19 @@ static GSList *scan(GSList *options)
 			/* not a supported VID/PID */
 			continue;
 	}
+
+	for (l = uploads; l; l = l->next) {
+		upload = l->data;
+		sdi = upload->user_data;
+		devc = sdi->priv;
+		if (ezusb_upload_firmware_finish(upload) == SR_OK)
+			/* Remember when the firmware on this device was updated */
+			devc->fw_updated = g_get_monotonic_time();
+		else
+			sr_err("Firmware upload failed for "
+			        "device %d.", sdi->index);
+	}
+	g_slist_free(uploads);
 	libusb_free_device_list(devlist, 1);
 
 	return devices;
@@ -649,58 +663,88 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+/*
+ * Voltage values are encoded as a value 0-255 (0-512 on the DSO-5200*),
+ * where the value is a point in the range represented by the vdiv setting.
+ * There are 8 vertical divs, so e.g. 500mV/div represents 4V peak-to-peak
+ * where 0 = -2V and 255 = +2V.
+ */
+static void build_lut(float *lut, int voltage)
+{
+	float range;
+	int i;
+
+	range = ((float)vdivs[voltage][0] / vdivs[voltage][1]) * 8;
+	for (i = 0; i < 256; i++) {
+		lut[i] = range / 255 * i;
+		/* Value is centered around 0V. */
+		lut[i] -= range / 2;
+	}
+}
+
 static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 		int num_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct dev_context *devc;
-	float ch1, ch2, range;
-	int num_probes, data_offset, i;
+	const float *lut1, *lut2;
+	float *data;
+	int i;
 
 	devc = sdi->priv;
-	num_probes = (devc->ch1_enabled && devc->ch2_enabled) ? 2 : 1;
+	lut1 = devc->lut[0];
+	lut2 = devc->lut[1];
+	data = devc->analog_buf;
+
+	/*
+	 * The device always sends data for both channels. If a channel
+	 * is disabled, it contains a copy of the enabled channel's
+	 * data. However, we only send the requested channels to
+	 * the bus.
+	 */
+	/* TODO: Support for DSO-5xxx series 9-bit samples. */
+	if (devc->ch1_enabled && devc->ch2_enabled) {
+		for (i = 0; i < num_samples; i++) {
+			data[i * 2] = lut1[buf[i * 2 + 1]];
+			data[i * 2 + 1] = lut2[buf[i * 2]];
+		}
+	} else if (devc->ch1_enabled) {
+		for (i = 0; i < num_samples; i++)
+			data[i] = lut1[buf[i * 2 + 1]];
+	} else {
+		for (i = 0; i < num_samples; i++)
+			data[i] = lut2[buf[i * 2]];
+	}
+
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
-	/* TODO: support for 5xxx series 9-bit samples */
 	analog.probes = devc->enabled_probes;
 	analog.num_samples = num_samples;
 	analog.mq = SR_MQ_VOLTAGE;
 	analog.unit = SR_UNIT_VOLT;
-	/* TODO: Check malloc return value. */
-	analog.data = g_try_malloc(analog.num_samples * sizeof(float) * num_probes);
-	data_offset = 0;
-	for (i = 0; i < analog.num_samples; i++) {
-		/*
-		 * The device always sends data for both channels. If a channel
-		 * is disabled, it contains a copy of the enabled channel's
-		 * data. However, we only send the requested channels to
-		 * the bus.
-		 *
-		 * Voltage values are encoded as a value 0-255 (0-512 on the
-		 * DSO-5200*), where the value is a point in the range
-		 * represented by the vdiv setting. There are 8 vertical divs,
-		 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
-		 * and 255 = +2V.
-		 */
-		/* TODO: Support for DSO-5xxx series 9-bit samples. */
-		if (devc->ch1_enabled) {
-			range = ((float)vdivs[devc->voltage_ch1][0] / vdivs[devc->voltage_ch1][1]) * 8;
-			ch1 = range / 255 * *(buf + i * 2 + 1);
-			/* Value is centered around 0V. */
-			ch1 -= range / 2;
-			analog.data[data_offset++] = ch1;
-		}
-		if (devc->ch2_enabled) {
-			range = ((float)vdivs[devc->voltage_ch2][0] / vdivs[devc->voltage_ch2][1]) * 8;
-			ch2 = range / 255 * *(buf + i * 2);
-			ch2 -= range / 2;
-			analog.data[data_offset++] = ch2;
-		}
-	}
+	analog.mqflags = 0;
+	analog.data = data;
+	analog.timestamps = NULL;
 	sr_session_send(devc->cb_data, &packet);
 }
 
+/*
+ * Keep pre-trigger samples in the frame buffer until the end of the frame.
+ * They are normally there already, as each transfer fills its own slice
+ * of the buffer; a short transfer leaves a gap that needs closing.
+ */
+static void buffer_samples(struct dev_context *devc, unsigned char *buf,
+		int num_samples)
+{
+	unsigned char *dest;
+
+	dest = devc->frames[devc->cur_frame].buf + devc->samp_buffered * 2;
+	if (dest != buf)
+		memmove(dest, buf, num_samples * 2);
+	devc->samp_buffered += num_samples;
+}
+
 /*
  * Called by libusb (as triggered by handle_event()) when a transfer comes in.
  * Only channel data comes in asynchronously, and all transfers for this are
@@ -712,13 +756,28 @@ static void receive_transfer(struct libusb_transfer *transfer)
 	struct sr_datafeed_packet packet;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
+	struct dso_frame *frame;
 	int num_samples, pre;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
+	devc->submitted_transfers--;
 	sr_spew("receive_transfer(): status %d received %d bytes.",
 		   transfer->status, transfer->actual_length);
 
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED
+			|| devc->dev_state == CANCELLING)
+		/* Acquisition is being stopped. */
+		return;
+
+	frame = &devc->frames[devc->cur_frame];
+	if (transfer->buffer < frame->buf || transfer->buffer
+			>= frame->buf + devc->framesize * sizeof(unsigned short)) {
+		/* It landed in an earlier frame's buffer, leave it there. */
+		sr_dbg("Ignoring late transfer of a previous frame.");
+		return;
+	}
+
 	if (transfer->actual_length == 0)
 		/* Nothing to send to the bus. */
 		return;
@@ -741,9 +800,7 @@ static void receive_transfer(struct libusb_transfer *transfer)
 		/* Trigger point not yet reached. */
 		if (devc->samp_received + num_samples < devc->trigger_offset) {
 			/* The entire chunk is before the trigger point. */
-			memcpy(devc->framebuf + devc->samp_buffered * 2,
-					transfer->buffer, num_samples * 2);
-			devc->samp_buffered += num_samples;
+			buffer_samples(devc, transfer->buffer, num_samples);
 		} else {
 			/*
 			 * This chunk hits or overruns the trigger point.
@@ -751,9 +808,7 @@ static void receive_transfer(struct libusb_transfer *transfer)
 			 * send the rest up to the session bus.
 			 */
 			pre = devc->trigger_offset - devc->samp_received;
-			memcpy(devc->framebuf + devc->samp_buffered * 2,
-					transfer->buffer, pre * 2);
-			devc->samp_buffered += pre;
+			buffer_samples(devc, transfer->buffer, pre);
 
 			/* The rest of this chunk starts with the trigger point. */
 			sr_dbg("Reached trigger point, %d samples buffered.",
@@ -773,22 +828,22 @@ static void receive_transfer(struct libusb_transfer *transfer)
 
 	devc->samp_received += num_samples;
 
-	/* Everything in this transfer was either copied to the buffer or
-	 * sent to the session bus. */
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	/* The transfer and its buffer are reused for the next frame. */
 
 	if (devc->samp_received >= devc->framesize) {
 		/* That was the last chunk in this frame. Send the buffered
 		 * pre-trigger samples out now, in one big chunk. */
 		sr_dbg("End of frame, sending %d pre-trigger buffered samples.",
 			   devc->samp_buffered);
-		send_chunk(sdi, devc->framebuf, devc->samp_buffered);
+		send_chunk(sdi, frame->buf, devc->samp_buffered);
 
 		/* Mark the end of this frame. */
 		packet.type = SR_DF_FRAME_END;
 		sr_session_send(devc->cb_data, &packet);
 
+		/* The next frame is fetched into the next buffer. */
+		devc->cur_frame = (devc->cur_frame + 1) % NUM_FRAME_BUFS;
+
 		if (devc->limit_frames && ++devc->num_frames == devc->limit_frames) {
 			/* Terminate session */
 			devc->dev_state = STOPPING;
@@ -798,6 +853,25 @@ static void receive_transfer(struct libusb_transfer *transfer)
 	}
 }
 
+/*
+ * Cancel the transfers still in flight. They come back through
+ * receive_transfer() as libusb events are handled.
+ */
+static void cancel_transfers(struct dev_context *devc)
+{
+	int f, i;
+
+	if (devc->submitted_transfers <= 0)
+		return;
+
+	for (f = 0; f < NUM_FRAME_BUFS; f++) {
+		if (!devc->frames[f].transfers)
+			continue;
+		for (i = 0; i < devc->num_transfers; i++)
+			libusb_cancel_transfer(devc->frames[f].transfers[i]);
+	}
+}
+
 static int handle_event(int fd, int revents, void *cb_data)
 {
 	const struct sr_dev_inst *sdi;
@@ -805,7 +879,6 @@ static int handle_event(int fd, int revents, void *cb_data)
 	struct timeval tv;
 	struct dev_context *devc;
 	struct drv_context *drvc = di->priv;
-	int num_probes;
 	uint32_t trigger_offset;
 	uint8_t capturestate;
 
@@ -817,11 +890,18 @@ static int handle_event(int fd, int revents, void *cb_data)
 	if (devc->dev_state == STOPPING) {
 		/* We've been told to wind up the acquisition. */
 		sr_dbg("Stopping acquisition.");
-		/*
-		 * TODO: Doesn't really cancel pending transfers so they might
-		 * come in after SR_DF_END is sent.
-		 */
+		cancel_transfers(devc);
+		devc->dev_state = CANCELLING;
+	}
+	if (devc->dev_state == CANCELLING) {
+		/* The buffers can only be freed once all transfers are back. */
+		tv.tv_sec = tv.tv_usec = 0;
+		libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+		if (devc->submitted_transfers > 0)
+			return TRUE;
+
 		usb_source_remove(drvc->sr_ctx);
+		dso_free_frame(devc);
 
 		packet.type = SR_DF_END;
 		sr_session_send(sdi, &packet);
@@ -875,13 +955,12 @@ static int handle_event(int fd, int revents, void *cb_data)
 		/* Remember where in the captured frame the trigger is. */
 		devc->trigger_offset = trigger_offset;
 
-		num_probes = (devc->ch1_enabled && devc->ch2_enabled) ? 2 : 1;
-		/* TODO: Check malloc return value. */
-		devc->framebuf = g_try_malloc(devc->framesize * num_probes * 2);
+		build_lut(devc->lut[0], devc->voltage_ch1);
+		build_lut(devc->lut[1], devc->voltage_ch2);
 		devc->samp_buffered = devc->samp_received = 0;
 
 		/* Tell the scope to send us the first frame. */
-		if (dso_get_channeldata(sdi, receive_transfer) != SR_OK)
+		if (dso_get_channeldata(sdi) != SR_OK)
 			break;
 
 		/*
@@ -928,6 +1007,9 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	if (dso_init(sdi) != SR_OK)
 		return SR_ERR;
 
+	if (dso_alloc_frame(sdi, receive_transfer) != SR_OK)
+		return SR_ERR_MALLOC;
+
 	if (dso_capture_start(sdi) != SR_OK)
 		return SR_ERR;
 
@@ -950,7 +1032,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 		return SR_ERR;
 
 	devc = sdi->priv;
-	devc->dev_state = STOPPING;
+	if (devc->dev_state != CANCELLING)
+		devc->dev_state = STOPPING;
 
 	return SR_OK;
 }
@@ -737,20 +737,95 @@ SR_PRIV int dso_capture_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
+/*
+ * Allocate the ring of frame buffers and the bulk transfers that fill
+ * them. These are reused for every frame of the acquisition.
+ */
+SR_PRIV int dso_alloc_frame(const struct sr_dev_inst *sdi,
 		libusb_transfer_cb_fn cb)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct libusb_transfer *transfer;
-	int num_transfers, ret, i;
+	struct dso_frame *frame;
+	int f, i;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	dso_free_frame(devc);
+
+	/* TODO: DSO-2xxx only. */
+	devc->num_transfers = devc->framesize *
+			sizeof(unsigned short) / devc->epin_maxpacketsize;
+	devc->cur_frame = 0;
+
+	if (!(devc->analog_buf = g_try_malloc(devc->framesize * 2
+			* sizeof(float)))) {
+		sr_err("Failed to malloc frame buffers.");
+		return SR_ERR_MALLOC;
+	}
+
+	for (f = 0; f < NUM_FRAME_BUFS; f++) {
+		frame = &devc->frames[f];
+		frame->buf = g_try_malloc(devc->framesize * sizeof(unsigned short));
+		frame->transfers = g_try_malloc0(devc->num_transfers *
+				sizeof(struct libusb_transfer *));
+		if (!frame->buf || !frame->transfers) {
+			sr_err("Failed to malloc frame buffers.");
+			dso_free_frame(devc);
+			return SR_ERR_MALLOC;
+		}
+
+		for (i = 0; i < devc->num_transfers; i++) {
+			if (!(frame->transfers[i] = libusb_alloc_transfer(0))) {
+				sr_err("Failed to allocate USB transfer.");
+				dso_free_frame(devc);
+				return SR_ERR_MALLOC;
+			}
+			libusb_fill_bulk_transfer(frame->transfers[i],
+					usb->devhdl, DSO_EP_IN,
+					frame->buf + i * devc->epin_maxpacketsize,
+					devc->epin_maxpacketsize, cb,
+					(void *)sdi, 40);
+		}
+	}
+
+	return SR_OK;
+}
+
+/* Free the frame buffers. No transfers may be in flight. */
+SR_PRIV void dso_free_frame(struct dev_context *devc)
+{
+	struct dso_frame *frame;
+	int f, i;
+
+	for (f = 0; f < NUM_FRAME_BUFS; f++) {
+		frame = &devc->frames[f];
+		if (frame->transfers) {
+			for (i = 0; i < devc->num_transfers; i++)
+				libusb_free_transfer(frame->transfers[i]);
+			g_free(frame->transfers);
+			frame->transfers = NULL;
+		}
+		g_free(frame->buf);
+		frame->buf = NULL;
+	}
+	devc->num_transfers = 0;
+
+	g_free(devc->analog_buf);
+	devc->analog_buf = NULL;
+}
+
+SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct libusb_transfer **transfers;
+	int ret, i;
 	uint8_t cmdstring[2];
-	unsigned char *buf;
 
 	sr_dbg("Sending CMD_GET_CHANNELDATA.");
 
 	devc = sdi->priv;
-	usb = sdi->conn;
 
 	cmdstring[0] = CMD_GET_CHANNELDATA;
 	cmdstring[1] = 0;
@@ -761,26 +836,15 @@ SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
 		return SR_ERR;
 	}
 
-	/* TODO: DSO-2xxx only. */
-	num_transfers = devc->framesize *
-			sizeof(unsigned short) / devc->epin_maxpacketsize;
-	sr_dbg("Queueing up %d transfers.", num_transfers);
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(devc->epin_maxpacketsize))) {
-			sr_err("Failed to malloc USB endpoint buffer.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl, DSO_EP_IN, buf,
-				devc->epin_maxpacketsize, cb, (void *)sdi, 40);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
+	sr_dbg("Queueing up %d transfers.", devc->num_transfers);
+	transfers = devc->frames[devc->cur_frame].transfers;
+	for (i = 0; i < devc->num_transfers; i++) {
+		if ((ret = libusb_submit_transfer(transfers[i])) != 0) {
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
-			/* TODO: Free them all. */
-			libusb_free_transfer(transfer);
-			g_free(buf);
 			return SR_ERR;
 		}
+		devc->submitted_transfers++;
 	}
 
 	return SR_OK;
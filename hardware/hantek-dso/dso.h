@@ -34,6 +34,9 @@
 
 #define MAX_CAPTURE_EMPTY       3
 
+/* Number of frame buffers the frames are fetched into in turn. */
+#define NUM_FRAME_BUFS          2
+
 #define DEFAULT_VOLTAGE         VDIV_500MV
 #define DEFAULT_FRAMESIZE       FRAMESIZE_SMALL
 #define DEFAULT_TIMEBASE        TIME_100us
@@ -145,6 +148,8 @@ enum states {
 	CAPTURE,
 	FETCH_DATA,
 	STOPPING,
+	/* Waiting for cancelled transfers to come back. */
+	CANCELLING,
 };
 
 struct dso_profile {
@@ -160,6 +165,12 @@ struct dso_profile {
 	char *firmware;
 };
 
+struct dso_frame {
+	unsigned char *buf;
+	/* Bulk transfers, each filling its own slice of buf. */
+	struct libusb_transfer **transfers;
+};
+
 struct dev_context {
 	const struct dso_profile *profile;
 	void *cb_data;
@@ -202,7 +213,16 @@ struct dev_context {
 	unsigned int samp_received;
 	unsigned int samp_buffered;
 	unsigned int trigger_offset;
-	unsigned char *framebuf;
+	/* Frame buffer ring, and the frame being fetched. */
+	struct dso_frame frames[NUM_FRAME_BUFS];
+	int cur_frame;
+	/* Bulk transfers per frame, and transfers in flight. */
+	int num_transfers;
+	int submitted_transfers;
+	/* Raw sample value to volts lookup tables, per channel. */
+	float lut[2][256];
+	/* Converted samples sent to the session bus. */
+	float *analog_buf;
 };
 
 SR_PRIV int dso_open(struct sr_dev_inst *sdi);
@@ -213,7 +233,9 @@ SR_PRIV int dso_init(const struct sr_dev_inst *sdi);
 SR_PRIV int dso_get_capturestate(const struct sr_dev_inst *sdi,
 		uint8_t *capturestate, uint32_t *trigger_offset);
 SR_PRIV int dso_capture_start(const struct sr_dev_inst *sdi);
-SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
+SR_PRIV int dso_alloc_frame(const struct sr_dev_inst *sdi,
 		libusb_transfer_cb_fn cb);
+SR_PRIV void dso_free_frame(struct dev_context *devc);
+SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi);
 
 #endif
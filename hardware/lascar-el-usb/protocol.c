@@ -414,6 +414,7 @@ static void lascar_el_usb_dispatch(struct sr_dev_inst *sdi, unsigned char *buf,
 		packet.type = SR_DF_ANALOG;
 		packet.payload = &analog;
 		analog.mqflags = 0;
+		analog.timestamps = NULL;
 		if (!(temp = g_try_malloc(sizeof(float) * samples)))
 			break;
 		if (!(rh = g_try_malloc(sizeof(float) * samples)))
@@ -143,39 +143,37 @@ static int handle_packet(const uint8_t *buf, struct sr_dev_inst *sdi, int idx)
 	return SR_OK;
 }
 
-static void handle_new_data(struct sr_dev_inst *sdi, int idx)
+struct packet_context {
+	struct sr_dev_inst *sdi;
+	int idx;
+};
+
+static void packet_handler(const uint8_t *buf, size_t len, void *cb_data)
 {
-	struct dev_context *devc;
-	struct sr_serial_dev_inst *serial;
-	int len, i, offset = 0;
+	struct packet_context *ctx;
 
-	devc = sdi->priv;
-	serial = sdi->conn;
+	(void)len;
 
-	/* Try to get as much data as the buffer can hold. */
-	len = SERIAL_BUFSIZE - devc->buflen;
-	len = serial_read(serial, devc->buf + devc->buflen, len);
-	if (len < 1) {
-		sr_err("Serial port read error: %d.", len);
-		return;
-	}
+	ctx = cb_data;
+	handle_packet(buf, ctx->sdi, ctx->idx);
+}
 
-	devc->buflen += len;
+static void handle_new_data(struct sr_dev_inst *sdi, int idx)
+{
+	struct packet_context ctx;
+	struct serial_packet_desc desc = {
+		.packet_size = mic_devs[idx].packet_size,
+		.length_offset = -1,
+		.terminator = -1,
+		.is_valid = mic_devs[idx].packet_valid,
+	};
+	int ret;
 
-	/* Now look for packets in that data. */
-	while ((devc->buflen - offset) >= mic_devs[idx].packet_size) {
-		if (mic_devs[idx].packet_valid(devc->buf + offset)) {
-			handle_packet(devc->buf + offset, sdi, idx);
-			offset += mic_devs[idx].packet_size;
-		} else {
-			offset++;
-		}
-	}
+	ctx.sdi = sdi;
+	ctx.idx = idx;
 
-	/* If we have any data left, move it to the beginning of our buffer. */
-	for (i = 0; i < devc->buflen - offset; i++)
-		devc->buf[i] = devc->buf[offset + i];
-	devc->buflen -= offset;
+	if ((ret = serial_receive(sdi->conn, &desc, packet_handler, &ctx)) < 0)
+		sr_err("Serial port read error: %d.", ret);
 }
 
 static int receive_data(int fd, int revents, int idx, void *cb_data)
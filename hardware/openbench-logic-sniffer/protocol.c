@@ -152,6 +152,7 @@ SR_PRIV struct dev_context *ols_dev_new(void)
 	devc->trigger_at = -1;
 	devc->probe_mask = 0xffffffff;
 	devc->flag_reg = 0;
+	devc->rle_values = devc->rle_lengths = NULL;
 
 	return devc;
 }
@@ -333,28 +334,217 @@ SR_PRIV void abort_acquisition(const struct sr_dev_inst *sdi)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_serial_dev_inst *serial;
+	struct dev_context *devc;
 
 	serial = sdi->conn;
 	serial_source_remove(serial);
 
+	/* Drop the runs of an RLE capture that was stopped early. */
+	devc = sdi->priv;
+	if (devc->rle_values)
+		g_array_free(devc->rle_values, TRUE);
+	if (devc->rle_lengths)
+		g_array_free(devc->rle_lengths, TRUE);
+	devc->rle_values = devc->rle_lengths = NULL;
+
 	/* Terminate session */
 	packet.type = SR_DF_END;
 	sr_session_send(sdi, &packet);
 }
 
+/*
+ * Replicate a single 4-byte sample 'count' times, starting at 'dst'. Each
+ * round copies everything filled in so far, so a run of n samples takes
+ * log2(n) memcpy() calls instead of n.
+ */
+static void fill_samples(uint8_t *dst, const uint8_t *sample, uint64_t count)
+{
+	uint64_t done, total, n;
+
+	if (count == 0)
+		return;
+
+	memcpy(dst, sample, 4);
+	total = count * 4;
+	for (done = 4; done < total; done += n) {
+		n = MIN(done, total - done);
+		memcpy(dst + done, dst, n);
+	}
+}
+
+/*
+ * Handle one complete sample of num_channels bytes in devc->sample,
+ * either as an RLE count or as a value to store in the sample buffer.
+ */
+static void store_sample(struct dev_context *devc, int num_channels)
+{
+	uint64_t run;
+	int i, j;
+
+	if (devc->flag_reg & FLAG_RLE) {
+		/*
+		 * In RLE mode the high bit of the sample is the
+		 * "count" flag, meaning this sample is the number
+		 * of times the previous sample occurred.
+		 */
+		if (devc->sample[num_channels - 1] & 0x80) {
+			/* Clear the high bit. */
+			devc->sample[num_channels - 1] &= 0x7f;
+			devc->rle_count = RL32(devc->sample);
+			memset(devc->sample, 0, 4);
+			devc->num_bytes = 0;
+			return;
+		}
+	}
+
+	if (num_channels < 4) {
+		/*
+		 * Some channel groups may have been turned
+		 * off, to speed up transfer between the
+		 * hardware and the PC. Expand that here before
+		 * submitting it over the session bus --
+		 * whatever is listening on the bus will be
+		 * expecting a full 32-bit sample, based on
+		 * the number of probes.
+		 */
+		j = 0;
+		memset(devc->tmp_sample, 0, 4);
+		for (i = 0; i < 4; i++) {
+			if (((devc->flag_reg >> 2) & (1 << i)) == 0) {
+				/*
+				 * This channel group was
+				 * enabled, copy from received
+				 * sample.
+				 */
+				devc->tmp_sample[i] = devc->sample[j++];
+			} else if (devc->flag_reg & FLAG_DEMUX && (i > 2)) {
+				/* group 2 & 3 get added to 0 & 1 */
+				devc->tmp_sample[i - 2] = devc->sample[j++];
+			}
+		}
+		memcpy(devc->sample, devc->tmp_sample, 4);
+	}
+
+	/* Save us from overrunning the buffer. */
+	run = MIN((uint64_t)devc->rle_count + 1,
+			devc->limit_samples - devc->num_samples);
+	devc->num_samples += run;
+
+	if (devc->flag_reg & FLAG_RLE) {
+		/* Keep the run as it is, it goes out as SR_DF_LOGIC_RLE. */
+		g_array_append_vals(devc->rle_values, devc->sample, 4);
+		g_array_append_val(devc->rle_lengths, run);
+	} else {
+		/*
+		 * The OLS sends its sample buffer backwards. Store it in
+		 * reverse order here, so we can dump this on the session
+		 * bus later.
+		 */
+		fill_samples(devc->raw_sample_buf +
+				(devc->limit_samples - devc->num_samples) * 4,
+				devc->sample, run);
+	}
+
+	memset(devc->sample, 0, 4);
+	devc->num_bytes = 0;
+	devc->rle_count = 0;
+}
+
+static void send_samples(void *cb_data, uint8_t *buf, uint64_t num_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = num_samples * 4;
+	logic.unitsize = 4;
+	logic.data = buf;
+	sr_session_send(cb_data, &packet);
+}
+
+static void send_runs(void *cb_data, uint8_t *values, uint64_t *lengths,
+		uint64_t num_runs)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle logic_rle;
+
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &logic_rle;
+	logic_rle.num_runs = num_runs;
+	logic_rle.unitsize = 4;
+	logic_rle.values = values;
+	logic_rle.lengths = lengths;
+	sr_session_send(cb_data, &packet);
+}
+
+/*
+ * Send the runs collected in RLE mode, in time order, with the trigger
+ * (if any) placed at devc->trigger_at samples into the capture.
+ */
+static void send_rle_capture(struct dev_context *devc, void *cb_data)
+{
+	struct sr_datafeed_packet packet;
+	uint8_t *values, tmp[4];
+	uint64_t *lengths, num_runs, pos, pre, len, i;
+
+	values = (uint8_t *)devc->rle_values->data;
+	lengths = (uint64_t *)devc->rle_lengths->data;
+	num_runs = devc->rle_lengths->len;
+
+	/* The runs came in newest first. */
+	for (i = 0; i < num_runs / 2; i++) {
+		memcpy(tmp, values + i * 4, 4);
+		memcpy(values + i * 4, values + (num_runs - 1 - i) * 4, 4);
+		memcpy(values + (num_runs - 1 - i) * 4, tmp, 4);
+		len = lengths[i];
+		lengths[i] = lengths[num_runs - 1 - i];
+		lengths[num_runs - 1 - i] = len;
+	}
+
+	if (devc->trigger_at == -1) {
+		/* no trigger was used */
+		if (num_runs > 0)
+			send_runs(cb_data, values, lengths, num_runs);
+		return;
+	}
+
+	/* Find the run the trigger falls in, and split it there. */
+	pos = 0;
+	for (i = 0; i < num_runs && pos + lengths[i] <= (uint64_t)devc->trigger_at; i++)
+		pos += lengths[i];
+	pre = (i < num_runs) ? devc->trigger_at - pos : 0;
+
+	/* there are pre-trigger samples, send those first */
+	if (pre > 0) {
+		len = lengths[i];
+		lengths[i] = pre;
+		send_runs(cb_data, values, lengths, i + 1);
+		lengths[i] = len - pre;
+	} else if (i > 0) {
+		send_runs(cb_data, values, lengths, i);
+	}
+
+	/* send the trigger */
+	packet.type = SR_DF_TRIGGER;
+	sr_session_send(cb_data, &packet);
+
+	/* send post-trigger samples */
+	if (i < num_runs)
+		send_runs(cb_data, values + i * 4, lengths + i, num_runs - i);
+}
+
 SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 {
 	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_serial_dev_inst *serial;
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
 	struct sr_dev_inst *sdi;
 	GSList *l;
-	uint32_t sample;
-	int num_channels, offset, j;
+	uint8_t buf[READ_CHUNK_SIZE], *samples;
+	int num_channels, len, k;
 	unsigned int i;
-	unsigned char byte;
 	int serial_fd;
 
 	drvc = di->priv;
@@ -383,13 +573,17 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 		 */
 		serial_source_remove(serial);
 		serial_source_add(serial, G_IO_IN, 30, ols_receive_data, cb_data);
-		devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
-		if (!devc->raw_sample_buf) {
-			sr_err("Sample buffer malloc failed.");
-			return FALSE;
+		if (devc->flag_reg & FLAG_RLE) {
+			/* No need to expand the runs, memory grows with their number. */
+			devc->rle_values = g_array_new(FALSE, FALSE, 1);
+			devc->rle_lengths = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+		} else {
+			devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
+			if (!devc->raw_sample_buf) {
+				sr_err("Sample buffer malloc failed.");
+				return FALSE;
+			}
 		}
-		/* fill with 1010... for debugging */
-		memset(devc->raw_sample_buf, 0x82, devc->limit_samples * 4);
 	}
 
 	num_channels = 0;
@@ -401,133 +595,63 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (revents == G_IO_IN && devc->num_samples < devc->limit_samples) {
-		if (serial_read_nonblocking(serial, &byte, 1) != 1)
+		/* Drain whatever the port has buffered in one go. */
+		if ((len = serial_read_nonblocking(serial, buf, sizeof(buf))) < 0)
 			return FALSE;
 
-		/* Ignore it if we've read enough. */
-		if (devc->num_samples >= devc->limit_samples)
+		/* Ignore anything past the point where we've read enough. */
+		for (k = 0; k < len && devc->num_samples < devc->limit_samples; k++) {
+			devc->sample[devc->num_bytes++] = buf[k];
+			if (devc->num_bytes == num_channels)
+				store_sample(devc, num_channels);
+		}
+
+		if (devc->num_samples < devc->limit_samples)
 			return TRUE;
 
-		devc->sample[devc->num_bytes++] = byte;
-		sr_dbg("Received byte 0x%.2x.", byte);
-		if (devc->num_bytes == num_channels) {
-			/* Got a full sample. Convert from the OLS's little-endian
-			 * sample to the local format. */
-			sample = devc->sample[0] | (devc->sample[1] << 8) \
-					| (devc->sample[2] << 16) | (devc->sample[3] << 24);
-			sr_dbg("Received sample 0x%.*x.", devc->num_bytes * 2, sample);
-			if (devc->flag_reg & FLAG_RLE) {
-				/*
-				 * In RLE mode the high bit of the sample is the
-				 * "count" flag, meaning this sample is the number
-				 * of times the previous sample occurred.
-				 */
-				if (devc->sample[devc->num_bytes - 1] & 0x80) {
-					/* Clear the high bit. */
-					sample &= ~(0x80 << (devc->num_bytes - 1) * 8);
-					devc->rle_count = sample;
-					sr_dbg("RLE count: %u.", devc->rle_count);
-					devc->num_bytes = 0;
-					return TRUE;
-				}
-			}
-			devc->num_samples += devc->rle_count + 1;
-			if (devc->num_samples > devc->limit_samples) {
-				/* Save us from overrunning the buffer. */
-				devc->rle_count -= devc->num_samples - devc->limit_samples;
-				devc->num_samples = devc->limit_samples;
-			}
+		/* Got everything we asked for, don't wait for the timeout. */
+	}
 
-			if (num_channels < 4) {
-				/*
-				 * Some channel groups may have been turned
-				 * off, to speed up transfer between the
-				 * hardware and the PC. Expand that here before
-				 * submitting it over the session bus --
-				 * whatever is listening on the bus will be
-				 * expecting a full 32-bit sample, based on
-				 * the number of probes.
-				 */
-				j = 0;
-				memset(devc->tmp_sample, 0, 4);
-				for (i = 0; i < 4; i++) {
-					if (((devc->flag_reg >> 2) & (1 << i)) == 0) {
-						/*
-						 * This channel group was
-						 * enabled, copy from received
-						 * sample.
-						 */
-						devc->tmp_sample[i] = devc->sample[j++];
-					} else if (devc->flag_reg & FLAG_DEMUX && (i > 2)) {
-						/* group 2 & 3 get added to 0 & 1 */
-						devc->tmp_sample[i - 2] = devc->sample[j++];
-					}
-				}
-				memcpy(devc->sample, devc->tmp_sample, 4);
-				sr_dbg("Full sample: 0x%.8x.", sample);
-			}
+	/*
+	 * This is the main loop telling us a timeout was reached, or
+	 * we've acquired all the samples we asked for -- we're done.
+	 * Send the (properly-ordered) buffer to the frontend.
+	 */
+	if (devc->flag_reg & FLAG_RLE) {
+		send_rle_capture(devc, cb_data);
 
-			/* the OLS sends its sample buffer backwards.
-			 * store it in reverse order here, so we can dump
-			 * this on the session bus later.
-			 */
-			offset = (devc->limit_samples - devc->num_samples) * 4;
-			for (i = 0; i <= devc->rle_count; i++) {
-				memcpy(devc->raw_sample_buf + offset + (i * 4),
-				       devc->sample, 4);
-			}
-			memset(devc->sample, 0, 4);
-			devc->num_bytes = 0;
-			devc->rle_count = 0;
-		}
-	} else {
-		/*
-		 * This is the main loop telling us a timeout was reached, or
-		 * we've acquired all the samples we asked for -- we're done.
-		 * Send the (properly-ordered) buffer to the frontend.
-		 */
-		if (devc->trigger_at != -1) {
-			/* a trigger was set up, so we need to tell the frontend
-			 * about it.
-			 */
-			if (devc->trigger_at > 0) {
-				/* there are pre-trigger samples, send those first */
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				logic.length = devc->trigger_at * 4;
-				logic.unitsize = 4;
-				logic.data = devc->raw_sample_buf +
-					(devc->limit_samples - devc->num_samples) * 4;
-				sr_session_send(cb_data, &packet);
-			}
+		serial_flush(serial);
+		abort_acquisition(sdi);
 
-			/* send the trigger */
-			packet.type = SR_DF_TRIGGER;
-			sr_session_send(cb_data, &packet);
-
-			/* send post-trigger samples */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = (devc->num_samples * 4) - (devc->trigger_at * 4);
-			logic.unitsize = 4;
-			logic.data = devc->raw_sample_buf + devc->trigger_at * 4 +
-				(devc->limit_samples - devc->num_samples) * 4;
-			sr_session_send(cb_data, &packet);
-		} else {
-			/* no trigger was used */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = devc->num_samples * 4;
-			logic.unitsize = 4;
-			logic.data = devc->raw_sample_buf +
-				(devc->limit_samples - devc->num_samples) * 4;
-			sr_session_send(cb_data, &packet);
+		return TRUE;
+	}
+
+	samples = devc->raw_sample_buf +
+			(devc->limit_samples - devc->num_samples) * 4;
+	if (devc->trigger_at != -1) {
+		/* a trigger was set up, so we need to tell the frontend
+		 * about it.
+		 */
+		if (devc->trigger_at > 0) {
+			/* there are pre-trigger samples, send those first */
+			send_samples(cb_data, samples, devc->trigger_at);
 		}
-		g_free(devc->raw_sample_buf);
 
-		serial_flush(serial);
-		abort_acquisition(sdi);
+		/* send the trigger */
+		packet.type = SR_DF_TRIGGER;
+		sr_session_send(cb_data, &packet);
+
+		/* send post-trigger samples */
+		send_samples(cb_data, samples + devc->trigger_at * 4,
+				devc->num_samples - devc->trigger_at);
+	} else {
+		/* no trigger was used */
+		send_samples(cb_data, samples, devc->num_samples);
 	}
+	g_free(devc->raw_sample_buf);
+
+	serial_flush(serial);
+	abort_acquisition(sdi);
 
 	return TRUE;
 }
@@ -35,6 +35,7 @@
 #define CLOCK_RATE             SR_MHZ(100)
 #define MIN_NUM_SAMPLES        4
 #define DEFAULT_SAMPLERATE     SR_KHZ(200)
+#define READ_CHUNK_SIZE        4096
 
 /* Command opcodes */
 #define CMD_RESET                  0x00
@@ -102,6 +103,9 @@ struct dev_context {
 	unsigned char sample[4];
 	unsigned char tmp_sample[4];
 	unsigned char *raw_sample_buf;
+	/* RLE mode: sample values and run lengths, newest first. */
+	GArray *rle_values;
+	GArray *rle_lengths;
 };
 
 
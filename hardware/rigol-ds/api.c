@@ -201,7 +201,6 @@ static void clear_helper(void *priv)
 	struct dev_context *devc;
 
 	devc = priv;
-	g_free(devc->data);
 	g_free(devc->buffer);
 	g_free(devc->coupling[0]);
 	g_free(devc->coupling[1]);
@@ -365,11 +364,6 @@ static int probe_port(const char *resource, const char *serialcomm, GSList **dev
 		if (!memcmp(&devc->model->min_vdiv, &vdivs[i], sizeof(uint64_t[2])))
 			devc->vdivs = &vdivs[i];
 
-	if (!(devc->buffer = g_try_malloc(ACQ_BUFFER_SIZE)))
-		return SR_ERR_MALLOC;
-	if (!(devc->data = g_try_malloc(ACQ_BUFFER_SIZE * sizeof(float))))
-		return SR_ERR_MALLOC;
-
 	devc->data_source = DATA_SOURCE_LIVE;
 
 	sdi->priv = devc;
@@ -766,7 +760,8 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 			/* Can't know this until we have the exact model. */
 			return SR_ERR_ARG;
 		/* This needs tweaking by series/model! */
-		if (devc->model->series == RIGOL_DS2000)
+		if (devc->model->series == RIGOL_DS2000 ||
+		    devc->model->series == RIGOL_DS4000)
 			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources));
 		else
 			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 1);
@@ -824,13 +819,20 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 		if (set_cfg(sdi, ":RUN") != SR_OK)
 			return SR_ERR;
 	} else if (devc->data_source == DATA_SOURCE_MEMORY) {
-		if (devc->model->series != RIGOL_DS2000) {
+		if (devc->model->series != RIGOL_DS2000 &&
+		    devc->model->series != RIGOL_DS4000) {
 			sr_err("Data source 'Memory' not supported for this device");
 			return SR_ERR;
 		}
 	} else if (devc->data_source == DATA_SOURCE_SEGMENTED) {
-		sr_err("Data source 'Segmented' not yet supported");
-		return SR_ERR;
+		if (devc->model->series != RIGOL_DS2000 &&
+		    devc->model->series != RIGOL_DS4000) {
+			sr_err("Data source 'Segmented' not supported for this device");
+			return SR_ERR;
+		}
+		/* Segments are captured with the waveform recorder. */
+		if (set_cfg(sdi, ":FUNC:WREC:ENAB ON") != SR_OK)
+			return SR_ERR;
 	}
 
 	sr_scpi_source_add(scpi, G_IO_IN, 50, rigol_ds_receive, (void *)sdi);
@@ -843,10 +845,15 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	else
 		devc->channel_entry = devc->enabled_digital_probes;
 
+	devc->num_data = 0;
+	devc->data_requested = FALSE;
+
 	if (devc->model->protocol == PROTOCOL_LEGACY) {
 		devc->analog_frame_size = (devc->model->series == RIGOL_VS5000 ?
 				VS5000_ANALOG_LIVE_WAVEFORM_SIZE :
 				DS1000_ANALOG_LIVE_WAVEFORM_SIZE);
+		if (rigol_ds_alloc_buffers(devc) != SR_OK)
+			return SR_ERR_MALLOC;
 		/* Fetch the first frame. */
 		if (rigol_ds_channel_start(sdi) != SR_OK)
 			return SR_ERR;
@@ -873,6 +880,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 				else
 					devc->analog_frame_size = DS2000_ANALOG_LIVE_WAVEFORM_SIZE;
 			}
+			if (rigol_ds_alloc_buffers(devc) != SR_OK)
+				return SR_ERR_MALLOC;
 			if (rigol_ds_capture_start(sdi) != SR_OK)
 				return SR_ERR;
 		}
@@ -902,6 +911,11 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 	scpi = sdi->conn;
 	sr_scpi_source_remove(scpi);
 
+	if (devc->data_source == DATA_SOURCE_SEGMENTED) {
+		sr_scpi_send(scpi, ":FUNC:WREC:OPER STOP");
+		sr_scpi_send(scpi, ":FUNC:WREC:ENAB OFF");
+	}
+
 	return SR_OK;
 }
 
@@ -25,13 +25,15 @@
 #include <errno.h>
 #include <string.h>
 #include <math.h>
-#include <ctype.h>
 #include <time.h>
 #include <glib.h>
 #include "libsigrok.h"
 #include "libsigrok-internal.h"
 #include "protocol.h"
 
+/* How often to ask whether segment recording has finished (µs). */
+#define RECORD_POLL_INTERVAL 100000
+
 /*
  * This is a unified protocol driver for the DS1000 and DS2000 series.
  *
@@ -99,6 +101,7 @@ static void rigol_ds_set_wait_event(struct dev_context *devc, enum wait_events e
 	else
 		devc->wait_status = 1;
 	devc->wait_event = event;
+	devc->wait_next = 0;
 }
 
 /*
@@ -291,10 +294,65 @@ static int rigol_ds_block_wait(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/*
+ * Check whether the scope has finished recording segments. Recording can
+ * take a long time, so rather than blocking, this asks at most once per
+ * RECORD_POLL_INTERVAL and returns SR_ERR_NA while the scope is still at
+ * it; rigol_ds_receive() calls it again later.
+ */
+static int rigol_ds_record_wait(const struct sr_dev_inst *sdi)
+{
+	char buf[20];
+	struct dev_context *devc;
+	int64_t now;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	now = g_get_monotonic_time();
+	if (now < devc->wait_next)
+		return SR_ERR_NA;
+	devc->wait_next = now + RECORD_POLL_INTERVAL;
+
+	if (get_cfg(sdi, ":FUNC:WREC:OPER?", buf, sizeof(buf)) != SR_OK)
+		return SR_ERR;
+
+	/* The recording operation returns to "STOP" once it's done. */
+	if (strncmp(buf, "STOP", 4))
+		return SR_ERR_NA;
+
+	rigol_ds_set_wait_event(devc, WAIT_NONE);
+
+	return SR_OK;
+}
+
+/* Replay the next recorded segment and start reading its first channel */
+static int rigol_ds_segment_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	devc->segment++;
+	sr_dbg("Reading segment %d of %d", devc->segment, devc->num_segments);
+
+	if (sr_scpi_send(sdi->conn, ":FUNC:WREP:FCUR %d", devc->segment) != SR_OK)
+		return SR_ERR;
+
+	if (devc->enabled_analog_probes)
+		devc->channel_entry = devc->enabled_analog_probes;
+	else
+		devc->channel_entry = devc->enabled_digital_probes;
+
+	return rigol_ds_channel_start(sdi);
+}
+
 /* Start capturing a new frameset */
 SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	int num;
 
 	if (!(devc = sdi->priv))
 		return SR_ERR;
@@ -308,6 +366,25 @@ SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 		if (sr_scpi_send(sdi->conn, ":WAV:MODE NORM") != SR_OK)
 			return SR_ERR;
 		rigol_ds_set_wait_event(devc, WAIT_TRIGGER);
+	} else if (devc->data_source == DATA_SOURCE_SEGMENTED) {
+		/*
+		 * Let the scope record as many triggers as it can hold, or
+		 * as are still wanted, then read them back via replay.
+		 */
+		if (get_cfg_int(sdi, ":FUNC:WREC:FMAX?", &num) != SR_OK)
+			return SR_ERR;
+		if (devc->limit_frames)
+			num = MIN((uint64_t)num, devc->limit_frames - devc->num_frames);
+		if (num < 1)
+			return SR_ERR;
+		if (sr_scpi_send(sdi->conn, ":WAV:MODE NORM") != SR_OK)
+			return SR_ERR;
+		if (sr_scpi_send(sdi->conn, ":FUNC:WREC:FEND %d", num) != SR_OK)
+			return SR_ERR;
+		if (sr_scpi_send(sdi->conn, ":FUNC:WREC:OPER RUN") != SR_OK)
+			return SR_ERR;
+		devc->num_segments = num;
+		rigol_ds_set_wait_event(devc, WAIT_RECORD);
 	} else {
 		if (sr_scpi_send(sdi->conn, ":WAV:MODE RAW") != SR_OK)
 			return SR_ERR;
@@ -345,7 +422,7 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 		if (sr_scpi_send(sdi->conn, ":WAV:SOUR CHAN%d",
 				  probe->index + 1) != SR_OK)
 			return SR_ERR;
-		if (devc->data_source != DATA_SOURCE_LIVE) {
+		if (devc->data_source == DATA_SOURCE_MEMORY) {
 			if (sr_scpi_send(sdi->conn, ":WAV:RES") != SR_OK)
 				return SR_ERR;
 			if (sr_scpi_send(sdi->conn, ":WAV:BEG") != SR_OK)
@@ -361,44 +438,90 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-/* Read the header of a data block */
-static int rigol_ds_read_header(struct sr_scpi_dev_inst *scpi)
+/*
+ * Make sure the acquisition buffer can hold a whole frame, so deep memory
+ * reads can be done in large blocks.
+ */
+SR_PRIV int rigol_ds_alloc_buffers(struct dev_context *devc)
 {
-	char start[3], length[10];
-	int len, tmp;
+	uint64_t size;
 
-	/* Read the hashsign and length digit. */
-	tmp = sr_scpi_read_data(scpi, start, 2);
-	start[2] = '\0';
-	if (tmp != 2)
-	{
-		sr_err("Failed to read first two bytes of data block header.");
-		return -1;
-	}
-	if (start[0] != '#' || !isdigit(start[1]) || start[1] == '0')
-	{
-		sr_err("Received invalid data block header start '%s'.", start);
-		return -1;
-	}
-	len = atoi(start + 1);
+	size = MAX(devc->analog_frame_size, ACQ_BUFFER_SIZE);
+	if (devc->buffer && size <= devc->buffer_size)
+		return SR_OK;
 
-	/* Read the data length. */
-	tmp = sr_scpi_read_data(scpi, length, len);
-	length[len] = '\0';
-	if (tmp != len)
-	{
-		sr_err("Failed to read %d bytes of data block length.", len);
-		return -1;
+	g_free(devc->buffer);
+	devc->buffer_size = 0;
+
+	/* One spare byte for the block terminator. */
+	if (!(devc->buffer = g_try_malloc(size + 1))) {
+		sr_err("Acquisition buffer malloc failed.");
+		return SR_ERR_MALLOC;
 	}
-	if (parse_int(length, &len) != SR_OK)
-	{
-		sr_err("Received invalid data block length '%s'.", length);
-		return -1;
+	devc->buffer_size = size;
+
+	return SR_OK;
+}
+
+/*
+ * Send the samples collected in the acquisition buffer as they are, along
+ * with the scale and offset which turn them into volts.
+ */
+static void send_analog(struct sr_dev_inst *sdi, struct sr_probe *probe)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog_raw analog;
+	float scale, offset;
+	int vref;
+
+	devc = sdi->priv;
+
+	if (devc->num_data == 0)
+		return;
+
+	vref = devc->vert_reference[probe->index];
+	scale = devc->vdiv[probe->index] / 25.6;
+	if (devc->model->protocol == PROTOCOL_IEEE488_2) {
+		offset = -vref * scale - devc->vert_offset[probe->index];
+	} else {
+		offset = 128 * scale - devc->vert_offset[probe->index];
+		scale = -scale;
 	}
 
-	sr_dbg("Received data block header: %s%s -> block length %d", start, length, len);
+	analog.probes = g_slist_append(NULL, probe);
+	analog.num_samples = devc->num_data;
+	analog.mq = SR_MQ_VOLTAGE;
+	analog.unit = SR_UNIT_VOLT;
+	analog.mqflags = 0;
+	analog.encoding = SR_ANALOG_RAW_UINT8;
+	analog.bits = 8;
+	analog.scale = &scale;
+	analog.offset = &offset;
+	analog.data = devc->buffer;
+	packet.type = SR_DF_ANALOG_RAW;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.probes);
+
+	devc->num_data = 0;
+}
+
+/* Channel to read after the current one within the same frameset, if any. */
+static GSList *next_channel(struct dev_context *devc)
+{
+	struct sr_probe *probe;
+
+	probe = devc->channel_entry->data;
 
-	return len;
+	if (probe->type == SR_PROBE_ANALOG && devc->channel_entry->next)
+		return devc->channel_entry->next;
+
+	if (devc->enabled_digital_probes &&
+	    devc->channel_entry != devc->enabled_digital_probes)
+		return devc->enabled_digital_probes;
+
+	return NULL;
 }
 
 SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
@@ -407,11 +530,12 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
 	struct sr_datafeed_logic logic;
-	double vdiv, offset;
-	int len, i, vref;
+	unsigned char *buf;
+	int len;
+	gboolean frame_done;
 	struct sr_probe *probe;
+	GSList *next;
 
 	(void)fd;
 
@@ -450,6 +574,14 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 					return TRUE;
 				return TRUE;
 
+			case WAIT_RECORD:
+				if (rigol_ds_record_wait(sdi) != SR_OK)
+					return TRUE;
+				devc->segment = 0;
+				if (rigol_ds_segment_start(sdi) != SR_OK)
+					return TRUE;
+				break;
+
 			default:
 				sr_err("BUG: Unknown event target encountered");
 			}
@@ -458,18 +590,20 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		probe = devc->channel_entry->data;
 		
 		if (devc->num_block_bytes == 0 &&
-		    devc->model->protocol == PROTOCOL_IEEE488_2) {
+		    devc->model->protocol == PROTOCOL_IEEE488_2 &&
+		    !devc->data_requested) {
 				if (sr_scpi_send(sdi->conn, ":WAV:DATA?") != SR_OK)
 					return TRUE;
 		}
 
 		if (devc->num_block_bytes == 0) {
+			devc->data_requested = FALSE;
 			if (sr_scpi_read_begin(scpi) != SR_OK)
 				return TRUE;
 			if (devc->model->protocol == PROTOCOL_IEEE488_2) {
 				sr_dbg("New block header expected");
-				len = rigol_ds_read_header(scpi);
-				if (len == -1)
+				len = sr_scpi_read_block_header(scpi);
+				if (len < 0)
 					return TRUE;
 				/* At slow timebases in live capture the DS2072
 				 * sometimes returns "short" data blocks, with
@@ -480,7 +614,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 				if (devc->data_source == DATA_SOURCE_LIVE
 						&& (unsigned)len < devc->num_frame_samples) {
 					sr_dbg("Discarding short data block");
-					sr_scpi_read_data(scpi, (char *)devc->buffer, len + 1);
+					sr_scpi_read_skip(scpi, len + 1);
 					return TRUE;
 				}
 				devc->num_block_bytes = len;
@@ -494,13 +628,22 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 			devc->num_block_read = 0;
 		}
 
-		len = devc->num_block_bytes - devc->num_block_read;
-		len = sr_scpi_read_data(scpi, (char *)devc->buffer,
-				len < ACQ_BUFFER_SIZE ? len : ACQ_BUFFER_SIZE);
+		/* Analog samples collect in the buffer until the frame is done. */
+		if (probe->type == SR_PROBE_ANALOG &&
+		    devc->num_data == devc->buffer_size)
+			send_analog(sdi, probe);
+		buf = devc->buffer + devc->num_data;
 
-		sr_dbg("Received %d bytes.", len);
-		if (len == -1)
+		len = MIN(devc->num_block_bytes - devc->num_block_read,
+				devc->buffer_size - devc->num_data);
+		len = sr_scpi_read_data(scpi, (char *)buf, len);
+
+		if (len < 0)
+			return TRUE;
+		/* Nothing has arrived yet, wait for the next event. */
+		if (len == 0)
 			return TRUE;
+		sr_dbg("Received %d bytes.", len);
 
 		devc->num_block_read += len;
 
@@ -510,43 +653,15 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 			sr_session_send(sdi, &packet);
 		}
 
-		if (probe->type == SR_PROBE_ANALOG) {
-			vref = devc->vert_reference[probe->index];
-			vdiv = devc->vdiv[probe->index] / 25.6;
-			offset = devc->vert_offset[probe->index];
-			if (devc->model->protocol == PROTOCOL_IEEE488_2)
-				for (i = 0; i < len; i++)
-					devc->data[i] = ((int)devc->buffer[i] - vref) * vdiv - offset;
-			else
-				for (i = 0; i < len; i++)
-					devc->data[i] = (128 - devc->buffer[i]) * vdiv - offset;
-			analog.probes = g_slist_append(NULL, probe);
-			analog.num_samples = len;
-			analog.data = devc->data;
-			analog.mq = SR_MQ_VOLTAGE;
-			analog.unit = SR_UNIT_VOLT;
-			analog.mqflags = 0;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			sr_session_send(cb_data, &packet);
-			g_slist_free(analog.probes);
-		} else {
-			logic.length = len - 10;
-			logic.unitsize = 2;
-			logic.data = devc->buffer + 10;
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			sr_session_send(cb_data, &packet);
-		}
-
 		if (devc->num_block_read == devc->num_block_bytes) {
 			sr_dbg("Block has been completed");
 			if (devc->model->protocol == PROTOCOL_IEEE488_2) {
 				/* Discard the terminating linefeed and prepare for
 				   possible next block */
-				sr_scpi_read_data(scpi, (char *)devc->buffer, 1);
+				if (sr_scpi_read_skip(scpi, 1) != SR_OK)
+					return TRUE;
 				devc->num_block_bytes = 0;
-				if (devc->data_source != DATA_SOURCE_LIVE)
+				if (devc->data_source == DATA_SOURCE_MEMORY)
 					rigol_ds_set_wait_event(devc, WAIT_BLOCK);
 			}
 			devc->num_block_read = 0;
@@ -555,57 +670,84 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		}
 
 		devc->num_frame_samples += len;
+		frame_done = devc->num_frame_samples >= (probe->type == SR_PROBE_ANALOG ?
+					devc->analog_frame_size : DIGITAL_WAVEFORM_SIZE);
+
+		next = NULL;
+		if (frame_done) {
+			sr_dbg("Frame completed, %d samples", devc->num_frame_samples);
+			if (devc->model->protocol == PROTOCOL_IEEE488_2) {
+				/* Signal end of data download to scope */
+				if (devc->data_source == DATA_SOURCE_MEMORY)
+					/*
+					 * This causes a query error, without it switching
+					 * to the next channel causes an error. Fun with
+					 * firmware...
+					 */
+					sr_scpi_send(sdi->conn, ":WAV:END");
+			}
+
+			/*
+			 * Get the scope working on the next channel of this
+			 * frameset before sending the data we just read.
+			 */
+			if ((next = next_channel(devc))) {
+				devc->channel_entry = next;
+				rigol_ds_channel_start(sdi);
+				if (devc->model->protocol == PROTOCOL_IEEE488_2 &&
+				    devc->data_source != DATA_SOURCE_MEMORY) {
+					if (sr_scpi_send(sdi->conn, ":WAV:DATA?") == SR_OK)
+						devc->data_requested = TRUE;
+				}
+			}
+		}
 
-		if (devc->num_frame_samples < (probe->type == SR_PROBE_ANALOG ?
-					devc->analog_frame_size : DIGITAL_WAVEFORM_SIZE))
+		if (probe->type == SR_PROBE_ANALOG) {
+			devc->num_data += len;
+			if (frame_done)
+				send_analog(sdi, probe);
+		} else {
+			logic.length = len - 10;
+			logic.unitsize = 2;
+			logic.data = buf + 10;
+			packet.type = SR_DF_LOGIC;
+			packet.payload = &logic;
+			sr_session_send(cb_data, &packet);
+		}
+
+		if (!frame_done)
 			/* Don't have the whole frame yet. */
 			return TRUE;
 
 		/* End of the frame. */
-		sr_dbg("Frame completed, %d samples", devc->num_frame_samples);
 		packet.type = SR_DF_FRAME_END;
 		sr_session_send(sdi, &packet);
-		if (devc->model->protocol == PROTOCOL_IEEE488_2) {
-			/* Signal end of data download to scope */
-			if (devc->data_source != DATA_SOURCE_LIVE)
-				/*
-				 * This causes a query error, without it switching
-				 * to the next channel causes an error. Fun with
-				 * firmware...
-				 */
-				sr_scpi_send(sdi->conn, ":WAV:END");
-		}
 
-		if (probe->type == SR_PROBE_ANALOG
-				&& devc->channel_entry->next != NULL) {
-			/* We got the frame for this analog channel, but
-			 * there's another analog channel. */
-			devc->channel_entry = devc->channel_entry->next;
-			rigol_ds_channel_start(sdi);
+		if (next)
+			/* The next channel has already been started. */
+			return TRUE;
+
+		/* Done with all channels in this frame. */
+		if (++devc->num_frames == devc->limit_frames) {
+			/* End of last frame. */
+			packet.type = SR_DF_END;
+			sr_session_send(sdi, &packet);
+			sdi->driver->dev_acquisition_stop(sdi, cb_data);
+		} else if (devc->data_source == DATA_SOURCE_SEGMENTED
+				&& devc->segment < devc->num_segments) {
+			/* More recorded segments to read, no need to re-arm. */
+			rigol_ds_segment_start(sdi);
 		} else {
-			/* Done with all analog channels in this frame. */
-			if (devc->enabled_digital_probes
-					&& devc->channel_entry != devc->enabled_digital_probes) {
-				/* Now we need to get the digital data. */
+			/* Get the next frame, starting with the first analog channel. */
+			if (devc->enabled_analog_probes)
+				devc->channel_entry = devc->enabled_analog_probes;
+			else
 				devc->channel_entry = devc->enabled_digital_probes;
+
+			if (devc->model->protocol == PROTOCOL_LEGACY)
 				rigol_ds_channel_start(sdi);
-			} else if (++devc->num_frames == devc->limit_frames) {
-				/* End of last frame. */
-				packet.type = SR_DF_END;
-				sr_session_send(sdi, &packet);
-				sdi->driver->dev_acquisition_stop(sdi, cb_data);
-			} else {
-				/* Get the next frame, starting with the first analog channel. */
-				if (devc->enabled_analog_probes)
-					devc->channel_entry = devc->enabled_analog_probes;
-				else
-					devc->channel_entry = devc->enabled_digital_probes;
-
-				if (devc->model->protocol == PROTOCOL_LEGACY)
-					rigol_ds_channel_start(sdi);
-				else
-					rigol_ds_capture_start(sdi);
-			}
+			else
+				rigol_ds_capture_start(sdi);
 		}
 	}
 
@@ -650,82 +792,99 @@ static int get_cfg_int(const struct sr_dev_inst *sdi, char *cmd, int *i)
 	return SR_OK;
 }
 
-static int get_cfg_float(const struct sr_dev_inst *sdi, char *cmd, float *f)
-{
-	char buf[32], *e;
-
-	if (get_cfg(sdi, cmd, buf, sizeof(buf)) != SR_OK)
-		return SR_ERR;
-	*f = strtof(buf, &e);
-	if (e == buf || (fpclassify(*f) & (FP_ZERO | FP_NORMAL)) == 0) {
-		sr_dbg("failed to parse response to '%s': '%s'", cmd, buf);
-		return SR_ERR;
-	}
-
-	return SR_OK;
-}
-
-static int get_cfg_string(const struct sr_dev_inst *sdi, char *cmd, char **buf)
-{
-	if (!(*buf = g_try_malloc0(256)))
-		return SR_ERR_MALLOC;
-
-	if (get_cfg(sdi, cmd, *buf, 256) != SR_OK)
-		return SR_ERR;
-
-	return SR_OK;
-}
-
 SR_PRIV int rigol_ds_get_dev_cfg(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	char *t_s, *cmd;
+	struct sr_scpi_batch *batch;
+	char *cmd;
 	unsigned int i;
 	int res;
 
 	devc = sdi->priv;
 
+	/*
+	 * Query the device settings in as few round trips as possible. The
+	 * legacy protocol doesn't support compound queries.
+	 */
+	if (!(batch = sr_scpi_batch_new(sdi->conn,
+			devc->model->protocol == PROTOCOL_IEEE488_2)))
+		return SR_ERR_MALLOC;
+
 	/* Analog channel state. */
 	for (i = 0; i < devc->model->analog_channels; i++) {
 		cmd = g_strdup_printf(":CHAN%d:DISP?", i + 1);
-		res = get_cfg_string(sdi, cmd, &t_s);
+		sr_scpi_batch_add_bool(batch, cmd, &devc->analog_channels[i]);
 		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-		devc->analog_channels[i] = !strcmp(t_s, "ON") || !strcmp(t_s, "1");
 	}
-	sr_dbg("Current analog channel state:");
-	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %s", i + 1, devc->analog_channels[i] ? "on" : "off");
 
 	/* Digital channel state. */
 	if (devc->model->has_digital) {
-		sr_dbg("Current digital channel state:");
 		for (i = 0; i < 16; i++) {
 			cmd = g_strdup_printf(":DIG%d:TURN?", i + 1);
-			res = get_cfg_string(sdi, cmd, &t_s);
+			sr_scpi_batch_add_bool(batch, cmd,
+					       &devc->digital_channels[i]);
 			g_free(cmd);
-			if (res != SR_OK)
-				return SR_ERR;
-			devc->digital_channels[i] = !strcmp(t_s, "ON") ? TRUE : FALSE;
-			g_free(t_s);
-			sr_dbg("D%d: %s", i + 1, devc->digital_channels[i] ? "on" : "off");
 		}
 	}
 
 	/* Timebase. */
-	if (get_cfg_float(sdi, ":TIM:SCAL?", &devc->timebase) != SR_OK)
-		return SR_ERR;
-	sr_dbg("Current timebase %g", devc->timebase);
+	sr_scpi_batch_add_float(batch, ":TIM:SCAL?", &devc->timebase);
 
 	/* Vertical gain. */
 	for (i = 0; i < devc->model->analog_channels; i++) {
 		cmd = g_strdup_printf(":CHAN%d:SCAL?", i + 1);
-		res = get_cfg_float(sdi, cmd, &devc->vdiv[i]);
+		sr_scpi_batch_add_float(batch, cmd, &devc->vdiv[i]);
 		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
 	}
+
+	/* Vertical offset. */
+	for (i = 0; i < devc->model->analog_channels; i++) {
+		cmd = g_strdup_printf(":CHAN%d:OFFS?", i + 1);
+		sr_scpi_batch_add_float(batch, cmd, &devc->vert_offset[i]);
+		g_free(cmd);
+	}
+
+	/* Coupling. */
+	for (i = 0; i < devc->model->analog_channels; i++) {
+		g_free(devc->coupling[i]);
+		devc->coupling[i] = NULL;
+		cmd = g_strdup_printf(":CHAN%d:COUP?", i + 1);
+		sr_scpi_batch_add_string(batch, cmd, &devc->coupling[i]);
+		g_free(cmd);
+	}
+
+	/* Trigger source. */
+	g_free(devc->trigger_source);
+	devc->trigger_source = NULL;
+	sr_scpi_batch_add_string(batch, ":TRIG:EDGE:SOUR?",
+				 &devc->trigger_source);
+
+	/* Horizontal trigger position. */
+	sr_scpi_batch_add_float(batch, ":TIM:OFFS?", &devc->horiz_triggerpos);
+
+	/* Trigger slope. */
+	g_free(devc->trigger_slope);
+	devc->trigger_slope = NULL;
+	sr_scpi_batch_add_string(batch, ":TRIG:EDGE:SLOP?",
+				 &devc->trigger_slope);
+
+	res = sr_scpi_batch_run(batch);
+	sr_scpi_batch_free(batch);
+	if (res != SR_OK)
+		return SR_ERR;
+
+	sr_dbg("Current analog channel state:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %s", i + 1, devc->analog_channels[i] ? "on" : "off");
+
+	if (devc->model->has_digital) {
+		sr_dbg("Current digital channel state:");
+		for (i = 0; i < 16; i++)
+			sr_dbg("D%d: %s", i + 1, devc->digital_channels[i] ? "on" : "off");
+	}
+
+	sr_dbg("Current timebase %g", devc->timebase);
+
 	sr_dbg("Current vertical gain:");
 	for (i = 0; i < devc->model->analog_channels; i++)
 		sr_dbg("CH%d %g", i + 1, devc->vdiv[i]);
@@ -742,43 +901,16 @@ SR_PRIV int rigol_ds_get_dev_cfg(const struct sr_dev_inst *sdi)
 		}
 	}
 
-	/* Vertical offset. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf(":CHAN%d:OFFS?", i + 1);
-		res = get_cfg_float(sdi, cmd, &devc->vert_offset[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
 	sr_dbg("Current vertical offset:");
 	for (i = 0; i < devc->model->analog_channels; i++)
 		sr_dbg("CH%d %g", i + 1, devc->vert_offset[i]);
 
-	/* Coupling. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf(":CHAN%d:COUP?", i + 1);
-		res = get_cfg_string(sdi, cmd, &devc->coupling[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
 	sr_dbg("Current coupling:");
 	for (i = 0; i < devc->model->analog_channels; i++)
 		sr_dbg("CH%d %s", i + 1, devc->coupling[i]);
 
-	/* Trigger source. */
-	if (get_cfg_string(sdi, ":TRIG:EDGE:SOUR?", &devc->trigger_source) != SR_OK)
-		return SR_ERR;
 	sr_dbg("Current trigger source %s", devc->trigger_source);
-
-	/* Horizontal trigger position. */
-	if (get_cfg_float(sdi, ":TIM:OFFS?", &devc->horiz_triggerpos) != SR_OK)
-		return SR_ERR;
 	sr_dbg("Current horizontal trigger position %g", devc->horiz_triggerpos);
-
-	/* Trigger slope. */
-	if (get_cfg_string(sdi, ":TRIG:EDGE:SLOP?", &devc->trigger_slope) != SR_OK)
-		return SR_ERR;
 	sr_dbg("Current trigger slope %s", devc->trigger_slope);
 
 	return SR_OK;
@@ -36,7 +36,7 @@
 #define DS2000_ANALOG_MEM_WAVEFORM_SIZE_1C 14000
 #define DS2000_ANALOG_MEM_WAVEFORM_SIZE_2C 7000
 #define DIGITAL_WAVEFORM_SIZE 1210
-/* Size of acquisition buffers */
+/* Minimum size of acquisition buffer, grown to hold a whole frame */
 #define ACQ_BUFFER_SIZE 32768
 
 #define MAX_ANALOG_PROBES 4
@@ -83,6 +83,7 @@ enum wait_events {
 	WAIT_TRIGGER, /* Wait for trigger (only live capture) */
 	WAIT_BLOCK,   /* Wait for block data (only when reading sample mem) */
 	WAIT_STOP,    /* Wait for scope stopping (only single shots) */
+	WAIT_RECORD,  /* Wait for segment recording to finish */
 };
 
 /** Private, per-device-instance driver context. */
@@ -124,6 +125,10 @@ struct dev_context {
 
 	/* Number of frames received in total. */
 	uint64_t num_frames;
+	/* Number of segments in the current recording. */
+	int num_segments;
+	/* Segment currently being read, starting at 1. */
+	int segment;
 	/* GSList entry for the current channel. */
 	GSList *channel_entry;
 	/* Number of samples received in current frame. */
@@ -136,11 +141,19 @@ struct dev_context {
 	enum wait_events wait_event;
 	/* Trigger/block copying/stop waiting status */
 	int wait_status;
-	/* Acq buffers used for reading from the scope and sending data to app */
+	/* Host time of the next status query while waiting, in µs. */
+	int64_t wait_next;
+	/* Data for the current channel has already been requested. */
+	gboolean data_requested;
+	/* Acq buffer used for reading from the scope and sending data to app */
 	unsigned char *buffer;
-	float *data;
+	/* Size of the acq buffer, in samples. */
+	uint64_t buffer_size;
+	/* Number of analog samples waiting in the buffer. */
+	uint64_t num_data;
 };
 
+SR_PRIV int rigol_ds_alloc_buffers(struct dev_context *devc);
 SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi);
 SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi);
 SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data);
@@ -45,6 +45,10 @@ static const int32_t hwopts[] = {
 	SR_CONF_CONN,
 };
 
+static const uint32_t usb_ids[] = {
+	(LOGIC16_VID << 16) | LOGIC16_PID,
+};
+
 static const int32_t hwcaps[] = {
 	SR_CONF_LOGIC_ANALYZER,
 	SR_CONF_SAMPLERATE,
@@ -138,7 +142,8 @@ static GSList *scan(GSList *options)
 	struct sr_usb_dev_inst *usb;
 	struct sr_probe *probe;
 	struct sr_config *src;
-	GSList *l, *devices, *conn_devices;
+	struct ezusb_upload *upload;
+	GSList *l, *devices, *conn_devices, *uploads;
 	struct libusb_device_descriptor des;
 	libusb_device **devlist;
 	int devcnt, ret, i, j;
@@ -162,6 +167,7 @@ static GSList *scan(GSList *options)
 
 	/* Find all Logic16 devices and upload firmware to them. */
 	devices = NULL;
+	uploads = NULL;
 	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
@@ -217,18 +223,31 @@ static GSList *scan(GSList *options)
 				libusb_get_bus_number(devlist[i]),
 				libusb_get_device_address(devlist[i]), NULL);
 		} else {
-			if (ezusb_upload_firmware(devlist[i], USB_CONFIGURATION,
-						  FX2_FIRMWARE) == SR_OK)
-				/* Store when this device's FW was updated. */
-				devc->fw_updated = g_get_monotonic_time();
+			/* Upload to all devices at once, see below. */
+			if ((upload = ezusb_upload_firmware_start(devlist[i],
+					USB_CONFIGURATION, FX2_FIRMWARE, sdi)))
+				uploads = g_slist_append(uploads, upload);
 			else
 				sr_err("Firmware upload failed for "
-				       "device %d.", devcnt);
+				       "device %d.", sdi->index);
 			sdi->inst_type = SR_INST_USB;
 			sdi->conn = sr_usb_dev_inst_new(
 				libusb_get_bus_number(devlist[i]), 0xff, NULL);
 		}
 	}
+
+	for (l = uploads; l; l = l->next) {
+		upload = l->data;
+		sdi = upload->user_data;
+		devc = sdi->priv;
+		if (ezusb_upload_firmware_finish(upload) == SR_OK)
+			/* Store when this device's FW was updated. */
+			devc->fw_updated = g_get_monotonic_time();
+		else
+			sr_err("Firmware upload failed for "
+			       "device %d.", sdi->index);
+	}
+	g_slist_free(uploads);
 	libusb_free_device_list(devlist, 1);
 	g_slist_free_full(conn_devices, (GDestroyNotify)sr_usb_dev_inst_free);
 
@@ -545,6 +564,10 @@ static int config_list(int key, GVariant **data, const struct sr_dev_inst *sdi,
 		*data = g_variant_new_fixed_array(G_VARIANT_TYPE_INT32,
 				hwopts, ARRAY_SIZE(hwopts), sizeof(int32_t));
 		break;
+	case SR_CONF_USB_IDS:
+		*data = g_variant_new_fixed_array(G_VARIANT_TYPE_UINT32,
+				usb_ids, ARRAY_SIZE(usb_ids), sizeof(uint32_t));
+		break;
 	case SR_CONF_DEVICE_OPTIONS:
 		*data = g_variant_new_fixed_array(G_VARIANT_TYPE_INT32,
 				hwcaps, ARRAY_SIZE(hwcaps), sizeof(int32_t));
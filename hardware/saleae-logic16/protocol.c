@@ -327,10 +327,12 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 				 enum voltage_range vrange)
 {
 	struct dev_context *devc;
-	int offset, chunksize, ret;
+	int ret;
 	const char *filename;
-	uint8_t len, buf[256 * 62], command[64];
-	FILE *fw;
+	const uint8_t *data;
+	gsize size, offset;
+	uint8_t len, command[64];
+	GBytes *fw;
 
 	devc = sdi->priv;
 
@@ -350,39 +352,29 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 	}
 
 	sr_info("Uploading FPGA bitstream at %s.", filename);
-	if ((fw = g_fopen(filename, "rb")) == NULL) {
-		sr_err("Unable to open bitstream file %s for reading: %s.",
-		       filename, strerror(errno));
+	if (!(fw = sr_firmware_get(filename)))
 		return SR_ERR;
-	}
+	data = g_bytes_get_data(fw, &size);
 
-	buf[0] = COMMAND_FPGA_UPLOAD_INIT;
-	if ((ret = do_ep1_command(sdi, buf, 1, NULL, 0)) != SR_OK) {
-		fclose(fw);
+	command[0] = COMMAND_FPGA_UPLOAD_INIT;
+	if ((ret = do_ep1_command(sdi, command, 1, NULL, 0)) != SR_OK) {
+		g_bytes_unref(fw);
 		return ret;
 	}
 
-	while (1) {
-		chunksize = fread(buf, 1, sizeof(buf), fw);
-		if (chunksize == 0)
-			break;
-
-		for (offset = 0; offset < chunksize; offset += 62) {
-			len = (offset + 62 > chunksize ?
-				chunksize - offset : 62);
-			command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
-			command[1] = len;
-			memcpy(command + 2, buf + offset, len);
-			ret = do_ep1_command(sdi, command, len + 2, NULL, 0);
-			if (ret != SR_OK) {
-				fclose(fw);
-				return ret;
-			}
+	/* EP1 commands are a single packet, 62 bytes is all that fits. */
+	for (offset = 0; offset < size; offset += len) {
+		len = MIN(size - offset, 62);
+		command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
+		command[1] = len;
+		memcpy(command + 2, data + offset, len);
+		ret = do_ep1_command(sdi, command, len + 2, NULL, 0);
+		if (ret != SR_OK) {
+			g_bytes_unref(fw);
+			return ret;
 		}
-
-		sr_info("Uploaded %d bytes.", chunksize);
 	}
-	fclose(fw);
+	g_bytes_unref(fw);
 	sr_info("FPGA bitstream upload done.");
 
 	if ((ret = prime_fpga(sdi)) != SR_OK)
@@ -556,6 +548,11 @@ SR_PRIV int logic16_abort_acquisition(const struct sr_dev_inst *sdi)
 
 SR_PRIV int logic16_init_device(const struct sr_dev_inst *sdi)
 {
+	static const char *bitstreams[] = {
+		FPGA_FIRMWARE_18,
+		FPGA_FIRMWARE_33,
+		NULL,
+	};
 	struct dev_context *devc;
 	int ret;
 
@@ -563,6 +560,9 @@ SR_PRIV int logic16_init_device(const struct sr_dev_inst *sdi)
 
 	devc->cur_voltage_range = VOLTAGE_RANGE_UNKNOWN;
 
+	/* Switching voltage ranges later shouldn't have to hit the disk. */
+	sr_firmware_preload(bitstreams);
+
 	if ((ret = abort_acquisition_sync(sdi)) != SR_OK)
 		return ret;
 
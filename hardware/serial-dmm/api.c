@@ -39,6 +39,7 @@ static const int32_t hwcaps[] = {
 	SR_CONF_LIMIT_SAMPLES,
 	SR_CONF_LIMIT_MSEC,
 	SR_CONF_CONTINUOUS,
+	SR_CONF_BATCH_LATENCY,
 };
 
 SR_PRIV struct sr_dev_driver bbcgm_m2110_driver_info;
@@ -441,6 +442,11 @@ static int config_set(int id, GVariant *data, const struct sr_dev_inst *sdi,
 		sr_dbg("Setting time limit to %" PRIu64 "ms.",
 		       devc->limit_msec);
 		break;
+	case SR_CONF_BATCH_LATENCY:
+		devc->batch_latency = g_variant_get_uint64(data);
+		sr_dbg("Setting batch latency to %" PRIu64 "ms.",
+		       devc->batch_latency);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -493,6 +499,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi,
 	 */
 	devc->num_samples = 0;
 	devc->starttime = g_get_monotonic_time();
+	std_analog_batch_init(&devc->batch, cb_data, BATCH_MAX_SAMPLES,
+			devc->batch_latency);
 
 	/* Send header packet to the session bus. */
 	std_session_send_df_header(cb_data, LOG_PREFIX);
@@ -507,6 +515,13 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi,
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 {
+	struct dev_context *devc;
+
+	if ((devc = sdi->priv)) {
+		std_analog_batch_flush(&devc->batch);
+		std_analog_batch_free(&devc->batch);
+	}
+
 	return std_serial_dev_acquisition_stop(sdi, cb_data, std_serial_dev_close,
 			sdi->conn, LOG_PREFIX);
 }
@@ -39,7 +39,6 @@ static void handle_packet(const uint8_t *buf, struct sr_dev_inst *sdi,
 			  int dmm, void *info)
 {
 	float floatval;
-	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct dev_context *devc;
 
@@ -61,47 +60,44 @@ static void handle_packet(const uint8_t *buf, struct sr_dev_inst *sdi,
 
 	if (analog.mq != -1) {
 		/* Got a measurement. */
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		sr_session_send(devc->cb_data, &packet);
+		std_analog_batch_add(&devc->batch, &analog);
 		devc->num_samples++;
 	}
 }
 
-static void handle_new_data(struct sr_dev_inst *sdi, int dmm, void *info)
+struct packet_context {
+	struct sr_dev_inst *sdi;
+	int dmm;
+	void *info;
+};
+
+static void packet_handler(const uint8_t *buf, size_t len, void *cb_data)
 {
-	struct dev_context *devc;
-	int len, i, offset = 0;
-	struct sr_serial_dev_inst *serial;
+	struct packet_context *ctx;
 
-	devc = sdi->priv;
-	serial = sdi->conn;
+	(void)len;
 
-	/* Try to get as much data as the buffer can hold. */
-	len = DMM_BUFSIZE - devc->buflen;
-	len = serial_read(serial, devc->buf + devc->buflen, len);
-	if (len == 0)
-		return; /* No new bytes, nothing to do. */
-	if (len < 0) {
-		sr_err("Serial port read error: %d.", len);
-		return;
-	}
-	devc->buflen += len;
-
-	/* Now look for packets in that data. */
-	while ((devc->buflen - offset) >= dmms[dmm].packet_size) {
-		if (dmms[dmm].packet_valid(devc->buf + offset)) {
-			handle_packet(devc->buf + offset, sdi, dmm, info);
-			offset += dmms[dmm].packet_size;
-		} else {
-			offset++;
-		}
-	}
+	ctx = cb_data;
+	handle_packet(buf, ctx->sdi, ctx->dmm, ctx->info);
+}
+
+static void handle_new_data(struct sr_dev_inst *sdi, int dmm, void *info)
+{
+	struct packet_context ctx;
+	struct serial_packet_desc desc = {
+		.packet_size = dmms[dmm].packet_size,
+		.length_offset = -1,
+		.terminator = -1,
+		.is_valid = dmms[dmm].packet_valid,
+	};
+	int ret;
 
-	/* If we have any data left, move it to the beginning of our buffer. */
-	for (i = 0; i < devc->buflen - offset; i++)
-		devc->buf[i] = devc->buf[offset + i];
-	devc->buflen -= offset;
+	ctx.sdi = sdi;
+	ctx.dmm = dmm;
+	ctx.info = info;
+
+	if ((ret = serial_receive(sdi->conn, &desc, packet_handler, &ctx)) < 0)
+		sr_err("Serial port read error: %d.", ret);
 }
 
 static int receive_data(int fd, int revents, int dmm, void *info, void *cb_data)
@@ -136,6 +132,8 @@ static int receive_data(int fd, int revents, int dmm, void *info, void *cb_data)
 		}
 	}
 
+	std_analog_batch_poll(&devc->batch);
+
 	if (devc->limit_samples && devc->num_samples >= devc->limit_samples) {
 		sr_info("Requested number of samples reached.");
 		sdi->driver->dev_acquisition_stop(sdi, cb_data);
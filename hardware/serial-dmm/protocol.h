@@ -56,6 +56,9 @@ enum {
 
 #define DMM_COUNT 28
 
+/* Most readings sent in one packet when batching is enabled. */
+#define BATCH_MAX_SAMPLES 64
+
 struct dmm_info {
 	/** Manufacturer/brand. */
 	char *vendor;
@@ -84,8 +87,6 @@ struct dmm_info {
 
 extern SR_PRIV struct dmm_info dmms[DMM_COUNT];
 
-#define DMM_BUFSIZE 256
-
 /** Private, per-device-instance driver context. */
 struct dev_context {
 	/** The current sampling limit (in number of samples). */
@@ -102,9 +103,11 @@ struct dev_context {
 
 	int64_t starttime;
 
-	uint8_t buf[DMM_BUFSIZE];
-	int bufoffset;
-	int buflen;
+	/** How long readings may be held back (in milliseconds). */
+	uint64_t batch_latency;
+
+	/** Readings held back for batching. */
+	struct std_analog_batch batch;
 };
 
 SR_PRIV int receive_data_BBCGM_M2110(int fd, int revents, void *cb_data);
@@ -179,43 +179,43 @@ SR_PRIV gboolean teleinfo_packet_valid(const uint8_t *buf)
 	return !!teleinfo_get_optarif(buf);
 }
 
+static const uint8_t teleinfo_sync[] = { LF };
+
+/* A group is an LF, a label, data and checksum, and a CR. */
+static const struct serial_packet_desc teleinfo_group = {
+	.sync = teleinfo_sync,
+	.sync_len = sizeof(teleinfo_sync),
+	.packet_size = 2,
+	.max_size = TELEINFO_GROUP_SIZE,
+	.length_offset = -1,
+	.terminator = CR,
+	.is_valid = NULL,
+};
+
+static void teleinfo_handle_group(const uint8_t *buf, size_t len,
+		void *cb_data)
+{
+	(void)len;
+
+	teleinfo_parse_group(cb_data, buf, NULL);
+}
+
 SR_PRIV int teleinfo_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct sr_serial_dev_inst *serial;
-	const uint8_t *ptr, *next_ptr, *end_ptr;
-	int len;
 	int64_t time;
+	int ret;
 
 	(void)fd;
 
 	if (!(sdi = cb_data) || !(devc = sdi->priv) || revents != G_IO_IN)
 		return TRUE;
-	serial = sdi->conn;
-
-	/* Try to get as much data as the buffer can hold. */
-	len = TELEINFO_BUF_SIZE - devc->buf_len;
-	len = serial_read(serial, devc->buf + devc->buf_len, len);
-	if (len < 1) {
-		sr_err("Serial port read error: %d.", len);
-		return FALSE;
-	}
-	devc->buf_len += len;
-
-	/* Now look for packets in that data. */
-	ptr = devc->buf;
-	end_ptr = ptr + devc->buf_len;
-	while ((next_ptr = teleinfo_parse_data(sdi, ptr, end_ptr - ptr, NULL)))
-		ptr = next_ptr;
-
-	/* If we have any data left, move it to the beginning of our buffer. */
-	memmove(devc->buf, ptr, end_ptr - ptr);
-	devc->buf_len -= ptr - devc->buf;
 
-	/* If buffer is full and no valid packet was found, wipe buffer. */
-	if (devc->buf_len >= TELEINFO_BUF_SIZE) {
-		devc->buf_len = 0;
+	ret = serial_receive(sdi->conn, &teleinfo_group,
+			teleinfo_handle_group, sdi);
+	if (ret < 0) {
+		sr_err("Serial port read error: %d.", ret);
 		return FALSE;
 	}
 
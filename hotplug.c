@@ -0,0 +1,1047 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <glib.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <glib-unix.h>
+#endif
+#include "config.h" /* Needed for HAVE_LIBUSB_1_0 and others. */
+#ifdef HAVE_LIBUDEV
+#include <libudev.h>
+#endif
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "hotplug"
+
+extern struct sr_session *session;
+
+/**
+ * @file
+ *
+ * Hotplug device monitoring.
+ */
+
+/**
+ * @defgroup grp_hotplug Hotplug
+ *
+ * Notification of devices being plugged in and unplugged.
+ *
+ * Rather than rescanning the whole bus with every driver to find out what
+ * changed, a frontend can start a hotplug monitor. It listens for libusb
+ * hotplug and udev serial port events from within the session loop, scans
+ * a newly plugged in device with the one driver that handles it in a thread
+ * of its own, and tells the frontend which devices arrived or left.
+ *
+ * @{
+ */
+
+/* A USB event, queued by the libusb callback for the session thread. */
+struct usb_event {
+	int type;
+	uint8_t bus;
+	uint8_t address;
+	uint16_t vid;
+	uint16_t pid;
+};
+
+/* A change to libusb's file descriptors, queued for the session thread. */
+struct usb_pollfd_change {
+	gboolean added;
+	int fd;
+	short events;
+};
+
+/* A device event, on its way through the scan thread to the frontend. */
+struct hotplug_job {
+	int type;
+	int inst_type;
+	char *conn;
+	uint8_t bus;
+	uint8_t address;
+	uint16_t vid;
+	uint16_t pid;
+	/* Drivers to scan the connection with, in the scan thread. */
+	GSList *drivers;
+	char *serialcomm;
+	/* Devices the event is about. */
+	GSList *devices;
+};
+
+struct sr_hotplug_monitor {
+	struct sr_context *ctx;
+	/* NULL-terminated, as passed to sr_hotplug_monitor_start(). */
+	struct sr_dev_driver **drivers;
+	sr_hotplug_callback_t cb;
+	void *cb_data;
+	/*
+	 * Events waiting for the scan thread. Only one is scanned at a time,
+	 * so they reach the frontend in order and the driver's device list
+	 * isn't looked at while one of our scans may be adding to it.
+	 */
+	GQueue *jobs;
+	gboolean scanning;
+	GThreadPool *scan_pool;
+	/* Jobs the scan thread is done with. */
+	GAsyncQueue *done_queue;
+	/* Other threads write to this pipe to wake up the session thread. */
+	int wakeup_fds[2];
+	GPollFD wakeup_pollfd;
+#ifdef HAVE_LIBUSB_1_0
+	gboolean usb_registered;
+	libusb_hotplug_callback_handle usb_handle;
+	GAsyncQueue *usb_queue;
+	/* libusb's file descriptors, as session sources of our own. */
+	GSList *usb_pollfds;
+	GAsyncQueue *usb_pollfd_queue;
+#endif
+#ifdef HAVE_LIBUDEV
+	struct udev *udev;
+	struct udev_monitor *udev_monitor;
+	GPollFD udev_pollfd;
+#endif
+};
+
+/* Find a monitored driver by name. */
+static struct sr_dev_driver *driver_find(struct sr_hotplug_monitor *mon,
+		const char *name)
+{
+	int i;
+
+	for (i = 0; mon->drivers[i]; i++) {
+		if (!strcmp(mon->drivers[i]->name, name))
+			return mon->drivers[i];
+	}
+
+	return NULL;
+}
+
+static struct hotplug_job *job_new(int type, int inst_type, const char *conn,
+		uint16_t vid, uint16_t pid)
+{
+	struct hotplug_job *job;
+
+	if (!(job = g_try_malloc0(sizeof(struct hotplug_job)))) {
+		sr_err("Hotplug job malloc failed.");
+		return NULL;
+	}
+	job->type = type;
+	job->inst_type = inst_type;
+	job->conn = g_strdup(conn);
+	job->vid = vid;
+	job->pid = pid;
+
+	return job;
+}
+
+static void job_free(struct hotplug_job *job)
+{
+	g_free(job->conn);
+	g_free(job->serialcomm);
+	g_slist_free(job->drivers);
+	g_slist_free(job->devices);
+	g_free(job);
+}
+
+/* Called from any thread. */
+static void wakeup(struct sr_hotplug_monitor *mon)
+{
+	/* The pipe is non-blocking; if it's full, a wakeup is pending anyway. */
+	if (write(mon->wakeup_fds[1], "", 1) < 0 && errno != EAGAIN)
+		sr_err("Failed to wake up session thread: %s.",
+				g_strerror(errno));
+}
+
+static void notify(struct sr_hotplug_monitor *mon, struct hotplug_job *job)
+{
+	struct sr_hotplug_event event;
+
+	sr_dbg("Device %s on %s (%04x:%04x), %d devices.",
+			job->type == SR_HOTPLUG_ARRIVED ? "arrived" : "left",
+			job->conn, job->vid, job->pid,
+			g_slist_length(job->devices));
+
+	event.type = job->type;
+	event.inst_type = job->inst_type;
+	event.conn = job->conn;
+	event.vid = job->vid;
+	event.pid = job->pid;
+	event.devices = job->devices;
+	mon->cb(&event, mon->cb_data);
+}
+
+/* Scan a single connection with a single driver. */
+static GSList *scan_conn(struct sr_dev_driver *driver, const char *conn,
+		const char *serialcomm)
+{
+	struct sr_config *src, *comm;
+	GSList *options, *devices;
+
+	if (!(src = sr_config_new(SR_CONF_CONN, g_variant_new_string(conn))))
+		return NULL;
+	options = g_slist_append(NULL, src);
+	comm = NULL;
+	if (serialcomm && (comm = sr_config_new(SR_CONF_SERIALCOMM,
+			g_variant_new_string(serialcomm))))
+		options = g_slist_append(options, comm);
+
+	sr_dbg("Scanning %s with driver '%s'.", conn, driver->name);
+	devices = sr_driver_scan(driver, options);
+
+	g_slist_free(options);
+	sr_config_free(src);
+	if (comm)
+		sr_config_free(comm);
+
+	return devices;
+}
+
+/*
+ * Runs in the scan thread, so that a slow probe doesn't hold up the
+ * session loop. The result goes back to the session thread.
+ */
+static void scan_thread(gpointer data, gpointer user_data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct hotplug_job *job;
+	GSList *l;
+
+	job = data;
+	mon = user_data;
+
+	for (l = job->drivers; l; l = l->next)
+		job->devices = g_slist_concat(job->devices,
+				scan_conn(l->data, job->conn, job->serialcomm));
+
+	g_async_queue_push(mon->done_queue, job);
+	wakeup(mon);
+}
+
+#ifdef HAVE_LIBUSB_1_0
+static void usb_job_prepare(struct sr_hotplug_monitor *mon,
+		struct hotplug_job *job);
+#endif
+#ifdef HAVE_LIBUDEV
+static void udev_job_prepare(struct sr_hotplug_monitor *mon,
+		struct hotplug_job *job);
+#endif
+
+/* Hand the queued events to the scan thread, one at a time. */
+static void jobs_run(struct sr_hotplug_monitor *mon)
+{
+	struct hotplug_job *job;
+
+	while (!mon->scanning && (job = g_queue_pop_head(mon->jobs))) {
+		/*
+		 * Find out which drivers to scan with only now, see above.
+		 * Jobs from sr_hotplug_monitor_scan() come with their driver.
+		 */
+#ifdef HAVE_LIBUSB_1_0
+		if (!job->drivers && job->inst_type == SR_INST_USB)
+			usb_job_prepare(mon, job);
+#endif
+#ifdef HAVE_LIBUDEV
+		if (!job->drivers && job->inst_type == SR_INST_SERIAL)
+			udev_job_prepare(mon, job);
+#endif
+		if (!job->drivers) {
+			notify(mon, job);
+			job_free(job);
+			continue;
+		}
+		mon->scanning = TRUE;
+		g_thread_pool_push(mon->scan_pool, job, NULL);
+	}
+}
+
+static void job_queue(struct sr_hotplug_monitor *mon, struct hotplug_job *job)
+{
+	g_queue_push_tail(mon->jobs, job);
+	jobs_run(mon);
+}
+
+#ifdef HAVE_LIBUSB_1_0
+
+/* Whether the driver lists vid:pid in its SR_CONF_USB_IDS. */
+static gboolean driver_handles_usb_id(struct sr_dev_driver *driver,
+		uint16_t vid, uint16_t pid)
+{
+	GVariant *gvar;
+	const uint32_t *ids;
+	gsize num_ids, i;
+	uint32_t id;
+	gboolean found;
+
+	if (sr_config_list(driver, NULL, NULL, SR_CONF_USB_IDS,
+			&gvar) != SR_OK)
+		return FALSE;
+
+	id = ((uint32_t)vid << 16) | pid;
+	ids = g_variant_get_fixed_array(gvar, &num_ids, sizeof(uint32_t));
+	found = FALSE;
+	for (i = 0; i < num_ids && !found; i++)
+		found = ids[i] == id;
+	g_variant_unref(gvar);
+
+	return found;
+}
+
+/*
+ * Devices of this driver on the given bus address. With any_renum set, a
+ * device on the same bus still waiting to renumerate after its firmware
+ * upload matches as well: the arriving device is that one coming back.
+ */
+static GSList *usb_devices_find(struct sr_dev_driver *driver, uint8_t bus,
+		uint8_t address, gboolean any_renum)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_usb_dev_inst *usb;
+	GSList *l, *devices;
+
+	devices = NULL;
+	for (l = sr_dev_list(driver); l; l = l->next) {
+		sdi = l->data;
+		if (sdi->inst_type != SR_INST_USB || !(usb = sdi->conn))
+			continue;
+		if (usb->bus != bus)
+			continue;
+		if (usb->address == address || (any_renum
+				&& usb->address == 0xff))
+			devices = g_slist_append(devices, sdi);
+	}
+
+	return devices;
+}
+
+static void usb_job_prepare(struct sr_hotplug_monitor *mon,
+		struct hotplug_job *job)
+{
+	struct sr_dev_driver *driver;
+	GSList *l;
+	int i;
+
+	for (i = 0; mon->drivers[i]; i++) {
+		driver = mon->drivers[i];
+		if (job->type == SR_HOTPLUG_LEFT) {
+			job->devices = g_slist_concat(job->devices,
+					usb_devices_find(driver, job->bus,
+					job->address, FALSE));
+			continue;
+		}
+
+		if (!driver_handles_usb_id(driver, job->vid, job->pid))
+			continue;
+		/* Don't create a second instance of a known device. */
+		if ((l = usb_devices_find(driver, job->bus, job->address, TRUE)))
+			job->devices = g_slist_concat(job->devices, l);
+		else
+			job->drivers = g_slist_append(job->drivers, driver);
+	}
+}
+
+/*
+ * Called from within libusb_handle_events(), in whichever thread that
+ * happens to be. libusb must not be re-entered from here, so just queue
+ * the event for the session thread.
+ */
+static int LIBUSB_CALL usb_hotplug_cb(libusb_context *libusb_ctx,
+		libusb_device *dev, libusb_hotplug_event event, void *user_data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct libusb_device_descriptor des;
+	struct usb_event *ev;
+
+	(void)libusb_ctx;
+
+	mon = user_data;
+
+	if (!(ev = g_try_malloc0(sizeof(struct usb_event)))) {
+		sr_err("USB event malloc failed.");
+		return 0;
+	}
+	ev->type = (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+			? SR_HOTPLUG_ARRIVED : SR_HOTPLUG_LEFT;
+	ev->bus = libusb_get_bus_number(dev);
+	ev->address = libusb_get_device_address(dev);
+	/* The descriptor is cached, this doesn't touch the device. */
+	if (libusb_get_device_descriptor(dev, &des) == 0) {
+		ev->vid = des.idVendor;
+		ev->pid = des.idProduct;
+	}
+	g_async_queue_push(mon->usb_queue, ev);
+	wakeup(mon);
+
+	return 0;
+}
+
+static int usb_receive(int fd, int revents, void *cb_data);
+
+static void usb_pollfd_add(struct sr_hotplug_monitor *mon, int fd,
+		short events)
+{
+	GPollFD *pollfd;
+	GSList *l;
+
+	for (l = mon->usb_pollfds; l; l = l->next) {
+		if (((GPollFD *)l->data)->fd == fd)
+			return;
+	}
+
+	if (!(pollfd = g_try_malloc0(sizeof(GPollFD)))) {
+		sr_err("USB pollfd malloc failed.");
+		return;
+	}
+	pollfd->fd = fd;
+	pollfd->events = events;
+	if (sr_session_source_add_pollfd(pollfd, 0, usb_receive, mon) != SR_OK) {
+		g_free(pollfd);
+		return;
+	}
+	mon->usb_pollfds = g_slist_append(mon->usb_pollfds, pollfd);
+}
+
+static void usb_pollfd_remove(struct sr_hotplug_monitor *mon, int fd)
+{
+	GPollFD *pollfd;
+	GSList *l;
+
+	for (l = mon->usb_pollfds; l; l = l->next) {
+		pollfd = l->data;
+		if (pollfd->fd != fd)
+			continue;
+		sr_session_source_remove_pollfd(pollfd);
+		mon->usb_pollfds = g_slist_delete_link(mon->usb_pollfds, l);
+		g_free(pollfd);
+		return;
+	}
+}
+
+/*
+ * libusb opens and closes descriptors of its own, e.g. one per opened
+ * device on Linux, which may well happen in the scan thread. Queue the
+ * change for the session thread, which owns the sources.
+ */
+static void LIBUSB_CALL usb_pollfd_added(int fd, short events,
+		void *user_data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct usb_pollfd_change *change;
+
+	mon = user_data;
+
+	if (!(change = g_try_malloc0(sizeof(struct usb_pollfd_change)))) {
+		sr_err("USB pollfd change malloc failed.");
+		return;
+	}
+	change->added = TRUE;
+	change->fd = fd;
+	change->events = events;
+	g_async_queue_push(mon->usb_pollfd_queue, change);
+	wakeup(mon);
+}
+
+static void LIBUSB_CALL usb_pollfd_removed(int fd, void *user_data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct usb_pollfd_change *change;
+
+	mon = user_data;
+
+	if (!(change = g_try_malloc0(sizeof(struct usb_pollfd_change)))) {
+		sr_err("USB pollfd change malloc failed.");
+		return;
+	}
+	change->fd = fd;
+	g_async_queue_push(mon->usb_pollfd_queue, change);
+	wakeup(mon);
+}
+
+static void usb_events_process(struct sr_hotplug_monitor *mon)
+{
+	struct usb_pollfd_change *change;
+	struct usb_event *ev;
+	struct hotplug_job *job;
+	char conn[16];
+
+	while ((change = g_async_queue_try_pop(mon->usb_pollfd_queue))) {
+		if (change->added)
+			usb_pollfd_add(mon, change->fd, change->events);
+		else
+			usb_pollfd_remove(mon, change->fd);
+		g_free(change);
+	}
+
+	while ((ev = g_async_queue_try_pop(mon->usb_queue))) {
+		snprintf(conn, sizeof(conn), "%d.%d", ev->bus, ev->address);
+		if ((job = job_new(ev->type, SR_INST_USB, conn, ev->vid,
+				ev->pid))) {
+			job->bus = ev->bus;
+			job->address = ev->address;
+			job_queue(mon, job);
+		}
+		g_free(ev);
+	}
+}
+
+static int usb_receive(int fd, int revents, void *cb_data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct timeval tv;
+
+	(void)fd;
+	(void)revents;
+
+	mon = cb_data;
+
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout(mon->ctx->libusb_ctx, &tv);
+
+	usb_events_process(mon);
+
+	return TRUE;
+}
+
+static int usb_monitor_start(struct sr_hotplug_monitor *mon)
+{
+	const struct libusb_pollfd **lupfd;
+	int ret, i;
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		sr_warn("libusb has no hotplug support on this platform.");
+		return SR_ERR_NA;
+	}
+
+	mon->usb_queue = g_async_queue_new_full(g_free);
+	mon->usb_pollfd_queue = g_async_queue_new_full(g_free);
+
+	ret = libusb_hotplug_register_callback(mon->ctx->libusb_ctx,
+			LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED
+			| LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+			LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY,
+			LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+			usb_hotplug_cb, mon, &mon->usb_handle);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("Failed to register USB hotplug callback: %s.",
+				libusb_error_name(ret));
+		return SR_ERR;
+	}
+	mon->usb_registered = TRUE;
+
+	/*
+	 * Poll libusb's descriptors through sources of our own, so that this
+	 * doesn't get in the way of a driver's usb_source_add(). The notifiers
+	 * go in first, so no change is missed; the duplicates they may
+	 * report are ignored.
+	 */
+	libusb_set_pollfd_notifiers(mon->ctx->libusb_ctx, usb_pollfd_added,
+			usb_pollfd_removed, mon);
+	lupfd = libusb_get_pollfds(mon->ctx->libusb_ctx);
+	for (i = 0; lupfd && lupfd[i]; i++)
+		usb_pollfd_add(mon, lupfd[i]->fd, lupfd[i]->events);
+	free(lupfd);
+
+	return SR_OK;
+}
+
+static void usb_monitor_stop(struct sr_hotplug_monitor *mon)
+{
+	GSList *l;
+
+	if (mon->usb_registered) {
+		libusb_hotplug_deregister_callback(mon->ctx->libusb_ctx,
+				mon->usb_handle);
+		libusb_set_pollfd_notifiers(mon->ctx->libusb_ctx,
+				NULL, NULL, NULL);
+	}
+	for (l = mon->usb_pollfds; session && l; l = l->next)
+		sr_session_source_remove_pollfd(l->data);
+	g_slist_free_full(mon->usb_pollfds, g_free);
+	if (mon->usb_queue)
+		g_async_queue_unref(mon->usb_queue);
+	if (mon->usb_pollfd_queue)
+		g_async_queue_unref(mon->usb_pollfd_queue);
+}
+
+#endif
+
+#ifdef HAVE_LIBUDEV
+
+#ifdef HAVE_LIBSERIALPORT
+static GSList *serial_devices_find(struct sr_dev_driver *driver,
+		const char *port)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_serial_dev_inst *serial;
+	GSList *l, *devices;
+
+	devices = NULL;
+	for (l = sr_dev_list(driver); l; l = l->next) {
+		sdi = l->data;
+		if (sdi->inst_type != SR_INST_SERIAL || !(serial = sdi->conn))
+			continue;
+		if (serial->port && !strcmp(serial->port, port))
+			devices = g_slist_append(devices, sdi);
+	}
+
+	return devices;
+}
+#endif
+
+/* The USB IDs of the device a tty belongs to, if any. */
+static void udev_usb_ids(struct udev_device *dev, uint16_t *vid,
+		uint16_t *pid)
+{
+	struct udev_device *usbdev;
+	const char *s;
+
+	*vid = *pid = 0;
+	usbdev = udev_device_get_parent_with_subsystem_devtype(dev, "usb",
+			"usb_device");
+	if (!usbdev)
+		return;
+	if ((s = udev_device_get_sysattr_value(usbdev, "idVendor")))
+		*vid = strtoul(s, NULL, 16);
+	if ((s = udev_device_get_sysattr_value(usbdev, "idProduct")))
+		*pid = strtoul(s, NULL, 16);
+}
+
+/*
+ * A serial port came or went. There is no way to tell which driver a port
+ * belongs to short of probing it with all of them, so an arriving port is
+ * only scanned with the driver the scan cache knows for it, if any.
+ */
+static void udev_job_prepare(struct sr_hotplug_monitor *mon,
+		struct hotplug_job *job)
+{
+	struct sr_dev_driver *driver;
+	char *name;
+
+	if (job->type == SR_HOTPLUG_ARRIVED) {
+		g_mutex_lock(&mon->ctx->scan_mutex);
+		name = g_key_file_get_string(mon->ctx->scan_cache, job->conn,
+				"driver", NULL);
+		job->serialcomm = g_key_file_get_string(mon->ctx->scan_cache,
+				job->conn, "serialcomm", NULL);
+		g_mutex_unlock(&mon->ctx->scan_mutex);
+		if (name && (driver = driver_find(mon, name)))
+			job->drivers = g_slist_append(NULL, driver);
+		g_free(name);
+	} else {
+#ifdef HAVE_LIBSERIALPORT
+		int i;
+
+		for (i = 0; mon->drivers[i]; i++)
+			job->devices = g_slist_concat(job->devices,
+				serial_devices_find(mon->drivers[i], job->conn));
+#endif
+	}
+}
+
+static void udev_event_process(struct sr_hotplug_monitor *mon,
+		struct udev_device *dev)
+{
+	struct hotplug_job *job;
+	const char *action, *port;
+	uint16_t vid, pid;
+	int type;
+
+	if (!(action = udev_device_get_action(dev))
+			|| !(port = udev_device_get_devnode(dev)))
+		return;
+	/* Virtual terminals and the like have no parent device. */
+	if (!udev_device_get_parent(dev))
+		return;
+
+	if (!strcmp(action, "add"))
+		type = SR_HOTPLUG_ARRIVED;
+	else if (!strcmp(action, "remove"))
+		type = SR_HOTPLUG_LEFT;
+	else
+		return;
+
+	udev_usb_ids(dev, &vid, &pid);
+
+	if ((job = job_new(type, SR_INST_SERIAL, port, vid, pid)))
+		job_queue(mon, job);
+}
+
+static int udev_receive(int fd, int revents, void *cb_data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct udev_device *dev;
+
+	(void)fd;
+
+	mon = cb_data;
+
+	if (!(revents & G_IO_IN))
+		return TRUE;
+
+	while ((dev = udev_monitor_receive_device(mon->udev_monitor))) {
+		udev_event_process(mon, dev);
+		udev_device_unref(dev);
+	}
+
+	return TRUE;
+}
+
+static int udev_monitor_start(struct sr_hotplug_monitor *mon)
+{
+	if (!(mon->udev = udev_new())) {
+		sr_err("Failed to create udev context.");
+		return SR_ERR;
+	}
+
+	mon->udev_monitor = udev_monitor_new_from_netlink(mon->udev, "udev");
+	if (!mon->udev_monitor) {
+		sr_err("Failed to create udev monitor.");
+		return SR_ERR;
+	}
+	if (udev_monitor_filter_add_match_subsystem_devtype(mon->udev_monitor,
+			"tty", NULL) < 0
+			|| udev_monitor_enable_receiving(mon->udev_monitor) < 0) {
+		sr_err("Failed to set up udev monitor.");
+		return SR_ERR;
+	}
+
+	/* The netlink socket is non-blocking. */
+	mon->udev_pollfd.fd = udev_monitor_get_fd(mon->udev_monitor);
+	mon->udev_pollfd.events = G_IO_IN;
+	if (sr_session_source_add_pollfd(&mon->udev_pollfd, 0, udev_receive,
+			mon) != SR_OK) {
+		sr_err("Failed to add udev monitor source.");
+		mon->udev_pollfd.events = 0;
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/* Can be called more than once, e.g. after a failed start. */
+static void udev_monitor_stop(struct sr_hotplug_monitor *mon)
+{
+	if (session && mon->udev_pollfd.events)
+		sr_session_source_remove_pollfd(&mon->udev_pollfd);
+	mon->udev_pollfd.events = 0;
+	if (mon->udev_monitor)
+		udev_monitor_unref(mon->udev_monitor);
+	mon->udev_monitor = NULL;
+	if (mon->udev)
+		udev_unref(mon->udev);
+	mon->udev = NULL;
+}
+
+#endif
+
+static int wakeup_receive(int fd, int revents, void *cb_data)
+{
+	struct sr_hotplug_monitor *mon;
+	struct hotplug_job *job;
+	char buf[64];
+
+	(void)fd;
+
+	mon = cb_data;
+
+	if (!(revents & G_IO_IN))
+		return TRUE;
+
+	while (read(mon->wakeup_fds[0], buf, sizeof(buf)) > 0)
+		;
+
+#ifdef HAVE_LIBUSB_1_0
+	if (mon->usb_registered)
+		usb_events_process(mon);
+#endif
+
+	while ((job = g_async_queue_try_pop(mon->done_queue))) {
+		mon->scanning = FALSE;
+		notify(mon, job);
+		job_free(job);
+	}
+	jobs_run(mon);
+
+	return TRUE;
+}
+
+static int wakeup_start(struct sr_hotplug_monitor *mon)
+{
+#ifdef _WIN32
+	(void)mon;
+	sr_warn("Hotplug monitoring is not supported on this platform.");
+	return SR_ERR_NA;
+#else
+	GError *error;
+
+	error = NULL;
+	if (!g_unix_open_pipe(mon->wakeup_fds, FD_CLOEXEC, &error)) {
+		sr_err("Failed to create wakeup pipe: %s.", error->message);
+		g_error_free(error);
+		mon->wakeup_fds[0] = mon->wakeup_fds[1] = -1;
+		return SR_ERR;
+	}
+	g_unix_set_fd_nonblocking(mon->wakeup_fds[0], TRUE, NULL);
+	g_unix_set_fd_nonblocking(mon->wakeup_fds[1], TRUE, NULL);
+
+	mon->wakeup_pollfd.fd = mon->wakeup_fds[0];
+	mon->wakeup_pollfd.events = G_IO_IN;
+	if (sr_session_source_add_pollfd(&mon->wakeup_pollfd, 0,
+			wakeup_receive, mon) != SR_OK) {
+		sr_err("Failed to add wakeup source.");
+		mon->wakeup_pollfd.events = 0;
+		close(mon->wakeup_fds[0]);
+		close(mon->wakeup_fds[1]);
+		mon->wakeup_fds[0] = mon->wakeup_fds[1] = -1;
+		return SR_ERR;
+	}
+
+	return SR_OK;
+#endif
+}
+
+static void wakeup_stop(struct sr_hotplug_monitor *mon)
+{
+	if (session && mon->wakeup_pollfd.events)
+		sr_session_source_remove_pollfd(&mon->wakeup_pollfd);
+	if (mon->wakeup_fds[0] >= 0)
+		close(mon->wakeup_fds[0]);
+	if (mon->wakeup_fds[1] >= 0)
+		close(mon->wakeup_fds[1]);
+}
+
+/**
+ * Start monitoring for devices being plugged in and unplugged.
+ *
+ * USB devices are watched through libusb's hotplug support. When a device
+ * arrives, only the drivers listing its vendor and product ID in
+ * SR_CONF_USB_IDS scan for it, and only at its bus address. Serial ports are
+ * watched through udev, where available; an arriving port is only scanned
+ * with the driver that was last found on it by sr_driver_scan_all().
+ *
+ * Scanning an arriving device happens in a background thread, one device
+ * at a time, so a slow probe doesn't hold up the session loop. Events are
+ * delivered in order from within the session loop, so there must be a
+ * session. The monitor's sources keep sr_session_run() from returning
+ * until sr_hotplug_monitor_stop() is called.
+ *
+ * @param ctx A libsigrok context object. Must not be NULL.
+ * @param drivers NULL-terminated array of drivers to look for devices with,
+ *                e.g. as returned by sr_driver_list(). They must have been
+ *                initialized with sr_driver_init(). Must not be NULL.
+ * @param cb Callback to invoke for every event. Must not be NULL.
+ * @param cb_data Data for the callback. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments, or a monitor is already running.
+ * @retval SR_ERR_BUG No session exists.
+ * @retval SR_ERR_NA Hotplug events are not supported on this platform.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ * @retval SR_ERR Other error.
+ */
+SR_API int sr_hotplug_monitor_start(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, sr_hotplug_callback_t cb,
+		void *cb_data)
+{
+	struct sr_hotplug_monitor *mon;
+	GError *error;
+	int i, ret, num_ok;
+
+	if (!ctx || !drivers || !cb) {
+		sr_err("%s: invalid arguments.", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!session) {
+		sr_err("%s: session was NULL; a session must be "
+		       "created before starting a hotplug monitor.", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (ctx->hotplug) {
+		sr_err("A hotplug monitor is already running.");
+		return SR_ERR_ARG;
+	}
+
+	for (i = 0; drivers[i]; i++) {
+		if (!drivers[i]->priv) {
+			sr_err("Driver '%s' not initialized, can't monitor "
+					"devices.", drivers[i]->name);
+			return SR_ERR_ARG;
+		}
+	}
+
+	if (!(mon = g_try_malloc0(sizeof(struct sr_hotplug_monitor)))) {
+		sr_err("Hotplug monitor malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+	mon->ctx = ctx;
+	mon->drivers = g_memdup(drivers, sizeof(*drivers) * (i + 1));
+	mon->cb = cb;
+	mon->cb_data = cb_data;
+	mon->jobs = g_queue_new();
+	mon->done_queue = g_async_queue_new_full((GDestroyNotify)job_free);
+	mon->wakeup_fds[0] = mon->wakeup_fds[1] = -1;
+	ctx->hotplug = mon;
+
+	error = NULL;
+	mon->scan_pool = g_thread_pool_new(scan_thread, mon, 1, FALSE, &error);
+	if (!mon->scan_pool) {
+		sr_err("Failed to create hotplug scan thread: %s.",
+				error->message);
+		g_error_free(error);
+		ret = SR_ERR;
+		goto fail;
+	}
+
+	if ((ret = wakeup_start(mon)) != SR_OK)
+		goto fail;
+
+	num_ok = 0;
+	ret = SR_ERR_NA;
+#ifdef HAVE_LIBUSB_1_0
+	if ((ret = usb_monitor_start(mon)) == SR_OK)
+		num_ok++;
+	else if (ret != SR_ERR_NA)
+		goto fail;
+#endif
+#ifdef HAVE_LIBUDEV
+	if ((ret = udev_monitor_start(mon)) == SR_OK) {
+		num_ok++;
+	} else if (num_ok > 0) {
+		/* USB hotplug works, that's still worth having. */
+		sr_warn("Not watching serial ports, only USB devices.");
+		udev_monitor_stop(mon);
+	} else {
+		goto fail;
+	}
+#endif
+
+	if (num_ok == 0)
+		goto fail;
+
+	return SR_OK;
+
+fail:
+	sr_hotplug_monitor_stop(ctx);
+	return ret;
+}
+
+/**
+ * Scan a connection in the background, as if a device had arrived on it.
+ *
+ * This is for devices the monitor can't see arriving by itself, e.g.
+ * network instruments, or a serial port the scan cache knows no driver
+ * for. The scan runs in the monitor's scan thread, in turn with those of
+ * arriving devices, and the devices found are reported to the monitor's
+ * callback as an SR_HOTPLUG_ARRIVED event.
+ *
+ * @param ctx A libsigrok context object with a running hotplug monitor.
+ *            Must not be NULL.
+ * @param driver The driver to scan with. It must be one of the drivers
+ *               passed to sr_hotplug_monitor_start().
+ * @param inst_type The type of connection, e.g. SR_INST_SERIAL, as
+ *                  reported in the event.
+ * @param conn The connection to scan, as for SR_CONF_CONN. Must not be NULL.
+ *
+ * @retval SR_OK Success, the event follows from within the session loop.
+ * @retval SR_ERR_ARG Invalid arguments, or no monitor is running.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ */
+SR_API int sr_hotplug_monitor_scan(struct sr_context *ctx,
+		struct sr_dev_driver *driver, int inst_type, const char *conn)
+{
+	struct sr_hotplug_monitor *mon;
+	struct hotplug_job *job;
+	int i;
+
+	if (!ctx || !driver || !conn) {
+		sr_err("%s: invalid arguments.", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!(mon = ctx->hotplug)) {
+		sr_err("No hotplug monitor is running.");
+		return SR_ERR_ARG;
+	}
+
+	for (i = 0; mon->drivers[i] && mon->drivers[i] != driver; i++)
+		;
+	if (!mon->drivers[i]) {
+		sr_err("Driver '%s' is not monitored.", driver->name);
+		return SR_ERR_ARG;
+	}
+
+	if (!(job = job_new(SR_HOTPLUG_ARRIVED, inst_type, conn, 0, 0)))
+		return SR_ERR_MALLOC;
+	job->drivers = g_slist_append(NULL, driver);
+	job_queue(mon, job);
+
+	return SR_OK;
+}
+
+/**
+ * Stop the hotplug monitor.
+ *
+ * This must be called from within the session thread, or once the session
+ * loop has returned. A scan in progress is waited for, events not yet
+ * delivered are dropped. It does nothing if no monitor is running.
+ *
+ * @param ctx A libsigrok context object. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ */
+SR_API int sr_hotplug_monitor_stop(struct sr_context *ctx)
+{
+	struct sr_hotplug_monitor *mon;
+
+	if (!ctx) {
+		sr_err("%s: invalid arguments.", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!(mon = ctx->hotplug))
+		return SR_OK;
+
+	/* Wait for a scan in progress, drop the queued ones. */
+	if (mon->scan_pool)
+		g_thread_pool_free(mon->scan_pool, TRUE, TRUE);
+
+#ifdef HAVE_LIBUSB_1_0
+	usb_monitor_stop(mon);
+#endif
+#ifdef HAVE_LIBUDEV
+	udev_monitor_stop(mon);
+#endif
+	wakeup_stop(mon);
+
+	g_queue_free_full(mon->jobs, (GDestroyNotify)job_free);
+	g_async_queue_unref(mon->done_queue);
+	g_free(mon->drivers);
+	g_free(mon);
+	ctx->hotplug = NULL;
+
+	return SR_OK;
+}
+
+/** @} */
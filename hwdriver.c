@@ -48,6 +48,8 @@ static struct sr_config_info sr_config_info_data[] = {
 		"Connection", NULL},
 	{SR_CONF_SERIALCOMM, SR_T_CHAR, "serialcomm",
 		"Serial communication", NULL},
+	{SR_CONF_NUM_DEVICES, SR_T_INT32, "devices",
+		"Number of devices", NULL},
 	{SR_CONF_SAMPLERATE, SR_T_UINT64, "samplerate",
 		"Sample rate", NULL},
 	{SR_CONF_CAPTURE_RATIO, SR_T_UINT64, "captureratio",
@@ -100,9 +102,31 @@ static struct sr_config_info sr_config_info_data[] = {
 		"Number of logic probes", NULL},
 	{SR_CONF_NUM_ANALOG_PROBES, SR_T_INT32, "analog_probes",
 		"Number of analog probes", NULL},
+	{SR_CONF_THROTTLE, SR_T_BOOL, "throttle",
+		"Throttle to samplerate", NULL},
+	{SR_CONF_BATCH_LATENCY, SR_T_UINT64, "batch_latency",
+		"Batch latency", NULL},
 	{0, 0, NULL, NULL, NULL},
 };
 
+#define CONFIG_INFO_COUNT (ARRAY_SIZE(sr_config_info_data) - 1)
+
+/* sr_config_info_data[] entries sorted by key, and by name. */
+static const struct sr_config_info *config_info_by_key[CONFIG_INFO_COUNT];
+static const struct sr_config_info *config_info_by_name[CONFIG_INFO_COUNT];
+
+/* Key of a cached sr_config_list() result. */
+struct config_list_key {
+	const struct sr_dev_driver *driver;
+	const struct sr_dev_inst *sdi;
+	const struct sr_probe_group *probe_group;
+	int key;
+};
+
+/* struct config_list_key -> GVariant */
+static GHashTable *config_list_cache;
+G_LOCK_DEFINE_STATIC(config_list_cache);
+
 /** @cond PRIVATE */
 #ifdef HAVE_HW_ANALOG_DISCOVERY
 extern SR_PRIV struct sr_dev_driver analog_discovery_driver_info;
@@ -386,6 +410,70 @@ static struct sr_dev_driver *drivers_list[] = {
 	NULL,
 };
 
+/*
+ * One lock per driver, as drivers' scan() is not reentrant. These are
+ * global, since a scan left running in the background by
+ * sr_driver_scan_all() may still be going when the next one starts.
+ */
+static GMutex driver_scan_locks[ARRAY_SIZE(drivers_list)];
+
+static GMutex *driver_scan_lock(const struct sr_dev_driver *driver)
+{
+	unsigned int i;
+
+	for (i = 0; drivers_list[i]; i++) {
+		if (drivers_list[i] == driver)
+			return &driver_scan_locks[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Lock a driver against scans, e.g. to use its device list while a scan
+ * with it may still be running in the background. This waits for such a
+ * scan to finish, and holds off new ones until sr_driver_unlock().
+ *
+ * @param driver The driver to lock. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_driver_lock(const struct sr_dev_driver *driver)
+{
+	GMutex *lock;
+
+	if ((lock = driver_scan_lock(driver)))
+		g_mutex_lock(lock);
+}
+
+/**
+ * Unlock a driver locked with sr_driver_lock().
+ *
+ * @param driver The driver to unlock. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_driver_unlock(const struct sr_dev_driver *driver)
+{
+	GMutex *lock;
+
+	if ((lock = driver_scan_lock(driver)))
+		g_mutex_unlock(lock);
+}
+
+/* Run a driver's scan, serialized against all other scans with it. */
+static GSList *driver_scan_locked(struct sr_dev_driver *driver,
+		GSList *options)
+{
+	GSList *l;
+
+	sr_driver_lock(driver);
+	l = driver->scan(options);
+	sr_driver_unlock(driver);
+
+	return l;
+}
+
 /**
  * Return the list of supported hardware drivers.
  *
@@ -428,8 +516,10 @@ SR_API int sr_driver_init(struct sr_context *ctx, struct sr_dev_driver *driver)
 	}
 
 	sr_spew("Initializing driver '%s'.", driver->name);
+	sr_driver_lock(driver);
 	if ((ret = driver->init(ctx)) < 0)
 		sr_err("Failed to initialize the driver: %d.", ret);
+	sr_driver_unlock(driver);
 
 	return ret;
 }
@@ -471,7 +561,7 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 		return NULL;
 	}
 
-	l = driver->scan(options);
+	l = driver_scan_locked(driver, options);
 
 	sr_spew("Scan of '%s' found %d devices.", driver->name,
 		g_slist_length(l));
@@ -479,6 +569,495 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 	return l;
 }
 
+/* Upper bound on the number of concurrently probing threads. */
+#define SCAN_MAX_THREADS 32
+
+/* Shared state of one sr_driver_scan_all() call. */
+struct scan_state {
+	struct sr_context *ctx;
+	struct sr_dev_driver **drivers;
+	int num_drivers;
+	/* Whether each driver takes SR_CONF_CONN, i.e. can probe a port. */
+	gboolean *takes_conn;
+	/* Options common to all jobs, deep copied. */
+	GSList *options;
+	GMutex mutex;
+	GCond cond;
+	int refcount;
+	int pending;
+	gboolean abandoned;
+	GSList *devices;
+};
+
+/* A single scan job: either one driver, or one port tried on all drivers. */
+struct scan_job {
+	int index;
+	/* Driver to scan, or -1 to try all drivers on conn. */
+	int driver;
+	char *conn;
+};
+
+static void scan_state_unref(struct scan_state *state)
+{
+	if (!g_atomic_int_dec_and_test(&state->refcount))
+		return;
+
+	g_free(state->takes_conn);
+	g_free(state->drivers);
+	g_slist_free_full(state->options, (GDestroyNotify)sr_config_free);
+	g_slist_free(state->devices);
+	g_mutex_clear(&state->mutex);
+	g_cond_clear(&state->cond);
+	g_free(state);
+}
+
+static gboolean scan_abandoned(struct scan_state *state)
+{
+	gboolean ret;
+
+	g_mutex_lock(&state->mutex);
+	ret = state->abandoned;
+	g_mutex_unlock(&state->mutex);
+
+	return ret;
+}
+
+/* Run one driver's scan, serialized against other jobs using that driver. */
+static GSList *scan_driver(struct scan_state *state, int driver,
+		GSList *options)
+{
+	struct sr_dev_driver *di;
+	GSList *l;
+
+	di = state->drivers[driver];
+	l = driver_scan_locked(di, options);
+
+	sr_spew("Scan of '%s' found %d devices.", di->name, g_slist_length(l));
+
+	return l;
+}
+
+/* Remember which driver (and serial parameters) found a device on conn. */
+static void scan_cache_update(struct sr_context *ctx, const char *conn,
+		const struct sr_dev_driver *di, GSList *devices)
+{
+	struct sr_dev_inst *sdi;
+	const char *serialcomm;
+
+	serialcomm = NULL;
+#ifdef HAVE_LIBSERIALPORT
+	sdi = devices ? devices->data : NULL;
+	if (sdi && sdi->inst_type == SR_INST_SERIAL && sdi->conn)
+		serialcomm = ((struct sr_serial_dev_inst *)sdi->conn)->serialcomm;
+#else
+	(void)sdi;
+	(void)devices;
+#endif
+
+	g_mutex_lock(&ctx->scan_mutex);
+	if (di) {
+		g_key_file_set_string(ctx->scan_cache, conn, "driver", di->name);
+		if (serialcomm)
+			g_key_file_set_string(ctx->scan_cache, conn,
+					"serialcomm", serialcomm);
+		else
+			g_key_file_remove_key(ctx->scan_cache, conn,
+					"serialcomm", NULL);
+	} else {
+		g_key_file_remove_group(ctx->scan_cache, conn, NULL);
+	}
+	g_mutex_unlock(&ctx->scan_mutex);
+}
+
+/* Look up the driver index and serial parameters cached for conn. */
+static int scan_cache_lookup(struct scan_state *state, const char *conn,
+		char **serialcomm)
+{
+	struct sr_context *ctx;
+	char *name;
+	int i, driver;
+
+	ctx = state->ctx;
+	driver = -1;
+
+	g_mutex_lock(&ctx->scan_mutex);
+	name = g_key_file_get_string(ctx->scan_cache, conn, "driver", NULL);
+	*serialcomm = g_key_file_get_string(ctx->scan_cache, conn,
+			"serialcomm", NULL);
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	if (name) {
+		for (i = 0; i < state->num_drivers; i++) {
+			if (!strcmp(state->drivers[i]->name, name)) {
+				driver = i;
+				break;
+			}
+		}
+		g_free(name);
+	}
+
+	return driver;
+}
+
+/* Whether a driver's scan options include SR_CONF_CONN. */
+static gboolean driver_takes_conn(const struct sr_dev_driver *driver)
+{
+	GVariant *gvar;
+	const int32_t *opts;
+	gsize num_opts, i;
+	gboolean ret;
+
+	if (sr_config_list(driver, NULL, NULL, SR_CONF_SCAN_OPTIONS,
+			&gvar) != SR_OK)
+		return FALSE;
+
+	ret = FALSE;
+	opts = g_variant_get_fixed_array(gvar, &num_opts, sizeof(int32_t));
+	for (i = 0; i < num_opts; i++) {
+		if (opts[i] == SR_CONF_CONN)
+			ret = TRUE;
+	}
+	g_variant_unref(gvar);
+
+	return ret;
+}
+
+/*
+ * Probe one port. The cached driver is tried first; otherwise all drivers
+ * which take a connection are tried in turn until one of them finds a
+ * device. Drivers which ignore SR_CONF_CONN would "find" their devices on
+ * every port, and end up cached as its driver. Each job starts at a
+ * different driver, so that jobs for different ports rarely wait on the
+ * same driver lock.
+ */
+static GSList *scan_port(struct scan_state *state, struct scan_job *job)
+{
+	struct sr_config *src, *comm;
+	GSList *options, *l;
+	char *serialcomm;
+	gboolean have_comm;
+	int cached, driver, i;
+
+	if (!(src = sr_config_new(SR_CONF_CONN,
+			g_variant_new_string(job->conn))))
+		return NULL;
+	options = g_slist_prepend(g_slist_copy(state->options), src);
+
+	have_comm = FALSE;
+	for (l = state->options; l; l = l->next) {
+		if (((struct sr_config *)l->data)->key == SR_CONF_SERIALCOMM)
+			have_comm = TRUE;
+	}
+
+	l = NULL;
+	cached = scan_cache_lookup(state, job->conn, &serialcomm);
+	if (cached >= 0 && (!state->takes_conn[cached]
+			|| scan_abandoned(state)))
+		cached = -1;
+	if (cached >= 0) {
+		sr_dbg("Trying cached driver '%s' on %s.",
+				state->drivers[cached]->name, job->conn);
+		comm = NULL;
+		if (serialcomm && !have_comm && (comm = sr_config_new(
+				SR_CONF_SERIALCOMM,
+				g_variant_new_string(serialcomm))))
+			options = g_slist_prepend(options, comm);
+		l = scan_driver(state, cached, options);
+		if (comm) {
+			options = g_slist_remove(options, comm);
+			sr_config_free(comm);
+		}
+	}
+	g_free(serialcomm);
+
+	for (i = 0; !l && i < state->num_drivers; i++) {
+		driver = (job->index + i) % state->num_drivers;
+		if (driver == cached || !state->takes_conn[driver])
+			continue;
+		if (scan_abandoned(state))
+			break;
+		if ((l = scan_driver(state, driver, options)))
+			cached = driver;
+	}
+
+	if (!scan_abandoned(state))
+		scan_cache_update(state->ctx, job->conn,
+				l ? state->drivers[cached] : NULL, l);
+
+	g_slist_free(options);
+	sr_config_free(src);
+
+	return l;
+}
+
+static void scan_job_run(gpointer data, gpointer user_data)
+{
+	struct scan_state *state;
+	struct scan_job *job;
+	struct sr_context *ctx;
+	GSList *l;
+
+	job = data;
+	state = user_data;
+	ctx = state->ctx;
+
+	l = NULL;
+	if (!scan_abandoned(state)) {
+		if (job->conn)
+			l = scan_port(state, job);
+		else
+			l = scan_driver(state, job->driver, state->options);
+	}
+
+	g_mutex_lock(&state->mutex);
+	if (state->abandoned) {
+		/* Late devices are still reachable through sr_dev_list(). */
+		g_slist_free(l);
+	} else {
+		state->devices = g_slist_concat(state->devices, l);
+	}
+	state->pending--;
+	g_cond_signal(&state->cond);
+	g_mutex_unlock(&state->mutex);
+
+	g_free(job->conn);
+	g_free(job);
+	scan_state_unref(state);
+
+	g_mutex_lock(&ctx->scan_mutex);
+	ctx->scan_jobs--;
+	g_cond_broadcast(&ctx->scan_cond);
+	g_mutex_unlock(&ctx->scan_mutex);
+}
+
+/**
+ * Scan for devices with several drivers concurrently.
+ *
+ * Each driver is run in its own thread. If the options contain one or more
+ * SR_CONF_CONN entries, each of those connections is probed in its own
+ * thread instead, trying those of the given drivers which take SR_CONF_CONN
+ * on it until one of them finds a device. Connections are first probed
+ * with the driver (and serial parameters) that found a device there the
+ * last time, see sr_scan_cache_load().
+ *
+ * Scans that are still running at the deadline are left to complete in
+ * the background, but no new ones are started. The devices they find are
+ * not returned, but can be retrieved later with sr_dev_list(), which
+ * waits for a background scan of its driver to finish, as do
+ * sr_dev_clear() and sr_driver_init(). sr_exit() waits for all of them.
+ *
+ * All drivers must have been initialized with sr_driver_init().
+ *
+ * @param ctx A libsigrok context object. Must not be NULL.
+ * @param drivers NULL-terminated array of drivers to scan with, e.g. as
+ *                returned by sr_driver_list(). Must not be NULL.
+ * @param options A list of 'struct sr_config' options to pass to the
+ *                drivers' scanners. Can be NULL/empty.
+ * @param timeout Deadline for the whole scan in milliseconds, or 0 to wait
+ *                for all drivers to finish.
+ *
+ * @return A GSList * of 'struct sr_dev_inst', or NULL if no devices were
+ *         found (or errors were encountered). This list must be freed by the
+ *         caller using g_slist_free(), but without freeing the data pointed
+ *         to in the list.
+ */
+SR_API GSList *sr_driver_scan_all(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, GSList *options, int timeout)
+{
+	struct scan_state *state;
+	struct scan_job *job;
+	struct sr_config *src;
+	GThreadPool *pool;
+	GSList *conns, *devices, *l;
+	GError *error;
+	gint64 end_time;
+	int num_jobs, i;
+
+	if (!ctx || !drivers) {
+		sr_err("%s: invalid arguments.", __func__);
+		return NULL;
+	}
+
+	if (!(state = g_try_malloc0(sizeof(struct scan_state)))) {
+		sr_err("Scan state malloc failed.");
+		return NULL;
+	}
+
+	for (i = 0; drivers[i]; i++) {
+		if (!drivers[i]->priv) {
+			sr_err("Driver '%s' not initialized, can't scan for "
+					"devices.", drivers[i]->name);
+			g_free(state);
+			return NULL;
+		}
+	}
+
+	state->ctx = ctx;
+	state->num_drivers = i;
+	state->drivers = g_memdup(drivers, sizeof(*drivers) * (i + 1));
+	state->takes_conn = g_malloc0(sizeof(gboolean) * (i + 1));
+	for (i = 0; i < state->num_drivers; i++)
+		state->takes_conn[i] = driver_takes_conn(drivers[i]);
+	g_mutex_init(&state->mutex);
+	g_cond_init(&state->cond);
+	state->refcount = 1;
+
+	/* Split the connections off, the remaining options are shared. */
+	conns = NULL;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			conns = g_slist_append(conns, g_variant_dup_string(
+					src->data, NULL));
+		else
+			state->options = g_slist_append(state->options,
+					sr_config_new(src->key, src->data));
+	}
+
+	num_jobs = conns ? (int)g_slist_length(conns) : state->num_drivers;
+	if (num_jobs == 0) {
+		scan_state_unref(state);
+		return NULL;
+	}
+
+	error = NULL;
+	pool = g_thread_pool_new(scan_job_run, state,
+			MIN(num_jobs, SCAN_MAX_THREADS), FALSE, &error);
+	if (!pool) {
+		sr_err("Failed to create scan thread pool: %s.",
+				error->message);
+		g_error_free(error);
+		g_slist_free_full(conns, g_free);
+		scan_state_unref(state);
+		return NULL;
+	}
+
+	for (i = 0, l = conns; i < num_jobs; i++) {
+		if (!(job = g_try_malloc0(sizeof(struct scan_job)))) {
+			sr_err("Scan job malloc failed.");
+			break;
+		}
+		job->index = i;
+		job->driver = conns ? -1 : i;
+		if (l) {
+			job->conn = l->data;
+			l->data = NULL;
+			l = l->next;
+		}
+		g_atomic_int_inc(&state->refcount);
+		g_mutex_lock(&state->mutex);
+		state->pending++;
+		g_mutex_unlock(&state->mutex);
+		g_mutex_lock(&ctx->scan_mutex);
+		ctx->scan_jobs++;
+		g_mutex_unlock(&ctx->scan_mutex);
+		g_thread_pool_push(pool, job, NULL);
+	}
+	g_slist_free_full(conns, g_free);
+
+	end_time = g_get_monotonic_time() + timeout * G_TIME_SPAN_MILLISECOND;
+
+	g_mutex_lock(&state->mutex);
+	while (state->pending) {
+		if (timeout <= 0) {
+			g_cond_wait(&state->cond, &state->mutex);
+		} else if (!g_cond_wait_until(&state->cond, &state->mutex,
+				end_time)) {
+			sr_warn("Scan deadline expired with %d jobs pending.",
+					state->pending);
+			break;
+		}
+	}
+	state->abandoned = TRUE;
+	devices = state->devices;
+	state->devices = NULL;
+	g_mutex_unlock(&state->mutex);
+
+	/* Don't wait for stragglers, the pool frees itself once they're done. */
+	g_thread_pool_free(pool, FALSE, FALSE);
+	scan_state_unref(state);
+
+	sr_spew("Parallel scan found %d devices.", g_slist_length(devices));
+
+	return devices;
+}
+
+/**
+ * Load the scan cache from a file.
+ *
+ * The scan cache records which driver found a device on a connection
+ * during sr_driver_scan_all(), so that the next scan of that connection
+ * can try it first. Any cached entries are replaced.
+ *
+ * @param ctx A libsigrok context object. Must not be NULL.
+ * @param filename The file to load. Must not be NULL.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments, or SR_ERR
+ *         if the file could not be read or parsed.
+ */
+SR_API int sr_scan_cache_load(struct sr_context *ctx, const char *filename)
+{
+	GKeyFile *keyfile;
+	GError *error;
+
+	if (!ctx || !filename)
+		return SR_ERR_ARG;
+
+	keyfile = g_key_file_new();
+	error = NULL;
+	if (!g_key_file_load_from_file(keyfile, filename, G_KEY_FILE_NONE,
+			&error)) {
+		sr_dbg("Failed to load scan cache '%s': %s.", filename,
+				error->message);
+		g_error_free(error);
+		g_key_file_free(keyfile);
+		return SR_ERR;
+	}
+
+	g_mutex_lock(&ctx->scan_mutex);
+	g_key_file_free(ctx->scan_cache);
+	ctx->scan_cache = keyfile;
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Save the scan cache to a file.
+ *
+ * @param ctx A libsigrok context object. Must not be NULL.
+ * @param filename The file to write. Must not be NULL.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments, or SR_ERR
+ *         if the file could not be written.
+ */
+SR_API int sr_scan_cache_save(struct sr_context *ctx, const char *filename)
+{
+	GError *error;
+	gchar *data;
+	gsize len;
+	int ret;
+
+	if (!ctx || !filename)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->scan_mutex);
+	data = g_key_file_to_data(ctx->scan_cache, &len, NULL);
+	g_mutex_unlock(&ctx->scan_mutex);
+
+	ret = SR_OK;
+	error = NULL;
+	if (!g_file_set_contents(filename, data, len, &error)) {
+		sr_err("Failed to save scan cache '%s': %s.", filename,
+				error->message);
+		g_error_free(error);
+		ret = SR_ERR;
+	}
+	g_free(data);
+
+	return ret;
+}
+
 /** @private */
 SR_PRIV void sr_hw_cleanup_all(void)
 {
@@ -490,6 +1069,15 @@ SR_PRIV void sr_hw_cleanup_all(void)
 		if (drivers[i]->cleanup)
 			drivers[i]->cleanup();
 	}
+
+	G_LOCK(config_list_cache);
+	if (config_list_cache) {
+		g_hash_table_destroy(config_list_cache);
+		config_list_cache = NULL;
+	}
+	G_UNLOCK(config_list_cache);
+
+	sr_firmware_cache_clear();
 }
 
 /** A floating reference can be passed in for data.
@@ -594,14 +1182,69 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 	else
 		ret = sdi->driver->config_set(key, data, sdi, probe_group);
 
+	/* The device's lists may depend on what was just set. */
+	if (ret == SR_OK)
+		sr_config_list_cache_invalidate(sdi->driver, sdi);
+
 	g_variant_unref(data);
 
 	return ret;
 }
 
+static guint config_list_key_hash(gconstpointer v)
+{
+	const struct config_list_key *k = v;
+
+	return g_direct_hash(k->driver) ^ g_direct_hash(k->sdi)
+		^ g_direct_hash(k->probe_group) ^ g_int_hash(&k->key);
+}
+
+static gboolean config_list_key_equal(gconstpointer a, gconstpointer b)
+{
+	const struct config_list_key *ka = a, *kb = b;
+
+	return ka->driver == kb->driver && ka->sdi == kb->sdi
+		&& ka->probe_group == kb->probe_group && ka->key == kb->key;
+}
+
+static gboolean config_list_key_matches(gpointer key, gpointer value,
+		gpointer user_data)
+{
+	const struct config_list_key *k = key, *match = user_data;
+
+	(void)value;
+
+	return (!match->driver || k->driver == match->driver)
+		&& (!match->sdi || k->sdi == match->sdi);
+}
+
+/** @private
+ *  Drop cached sr_config_list() results.
+ *  @param driver Only drop results of this driver, or NULL for any.
+ *  @param sdi Only drop results for this device instance, or NULL for any.
+ */
+SR_PRIV void sr_config_list_cache_invalidate(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi)
+{
+	struct config_list_key match;
+
+	match.driver = driver;
+	match.sdi = sdi;
+
+	G_LOCK(config_list_cache);
+	if (config_list_cache)
+		g_hash_table_foreach_remove(config_list_cache,
+				config_list_key_matches, &match);
+	G_UNLOCK(config_list_cache);
+}
+
 /**
  * List all possible values for a configuration key.
  *
+ * Lists are immutable, so the driver is only asked once. Later calls return
+ * another reference to the same GVariant, until sr_config_set() succeeds on
+ * the device instance, or it's opened, closed or freed.
+ *
  * @param driver The sr_dev_driver struct to query.
  * @param sdi (optional) If the key is specific to a device, this must
  *            contain a pointer to the struct sr_dev_inst to be checked.
@@ -624,16 +1267,83 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		const struct sr_probe_group *probe_group,
 		int key, GVariant **data)
 {
+	struct config_list_key lookup, *k;
+	GVariant *cached;
 	int ret;
 
 	if (!driver || !data)
-		ret = SR_ERR;
+		return SR_ERR;
 	else if (!driver->config_list)
-		ret = SR_ERR_ARG;
-	else if ((ret = driver->config_list(key, data, sdi, probe_group)) == SR_OK)
-		g_variant_ref_sink(*data);
+		return SR_ERR_ARG;
 
-	return ret;
+	lookup.driver = driver;
+	lookup.sdi = sdi;
+	lookup.probe_group = probe_group;
+	lookup.key = key;
+
+	G_LOCK(config_list_cache);
+	cached = NULL;
+	if (config_list_cache
+			&& (cached = g_hash_table_lookup(config_list_cache, &lookup)))
+		*data = g_variant_ref(cached);
+	G_UNLOCK(config_list_cache);
+	if (cached)
+		return SR_OK;
+
+	if ((ret = driver->config_list(key, data, sdi, probe_group)) != SR_OK)
+		return ret;
+	g_variant_ref_sink(*data);
+
+	if (!(k = g_try_malloc(sizeof(struct config_list_key))))
+		return SR_OK;
+	*k = lookup;
+
+	G_LOCK(config_list_cache);
+	if (!config_list_cache)
+		config_list_cache = g_hash_table_new_full(config_list_key_hash,
+				config_list_key_equal, g_free,
+				(GDestroyNotify)g_variant_unref);
+	g_hash_table_replace(config_list_cache, k, g_variant_ref(*data));
+	G_UNLOCK(config_list_cache);
+
+	return SR_OK;
+}
+
+static int config_info_key_cmp(const void *a, const void *b)
+{
+	const struct sr_config_info *ia = *(const struct sr_config_info **)a;
+	const struct sr_config_info *ib = *(const struct sr_config_info **)b;
+
+	return (ia->key > ib->key) - (ia->key < ib->key);
+}
+
+static int config_info_name_cmp(const void *a, const void *b)
+{
+	const struct sr_config_info *ia = *(const struct sr_config_info **)a;
+	const struct sr_config_info *ib = *(const struct sr_config_info **)b;
+
+	return strcmp(ia->id, ib->id);
+}
+
+/* Sort the lookup indexes, the first time they're needed. */
+static void config_info_index_init(void)
+{
+	static gsize initialized = 0;
+	unsigned int i;
+
+	if (!g_once_init_enter(&initialized))
+		return;
+
+	for (i = 0; i < CONFIG_INFO_COUNT; i++) {
+		config_info_by_key[i] = &sr_config_info_data[i];
+		config_info_by_name[i] = &sr_config_info_data[i];
+	}
+	qsort(config_info_by_key, CONFIG_INFO_COUNT,
+			sizeof(struct sr_config_info *), config_info_key_cmp);
+	qsort(config_info_by_name, CONFIG_INFO_COUNT,
+			sizeof(struct sr_config_info *), config_info_name_cmp);
+
+	g_once_init_leave(&initialized, 1);
 }
 
 /**
@@ -646,14 +1356,17 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
  */
 SR_API const struct sr_config_info *sr_config_info_get(int key)
 {
-	int i;
+	struct sr_config_info info;
+	const struct sr_config_info *pinfo, **found;
 
-	for (i = 0; sr_config_info_data[i].key; i++) {
-		if (sr_config_info_data[i].key == key)
-			return &sr_config_info_data[i];
-	}
+	config_info_index_init();
 
-	return NULL;
+	info.key = key;
+	pinfo = &info;
+	found = bsearch(&pinfo, config_info_by_key, CONFIG_INFO_COUNT,
+			sizeof(struct sr_config_info *), config_info_key_cmp);
+
+	return found ? *found : NULL;
 }
 
 /**
@@ -666,14 +1379,20 @@ SR_API const struct sr_config_info *sr_config_info_get(int key)
  */
 SR_API const struct sr_config_info *sr_config_info_name_get(const char *optname)
 {
-	int i;
+	struct sr_config_info info;
+	const struct sr_config_info *pinfo, **found;
 
-	for (i = 0; sr_config_info_data[i].key; i++) {
-		if (!strcmp(sr_config_info_data[i].id, optname))
-			return &sr_config_info_data[i];
-	}
+	if (!optname)
+		return NULL;
 
-	return NULL;
+	config_info_index_init();
+
+	info.id = (char *)optname;
+	pinfo = &info;
+	found = bsearch(&pinfo, config_info_by_name, CONFIG_INFO_COUNT,
+			sizeof(struct sr_config_info *), config_info_name_cmp);
+
+	return found ? *found : NULL;
 }
 
 /* Unnecessary level of indirection follows. */
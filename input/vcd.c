@@ -66,7 +66,6 @@
 #define LOG_PREFIX "input/vcd"
 
 #define DEFAULT_NUM_PROBES 8
-#define CHUNKSIZE 1024
 
 struct context {
 	uint64_t samplerate;
@@ -358,31 +357,21 @@ static int init(struct sr_input *in, const char *filename)
 static void send_samples(const struct sr_dev_inst *sdi, uint64_t sample, uint64_t count)
 {
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	uint64_t buffer[CHUNKSIZE];
-	uint64_t i;
-	unsigned chunksize = CHUNKSIZE;
-		
-	if (count < chunksize)
-		chunksize = count;
+	struct sr_datafeed_logic_rle logic_rle;
 
-	for (i = 0; i < chunksize; i++)
-		buffer[i] = sample;
-	
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;	
-	logic.unitsize = sizeof(uint64_t);
-	logic.data = buffer;
-	
-	while (count) {
-		if (count < chunksize)
-			chunksize = count;
-	
-		logic.length = sizeof(uint64_t) * chunksize;
-	
-		sr_session_send(sdi, &packet);
-		count -= chunksize;
-	}
+	/* Never put an empty run on the bus. */
+	if (count == 0)
+		return;
+
+	/* The value holds until the next timestamp: that's a single run. */
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &logic_rle;
+	logic_rle.num_runs = 1;
+	logic_rle.unitsize = sizeof(uint64_t);
+	logic_rle.values = &sample;
+	logic_rle.lengths = &count;
+
+	sr_session_send(sdi, &packet);
 }
 
 /* Parse the data section of VCD */
@@ -28,11 +28,14 @@
 #define LOG_PREFIX "input/wav"
 
 #define CHUNK_SIZE 4096
+#define MAX_CHANNELS 20
 
 struct context {
 	uint64_t samplerate;
 	int samplesize;
 	int num_channels;
+	float scale[MAX_CHANNELS];
+	float offset[MAX_CHANNELS];
 };
 
 static int get_wav_header(const char *filename, char *buf)
@@ -107,12 +110,21 @@ static int init(struct sr_input *in, const char *filename)
 		return SR_ERR;
 	}
 
-	if ((ctx->num_channels = GUINT16_FROM_LE(*(uint16_t *)(buf + 22))) > 20) {
+	if ((ctx->num_channels = GUINT16_FROM_LE(*(uint16_t *)(buf + 22))) > MAX_CHANNELS) {
 		sr_err("%d channels seems crazy.", ctx->num_channels);
 		return SR_ERR;
 	}
 
 	for (i = 0; i < ctx->num_channels; i++) {
+		/* 8-bit PCM samples are unsigned. */
+		if (ctx->samplesize == 1)
+			ctx->scale[i] = 1 / 255.0;
+		else if (ctx->samplesize == 2)
+			ctx->scale[i] = 1 / 32767.0;
+		else
+			ctx->scale[i] = 1 / 65535.0;
+		ctx->offset[i] = 0;
+
 		snprintf(probename, 8, "CH%d", i + 1);
 		if (!(probe = sr_probe_new(0, SR_PROBE_ANALOG, TRUE, probename)))
 			return SR_ERR;
@@ -122,17 +134,36 @@ static int init(struct sr_input *in, const char *filename)
 	return SR_OK;
 }
 
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+/* WAV samples are little endian, raw analog packets use host byte order. */
+static void swap_samples(void *buf, int len, int samplesize)
+{
+	uint16_t *buf16;
+	uint32_t *buf32;
+	int i;
+
+	if (samplesize == 2) {
+		buf16 = buf;
+		for (i = 0; i < len / 2; i++)
+			buf16[i] = GUINT16_FROM_LE(buf16[i]);
+	} else if (samplesize == 4) {
+		buf32 = buf;
+		for (i = 0; i < len / 4; i++)
+			buf32[i] = GUINT32_FROM_LE(buf32[i]);
+	}
+}
+#endif
+
 static int loadfile(struct sr_input *in, const char *filename)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_meta meta;
-	struct sr_datafeed_analog analog;
+	struct sr_datafeed_analog_raw analog;
 	struct sr_config *src;
 	struct context *ctx;
-	float fdata[CHUNK_SIZE];
-	uint64_t sample;
-	int num_samples, chunk_samples, s, c, fd, l;
-	char buf[CHUNK_SIZE];
+	int num_samples, chunk_size, fd, l;
+	/* Keep the sample data aligned for 16 and 32-bit access. */
+	uint32_t buf[CHUNK_SIZE / sizeof(uint32_t)];
 
 	ctx = in->sdi->priv;
 
@@ -152,37 +183,34 @@ static int loadfile(struct sr_input *in, const char *filename)
 
 	lseek(fd, 40, SEEK_SET);
 	l = read(fd, buf, 4);
-	num_samples = GUINT32_FROM_LE((uint32_t)*(buf));
+	num_samples = GUINT32_FROM_LE(buf[0]);
 	num_samples /= ctx->samplesize / ctx->num_channels;
+
+	/* Only read whole samples, for all channels. */
+	chunk_size = CHUNK_SIZE - CHUNK_SIZE % (ctx->samplesize * ctx->num_channels);
+
+	/* The PCM data goes on the bus as it is. */
+	packet.type = SR_DF_ANALOG_RAW;
+	packet.payload = &analog;
+	analog.probes = in->sdi->probes;
+	analog.mq = 0;
+	analog.unit = 0;
+	analog.mqflags = 0;
+	analog.encoding = ctx->samplesize == 1 ? SR_ANALOG_RAW_UINT8 :
+			ctx->samplesize == 2 ? SR_ANALOG_RAW_INT16 :
+			SR_ANALOG_RAW_INT32;
+	analog.bits = ctx->samplesize * 8;
+	analog.scale = ctx->scale;
+	analog.offset = ctx->offset;
+	analog.data = buf;
+
 	while (TRUE) {
-		if ((l = read(fd, buf, CHUNK_SIZE)) < 1)
+		if ((l = read(fd, buf, chunk_size)) < 1)
 			break;
-		chunk_samples = l / ctx->samplesize / ctx->num_channels;
-		for (s = 0; s < chunk_samples; s++) {
-			for (c = 0; c < ctx->num_channels; c++) {
-				sample = 0;
-				memcpy(&sample, buf + s * ctx->samplesize + c, ctx->samplesize);
-				switch (ctx->samplesize) {
-				case 1:
-					/* 8-bit PCM samples are unsigned. */
-					fdata[s + c] = (uint8_t)sample / 255.0;
-					break;
-				case 2:
-					fdata[s + c] = GINT16_FROM_LE(sample) / 32767.0;
-					break;
-				case 4:
-					fdata[s + c] = GINT32_FROM_LE(sample) / 65535.0;
-					break;
-				}
-			}
-		}
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		analog.probes = in->sdi->probes;
-		analog.num_samples = chunk_samples;
-		analog.mq = 0;
-		analog.unit = 0;
-		analog.data = fdata;
+		analog.num_samples = l / ctx->samplesize / ctx->num_channels;
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+		swap_samples(buf, l, ctx->samplesize);
+#endif
 		sr_session_send(in->sdi, &packet);
 	}
 
@@ -86,6 +86,13 @@
                   ((unsigned)((const uint8_t*)(x))[1] <<  8) |  \
                    (unsigned)((const uint8_t*)(x))[0])
 
+/**
+ * Check that no more than one bit is set in an unsigned integer.
+ * @param x the integer
+ * @return nonzero if x has zero or one bits set
+ */
+#define ONE_BIT_MAX(x)  (((x) & ((x) - 1)) == 0)
+
 /* Portability fixes for FreeBSD. */
 #ifdef __FreeBSD__
 #define LIBUSB_CLASS_APPLICATION 0xfe
@@ -107,6 +114,14 @@ struct sr_context {
 	void *usb_cb_data;
 #endif
 #endif
+	/* Connection -> driver cache for sr_driver_scan_all(). */
+	GKeyFile *scan_cache;
+	GMutex scan_mutex;
+	GCond scan_cond;
+	/* Scan jobs still running in the background. */
+	int scan_jobs;
+	/* Running hotplug monitor, if any. */
+	struct sr_hotplug_monitor *hotplug;
 };
 
 #ifdef HAVE_LIBUSB_1_0
@@ -138,6 +153,14 @@ struct sr_serial_dev_inst {
 	struct sp_event_set *event_set;
 	/** GPollFDs for event polling */
 	GPollFD *pollfds;
+	/** libserialport event set used to wait for incoming data */
+	struct sp_event_set *rx_event_set;
+	/** Receive buffer, bytes read ahead of what was asked for */
+	uint8_t *rxbuf;
+	/** Offset of the first unread byte in the receive buffer */
+	size_t rxbuf_pos;
+	/** Number of unread bytes in the receive buffer */
+	size_t rxbuf_len;
 };
 #endif
 
@@ -204,8 +227,12 @@ SR_PRIV void sr_usbtmc_dev_inst_free(struct sr_usbtmc_dev_inst *usbtmc);
 /*--- hwdriver.c ------------------------------------------------------------*/
 
 SR_PRIV void sr_hw_cleanup_all(void);
+SR_PRIV void sr_config_list_cache_invalidate(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi);
 SR_PRIV struct sr_config *sr_config_new(int key, GVariant *data);
 SR_PRIV void sr_config_free(struct sr_config *src);
+SR_PRIV void sr_driver_lock(const struct sr_dev_driver *driver);
+SR_PRIV void sr_driver_unlock(const struct sr_dev_driver *driver);
 SR_PRIV int sr_source_remove(int fd);
 SR_PRIV int sr_source_add(int fd, int events, int timeout,
 		sr_receive_data_callback_t cb, void *cb_data);
@@ -217,6 +244,19 @@ struct sr_session {
 	GSList *devs;
 	/** List of struct datafeed_callback pointers. */
 	GSList *datafeed_callbacks;
+	/** Position and timebase of each device's stream. */
+	GSList *streams;
+	/** Logic streams merged into virtual devices, see session_merge.c. */
+	GSList *merges;
+	/** Callbacks each device's packets go to, by device. Built as
+	 *  packets arrive, emptied when callbacks or devices change. */
+	GHashTable *dispatch;
+	/** Nesting depth of sr_session_send() calls walking the above. */
+	int dispatching;
+	/** Callbacks or devices changed while dispatching. */
+	gboolean dispatch_dirty;
+	/** Callbacks removed while dispatching, freed once done. */
+	GSList *dead_callbacks;
 	GTimeVal starttime;
 	gboolean running;
 
@@ -248,11 +288,49 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 SR_PRIV int sr_session_stop_sync(void);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 
+/*--- session_merge.c -------------------------------------------------------*/
+
+SR_PRIV gboolean sr_session_merge_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_merge_free_all(void);
+
+/*--- session_decimate.c ----------------------------------------------------*/
+
+struct sr_decimator;
+
+SR_PRIV struct sr_decimator *sr_decimator_new(sr_datafeed_callback_t cb,
+		void *cb_data, uint64_t rate);
+SR_PRIV void sr_decimator_free(struct sr_decimator *dec);
+SR_PRIV void sr_decimator_send(struct sr_decimator *dec,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, uint32_t types);
+
 /*--- std.c -----------------------------------------------------------------*/
 
 typedef int (*dev_close_t)(struct sr_dev_inst *sdi);
 typedef void (*std_dev_clear_t)(void *priv);
 
+/** Readings held back by std_analog_batch_add(). */
+struct std_analog_batch {
+	/** Most samples sent in one packet. */
+	int max_samples;
+	/** Longest a reading is held back, in microseconds. 0 disables. */
+	int64_t max_latency;
+	const struct sr_dev_inst *sdi;
+	/* Format shared by all held readings. */
+	GSList *probes;
+	int mq;
+	int unit;
+	uint64_t mqflags;
+	int num_samples;
+	float *data;
+	int64_t *timestamps;
+	/** Number of probes the buffers have room for. */
+	int buf_probes;
+	/** Monotonic time the oldest held reading arrived. */
+	int64_t first_time;
+};
+
 SR_PRIV int std_init(struct sr_context *sr_ctx, struct sr_dev_driver *di,
 		const char *prefix);
 #ifdef HAVE_LIBSERIALPORT
@@ -266,6 +344,14 @@ SR_PRIV int std_session_send_df_header(const struct sr_dev_inst *sdi,
 SR_PRIV int std_dev_clear(const struct sr_dev_driver *driver,
 		std_dev_clear_t clear_private);
 SR_PRIV int std_serial_dev_close(struct sr_dev_inst *sdi);
+SR_PRIV void std_analog_batch_init(struct std_analog_batch *batch,
+		const struct sr_dev_inst *sdi, int max_samples,
+		uint64_t latency_ms);
+SR_PRIV int std_analog_batch_add(struct std_analog_batch *batch,
+		const struct sr_datafeed_analog *analog);
+SR_PRIV int std_analog_batch_poll(struct std_analog_batch *batch);
+SR_PRIV int std_analog_batch_flush(struct std_analog_batch *batch);
+SR_PRIV void std_analog_batch_free(struct std_analog_batch *batch);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -284,6 +370,28 @@ enum {
 };
 
 typedef gboolean (*packet_valid_t)(const uint8_t *buf);
+typedef void (*packet_handler_t)(const uint8_t *buf, size_t len,
+		void *cb_data);
+
+/** Framing of the packets a serial device sends, see serial_receive(). */
+struct serial_packet_desc {
+	/** Bytes every packet starts with, or NULL. */
+	const uint8_t *sync;
+	/** Number of sync bytes. */
+	size_t sync_len;
+	/** Packet size, or header size if the size is variable. */
+	size_t packet_size;
+	/** Largest valid packet size, if the size is variable. */
+	size_t max_size;
+	/** Offset of a length byte in the header, or -1. */
+	int length_offset;
+	/** Added to the length byte to get the packet size. */
+	int length_extra;
+	/** Byte that ends each packet, or -1. */
+	int terminator;
+	/** Callback that assesses whether a packet is valid, or NULL. */
+	packet_valid_t is_valid;
+};
 
 SR_PRIV int serial_open(struct sr_serial_dev_inst *serial, int flags);
 SR_PRIV int serial_close(struct sr_serial_dev_inst *serial);
@@ -306,10 +414,17 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
 		const char *paramstr);
 SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial, char **buf,
 		int *buflen, gint64 timeout_ms);
+SR_PRIV int serial_readline_nonblocking(struct sr_serial_dev_inst *serial,
+		char *buf, int *buflen);
 SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 				 uint8_t *buf, size_t *buflen,
 				 size_t packet_size, packet_valid_t is_valid,
 				 uint64_t timeout_ms, int baudrate);
+SR_PRIV int serial_read_packet(struct sr_serial_dev_inst *serial,
+		uint8_t *buf, size_t packet_size, packet_valid_t is_valid);
+SR_PRIV int serial_receive(struct sr_serial_dev_inst *serial,
+		const struct serial_packet_desc *desc,
+		packet_handler_t handler, void *cb_data);
 SR_PRIV int sr_serial_extract_options(GSList *options, const char **serial_device,
 				      const char **serial_options);
 SR_PRIV int serial_source_add(struct sr_serial_dev_inst *serial, int events,
@@ -320,13 +435,33 @@ SR_PRIV int serial_source_remove(struct sr_serial_dev_inst *serial);
 /*--- hardware/common/ezusb.c -----------------------------------------------*/
 
 #ifdef HAVE_LIBUSB_1_0
+/** A firmware upload running in the background. */
+struct ezusb_upload {
+	libusb_device *dev;
+	int configuration;
+	const char *filename;
+	/** Driver data passed to ezusb_upload_firmware_start(). */
+	void *user_data;
+	GThread *thread;
+	int result;
+};
+
 SR_PRIV int ezusb_reset(struct libusb_device_handle *hdl, int set_clear);
 SR_PRIV int ezusb_install_firmware(libusb_device_handle *hdl,
 				   const char *filename);
 SR_PRIV int ezusb_upload_firmware(libusb_device *dev, int configuration,
 				  const char *filename);
+SR_PRIV struct ezusb_upload *ezusb_upload_firmware_start(libusb_device *dev,
+		int configuration, const char *filename, void *user_data);
+SR_PRIV int ezusb_upload_firmware_finish(struct ezusb_upload *upload);
 #endif
 
+/*--- hardware/common/firmware.c --------------------------------------------*/
+
+SR_PRIV GBytes *sr_firmware_get(const char *filename);
+SR_PRIV void sr_firmware_preload(const char **filenames);
+SR_PRIV void sr_firmware_cache_clear(void);
+
 /*--- hardware/common/usb.c -------------------------------------------------*/
 
 #ifdef HAVE_LIBUSB_1_0
@@ -385,8 +520,15 @@ struct sr_scpi_dev_inst {
 	int (*close)(void *priv);
 	void (*free)(void *priv);
 	void *priv;
+	/* Receive buffer, refilled with reads of read_size bytes. */
+	char *read_buf;
+	size_t read_size;
+	size_t read_pos;
+	size_t read_len;
 };
 
+struct sr_scpi_batch;
+
 SR_PRIV int sr_scpi_open(struct sr_scpi_dev_inst *scpi);
 SR_PRIV int sr_scpi_source_add(struct sr_scpi_dev_inst *scpi, int events,
 		int timeout, sr_receive_data_callback_t cb, void *cb_data);
@@ -416,6 +558,30 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
 SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(struct sr_scpi_dev_inst *scpi,
+			gboolean compound);
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch);
+SR_PRIV void sr_scpi_batch_add_string(struct sr_scpi_batch *batch,
+			const char *command, char **result);
+SR_PRIV void sr_scpi_batch_add_bool(struct sr_scpi_batch *batch,
+			const char *command, gboolean *result);
+SR_PRIV void sr_scpi_batch_add_int(struct sr_scpi_batch *batch,
+			const char *command, int *result);
+SR_PRIV void sr_scpi_batch_add_float(struct sr_scpi_batch *batch,
+			const char *command, float *result);
+SR_PRIV int sr_scpi_batch_run(struct sr_scpi_batch *batch);
+SR_PRIV int sr_scpi_read_block_header(struct sr_scpi_dev_inst *scpi);
+SR_PRIV int sr_scpi_read_skip(struct sr_scpi_dev_inst *scpi, size_t len);
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_get_block_int8v(struct sr_scpi_dev_inst *scpi,
+			const char *command, GArray **scpi_response);
+SR_PRIV int sr_scpi_get_block_int16v(struct sr_scpi_dev_inst *scpi,
+			const char *command, gboolean big_endian,
+			GArray **scpi_response);
+SR_PRIV int sr_scpi_get_block_float32v(struct sr_scpi_dev_inst *scpi,
+			const char *command, gboolean big_endian,
+			GArray **scpi_response);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
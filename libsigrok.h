@@ -166,6 +166,31 @@ enum {
 	SR_DF_FRAME_BEGIN,
 	/** End of frame. No payload. */
 	SR_DF_FRAME_END,
+	/** Payload is struct sr_datafeed_logic_rle. */
+	SR_DF_LOGIC_RLE,
+	/** Payload is struct sr_datafeed_analog_raw. */
+	SR_DF_ANALOG_RAW,
+	/** Payload is struct sr_datafeed_logic_summary. */
+	SR_DF_LOGIC_SUMMARY,
+	/** Payload is struct sr_datafeed_analog_summary. */
+	SR_DF_ANALOG_SUMMARY,
+};
+
+/**
+ * Bit for a packet type in a mask of packet types, for
+ * sr_session_datafeed_callback_subscribe().
+ */
+#define SR_DF_MASK(type) (1 << ((type) - SR_DF_HEADER))
+
+/**
+ * Packet types a datafeed callback can take as they are, for
+ * sr_session_datafeed_callback_native_add().
+ */
+enum {
+	/** SR_DF_LOGIC_RLE packets. */
+	SR_DF_NATIVE_LOGIC_RLE = 0x01,
+	/** SR_DF_ANALOG_RAW packets. */
+	SR_DF_NATIVE_ANALOG_RAW = 0x02,
 };
 
 /** Measured quantity, sr_datafeed_analog.mq. */
@@ -304,6 +329,20 @@ enum {
 	SR_MQFLAG_AVG = 0x40000,
 };
 
+/** Sample encoding, sr_datafeed_analog_raw.encoding. */
+enum {
+	/** Unsigned 8-bit integers. */
+	SR_ANALOG_RAW_UINT8 = 10000,
+	/** Signed 8-bit integers. */
+	SR_ANALOG_RAW_INT8,
+	/** Unsigned 16-bit integers, host byte order. */
+	SR_ANALOG_RAW_UINT16,
+	/** Signed 16-bit integers, host byte order. */
+	SR_ANALOG_RAW_INT16,
+	/** Signed 32-bit integers, host byte order. */
+	SR_ANALOG_RAW_INT32,
+};
+
 /**
  * @struct sr_context
  * Opaque structure representing a libsigrok context.
@@ -318,6 +357,13 @@ struct sr_context;
 struct sr_datafeed_packet {
 	uint16_t type;
 	const void *payload;
+	/**
+	 * Position of the packet's first sample in the device's stream of
+	 * logic or analog samples, counted from the SR_DF_HEADER packet.
+	 * For SR_DF_TRIGGER, the position of the trigger in the logic stream.
+	 * Set by the session, drivers need not fill this in.
+	 */
+	uint64_t sample_offset;
 };
 
 /** Header of a sigrok data feed. */
@@ -338,6 +384,49 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Run-length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Equivalent to an SR_DF_LOGIC packet in which each value is repeated
+ * for the number of samples given in the corresponding lengths entry.
+ * Datafeed callbacks registered with sr_session_datafeed_callback_add()
+ * receive these as regular SR_DF_LOGIC packets instead.
+ */
+struct sr_datafeed_logic_rle {
+	/** Number of runs in this packet. */
+	uint64_t num_runs;
+	/** Size of a single sample value, in bytes. */
+	uint16_t unitsize;
+	/** One sample value per run, num_runs * unitsize bytes in total. */
+	void *values;
+	/** Number of consecutive samples each value holds for. */
+	uint64_t *lengths;
+};
+
+/**
+ * Decimated logic datafeed payload for type SR_DF_LOGIC_SUMMARY.
+ *
+ * Each bucket stands for a number of consecutive samples of the logic
+ * stream. Only callbacks registered with
+ * sr_session_datafeed_callback_decimate_add() receive these, instead of
+ * SR_DF_LOGIC packets. The packet's sample_offset is that of the first
+ * sample of the first bucket.
+ */
+struct sr_datafeed_logic_summary {
+	/** Number of buckets in this packet. */
+	uint64_t num_buckets;
+	/** Number of samples in each bucket. */
+	uint64_t bucket_samples;
+	/** Size of a single sample value, in bytes. */
+	uint16_t unitsize;
+	/** Value of the last sample of each bucket, num_buckets * unitsize
+	 *  bytes in total. */
+	void *last;
+	/** Bits which changed in each bucket, counting from the last sample
+	 *  of the bucket before, num_buckets * unitsize bytes in total. */
+	void *edges;
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	/** The probes for which data is included in this packet. */
@@ -354,6 +443,74 @@ struct sr_datafeed_analog {
 	/** The analog value(s). The data is interleaved according to
 	 * the probes list. */
 	float *data;
+	/** Time at which each sample was taken, in microseconds since the
+	 *  Unix epoch, or NULL if not known. */
+	int64_t *timestamps;
+};
+
+/**
+ * Raw analog datafeed payload for type SR_DF_ANALOG_RAW.
+ *
+ * Carries samples as the integer codes the device produced, which saves
+ * converting them to float where nobody needs that. The value of a sample
+ * is code * scale + offset, where scale and offset are given per probe.
+ * Datafeed callbacks registered with sr_session_datafeed_callback_add()
+ * receive these as regular SR_DF_ANALOG packets instead.
+ */
+struct sr_datafeed_analog_raw {
+	/** The probes for which data is included in this packet. */
+	GSList *probes;
+	/** Number of samples in data, per probe. */
+	int num_samples;
+	/** Measured quantity, as in sr_datafeed_analog. */
+	int mq;
+	/** Unit in which the MQ is measured, as in sr_datafeed_analog. */
+	int unit;
+	/** Bitmap with extra information about the MQ, as in
+	 * sr_datafeed_analog. */
+	uint64_t mqflags;
+	/** Encoding of each sample. Use SR_ANALOG_RAW_UINT8, ... */
+	int encoding;
+	/** Number of significant bits in each sample, or 0 if all of them. */
+	int bits;
+	/** Scale factor for each probe, in the order of the probes list. */
+	const float *scale;
+	/** Offset for each probe, in the order of the probes list. */
+	const float *offset;
+	/** The sample codes. The data is interleaved according to the
+	 * probes list. */
+	void *data;
+};
+
+/**
+ * Decimated analog datafeed payload for type SR_DF_ANALOG_SUMMARY.
+ *
+ * Each bucket stands for a number of consecutive samples of the analog
+ * stream. Only callbacks registered with
+ * sr_session_datafeed_callback_decimate_add() receive these, instead of
+ * SR_DF_ANALOG packets. The packet's sample_offset is that of the first
+ * sample of the first bucket.
+ */
+struct sr_datafeed_analog_summary {
+	/** The probes for which data is included in this packet. */
+	GSList *probes;
+	/** Number of buckets in this packet. */
+	uint64_t num_buckets;
+	/** Number of samples in each bucket. */
+	uint64_t bucket_samples;
+	/** Measured quantity, as in sr_datafeed_analog. */
+	int mq;
+	/** Unit in which the MQ is measured, as in sr_datafeed_analog. */
+	int unit;
+	/** Bitmap with extra information about the MQ, as in
+	 * sr_datafeed_analog. */
+	uint64_t mqflags;
+	/** Smallest, largest and mean value in each bucket. Each of these is
+	 *  interleaved according to the probes list, as in
+	 *  sr_datafeed_analog. */
+	float *min;
+	float *max;
+	float *mean;
 };
 
 /** Input (file) format struct. */
@@ -718,6 +875,9 @@ enum {
 	 */
 	SR_CONF_SERIALCOMM,
 
+	/** Number of devices the driver creates in one scan. */
+	SR_CONF_NUM_DEVICES,
+
 	/*--- Device configuration ------------------------------------------*/
 
 	/** The device supports setting its samplerate, in Hz. */
@@ -807,6 +967,16 @@ enum {
 	/** The device supports setting the number of analog probes. */
 	SR_CONF_NUM_ANALOG_PROBES,
 
+	/** The device supports throttling its data output to the samplerate. */
+	SR_CONF_THROTTLE,
+
+	/**
+	 * The device can hold back readings for up to this many milliseconds,
+	 * and send them as one multi-sample analog packet. 0 sends each
+	 * reading as it arrives.
+	 */
+	SR_CONF_BATCH_LATENCY,
+
 	/*--- Special stuff -------------------------------------------------*/
 
 	/** Scan options supported by the driver. */
@@ -839,6 +1009,13 @@ enum {
 	 * is always the default. */
 	SR_CONF_DATA_SOURCE,
 
+	/**
+	 * USB vendor and product IDs handled by the driver, each as
+	 * (vid << 16) | pid. Used to pick the driver for a hotplugged
+	 * device, see sr_hotplug_monitor_start().
+	 */
+	SR_CONF_USB_IDS,
+
 	/*--- Acquisition modes ---------------------------------------------*/
 
 	/**
@@ -922,6 +1099,37 @@ enum {
 	SR_ST_STOPPING,
 };
 
+/** Hotplug event types, struct sr_hotplug_event.type */
+enum {
+	/** A device was plugged in. */
+	SR_HOTPLUG_ARRIVED = 10000,
+	/** A device was unplugged. */
+	SR_HOTPLUG_LEFT,
+};
+
+/** A device being plugged in or unplugged, see sr_hotplug_monitor_start(). */
+struct sr_hotplug_event {
+	/** SR_HOTPLUG_ARRIVED or SR_HOTPLUG_LEFT. */
+	int type;
+	/** SR_INST_USB or SR_INST_SERIAL, or as sr_hotplug_monitor_scan(). */
+	int inst_type;
+	/** Connection as for SR_CONF_CONN: "bus.address", or the port name. */
+	const char *conn;
+	/** USB vendor ID, or 0 if unknown. */
+	uint16_t vid;
+	/** USB product ID, or 0 if unknown. */
+	uint16_t pid;
+	/**
+	 * Device instances found on the connection when it arrived, or using
+	 * it when it left. Only valid during the callback.
+	 */
+	GSList *devices;
+};
+
+/** Type definition for callback function for hotplug events. */
+typedef void (*sr_hotplug_callback_t)(const struct sr_hotplug_event *event,
+		void *cb_data);
+
 /** Device driver data */
 struct sr_dev_driver {
 	/* Driver-specific */
@@ -27,6 +27,9 @@
 
 #define LOG_PREFIX "output/csv"
 
+/* Samples expanded from an RLE packet at a time. */
+#define RLE_CHUNK_SAMPLES 4096
+
 struct context {
 	unsigned int num_enabled_probes;
 	unsigned int unitsize;
@@ -121,57 +124,34 @@ static int init(struct sr_output *o)
 	return SR_OK;
 }
 
-static int event(struct sr_output *o, int event_type, uint8_t **data_out,
-		 uint64_t *length_out)
+static void append_sample(const struct context *ctx, const uint8_t *data,
+		GString *out)
 {
-	struct context *ctx;
-
-	if (!o) {
-		sr_err("%s: o was NULL", __func__);
-		return SR_ERR_ARG;
+	uint64_t sample, j;
+
+	sample = 0;
+	memcpy(&sample, data, ctx->unitsize);
+	for (j = 0; j < ctx->num_enabled_probes; j++) {
+		g_string_append_printf(out, "%d%c",
+			(int)((sample & (1ULL << j)) >> j),
+			ctx->separator);
 	}
-
-	if (!(ctx = o->internal)) {
-		sr_err("%s: o->internal was NULL", __func__);
-		return SR_ERR_ARG;
-	}
-
-	if (!data_out) {
-		sr_err("%s: data_out was NULL", __func__);
-		return SR_ERR_ARG;
-	}
-
-	switch (event_type) {
-	case SR_DF_TRIGGER:
-		sr_dbg("%s: SR_DF_TRIGGER event", __func__);
-		/* TODO */
-		*data_out = NULL;
-		*length_out = 0;
-		break;
-	case SR_DF_END:
-		sr_dbg("%s: SR_DF_END event", __func__);
-		/* TODO */
-		*data_out = NULL;
-		*length_out = 0;
-		g_free(o->internal);
-		o->internal = NULL;
-		break;
-	default:
-		sr_err("%s: unsupported event type: %d", __func__, event_type);
-		*data_out = NULL;
-		*length_out = 0;
-		break;
-	}
-
-	return SR_OK;
+	g_string_append_c(out, '\n');
 }
 
-static int data(struct sr_output *o, const uint8_t *data_in,
-		uint64_t length_in, uint8_t **data_out, uint64_t *length_out)
+static int receive(struct sr_output *o, const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, GString **out)
 {
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *logic_rle;
 	struct context *ctx;
-	GString *outstr;
-	uint64_t sample, i, j;
+	const uint8_t *data;
+	uint8_t *buf;
+	uint64_t i, run, offset, num_samples;
+
+	(void)sdi;
+
+	*out = NULL;
 
 	if (!o) {
 		sr_err("%s: o was NULL", __func__);
@@ -183,32 +163,56 @@ static int data(struct sr_output *o, const uint8_t *data_in,
 		return SR_ERR_ARG;
 	}
 
-	if (!data_in) {
-		sr_err("%s: data_in was NULL", __func__);
-		return SR_ERR_ARG;
-	}
+	if (packet->type != SR_DF_LOGIC && packet->type != SR_DF_LOGIC_RLE)
+		return SR_OK;
 
 	if (ctx->header) {
 		/* First data packet. */
-		outstr = ctx->header;
+		*out = ctx->header;
 		ctx->header = NULL;
 	} else {
-		outstr = g_string_sized_new(512);
+		*out = g_string_sized_new(512);
 	}
 
-	for (i = 0; i <= length_in - ctx->unitsize; i += ctx->unitsize) {
-		memcpy(&sample, data_in + i, ctx->unitsize);
-		for (j = 0; j < ctx->num_enabled_probes; j++) {
-			g_string_append_printf(outstr, "%d%c",
-				(int)((sample & (1 << j)) >> j),
-				ctx->separator);
-		}
-		g_string_append_printf(outstr, "\n");
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		data = logic->data;
+		for (i = 0; i + ctx->unitsize <= logic->length; i += logic->unitsize)
+			append_sample(ctx, data + i, *out);
+		return SR_OK;
+	}
+
+	/* Expand the runs a bounded chunk at a time, however long they are. */
+	logic_rle = packet->payload;
+	if (!(buf = g_try_malloc(RLE_CHUNK_SAMPLES * logic_rle->unitsize))) {
+		sr_err("%s: buf malloc failed", __func__);
+		g_string_free(*out, TRUE);
+		*out = NULL;
+		return SR_ERR_MALLOC;
+	}
+	run = offset = 0;
+	while ((num_samples = sr_datafeed_logic_rle_expand(logic_rle, &run,
+			&offset, buf, RLE_CHUNK_SAMPLES)) > 0) {
+		for (i = 0; i < num_samples; i++)
+			append_sample(ctx, buf + i * logic_rle->unitsize, *out);
 	}
+	g_free(buf);
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+
+	if (!o || !o->internal)
+		return SR_ERR_ARG;
 
-	*data_out = (uint8_t *)outstr->str;
-	*length_out = outstr->len;
-	g_string_free(outstr, FALSE);
+	ctx = o->internal;
+	if (ctx->header)
+		g_string_free(ctx->header, TRUE);
+	g_free(ctx);
+	o->internal = NULL;
 
 	return SR_OK;
 }
@@ -218,6 +222,6 @@ SR_PRIV struct sr_output_format output_csv = {
 	.description = "Comma-separated values (CSV)",
 	.df_type = SR_DF_LOGIC,
 	.init = init,
-	.data = data,
-	.event = event,
+	.receive = receive,
+	.cleanup = cleanup,
 };
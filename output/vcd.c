@@ -147,13 +147,37 @@ static int init(struct sr_output *o)
 	return SR_OK;
 }
 
+static void dump_changes(struct context *ctx, const uint8_t *sample,
+		uint64_t samplecount, GString *out)
+{
+	int p, curbit, prevbit, index;
+
+	for (p = 0; p < ctx->num_enabled_probes; p++) {
+		index = g_array_index(ctx->probeindices, int, p);
+		curbit = (sample[p / 8] & (((uint8_t) 1) << index)) >> index;
+		prevbit = (ctx->prevsample[p / 8] & (((uint8_t) 1) << index)) >> index;
+
+		/* VCD only contains deltas/changes of signals. */
+		if (prevbit == curbit)
+			continue;
+
+		/* Output which signal changed to which value. */
+		g_string_append_printf(out, "#%" PRIu64 "\n%i%c\n",
+				(uint64_t)(((float)samplecount / ctx->samplerate)
+				* ctx->period), curbit, (char)('!' + p));
+	}
+
+	memcpy(ctx->prevsample, sample, ctx->unitsize);
+}
+
 static int receive(struct sr_output *o, const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *logic_rle;
 	struct context *ctx;
 	unsigned int i;
-	int p, curbit, prevbit, index;
+	uint64_t run;
 	uint8_t *sample;
 	static uint64_t samplecount = 0;
 
@@ -167,7 +191,8 @@ static int receive(struct sr_output *o, const struct sr_dev_inst *sdi,
 	if (packet->type == SR_DF_END) {
 		*out = g_string_new("$dumpoff\n$end\n");
 		return SR_OK;
-	} else if (packet->type != SR_DF_LOGIC)
+	} else if (packet->type != SR_DF_LOGIC
+			&& packet->type != SR_DF_LOGIC_RLE)
 		return SR_OK;
 
 	if (ctx->header) {
@@ -178,28 +203,26 @@ static int receive(struct sr_output *o, const struct sr_dev_inst *sdi,
 		*out = g_string_sized_new(512);
 	}
 
+	if (packet->type == SR_DF_LOGIC_RLE) {
+		/* Only the first sample of a run can hold a change. */
+		logic_rle = packet->payload;
+		for (run = 0; run < logic_rle->num_runs; run++) {
+			if (!logic_rle->lengths[run])
+				continue;
+			sample = (uint8_t *)logic_rle->values +
+					run * logic_rle->unitsize;
+			dump_changes(ctx, sample, samplecount + 1, *out);
+			samplecount += logic_rle->lengths[run];
+		}
+		return SR_OK;
+	}
+
 	logic = packet->payload;
 	for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
 		samplecount++;
 
 		sample = logic->data + i;
-
-		for (p = 0; p < ctx->num_enabled_probes; p++) {
-			index = g_array_index(ctx->probeindices, int, p);
-			curbit = (sample[p / 8] & (((uint8_t) 1) << index)) >> index;
-			prevbit = (ctx->prevsample[p / 8] & (((uint8_t) 1) << index)) >> index;
-
-			/* VCD only contains deltas/changes of signals. */
-			if (prevbit == curbit)
-				continue;
-
-			/* Output which signal changed to which value. */
-			g_string_append_printf(*out, "#%" PRIu64 "\n%i%c\n",
-					(uint64_t)(((float)samplecount / ctx->samplerate)
-					* ctx->period), curbit, (char)('!' + p));
-		}
-
-		memcpy(ctx->prevsample, sample, ctx->unitsize);
+		dump_changes(ctx, sample, samplecount, *out);
 	}
 
 	return SR_OK;
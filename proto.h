@@ -70,6 +70,10 @@ SR_API struct sr_dev_driver **sr_driver_list(void);
 SR_API int sr_driver_init(struct sr_context *ctx,
 		struct sr_dev_driver *driver);
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options);
+SR_API GSList *sr_driver_scan_all(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, GSList *options, int timeout);
+SR_API int sr_scan_cache_load(struct sr_context *ctx, const char *filename);
+SR_API int sr_scan_cache_save(struct sr_context *ctx, const char *filename);
 SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_probe_group *probe_group,
@@ -84,6 +88,15 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 SR_API const struct sr_config_info *sr_config_info_get(int key);
 SR_API const struct sr_config_info *sr_config_info_name_get(const char *optname);
 
+/*--- hotplug.c -------------------------------------------------------------*/
+
+SR_API int sr_hotplug_monitor_start(struct sr_context *ctx,
+		struct sr_dev_driver **drivers, sr_hotplug_callback_t cb,
+		void *cb_data);
+SR_API int sr_hotplug_monitor_scan(struct sr_context *ctx,
+		struct sr_dev_driver *driver, int inst_type, const char *conn);
+SR_API int sr_hotplug_monitor_stop(struct sr_context *ctx);
+
 /*--- session.c -------------------------------------------------------------*/
 
 typedef void (*sr_datafeed_callback_t)(const struct sr_dev_inst *sdi,
@@ -96,11 +109,29 @@ SR_API int sr_session_destroy(void);
 SR_API int sr_session_dev_remove_all(void);
 SR_API int sr_session_dev_add(const struct sr_dev_inst *sdi);
 SR_API int sr_session_dev_list(GSList **devlist);
+SR_API int sr_session_dev_timebase(const struct sr_dev_inst *sdi,
+		int64_t *first_sample_time, uint64_t *samplerate);
+SR_API struct sr_dev_inst *sr_session_merge_logic(GSList *devs,
+		gboolean align);
 
 /* Datafeed setup */
 SR_API int sr_session_datafeed_callback_remove_all(void);
 SR_API int sr_session_datafeed_callback_add(sr_datafeed_callback_t cb,
 		void *cb_data);
+SR_API int sr_session_datafeed_callback_rle_add(sr_datafeed_callback_t cb,
+		void *cb_data);
+SR_API int sr_session_datafeed_callback_native_add(sr_datafeed_callback_t cb,
+		void *cb_data, int native);
+SR_API int sr_session_datafeed_callback_decimate_add(sr_datafeed_callback_t cb,
+		void *cb_data, uint64_t rate);
+SR_API int sr_session_datafeed_callback_subscribe(sr_datafeed_callback_t cb,
+		void *cb_data, uint32_t types, GSList *devs, GSList *probes);
+SR_API uint64_t sr_datafeed_logic_rle_expand(
+		const struct sr_datafeed_logic_rle *rle, uint64_t *run,
+		uint64_t *offset, void *buf, uint64_t max_samples);
+SR_API int sr_datafeed_analog_raw_convert(
+		const struct sr_datafeed_analog_raw *raw, int first,
+		int num_samples, float *buf);
 
 /* Session control */
 SR_API int sr_session_start(void);
@@ -110,6 +141,8 @@ SR_API int sr_session_save(const char *filename, const struct sr_dev_inst *sdi,
 		unsigned char *buf, int unitsize, int units);
 SR_API int sr_session_append(const char *filename, unsigned char *buf,
 		int unitsize, int units);
+SR_API int sr_session_append_rle(const char *filename,
+		const struct sr_datafeed_logic_rle *rle);
 SR_API int sr_session_source_add(int fd, int events, int timeout,
 		sr_receive_data_callback_t cb, void *cb_data);
 SR_API int sr_session_source_add_pollfd(GPollFD *pollfd, int timeout,
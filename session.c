@@ -55,12 +55,104 @@ struct source {
 struct datafeed_callback {
 	sr_datafeed_callback_t cb;
 	void *cb_data;
+	/* Packet types the callback takes as they are, SR_DF_NATIVE_*. */
+	int native;
+	/* Sums up the data for the callback, if it asked for that. */
+	struct sr_decimator *decimator;
+	/* Subscription: packet types (SR_DF_MASK), devices and probes the
+	 * callback wants, all if 0 or NULL. */
+	uint32_t types;
+	GSList *devs;
+	GSList *probes;
+	/* Removed while a packet was being dispatched to it. */
+	gboolean removed;
 };
 
+/* Number of packet types, SR_DF_HEADER and up. */
+#define DF_NUM_TYPES (SR_DF_ANALOG_SUMMARY - SR_DF_HEADER + 1)
+
+/*
+ * The callbacks a device's packets go to, by packet type, as
+ * NULL-terminated arrays. This saves going through the subscriptions
+ * of every callback for every packet.
+ */
+struct dispatch {
+	struct datafeed_callback **cbs[DF_NUM_TYPES];
+	/* Callbacks which get SR_DF_LOGIC_RLE, SR_DF_ANALOG_RAW converted. */
+	struct datafeed_callback **convert_rle;
+	struct datafeed_callback **convert_raw;
+};
+
+/* Where a device's stream is at, see sr_session_dev_timebase(). */
+struct stream {
+	const struct sr_dev_inst *sdi;
+	uint64_t logic_samples;
+	uint64_t analog_samples;
+	uint64_t samplerate;
+	gboolean started;
+	/* Host monotonic time of the first sample, in microseconds. */
+	int64_t first_sample_time;
+};
+
+/* Number of samples per SR_DF_LOGIC packet when expanding RLE packets. */
+#define RLE_EXPAND_CHUNK_SAMPLES (64 * 1024)
+
+/* Number of floats per SR_DF_ANALOG packet when converting raw packets. */
+#define RAW_CONVERT_CHUNK_VALUES (16 * 1024)
+
 /* There can only be one session at a time. */
 /* 'session' is not static, it's used elsewhere (via 'extern'). */
 struct sr_session *session;
 
+static void dispatch_free(struct dispatch *d)
+{
+	int i;
+
+	for (i = 0; i < DF_NUM_TYPES; i++)
+		g_free(d->cbs[i]);
+	g_free(d->convert_rle);
+	g_free(d->convert_raw);
+	g_free(d);
+}
+
+/*
+ * Callbacks or devices changed, work out where packets go anew. While a
+ * packet is being dispatched, this is put off until it's done, so the
+ * callback arrays being walked stay around.
+ */
+static void dispatch_invalidate(void)
+{
+	if (session->dispatching) {
+		session->dispatch_dirty = TRUE;
+		return;
+	}
+
+	session->dispatch_dirty = FALSE;
+	if (session->dispatch)
+		g_hash_table_remove_all(session->dispatch);
+}
+
+static struct stream *stream_get(const struct sr_dev_inst *sdi)
+{
+	struct stream *st;
+	GSList *l;
+
+	for (l = session->streams; l; l = l->next) {
+		st = l->data;
+		if (st->sdi == sdi)
+			return st;
+	}
+
+	if (!(st = g_try_malloc0(sizeof(struct stream)))) {
+		sr_err("%s: stream malloc failed", __func__);
+		return NULL;
+	}
+	st->sdi = sdi;
+	session->streams = g_slist_prepend(session->streams, st);
+
+	return st;
+}
+
 /**
  * Create a new session.
  *
@@ -100,6 +192,10 @@ SR_API int sr_session_destroy(void)
 	}
 
 	sr_session_dev_remove_all();
+	g_slist_free_full(session->streams, g_free);
+	sr_session_datafeed_callback_remove_all();
+	if (session->dispatch)
+		g_hash_table_destroy(session->dispatch);
 
 	/* TODO: Error checks needed? */
 
@@ -129,6 +225,8 @@ SR_API int sr_session_dev_remove_all(void)
 
 	g_slist_free(session->devs);
 	session->devs = NULL;
+	sr_session_merge_free_all();
+	dispatch_invalidate();
 
 	return SR_OK;
 }
@@ -164,6 +262,7 @@ SR_API int sr_session_dev_add(const struct sr_dev_inst *sdi)
 		       "a virtual device; continuing", __func__);
 		/* Just add the device, don't run dev_open(). */
 		session->devs = g_slist_append(session->devs, (gpointer)sdi);
+		dispatch_invalidate();
 		return SR_OK;
 	}
 
@@ -174,6 +273,7 @@ SR_API int sr_session_dev_add(const struct sr_dev_inst *sdi)
 	}
 
 	session->devs = g_slist_append(session->devs, (gpointer)sdi);
+	dispatch_invalidate();
 
 	if (session->running) {
 		/* Adding a device to a running session. Start acquisition
@@ -213,6 +313,122 @@ SR_API int sr_session_dev_list(GSList **devlist)
 	return SR_OK;
 }
 
+static void datafeed_callback_free(struct datafeed_callback *cb_struct)
+{
+	if (cb_struct->decimator)
+		sr_decimator_free(cb_struct->decimator);
+	g_slist_free(cb_struct->devs);
+	g_slist_free(cb_struct->probes);
+	g_free(cb_struct);
+}
+
+/* Whether a subscription covers a device at all. */
+static gboolean subscribed_dev(const struct datafeed_callback *cb_struct,
+		const struct sr_dev_inst *sdi)
+{
+	GSList *l;
+
+	if (cb_struct->devs && !g_slist_find(cb_struct->devs, sdi))
+		return FALSE;
+
+	if (!cb_struct->probes)
+		return TRUE;
+	for (l = cb_struct->probes; l; l = l->next) {
+		if (g_slist_find(sdi->probes, l->data))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Whether a callback takes a packet type, as it's passed to the callback. */
+static gboolean subscribed_type(const struct datafeed_callback *cb_struct,
+		int type)
+{
+	uint32_t types;
+
+	if (!(types = cb_struct->types))
+		return TRUE;
+
+	if (cb_struct->decimator) {
+		/* The decimator turns these into what the callback gets. */
+		if (type == SR_DF_LOGIC)
+			type = SR_DF_LOGIC_SUMMARY;
+		else if (type == SR_DF_ANALOG)
+			type = SR_DF_ANALOG_SUMMARY;
+		/* It resets or flushes on these, and filters them itself. */
+		else if (type == SR_DF_HEADER || type == SR_DF_META
+				|| type == SR_DF_END || type == SR_DF_TRIGGER
+				|| type == SR_DF_FRAME_BEGIN
+				|| type == SR_DF_FRAME_END)
+			return TRUE;
+	}
+
+	return (types & SR_DF_MASK(type)) != 0;
+}
+
+static struct datafeed_callback **dispatch_list(GPtrArray *cbs)
+{
+	g_ptr_array_add(cbs, NULL);
+
+	return (struct datafeed_callback **)g_ptr_array_free(cbs, FALSE);
+}
+
+/* Work out which callbacks a device's packets go to. */
+static struct dispatch *dispatch_get(const struct sr_dev_inst *sdi)
+{
+	struct datafeed_callback *cb_struct;
+	struct dispatch *d;
+	GPtrArray *cbs[DF_NUM_TYPES], *convert_rle, *convert_raw;
+	GSList *l;
+	int type, i;
+
+	if (!session->dispatch)
+		session->dispatch = g_hash_table_new_full(g_direct_hash,
+				g_direct_equal, NULL, (GDestroyNotify)dispatch_free);
+	else if ((d = g_hash_table_lookup(session->dispatch, sdi)))
+		return d;
+
+	if (!(d = g_try_malloc0(sizeof(struct dispatch)))) {
+		sr_err("%s: dispatch malloc failed", __func__);
+		return NULL;
+	}
+
+	for (i = 0; i < DF_NUM_TYPES; i++)
+		cbs[i] = g_ptr_array_new();
+	convert_rle = g_ptr_array_new();
+	convert_raw = g_ptr_array_new();
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (!subscribed_dev(cb_struct, sdi))
+			continue;
+		for (i = 0; i < DF_NUM_TYPES; i++) {
+			type = SR_DF_HEADER + i;
+			if (type == SR_DF_LOGIC_RLE &&
+			    !(cb_struct->native & SR_DF_NATIVE_LOGIC_RLE)) {
+				if (subscribed_type(cb_struct, SR_DF_LOGIC))
+					g_ptr_array_add(convert_rle, cb_struct);
+			} else if (type == SR_DF_ANALOG_RAW &&
+			    !(cb_struct->native & SR_DF_NATIVE_ANALOG_RAW)) {
+				if (subscribed_type(cb_struct, SR_DF_ANALOG))
+					g_ptr_array_add(convert_raw, cb_struct);
+			} else if (subscribed_type(cb_struct, type)) {
+				g_ptr_array_add(cbs[i], cb_struct);
+			}
+		}
+	}
+
+	for (i = 0; i < DF_NUM_TYPES; i++)
+		d->cbs[i] = dispatch_list(cbs[i]);
+	d->convert_rle = dispatch_list(convert_rle);
+	d->convert_raw = dispatch_list(convert_raw);
+
+	g_hash_table_insert(session->dispatch, (gpointer)sdi, d);
+
+	return d;
+}
+
 /**
  * Remove all datafeed callbacks in the current session.
  *
@@ -221,13 +437,60 @@ SR_API int sr_session_dev_list(GSList **devlist)
  */
 SR_API int sr_session_datafeed_callback_remove_all(void)
 {
+	GSList *l;
+
 	if (!session) {
 		sr_err("%s: session was NULL", __func__);
 		return SR_ERR_BUG;
 	}
 
-	g_slist_free_full(session->datafeed_callbacks, g_free);
+	/* A packet may still be on its way to them, see sr_session_send(). */
+	if (session->dispatching) {
+		for (l = session->datafeed_callbacks; l; l = l->next)
+			((struct datafeed_callback *)l->data)->removed = TRUE;
+		session->dead_callbacks = g_slist_concat(
+				session->dead_callbacks,
+				session->datafeed_callbacks);
+	} else {
+		g_slist_free_full(session->datafeed_callbacks,
+				(GDestroyNotify)datafeed_callback_free);
+	}
 	session->datafeed_callbacks = NULL;
+	dispatch_invalidate();
+
+	return SR_OK;
+}
+
+static int _sr_session_datafeed_callback_add(sr_datafeed_callback_t cb,
+		void *cb_data, int native, uint64_t decimate_rate)
+{
+	struct datafeed_callback *cb_struct;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (!cb) {
+		sr_err("%s: cb was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!(cb_struct = g_try_malloc0(sizeof(struct datafeed_callback))))
+		return SR_ERR_MALLOC;
+
+	cb_struct->cb = cb;
+	cb_struct->cb_data = cb_data;
+	cb_struct->native = native;
+	if (decimate_rate && !(cb_struct->decimator = sr_decimator_new(cb,
+			cb_data, decimate_rate))) {
+		g_free(cb_struct);
+		return SR_ERR_MALLOC;
+	}
+
+	session->datafeed_callbacks =
+	    g_slist_append(session->datafeed_callbacks, cb_struct);
+	dispatch_invalidate();
 
 	return SR_OK;
 }
@@ -235,6 +498,9 @@ SR_API int sr_session_datafeed_callback_remove_all(void)
 /**
  * Add a datafeed callback to the current session.
  *
+ * SR_DF_LOGIC_RLE packets are expanded and passed to this callback as
+ * regular SR_DF_LOGIC packets.
+ *
  * @param cb Function to call when a chunk of data is received.
  *           Must not be NULL.
  * @param cb_data Opaque pointer passed in by the caller.
@@ -243,27 +509,285 @@ SR_API int sr_session_datafeed_callback_remove_all(void)
  * @retval SR_ERR_BUG No session exists.
  */
 SR_API int sr_session_datafeed_callback_add(sr_datafeed_callback_t cb, void *cb_data)
+{
+	return _sr_session_datafeed_callback_add(cb, cb_data, 0, 0);
+}
+
+/**
+ * Add a datafeed callback which handles run-length encoded logic data.
+ *
+ * Unlike with sr_session_datafeed_callback_add(), SR_DF_LOGIC_RLE packets
+ * are passed to this callback as they are.
+ *
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ */
+SR_API int sr_session_datafeed_callback_rle_add(sr_datafeed_callback_t cb,
+		void *cb_data)
+{
+	return _sr_session_datafeed_callback_add(cb, cb_data,
+			SR_DF_NATIVE_LOGIC_RLE, 0);
+}
+
+/**
+ * Add a datafeed callback which handles packets in their native encoding.
+ *
+ * Packets of the types selected in <code>native</code> are passed to this
+ * callback as they are. Other compact packet types are converted, as with
+ * sr_session_datafeed_callback_add().
+ *
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ * @param native Bitmask of SR_DF_NATIVE_LOGIC_RLE, SR_DF_NATIVE_ANALOG_RAW.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ */
+SR_API int sr_session_datafeed_callback_native_add(sr_datafeed_callback_t cb,
+		void *cb_data, int native)
+{
+	return _sr_session_datafeed_callback_add(cb, cb_data, native, 0);
+}
+
+/**
+ * Add a datafeed callback which only needs a summary of the data, such as
+ * a live display.
+ *
+ * Instead of every sample, this callback receives buckets of consecutive
+ * samples summed up: SR_DF_LOGIC_SUMMARY packets with the last value and
+ * the bits which changed in each bucket, and SR_DF_ANALOG_SUMMARY packets
+ * with the smallest, largest and mean value in each bucket. Buckets are
+ * sized to give about <code>rate</code> of them per second of samples,
+ * going by the device's samplerate. Streams of unknown samplerate aren't
+ * decimated, but are still passed on in summary packets. All other
+ * packets are passed on as they are.
+ *
+ * Other callbacks still receive every sample.
+ *
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ * @param rate Number of buckets per second of samples. Must not be 0.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ * @retval SR_ERR_BUG No session exists.
+ */
+SR_API int sr_session_datafeed_callback_decimate_add(sr_datafeed_callback_t cb,
+		void *cb_data, uint64_t rate)
+{
+	if (!rate) {
+		sr_err("%s: rate was 0", __func__);
+		return SR_ERR_ARG;
+	}
+
+	return _sr_session_datafeed_callback_add(cb, cb_data, 0, rate);
+}
+
+/**
+ * Narrow down the packets a datafeed callback receives.
+ *
+ * Packets the callback is not interested in are not passed to it at all,
+ * which saves a call per packet, and the callback having to sort them out.
+ * Each new subscription replaces the callback's previous one.
+ *
+ * @param cb The callback, as added before. Must not be NULL.
+ * @param cb_data The opaque pointer it was added with.
+ * @param types Mask of the packet types to pass to the callback, such as
+ *              SR_DF_MASK(SR_DF_ANALOG) | SR_DF_MASK(SR_DF_END), or 0 for
+ *              all of them. These are the types as the callback gets them,
+ *              e.g. SR_DF_LOGIC rather than SR_DF_LOGIC_RLE for callbacks
+ *              which get those expanded.
+ * @param devs List of struct sr_dev_inst whose packets to pass to the
+ *             callback, or NULL for all devices.
+ * @param probes List of struct sr_probe. If not NULL, only packets from
+ *               devices with any of these probes are passed to the
+ *               callback, and analog packets only if they carry data of
+ *               any of these probes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG The callback has not been added.
+ * @retval SR_ERR_BUG No session exists.
+ */
+SR_API int sr_session_datafeed_callback_subscribe(sr_datafeed_callback_t cb,
+		void *cb_data, uint32_t types, GSList *devs, GSList *probes)
 {
 	struct datafeed_callback *cb_struct;
+	GSList *l;
 
 	if (!session) {
 		sr_err("%s: session was NULL", __func__);
 		return SR_ERR_BUG;
 	}
 
-	if (!cb) {
-		sr_err("%s: cb was NULL", __func__);
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->cb == cb && cb_struct->cb_data == cb_data)
+			break;
+	}
+	if (!l) {
+		sr_err("%s: callback was not added", __func__);
 		return SR_ERR_ARG;
 	}
 
-	if (!(cb_struct = g_try_malloc0(sizeof(struct datafeed_callback))))
-		return SR_ERR_MALLOC;
+	g_slist_free(cb_struct->devs);
+	g_slist_free(cb_struct->probes);
+	cb_struct->types = types;
+	cb_struct->devs = g_slist_copy(devs);
+	cb_struct->probes = g_slist_copy(probes);
+	dispatch_invalidate();
 
-	cb_struct->cb = cb;
-	cb_struct->cb_data = cb_data;
+	return SR_OK;
+}
 
-	session->datafeed_callbacks =
-	    g_slist_append(session->datafeed_callbacks, cb_struct);
+/* Whether an analog packet carries data of a subscribed probe. */
+static gboolean subscribed_probes(const struct datafeed_callback *cb_struct,
+		const struct sr_datafeed_packet *packet)
+{
+	GSList *probes, *l;
+
+	if (packet->type == SR_DF_ANALOG)
+		probes = ((const struct sr_datafeed_analog *)packet->payload)->probes;
+	else if (packet->type == SR_DF_ANALOG_RAW)
+		probes = ((const struct sr_datafeed_analog_raw *)packet->payload)->probes;
+	else
+		return TRUE;
+
+	for (l = cb_struct->probes; l; l = l->next) {
+		if (g_slist_find(probes, l->data))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Pass a packet to a callback, through its decimator if it has one. */
+static void datafeed_callback_call(struct datafeed_callback *cb_struct,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	if (cb_struct->removed)
+		return;
+
+	if (cb_struct->probes && !subscribed_probes(cb_struct, packet))
+		return;
+
+	if (cb_struct->decimator)
+		sr_decimator_send(cb_struct->decimator, sdi, packet,
+				cb_struct->types);
+	else
+		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+}
+
+/**
+ * Expand (part of) a run-length encoded logic packet.
+ *
+ * The position within the packet is kept in <code>run</code> and
+ * <code>offset</code>, both of which should be 0 on the first call.
+ * Repeated calls continue where the previous one left off, so a packet
+ * can be expanded piecewise into a buffer smaller than its full length.
+ *
+ * @param rle The packet payload. Must not be NULL.
+ * @param run Index of the run to continue from. Must not be NULL.
+ * @param offset Number of samples of that run already expanded.
+ *               Must not be NULL.
+ * @param buf Buffer of at least max_samples * rle->unitsize bytes.
+ * @param max_samples Maximum number of samples to store in buf.
+ *
+ * @return The number of samples stored in buf, 0 once the whole packet
+ *         has been expanded.
+ */
+SR_API uint64_t sr_datafeed_logic_rle_expand(
+		const struct sr_datafeed_logic_rle *rle, uint64_t *run,
+		uint64_t *offset, void *buf, uint64_t max_samples)
+{
+	const uint8_t *value;
+	uint8_t *dst;
+	uint64_t done, num, filled, total, n;
+
+	dst = buf;
+	done = 0;
+	while (*run < rle->num_runs && done < max_samples) {
+		num = MIN(rle->lengths[*run] - *offset, max_samples - done);
+		if (num > 0) {
+			/* Copy the value once, then keep doubling it. */
+			value = (const uint8_t *)rle->values + *run * rle->unitsize;
+			memcpy(dst, value, rle->unitsize);
+			total = num * rle->unitsize;
+			for (filled = rle->unitsize; filled < total; filled += n) {
+				n = MIN(filled, total - filled);
+				memcpy(dst + filled, dst, n);
+			}
+			dst += total;
+			done += num;
+			*offset += num;
+		}
+		if (*offset == rle->lengths[*run]) {
+			(*run)++;
+			*offset = 0;
+		}
+	}
+
+	return done;
+}
+
+#define RAW_CONVERT(type) do { \
+	const type *src = (const type *)raw->data + first * num_probes; \
+	for (i = 0; i < num_samples; i++) \
+		for (p = 0; p < num_probes; p++) \
+			*buf++ = *src++ * raw->scale[p] + raw->offset[p]; \
+} while (0)
+
+/**
+ * Convert (part of) a raw analog packet to floating point values.
+ *
+ * @param raw The packet payload. Must not be NULL.
+ * @param first Index of the first sample to convert.
+ * @param num_samples Number of samples to convert, per probe.
+ * @param buf Buffer of at least num_samples times the number of probes
+ *            floats. The values are interleaved as in raw->data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments or unknown sample encoding.
+ */
+SR_API int sr_datafeed_analog_raw_convert(
+		const struct sr_datafeed_analog_raw *raw, int first,
+		int num_samples, float *buf)
+{
+	int num_probes, i, p;
+
+	if (!raw || !buf || first < 0 || num_samples < 0 ||
+	    first + num_samples > raw->num_samples)
+		return SR_ERR_ARG;
+
+	num_probes = g_slist_length(raw->probes);
+
+	switch (raw->encoding) {
+	case SR_ANALOG_RAW_UINT8:
+		RAW_CONVERT(uint8_t);
+		break;
+	case SR_ANALOG_RAW_INT8:
+		RAW_CONVERT(int8_t);
+		break;
+	case SR_ANALOG_RAW_UINT16:
+		RAW_CONVERT(uint16_t);
+		break;
+	case SR_ANALOG_RAW_INT16:
+		RAW_CONVERT(int16_t);
+		break;
+	case SR_ANALOG_RAW_INT32:
+		RAW_CONVERT(int32_t);
+		break;
+	default:
+		sr_err("Unknown raw analog encoding %d.", raw->encoding);
+		return SR_ERR_ARG;
+	}
 
 	return SR_OK;
 }
@@ -328,13 +852,22 @@ static int sr_session_iteration(gboolean block)
  *
  * There can only be one session at a time.
  *
+ * The devices are started back to back, in the order they were added, and
+ * before any of their data is pumped by sr_session_run(). There is no
+ * hardware synchronisation between them: their streams are only lined up
+ * on the host, see sr_session_dev_timebase(). If a device fails to start,
+ * the ones already started are stopped again.
+ *
  * @retval SR_OK Success.
- * @retval SR_ERR Error occured.
+ * @retval SR_ERR_BUG No session exists, or it has no devices.
+ * @retval other The error returned by the device that failed to start.
  */
 SR_API int sr_session_start(void)
 {
 	struct sr_dev_inst *sdi;
-	GSList *l;
+	struct stream *st;
+	GVariant *gvar;
+	GSList *l, *m;
 	int ret;
 
 	if (!session) {
@@ -351,6 +884,25 @@ SR_API int sr_session_start(void)
 
 	sr_info("Starting.");
 
+	/* Device instances may have come and gone since the last run. */
+	dispatch_invalidate();
+
+	/*
+	 * Get the samplerates for the stream timebases now, rather than from
+	 * within the datafeed. A SR_DF_META samplerate still overrides them.
+	 */
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		if (!(st = stream_get(sdi)))
+			return SR_ERR_MALLOC;
+		st->samplerate = 0;
+		if (sr_config_get(sdi->driver, sdi, NULL, SR_CONF_SAMPLERATE,
+				&gvar) == SR_OK) {
+			st->samplerate = g_variant_get_uint64(gvar);
+			g_variant_unref(gvar);
+		}
+	}
+
 	ret = SR_OK;
 	for (l = session->devs; l; l = l->next) {
 		sdi = l->data;
@@ -361,7 +913,12 @@ SR_API int sr_session_start(void)
 		}
 	}
 
-	/* TODO: What if there are multiple devices? Which return code? */
+	if (ret != SR_OK) {
+		for (m = session->devs; m != l; m = m->next) {
+			sdi = m->data;
+			sdi->driver->dev_acquisition_stop(sdi, sdi);
+		}
+	}
 
 	return ret;
 }
@@ -478,7 +1035,9 @@ SR_API int sr_session_stop(void)
 static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *logic_rle;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_analog_raw *analog_raw;
 
 	switch (packet->type) {
 	case SR_DF_HEADER:
@@ -509,12 +1068,200 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 	case SR_DF_FRAME_END:
 		sr_dbg("bus: Received SR_DF_FRAME_END packet.");
 		break;
+	case SR_DF_LOGIC_RLE:
+		logic_rle = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " runs).",
+		       logic_rle->num_runs);
+		break;
+	case SR_DF_ANALOG_RAW:
+		analog_raw = packet->payload;
+		sr_dbg("bus: Received SR_DF_ANALOG_RAW packet (%d samples).",
+		       analog_raw->num_samples);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
 	}
 }
 
+/**
+ * Pass an SR_DF_LOGIC_RLE packet to the callbacks which can't handle it,
+ * as a series of SR_DF_LOGIC packets.
+ *
+ * @param sdi The device instance that generated the packet.
+ * @param rle The payload of the packet.
+ * @param sample_offset The sample offset of the packet.
+ * @param cbs The callbacks, NULL-terminated.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ */
+static int send_rle_expanded(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_logic_rle *rle, uint64_t sample_offset,
+		struct datafeed_callback **cbs)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct datafeed_callback **cb_struct;
+	uint64_t run, offset, num_samples;
+	uint8_t *buf;
+
+	if (!(buf = g_try_malloc(RLE_EXPAND_CHUNK_SAMPLES * rle->unitsize))) {
+		sr_err("%s: buf malloc failed", __func__);
+		return SR_ERR_MALLOC;
+	}
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	packet.sample_offset = sample_offset;
+	logic.unitsize = rle->unitsize;
+	logic.data = buf;
+
+	run = offset = 0;
+	while ((num_samples = sr_datafeed_logic_rle_expand(rle, &run, &offset,
+			buf, RLE_EXPAND_CHUNK_SAMPLES)) > 0) {
+		logic.length = num_samples * rle->unitsize;
+		for (cb_struct = cbs; *cb_struct; cb_struct++)
+			datafeed_callback_call(*cb_struct, sdi, &packet);
+		packet.sample_offset += num_samples;
+	}
+
+	g_free(buf);
+
+	return SR_OK;
+}
+
+/**
+ * Pass an SR_DF_ANALOG_RAW packet to the callbacks which can't handle it,
+ * as a series of SR_DF_ANALOG packets.
+ *
+ * @param sdi The device instance that generated the packet.
+ * @param raw The payload of the packet.
+ * @param sample_offset The sample offset of the packet.
+ * @param cbs The callbacks, NULL-terminated.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid packet.
+ * @retval SR_ERR_MALLOC Memory allocation error.
+ */
+static int send_raw_converted(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_analog_raw *raw, uint64_t sample_offset,
+		struct datafeed_callback **cbs)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct datafeed_callback **cb_struct;
+	int num_probes, chunk, first, ret;
+	float *buf;
+
+	if ((num_probes = g_slist_length(raw->probes)) == 0)
+		return SR_ERR_ARG;
+	chunk = MAX(RAW_CONVERT_CHUNK_VALUES / num_probes, 1);
+
+	if (!(buf = g_try_malloc(chunk * num_probes * sizeof(float)))) {
+		sr_err("%s: buf malloc failed", __func__);
+		return SR_ERR_MALLOC;
+	}
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	analog.probes = raw->probes;
+	analog.mq = raw->mq;
+	analog.unit = raw->unit;
+	analog.mqflags = raw->mqflags;
+	analog.data = buf;
+	analog.timestamps = NULL;
+
+	ret = SR_OK;
+	for (first = 0; first < raw->num_samples; first += chunk) {
+		analog.num_samples = MIN(chunk, raw->num_samples - first);
+		if ((ret = sr_datafeed_analog_raw_convert(raw, first,
+				analog.num_samples, buf)) != SR_OK)
+			break;
+		packet.sample_offset = sample_offset + first;
+		for (cb_struct = cbs; *cb_struct; cb_struct++)
+			datafeed_callback_call(*cb_struct, sdi, &packet);
+	}
+
+	g_free(buf);
+
+	return ret;
+}
+
+/*
+ * The first samples of a stream arrived. They were taken some time before
+ * that, so go back by as much as they span, if the samplerate is known.
+ */
+static void stream_start(struct stream *st, uint64_t num_samples)
+{
+	int64_t span;
+
+	span = st->samplerate ? num_samples * G_USEC_PER_SEC / st->samplerate : 0;
+	st->first_sample_time = g_get_monotonic_time() - span;
+	st->started = TRUE;
+}
+
+/* Account for a packet in its device's stream, return its sample offset. */
+static uint64_t stream_update(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *logic_rle;
+	struct sr_config *src;
+	struct stream *st;
+	GSList *l;
+	uint64_t *count, num, offset, i;
+
+	if (!(st = stream_get(sdi)))
+		return 0;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		/* The samplerate is kept, see sr_session_start(). */
+		st->logic_samples = st->analog_samples = 0;
+		st->started = FALSE;
+		return 0;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				st->samplerate = g_variant_get_uint64(src->data);
+		}
+		return 0;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		num = logic->unitsize ? logic->length / logic->unitsize : 0;
+		count = &st->logic_samples;
+		break;
+	case SR_DF_LOGIC_RLE:
+		logic_rle = packet->payload;
+		for (num = i = 0; i < logic_rle->num_runs; i++)
+			num += logic_rle->lengths[i];
+		count = &st->logic_samples;
+		break;
+	case SR_DF_ANALOG:
+		num = ((const struct sr_datafeed_analog *)packet->payload)->num_samples;
+		count = &st->analog_samples;
+		break;
+	case SR_DF_ANALOG_RAW:
+		num = ((const struct sr_datafeed_analog_raw *)packet->payload)->num_samples;
+		count = &st->analog_samples;
+		break;
+	default:
+		/* Triggers and such: where the logic stream is at. */
+		return st->logic_samples;
+	}
+
+	if (!st->started && num > 0)
+		stream_start(st, num);
+	offset = *count;
+	*count += num;
+
+	return offset;
+}
+
 /**
  * Send a packet to whatever is listening on the datafeed bus.
  *
@@ -531,8 +1278,10 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 			    const struct sr_datafeed_packet *packet)
 {
-	GSList *l;
-	struct datafeed_callback *cb_struct;
+	struct datafeed_callback **cb_struct;
+	struct dispatch *d;
+	struct sr_datafeed_packet p;
+	int ret;
 
 	if (!sdi) {
 		sr_err("%s: sdi was NULL", __func__);
@@ -544,14 +1293,105 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_ARG;
 	}
 
-	for (l = session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
-		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+	/* Drivers don't fill in the sample offset, so work on a copy. */
+	p.type = packet->type;
+	p.payload = packet->payload;
+	p.sample_offset = stream_update(sdi, packet);
+	packet = &p;
+
+	/* Logic data of merged devices comes out of the merged device. */
+	if (session->merges && sr_session_merge_send(sdi, packet))
+		return SR_OK;
+
+	if (sr_log_loglevel_get() >= SR_LOG_DBG)
+		datafeed_dump(packet);
+
+	if (packet->type < SR_DF_HEADER ||
+			packet->type >= SR_DF_HEADER + DF_NUM_TYPES) {
+		sr_err("%s: unknown packet type %d", __func__, packet->type);
+		return SR_ERR_ARG;
 	}
 
-	return SR_OK;
+	if (!(d = dispatch_get(sdi)))
+		return SR_ERR_MALLOC;
+
+	/*
+	 * Callbacks may add or remove callbacks, or devices, along the way.
+	 * That only takes effect once the outermost send is done.
+	 */
+	session->dispatching++;
+
+	for (cb_struct = d->cbs[packet->type - SR_DF_HEADER]; *cb_struct;
+			cb_struct++)
+		datafeed_callback_call(*cb_struct, sdi, packet);
+
+	ret = SR_OK;
+	if (packet->type == SR_DF_LOGIC_RLE && *d->convert_rle)
+		ret = send_rle_expanded(sdi, packet->payload,
+				packet->sample_offset, d->convert_rle);
+	else if (packet->type == SR_DF_ANALOG_RAW && *d->convert_raw)
+		ret = send_raw_converted(sdi, packet->payload,
+				packet->sample_offset, d->convert_raw);
+
+	if (--session->dispatching == 0) {
+		if (session->dispatch_dirty)
+			dispatch_invalidate();
+		g_slist_free_full(session->dead_callbacks,
+				(GDestroyNotify)datafeed_callback_free);
+		session->dead_callbacks = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * Get the timebase of a device's stream in the current session.
+ *
+ * This relates the sample offsets of a device's packets to host time, so
+ * the streams of several devices acquiring at once can be lined up. The
+ * time of the first sample is estimated from when the first samples
+ * arrived, less the time they span. It is therefore only as accurate as
+ * the device's latency is constant.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param first_sample_time Host time the first sample was taken at, in
+ *                          microseconds on the g_get_monotonic_time() clock.
+ *                          Can be NULL.
+ * @param samplerate The samplerate of the stream, 0 if unknown. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The device has not sent any samples yet.
+ * @retval SR_ERR_BUG No session exists.
+ */
+SR_API int sr_session_dev_timebase(const struct sr_dev_inst *sdi,
+		int64_t *first_sample_time, uint64_t *samplerate)
+{
+	struct stream *st;
+	GSList *l;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (!sdi) {
+		sr_err("%s: sdi was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	for (l = session->streams; l; l = l->next) {
+		st = l->data;
+		if (st->sdi != sdi || !st->started)
+			continue;
+		if (first_sample_time)
+			*first_sample_time = st->first_sample_time;
+		if (samplerate)
+			*samplerate = st->samplerate;
+		return SR_OK;
+	}
+
+	return SR_ERR_NA;
 }
 
 /**
@@ -0,0 +1,482 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <float.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "session-decimate"
+
+/**
+ * @file
+ *
+ * Decimating the datafeed for callbacks which don't need every sample.
+ */
+
+/* Where a decimating callback is at in one device's streams. */
+struct decimate_stream {
+	const struct sr_dev_inst *sdi;
+	/* Samples per bucket, 0 until the first data packet. */
+	uint64_t bucket_samples;
+
+	/* Logic: the bucket being filled. */
+	uint16_t unitsize;
+	uint64_t logic_start;
+	uint64_t logic_count;
+	gboolean have_prev;
+	uint8_t *prev;
+	uint8_t *edges;
+
+	/* Analog: the bucket being filled. */
+	GSList *probes;
+	int num_probes;
+	int mq;
+	int unit;
+	uint64_t mqflags;
+	uint64_t analog_start;
+	uint64_t analog_count;
+	float *min;
+	float *max;
+	double *sum;
+};
+
+struct sr_decimator {
+	sr_datafeed_callback_t cb;
+	void *cb_data;
+	/* Buckets per second the callback wants. */
+	uint64_t rate;
+	GSList *streams;
+};
+
+static void stream_logic_reset(struct decimate_stream *ds)
+{
+	g_free(ds->prev);
+	g_free(ds->edges);
+	ds->prev = ds->edges = NULL;
+	ds->unitsize = 0;
+	ds->logic_count = 0;
+	ds->have_prev = FALSE;
+}
+
+static void stream_analog_reset(struct decimate_stream *ds)
+{
+	g_slist_free(ds->probes);
+	g_free(ds->min);
+	g_free(ds->max);
+	g_free(ds->sum);
+	ds->probes = NULL;
+	ds->min = ds->max = NULL;
+	ds->sum = NULL;
+	ds->num_probes = 0;
+	ds->analog_count = 0;
+}
+
+static void stream_free(struct decimate_stream *ds)
+{
+	stream_logic_reset(ds);
+	stream_analog_reset(ds);
+	g_free(ds);
+}
+
+static struct decimate_stream *stream_get(struct sr_decimator *dec,
+		const struct sr_dev_inst *sdi)
+{
+	struct decimate_stream *ds;
+	GSList *l;
+
+	for (l = dec->streams; l; l = l->next) {
+		ds = l->data;
+		if (ds->sdi == sdi)
+			return ds;
+	}
+
+	if (!(ds = g_try_malloc0(sizeof(struct decimate_stream)))) {
+		sr_err("%s: stream malloc failed", __func__);
+		return NULL;
+	}
+	ds->sdi = sdi;
+	dec->streams = g_slist_prepend(dec->streams, ds);
+
+	return ds;
+}
+
+static void send_summary(struct sr_decimator *dec,
+		const struct sr_dev_inst *sdi, int type, const void *payload,
+		uint64_t sample_offset)
+{
+	struct sr_datafeed_packet packet;
+
+	packet.type = type;
+	packet.payload = payload;
+	packet.sample_offset = sample_offset;
+	dec->cb(sdi, &packet, dec->cb_data);
+}
+
+/* Work out the bucket size from the stream's samplerate, once known. */
+static void stream_bucket_init(struct sr_decimator *dec,
+		struct decimate_stream *ds)
+{
+	uint64_t samplerate;
+
+	if (ds->bucket_samples)
+		return;
+
+	if (sr_session_dev_timebase(ds->sdi, NULL, &samplerate) != SR_OK)
+		samplerate = 0;
+	ds->bucket_samples = MAX(samplerate / dec->rate, 1);
+	sr_dbg("Decimating by %" PRIu64 ".", ds->bucket_samples);
+}
+
+/* Send the logic bucket being filled, however full it is. */
+static void logic_flush(struct sr_decimator *dec, struct decimate_stream *ds)
+{
+	struct sr_datafeed_logic_summary summary;
+
+	if (!ds->logic_count)
+		return;
+
+	summary.num_buckets = 1;
+	summary.bucket_samples = ds->logic_count;
+	summary.unitsize = ds->unitsize;
+	summary.last = ds->prev;
+	summary.edges = ds->edges;
+	send_summary(dec, ds->sdi, SR_DF_LOGIC_SUMMARY, &summary,
+			ds->logic_start);
+
+	ds->logic_start += ds->logic_count;
+	ds->logic_count = 0;
+	memset(ds->edges, 0, ds->unitsize);
+}
+
+static int logic_decimate(struct sr_decimator *dec, struct decimate_stream *ds,
+		const struct sr_datafeed_logic *logic, uint64_t sample_offset)
+{
+	struct sr_datafeed_logic_summary summary;
+	const uint8_t *src;
+	uint8_t *last, *edges;
+	uint64_t num_samples, max_buckets, s, n;
+	unsigned int i;
+
+	if (!logic->unitsize)
+		return SR_OK;
+
+	if (logic->unitsize != ds->unitsize) {
+		stream_logic_reset(ds);
+		if (!(ds->prev = g_try_malloc0(logic->unitsize)) ||
+				!(ds->edges = g_try_malloc0(logic->unitsize))) {
+			sr_err("%s: bucket malloc failed", __func__);
+			stream_logic_reset(ds);
+			return SR_ERR_MALLOC;
+		}
+		ds->unitsize = logic->unitsize;
+	}
+	if (!ds->logic_count)
+		ds->logic_start = sample_offset;
+
+	num_samples = logic->length / logic->unitsize;
+	max_buckets = (ds->logic_count + num_samples) / ds->bucket_samples;
+	if (!(last = g_try_malloc(max_buckets * ds->unitsize + 1)) ||
+			!(edges = g_try_malloc(max_buckets * ds->unitsize + 1))) {
+		sr_err("%s: summary malloc failed", __func__);
+		g_free(last);
+		return SR_ERR_MALLOC;
+	}
+
+	src = logic->data;
+	n = 0;
+	for (s = 0; s < num_samples; s++) {
+		if (ds->have_prev) {
+			for (i = 0; i < ds->unitsize; i++)
+				ds->edges[i] |= src[i] ^ ds->prev[i];
+		}
+		memcpy(ds->prev, src, ds->unitsize);
+		ds->have_prev = TRUE;
+		src += ds->unitsize;
+
+		if (++ds->logic_count < ds->bucket_samples)
+			continue;
+		memcpy(last + n * ds->unitsize, ds->prev, ds->unitsize);
+		memcpy(edges + n * ds->unitsize, ds->edges, ds->unitsize);
+		memset(ds->edges, 0, ds->unitsize);
+		ds->logic_count = 0;
+		n++;
+	}
+
+	if (n > 0) {
+		summary.num_buckets = n;
+		summary.bucket_samples = ds->bucket_samples;
+		summary.unitsize = ds->unitsize;
+		summary.last = last;
+		summary.edges = edges;
+		send_summary(dec, ds->sdi, SR_DF_LOGIC_SUMMARY, &summary,
+				ds->logic_start);
+		ds->logic_start += n * ds->bucket_samples;
+	}
+
+	g_free(last);
+	g_free(edges);
+
+	return SR_OK;
+}
+
+static void analog_bucket_clear(struct decimate_stream *ds)
+{
+	int p;
+
+	for (p = 0; p < ds->num_probes; p++) {
+		ds->min[p] = FLT_MAX;
+		ds->max[p] = -FLT_MAX;
+		ds->sum[p] = 0;
+	}
+	ds->analog_count = 0;
+}
+
+/* Send the analog bucket being filled, however full it is. */
+static void analog_flush(struct sr_decimator *dec, struct decimate_stream *ds)
+{
+	struct sr_datafeed_analog_summary summary;
+	float mean[ds->num_probes + 1];
+	int p;
+
+	if (!ds->analog_count)
+		return;
+
+	for (p = 0; p < ds->num_probes; p++)
+		mean[p] = ds->sum[p] / ds->analog_count;
+
+	summary.probes = ds->probes;
+	summary.num_buckets = 1;
+	summary.bucket_samples = ds->analog_count;
+	summary.mq = ds->mq;
+	summary.unit = ds->unit;
+	summary.mqflags = ds->mqflags;
+	summary.min = ds->min;
+	summary.max = ds->max;
+	summary.mean = mean;
+	send_summary(dec, ds->sdi, SR_DF_ANALOG_SUMMARY, &summary,
+			ds->analog_start);
+
+	ds->analog_start += ds->analog_count;
+	analog_bucket_clear(ds);
+}
+
+/* Buckets can't span a change of probes or quantity. */
+static gboolean analog_same_format(const struct decimate_stream *ds,
+		const struct sr_datafeed_analog *analog)
+{
+	const GSList *a, *b;
+
+	if (analog->mq != ds->mq || analog->unit != ds->unit ||
+			analog->mqflags != ds->mqflags)
+		return FALSE;
+
+	for (a = ds->probes, b = analog->probes; a && b; a = a->next, b = b->next)
+		if (a->data != b->data)
+			return FALSE;
+
+	return !a && !b;
+}
+
+static int analog_decimate(struct sr_decimator *dec,
+		struct decimate_stream *ds, const struct sr_datafeed_analog *analog,
+		uint64_t sample_offset)
+{
+	struct sr_datafeed_analog_summary summary;
+	const float *src;
+	float *min, *max, *mean;
+	uint64_t max_buckets, n, b;
+	int num_probes, s, p;
+
+	if (!ds->probes || !analog_same_format(ds, analog)) {
+		analog_flush(dec, ds);
+		stream_analog_reset(ds);
+		num_probes = g_slist_length(analog->probes);
+		if (!num_probes)
+			return SR_OK;
+		ds->min = g_try_malloc(num_probes * sizeof(float));
+		ds->max = g_try_malloc(num_probes * sizeof(float));
+		ds->sum = g_try_malloc(num_probes * sizeof(double));
+		if (!ds->min || !ds->max || !ds->sum) {
+			sr_err("%s: bucket malloc failed", __func__);
+			stream_analog_reset(ds);
+			return SR_ERR_MALLOC;
+		}
+		ds->probes = g_slist_copy(analog->probes);
+		ds->num_probes = num_probes;
+		ds->mq = analog->mq;
+		ds->unit = analog->unit;
+		ds->mqflags = analog->mqflags;
+		analog_bucket_clear(ds);
+	}
+	if (!ds->analog_count)
+		ds->analog_start = sample_offset;
+
+	num_probes = ds->num_probes;
+	max_buckets = (ds->analog_count + analog->num_samples)
+			/ ds->bucket_samples;
+	b = max_buckets * num_probes + 1;
+	min = g_try_malloc(b * sizeof(float));
+	max = g_try_malloc(b * sizeof(float));
+	mean = g_try_malloc(b * sizeof(float));
+	if (!min || !max || !mean) {
+		sr_err("%s: summary malloc failed", __func__);
+		g_free(min);
+		g_free(max);
+		g_free(mean);
+		return SR_ERR_MALLOC;
+	}
+
+	src = analog->data;
+	n = 0;
+	for (s = 0; s < analog->num_samples; s++) {
+		for (p = 0; p < num_probes; p++, src++) {
+			ds->min[p] = MIN(ds->min[p], *src);
+			ds->max[p] = MAX(ds->max[p], *src);
+			ds->sum[p] += *src;
+		}
+
+		if (++ds->analog_count < ds->bucket_samples)
+			continue;
+		for (p = 0; p < num_probes; p++) {
+			min[n * num_probes + p] = ds->min[p];
+			max[n * num_probes + p] = ds->max[p];
+			mean[n * num_probes + p] = ds->sum[p] / ds->analog_count;
+		}
+		analog_bucket_clear(ds);
+		n++;
+	}
+
+	if (n > 0) {
+		summary.probes = ds->probes;
+		summary.num_buckets = n;
+		summary.bucket_samples = ds->bucket_samples;
+		summary.mq = ds->mq;
+		summary.unit = ds->unit;
+		summary.mqflags = ds->mqflags;
+		summary.min = min;
+		summary.max = max;
+		summary.mean = mean;
+		send_summary(dec, ds->sdi, SR_DF_ANALOG_SUMMARY, &summary,
+				ds->analog_start);
+		ds->analog_start += n * ds->bucket_samples;
+	}
+
+	g_free(min);
+	g_free(max);
+	g_free(mean);
+
+	return SR_OK;
+}
+
+/**
+ * Create a decimator, which passes packets on to a datafeed callback with
+ * the logic and analog data summed up in buckets.
+ *
+ * @param cb The callback. Must not be NULL.
+ * @param cb_data Opaque pointer passed to the callback.
+ * @param rate Number of buckets per second of samples. Must not be 0.
+ *
+ * @return The new decimator, or NULL upon errors.
+ *
+ * @private
+ */
+SR_PRIV struct sr_decimator *sr_decimator_new(sr_datafeed_callback_t cb,
+		void *cb_data, uint64_t rate)
+{
+	struct sr_decimator *dec;
+
+	if (!(dec = g_try_malloc0(sizeof(struct sr_decimator)))) {
+		sr_err("%s: decimator malloc failed", __func__);
+		return NULL;
+	}
+	dec->cb = cb;
+	dec->cb_data = cb_data;
+	dec->rate = rate;
+
+	return dec;
+}
+
+/** @private */
+SR_PRIV void sr_decimator_free(struct sr_decimator *dec)
+{
+	g_slist_free_full(dec->streams, (GDestroyNotify)stream_free);
+	g_free(dec);
+}
+
+/**
+ * Pass a packet through a decimator.
+ *
+ * SR_DF_LOGIC and SR_DF_ANALOG packets are passed on summed up, as
+ * SR_DF_LOGIC_SUMMARY and SR_DF_ANALOG_SUMMARY packets respectively,
+ * whenever a bucket is full. Other packets are passed on as they are,
+ * after whatever is left in the buckets, so e.g. a trigger stays where
+ * it was in the stream.
+ *
+ * @param dec The decimator.
+ * @param sdi The device the packet came from.
+ * @param packet The packet, with its sample offset filled in.
+ * @param types Mask of the packet types to pass on, 0 for all of them.
+ *
+ * @private
+ */
+SR_PRIV void sr_decimator_send(struct sr_decimator *dec,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, uint32_t types)
+{
+	struct decimate_stream *ds;
+
+	if (!(ds = stream_get(dec, sdi))) {
+		dec->cb(sdi, packet, dec->cb_data);
+		return;
+	}
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		stream_bucket_init(dec, ds);
+		logic_decimate(dec, ds, packet->payload, packet->sample_offset);
+		return;
+	case SR_DF_ANALOG:
+		stream_bucket_init(dec, ds);
+		analog_decimate(dec, ds, packet->payload, packet->sample_offset);
+		return;
+	case SR_DF_HEADER:
+		/* Whatever was left belongs to the last acquisition. */
+		stream_logic_reset(ds);
+		stream_analog_reset(ds);
+		ds->bucket_samples = 0;
+		break;
+	case SR_DF_META:
+		/* The samplerate may have changed. */
+		logic_flush(dec, ds);
+		analog_flush(dec, ds);
+		ds->bucket_samples = 0;
+		break;
+	default:
+		logic_flush(dec, ds);
+		analog_flush(dec, ds);
+		break;
+	}
+
+	/*
+	 * Header, meta, end, trigger and frame packets come here even if not
+	 * wanted, to reset or flush the buckets.
+	 */
+	if (!types || (types & SR_DF_MASK(packet->type)))
+		dec->cb(sdi, packet, dec->cb_data);
+}
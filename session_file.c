@@ -326,31 +326,22 @@ SR_API int sr_session_save(const char *filename, const struct sr_dev_inst *sdi,
 }
 
 /**
- * Append data to an existing session file.
+ * Pick the name for the next logic data chunk in a session file.
  *
- * @param filename The name of the filename to append to. Must not be NULL.
- * @param buf The data to be appended.
- * @param unitsize The number of bytes per sample.
- * @param units The number of samples.
+ * A session file holding a single "logic-1" entry is converted to the
+ * chunked layout first, by renaming that entry to "logic-1-1".
  *
- * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments, or SR_ERR
- *         upon other errors.
+ * @param archive The opened session file.
+ * @param chunkname Buffer of at least 16 bytes to store the name in.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Error renaming the existing entry.
  */
-SR_API int sr_session_append(const char *filename, unsigned char *buf,
-		int unitsize, int units)
+static int next_chunk_name(struct zip *archive, char *chunkname)
 {
-	struct zip *archive;
-	struct zip_source *logicsrc;
 	zip_int64_t num_files;
-	int chunk_num, next_chunk_num, ret, i;
+	int chunk_num, next_chunk_num, i;
 	const char *entry_name;
-	char chunkname[16];
-
-	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
-		return ret;
-
-	if (!(archive = zip_open(filename, 0, &ret)))
-		return SR_ERR;
 
 	next_chunk_num = 1;
 	num_files = zip_get_num_entries(archive, 0);
@@ -374,6 +365,37 @@ SR_API int sr_session_append(const char *filename, unsigned char *buf,
 		}
 	}
 	snprintf(chunkname, 15, "logic-1-%d", next_chunk_num);
+
+	return SR_OK;
+}
+
+/**
+ * Append data to an existing session file.
+ *
+ * @param filename The name of the filename to append to. Must not be NULL.
+ * @param buf The data to be appended.
+ * @param unitsize The number of bytes per sample.
+ * @param units The number of samples.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments, or SR_ERR
+ *         upon other errors.
+ */
+SR_API int sr_session_append(const char *filename, unsigned char *buf,
+		int unitsize, int units)
+{
+	struct zip *archive;
+	struct zip_source *logicsrc;
+	int ret;
+	char chunkname[16];
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	if (!(archive = zip_open(filename, 0, &ret)))
+		return SR_ERR;
+
+	if (next_chunk_name(archive, chunkname) != SR_OK)
+		return SR_ERR;
 	if (!(logicsrc = zip_source_buffer(archive, buf, units * unitsize, FALSE)))
 		return SR_ERR;
 	if (zip_add(archive, chunkname, logicsrc) == -1)
@@ -386,4 +408,115 @@ SR_API int sr_session_append(const char *filename, unsigned char *buf,
 	return SR_OK;
 }
 
+/* Read position in an RLE packet being written out by libzip. */
+struct rle_source {
+	const struct sr_datafeed_logic_rle *rle;
+	uint64_t total_samples;
+	uint64_t run;
+	uint64_t offset;
+};
+
+/*
+ * libzip source callback which expands the runs on the fly, straight
+ * into libzip's own buffer, as the archive is written out.
+ */
+static zip_int64_t rle_source_cb(void *state, void *data, zip_uint64_t len,
+		enum zip_source_cmd cmd)
+{
+	struct rle_source *src;
+	struct zip_stat *st;
+	uint64_t num_samples;
+
+	src = state;
+
+	switch (cmd) {
+	case ZIP_SOURCE_OPEN:
+		src->run = src->offset = 0;
+		return 0;
+	case ZIP_SOURCE_READ:
+		num_samples = sr_datafeed_logic_rle_expand(src->rle, &src->run,
+				&src->offset, data, len / src->rle->unitsize);
+		return num_samples * src->rle->unitsize;
+	case ZIP_SOURCE_CLOSE:
+		return 0;
+	case ZIP_SOURCE_STAT:
+		if (len < sizeof(*st))
+			return -1;
+		st = data;
+		zip_stat_init(st);
+		st->size = src->total_samples * src->rle->unitsize;
+		st->valid |= ZIP_STAT_SIZE;
+		return sizeof(*st);
+	case ZIP_SOURCE_ERROR:
+		if (len < 2 * sizeof(int))
+			return -1;
+		memset(data, 0, 2 * sizeof(int));
+		return 2 * sizeof(int);
+	case ZIP_SOURCE_FREE:
+		g_free(src);
+		return 0;
+	}
+
+	return -1;
+}
+
+/**
+ * Append run-length encoded data to an existing session file.
+ *
+ * The data is stored in the same (expanded) format as with
+ * sr_session_append(), but the expanded samples are never held in
+ * memory all at once.
+ *
+ * @param filename The name of the filename to append to. Must not be NULL.
+ * @param rle The data to be appended. Must not be NULL.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments, or SR_ERR
+ *         upon other errors.
+ */
+SR_API int sr_session_append_rle(const char *filename,
+		const struct sr_datafeed_logic_rle *rle)
+{
+	struct zip *archive;
+	struct zip_source *logicsrc;
+	struct rle_source *src;
+	uint64_t i;
+	int ret;
+	char chunkname[16];
+
+	if (!rle || !rle->unitsize) {
+		sr_err("%s: invalid RLE data", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	if (!(archive = zip_open(filename, 0, &ret)))
+		return SR_ERR;
+
+	if (next_chunk_name(archive, chunkname) != SR_OK)
+		return SR_ERR;
+
+	if (!(src = g_try_malloc0(sizeof(struct rle_source))))
+		return SR_ERR_MALLOC;
+	src->rle = rle;
+	for (i = 0; i < rle->num_runs; i++)
+		src->total_samples += rle->lengths[i];
+
+	if (!(logicsrc = zip_source_function(archive, rle_source_cb, src))) {
+		g_free(src);
+		return SR_ERR;
+	}
+	if (zip_add(archive, chunkname, logicsrc) == -1) {
+		zip_source_free(logicsrc);
+		return SR_ERR;
+	}
+	if ((ret = zip_close(archive)) == -1) {
+		sr_info("error saving session file: %s", zip_strerror(archive));
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
 /** @} */
@@ -0,0 +1,598 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "session-merge"
+
+/**
+ * @file
+ *
+ * Merging the logic streams of several devices into one.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+extern struct sr_session *session;
+
+/*
+ * Samples a member may get ahead of the slowest one by, before the merged
+ * stream is ended. This is what keeps a stalled device from eating all
+ * memory.
+ */
+#define MERGE_MAX_BACKLOG (16 * 1024 * 1024)
+
+/* Samples per expanded SR_DF_LOGIC_RLE chunk. */
+#define MERGE_RLE_CHUNK_SAMPLES (16 * 1024)
+
+struct merge_member {
+	const struct sr_dev_inst *sdi;
+	/* Where this member's bytes go in a merged sample, and how many. */
+	unsigned int byte_offset;
+	unsigned int width;
+	/* Samples received but not merged yet, width bytes each. */
+	GByteArray *backlog;
+	/* Samples received, and leading samples dropped for alignment. */
+	uint64_t received;
+	uint64_t skip;
+	uint64_t skip_total;
+	gboolean ended;
+};
+
+struct merge {
+	/* The virtual device the merged stream comes from. */
+	struct sr_dev_inst *sdi;
+	struct merge_member *members;
+	int num_members;
+	unsigned int unitsize;
+	gboolean align;
+	/* An acquisition is in progress. */
+	gboolean running;
+	/* The members' alignment has been worked out. */
+	gboolean aligned;
+	/* The merged stream ended first, wait for the members to end. */
+	gboolean ended_early;
+	int num_ended;
+	/* Merged samples sent so far. */
+	uint64_t sent;
+	/* Merged sample a trigger is pending at, or -1. */
+	int64_t trigger;
+	/* Member stream trigger position, until aligned. */
+	struct merge_member *trigger_member;
+	uint64_t trigger_pos;
+};
+
+static void merge_free(struct merge *merge)
+{
+	int i;
+
+	for (i = 0; i < merge->num_members; i++) {
+		if (merge->members[i].backlog)
+			g_byte_array_free(merge->members[i].backlog, TRUE);
+	}
+	g_free(merge->members);
+	sr_dev_inst_free(merge->sdi);
+	g_free(merge);
+}
+
+static void merge_reset(struct merge *merge)
+{
+	struct merge_member *m;
+	int i;
+
+	for (i = 0; i < merge->num_members; i++) {
+		m = &merge->members[i];
+		g_byte_array_set_size(m->backlog, 0);
+		m->received = m->skip = m->skip_total = 0;
+		m->ended = FALSE;
+	}
+	merge->aligned = !merge->align;
+	merge->ended_early = FALSE;
+	merge->num_ended = 0;
+	merge->sent = 0;
+	merge->trigger = -1;
+	merge->trigger_member = NULL;
+}
+
+static void send_packet(struct merge *merge, int type, const void *payload)
+{
+	struct sr_datafeed_packet packet;
+
+	packet.type = type;
+	packet.payload = payload;
+	sr_session_send(merge->sdi, &packet);
+}
+
+/*
+ * Once every member has sent samples, drop however many leading samples it
+ * takes to line the members up with the one that started last.
+ */
+static void merge_align(struct merge *merge)
+{
+	struct merge_member *m;
+	int64_t first[merge->num_members], last;
+	uint64_t samplerate, rate;
+	int i;
+
+	last = 0;
+	samplerate = 0;
+	for (i = 0; i < merge->num_members; i++) {
+		m = &merge->members[i];
+		if (sr_session_dev_timebase(m->sdi, &first[i], &rate) != SR_OK)
+			return;
+		if (!rate || (samplerate && rate != samplerate)) {
+			sr_err("Can't align devices without a common "
+			       "samplerate, merging unaligned.");
+			merge->aligned = TRUE;
+			return;
+		}
+		samplerate = rate;
+		last = MAX(last, first[i]);
+	}
+
+	for (i = 0; i < merge->num_members; i++) {
+		m = &merge->members[i];
+		m->skip = (last - first[i]) * samplerate / G_USEC_PER_SEC;
+		m->skip_total = m->skip;
+		sr_dbg("Dropping %" PRIu64 " samples of device %d to align.",
+		       m->skip, i);
+	}
+	merge->aligned = TRUE;
+}
+
+static void send_logic(struct merge *merge, const uint8_t *data,
+		uint64_t num_samples)
+{
+	struct sr_datafeed_logic logic;
+
+	logic.length = num_samples * merge->unitsize;
+	logic.unitsize = merge->unitsize;
+	logic.data = (void *)data;
+	send_packet(merge, SR_DF_LOGIC, &logic);
+	merge->sent += num_samples;
+}
+
+/* Send as many merged samples as all members have data for. */
+static int merge_flush(struct merge *merge)
+{
+	struct merge_member *m;
+	uint64_t num_samples, s, before;
+	uint8_t *buf, *dst;
+	int i;
+
+	if (!merge->aligned)
+		return SR_OK;
+
+	num_samples = G_MAXUINT64;
+	for (i = 0; i < merge->num_members; i++) {
+		m = &merge->members[i];
+		if (m->skip) {
+			s = MIN(m->skip, m->backlog->len / m->width);
+			g_byte_array_remove_range(m->backlog, 0, s * m->width);
+			m->skip -= s;
+		}
+		num_samples = MIN(num_samples, m->backlog->len / m->width);
+	}
+
+	/* A trigger seen before alignment is placed now. */
+	if (merge->trigger_member) {
+		m = merge->trigger_member;
+		merge->trigger = MAX((int64_t)merge->trigger_pos
+				- (int64_t)m->skip_total, 0);
+		merge->trigger_member = NULL;
+	}
+
+	if (num_samples == 0)
+		return SR_OK;
+
+	if (!(buf = g_try_malloc(num_samples * merge->unitsize))) {
+		sr_err("%s: buf malloc failed", __func__);
+		return SR_ERR_MALLOC;
+	}
+
+	for (i = 0; i < merge->num_members; i++) {
+		m = &merge->members[i];
+		dst = buf + m->byte_offset;
+		for (s = 0; s < num_samples; s++) {
+			memcpy(dst, m->backlog->data + s * m->width, m->width);
+			dst += merge->unitsize;
+		}
+		g_byte_array_remove_range(m->backlog, 0, num_samples * m->width);
+	}
+
+	if (merge->trigger >= 0 && (uint64_t)merge->trigger < merge->sent
+			+ num_samples) {
+		before = merge->trigger - MIN((uint64_t)merge->trigger,
+				merge->sent);
+		if (before)
+			send_logic(merge, buf, before);
+		send_packet(merge, SR_DF_TRIGGER, NULL);
+		send_logic(merge, buf + before * merge->unitsize,
+				num_samples - before);
+		merge->trigger = -1;
+	} else {
+		send_logic(merge, buf, num_samples);
+	}
+
+	g_free(buf);
+
+	return SR_OK;
+}
+
+/*
+ * Queue samples of any unitsize as the member's width. Dropping samples
+ * would misalign the member for the rest of the stream, so an overflowing
+ * backlog is an error.
+ */
+static int member_append(struct merge_member *m, const uint8_t *data,
+		uint16_t unitsize, uint64_t num_samples)
+{
+	uint8_t sample[m->width];
+	uint64_t s;
+
+	if (m->backlog->len / m->width + num_samples > MERGE_MAX_BACKLOG) {
+		sr_err("Merge backlog of %s overflowed.",
+		       m->sdi->model ? m->sdi->model : "device");
+		return SR_ERR;
+	}
+
+	m->received += num_samples;
+
+	if (unitsize == m->width) {
+		g_byte_array_append(m->backlog, data, num_samples * unitsize);
+		return SR_OK;
+	}
+
+	memset(sample, 0, m->width);
+	for (s = 0; s < num_samples; s++) {
+		memcpy(sample, data + s * unitsize, MIN(unitsize, m->width));
+		g_byte_array_append(m->backlog, sample, m->width);
+	}
+
+	return SR_OK;
+}
+
+static int member_append_rle(struct merge_member *m,
+		const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t run, offset, num_samples;
+	uint8_t *buf;
+	int ret;
+
+	if (!(buf = g_try_malloc(MERGE_RLE_CHUNK_SAMPLES * rle->unitsize))) {
+		sr_err("%s: buf malloc failed", __func__);
+		return SR_ERR_MALLOC;
+	}
+
+	ret = SR_OK;
+	run = offset = 0;
+	while (ret == SR_OK && (num_samples = sr_datafeed_logic_rle_expand(rle,
+			&run, &offset, buf, MERGE_RLE_CHUNK_SAMPLES)) > 0)
+		ret = member_append(m, buf, rle->unitsize, num_samples);
+
+	g_free(buf);
+
+	return ret;
+}
+
+/*
+ * Whether a member has ended and all its samples have been merged, so no
+ * more merged samples can follow.
+ */
+static gboolean merge_drained(struct merge *merge)
+{
+	struct merge_member *m;
+	int i;
+
+	if (!merge->aligned)
+		return FALSE;
+
+	for (i = 0; i < merge->num_members; i++) {
+		m = &merge->members[i];
+		if (m->ended && m->backlog->len < m->width)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * End the merged stream. If some members are still running, their
+ * remaining packets are swallowed until all of them have ended too.
+ */
+static void merge_end(struct merge *merge)
+{
+	int i;
+
+	for (i = 0; i < merge->num_members; i++)
+		g_byte_array_set_size(merge->members[i].backlog, 0);
+	send_packet(merge, SR_DF_END, NULL);
+	merge->running = FALSE;
+	merge->ended_early = merge->num_ended < merge->num_members;
+}
+
+static void member_packet(struct merge *merge, struct merge_member *m,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	int ret;
+
+	if (merge->ended_early) {
+		if (packet->type == SR_DF_END && !m->ended) {
+			m->ended = TRUE;
+			if (++merge->num_ended == merge->num_members)
+				merge->ended_early = FALSE;
+		}
+		return;
+	}
+
+	ret = SR_OK;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		/* The first member to start starts the merged device. */
+		if (!merge->running) {
+			merge_reset(merge);
+			merge->running = TRUE;
+			send_packet(merge, SR_DF_HEADER, packet->payload);
+		}
+		break;
+	case SR_DF_META:
+		/* The members are alike, one of them speaks for all. */
+		if (m == &merge->members[0])
+			send_packet(merge, SR_DF_META, packet->payload);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (logic->unitsize)
+			ret = member_append(m, logic->data, logic->unitsize,
+					logic->length / logic->unitsize);
+		break;
+	case SR_DF_LOGIC_RLE:
+		ret = member_append_rle(m, packet->payload);
+		break;
+	case SR_DF_TRIGGER:
+		if (merge->trigger >= 0 || merge->trigger_member)
+			break;
+		merge->trigger_member = m;
+		merge->trigger_pos = m->received;
+		break;
+	case SR_DF_END:
+		if (!m->ended) {
+			m->ended = TRUE;
+			merge->num_ended++;
+		}
+		break;
+	}
+
+	if (!merge->aligned)
+		merge_align(merge);
+	if (ret == SR_OK)
+		ret = merge_flush(merge);
+
+	if (!merge->running)
+		return;
+
+	if (ret != SR_OK) {
+		sr_err("Ending merged stream after %" PRIu64 " samples.",
+		       merge->sent);
+		merge_end(merge);
+		return;
+	}
+
+	/* The merged stream ends with the shortest member's. */
+	if (merge->num_ended == merge->num_members || merge_drained(merge))
+		merge_end(merge);
+}
+
+/**
+ * Pass a packet from a merged device to its merge.
+ *
+ * @param sdi The device the packet came from.
+ * @param packet The packet.
+ *
+ * @return TRUE if the packet was taken by a merge, FALSE if it should be
+ *         sent on as it is.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_merge_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct merge *merge;
+	GSList *l;
+	int i;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+	case SR_DF_END:
+	case SR_DF_META:
+	case SR_DF_TRIGGER:
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+		break;
+	default:
+		/* Analog data and frames still come from the member. */
+		return FALSE;
+	}
+
+	for (l = session->merges; l; l = l->next) {
+		merge = l->data;
+		for (i = 0; i < merge->num_members; i++) {
+			if (merge->members[i].sdi == sdi) {
+				member_packet(merge, &merge->members[i], packet);
+				return TRUE;
+			}
+		}
+	}
+
+	return FALSE;
+}
+
+/** @private */
+SR_PRIV void sr_session_merge_free_all(void)
+{
+	g_slist_free_full(session->merges, (GDestroyNotify)merge_free);
+	session->merges = NULL;
+}
+
+/* Find a member device among the existing merges. */
+static gboolean merged(const struct sr_dev_inst *sdi)
+{
+	struct merge *merge;
+	GSList *l;
+	int i;
+
+	for (l = session->merges; l; l = l->next) {
+		merge = l->data;
+		for (i = 0; i < merge->num_members; i++) {
+			if (merge->members[i].sdi == sdi)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Merge the logic streams of several devices into one wider virtual device.
+ *
+ * For each sample, the merged device sends the logic samples of all the
+ * devices, one after the other, so its probes are those of the first
+ * device, followed by those of the second, and so on. Probe names are
+ * prefixed with the device's position in the list, counting from 1,
+ * e.g. "1:D0".
+ *
+ * Once merged, the devices' logic packets, as well as their header, end,
+ * meta and trigger packets, only come out of the merged device. Analog
+ * packets still come from the devices themselves. The merged stream ends
+ * with the shortest of the devices' streams. It also ends early if one
+ * device gets too far ahead of another, e.g. because the other stalled.
+ *
+ * Devices that start acquiring at slightly different times can be lined
+ * up using the timebase of their streams, see sr_session_dev_timebase().
+ * This needs all of them to run at the same samplerate. Devices which are
+ * already in sync, e.g. through a shared clock or trigger, should be
+ * merged without that.
+ *
+ * @param devs List of two or more struct sr_dev_inst, all of which must
+ *             have been added to the current session, and none of which
+ *             must have been merged before.
+ * @param align TRUE to line the streams up by their timebase.
+ *
+ * @return The merged device, owned by the session, or NULL upon errors.
+ *         It is freed along with the session's devices.
+ */
+SR_API struct sr_dev_inst *sr_session_merge_logic(GSList *devs,
+		gboolean align)
+{
+	struct merge *merge;
+	struct merge_member *m;
+	struct sr_dev_inst *sdi;
+	struct sr_probe *probe, *mprobe;
+	GSList *l, *p;
+	char name[32];
+	int max_index, i;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return NULL;
+	}
+
+	if (g_slist_length(devs) < 2) {
+		sr_err("%s: need at least two devices to merge", __func__);
+		return NULL;
+	}
+
+	for (l = devs; l; l = l->next) {
+		if (!g_slist_find(session->devs, l->data) || merged(l->data)
+				|| g_slist_find(l->next, l->data)) {
+			sr_err("%s: devices must be in the session, and not "
+			       "merged yet", __func__);
+			return NULL;
+		}
+	}
+
+	if (!(merge = g_try_malloc0(sizeof(struct merge)))) {
+		sr_err("%s: merge malloc failed", __func__);
+		return NULL;
+	}
+	merge->num_members = g_slist_length(devs);
+	merge->align = align;
+	if (!(merge->members = g_try_malloc0(merge->num_members
+			* sizeof(struct merge_member)))) {
+		sr_err("%s: members malloc failed", __func__);
+		g_free(merge);
+		return NULL;
+	}
+
+	if (!(merge->sdi = sr_dev_inst_new(0, SR_ST_ACTIVE, "sigrok",
+			"Merged device", NULL))) {
+		merge_free(merge);
+		return NULL;
+	}
+
+	for (l = devs, i = 0; l; l = l->next, i++) {
+		sdi = l->data;
+		m = &merge->members[i];
+		m->sdi = sdi;
+		m->byte_offset = merge->unitsize;
+		m->backlog = g_byte_array_new();
+
+		max_index = -1;
+		for (p = sdi->probes; p; p = p->next) {
+			probe = p->data;
+			if (probe->type == SR_PROBE_LOGIC)
+				max_index = MAX(max_index, probe->index);
+		}
+		m->width = MAX(max_index + 8, 8) / 8;
+
+		for (p = sdi->probes; p; p = p->next) {
+			probe = p->data;
+			if (probe->type != SR_PROBE_LOGIC)
+				continue;
+			snprintf(name, sizeof(name), "%d:%s", i + 1, probe->name);
+			if (!(mprobe = sr_probe_new(m->byte_offset * 8
+					+ probe->index, SR_PROBE_LOGIC,
+					probe->enabled, name))) {
+				merge_free(merge);
+				return NULL;
+			}
+			merge->sdi->probes = g_slist_append(merge->sdi->probes,
+					mprobe);
+		}
+
+		merge->unitsize += m->width;
+	}
+	merge_reset(merge);
+
+	session->merges = g_slist_append(session->merges, merge);
+
+	sr_dbg("Merged %d devices into %u bytes per sample.",
+	       merge->num_members, merge->unitsize);
+
+	return merge->sdi;
+}
+
+/** @} */
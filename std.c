@@ -23,6 +23,7 @@
   * @internal
   */
 
+#include <string.h>
 #include <glib.h>
 #include "libsigrok.h"
 #include "libsigrok-internal.h"
@@ -288,3 +289,221 @@ SR_PRIV int std_dev_clear(const struct sr_dev_driver *driver,
 	return ret;
 }
 
+/**
+ * Prepare to batch analog readings.
+ *
+ * Meter drivers that produce one reading at a time can pass each one to
+ * std_analog_batch_add() instead of sending it. Readings are then
+ * timestamped, and held back until max_samples have accumulated or the
+ * oldest is latency_ms old, and sent as a single packet.
+ *
+ * @param batch The batch state to initialize.
+ * @param sdi The device instance the packets are sent for.
+ * @param max_samples The most samples to send in one packet.
+ * @param latency_ms The longest a reading may be held back. 0 sends every
+ *                   reading right away.
+ */
+SR_PRIV void std_analog_batch_init(struct std_analog_batch *batch,
+		const struct sr_dev_inst *sdi, int max_samples,
+		uint64_t latency_ms)
+{
+	memset(batch, 0, sizeof(struct std_analog_batch));
+	batch->sdi = sdi;
+	batch->max_samples = MAX(max_samples, 1);
+	batch->max_latency = latency_ms * 1000;
+}
+
+static gboolean probes_equal(const GSList *a, const GSList *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (a->data != b->data)
+			return FALSE;
+	}
+
+	return !a && !b;
+}
+
+/* Send an analog packet, timestamping its samples if it has none. */
+static int send_timestamped(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_analog *analog)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog copy;
+	int64_t now;
+	int i, ret;
+
+	copy = *analog;
+	if (!copy.timestamps) {
+		now = g_get_real_time();
+		/* Most meters send one reading at a time, that needs no buffer. */
+		if (analog->num_samples <= 1) {
+			copy.timestamps = &now;
+		} else {
+			if (!(copy.timestamps = g_try_malloc(sizeof(int64_t)
+					* analog->num_samples)))
+				return SR_ERR_MALLOC;
+			for (i = 0; i < analog->num_samples; i++)
+				copy.timestamps[i] = now;
+		}
+	}
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &copy;
+	ret = sr_session_send(sdi, &packet);
+
+	if (copy.timestamps != analog->timestamps && copy.timestamps != &now)
+		g_free(copy.timestamps);
+
+	return ret;
+}
+
+/**
+ * Add analog readings to a batch.
+ *
+ * The readings are copied, so the packet's buffers can be reused right
+ * away. A change in probes, quantity, unit or flags sends the readings
+ * held so far first.
+ *
+ * @param batch The batch state.
+ * @param analog The readings. If timestamps is NULL, the current time is
+ *               used for all of them.
+ *
+ * @return SR_OK upon success, or a negative error code.
+ */
+SR_PRIV int std_analog_batch_add(struct std_analog_batch *batch,
+		const struct sr_datafeed_analog *analog)
+{
+	int num_probes, num_values, ret, i;
+	int64_t now;
+
+	if (!batch->max_latency || analog->num_samples > batch->max_samples) {
+		if ((ret = std_analog_batch_flush(batch)) != SR_OK)
+			return ret;
+		return send_timestamped(batch->sdi, analog);
+	}
+
+	if (batch->num_samples && (analog->mq != batch->mq
+			|| analog->unit != batch->unit
+			|| analog->mqflags != batch->mqflags
+			|| !probes_equal(analog->probes, batch->probes)
+			|| batch->num_samples + analog->num_samples
+				> batch->max_samples)) {
+		if ((ret = std_analog_batch_flush(batch)) != SR_OK)
+			return ret;
+	}
+
+	num_probes = g_slist_length(analog->probes);
+	if (!batch->num_samples) {
+		if (num_probes > batch->buf_probes) {
+			g_free(batch->data);
+			g_free(batch->timestamps);
+			batch->data = g_try_malloc(sizeof(float)
+					* batch->max_samples * num_probes);
+			batch->timestamps = g_try_malloc(sizeof(int64_t)
+					* batch->max_samples);
+			if (!batch->data || !batch->timestamps) {
+				g_free(batch->data);
+				g_free(batch->timestamps);
+				batch->data = NULL;
+				batch->timestamps = NULL;
+				batch->buf_probes = 0;
+				return SR_ERR_MALLOC;
+			}
+			batch->buf_probes = num_probes;
+		}
+		batch->probes = g_slist_copy(analog->probes);
+		batch->mq = analog->mq;
+		batch->unit = analog->unit;
+		batch->mqflags = analog->mqflags;
+		batch->first_time = g_get_monotonic_time();
+	}
+
+	num_values = analog->num_samples * num_probes;
+	memcpy(batch->data + batch->num_samples * num_probes, analog->data,
+			sizeof(float) * num_values);
+	if (analog->timestamps) {
+		memcpy(batch->timestamps + batch->num_samples,
+				analog->timestamps,
+				sizeof(int64_t) * analog->num_samples);
+	} else {
+		now = g_get_real_time();
+		for (i = 0; i < analog->num_samples; i++)
+			batch->timestamps[batch->num_samples + i] = now;
+	}
+	batch->num_samples += analog->num_samples;
+
+	if (batch->num_samples >= batch->max_samples)
+		return std_analog_batch_flush(batch);
+
+	return std_analog_batch_poll(batch);
+}
+
+/**
+ * Send the held readings if the oldest one has reached the latency bound.
+ *
+ * Drivers should call this periodically, e.g. from their receive callback
+ * on timeouts, so readings aren't held back when the device goes quiet.
+ *
+ * @param batch The batch state.
+ *
+ * @return SR_OK upon success, or a negative error code.
+ */
+SR_PRIV int std_analog_batch_poll(struct std_analog_batch *batch)
+{
+	if (!batch->num_samples)
+		return SR_OK;
+
+	if (g_get_monotonic_time() - batch->first_time < batch->max_latency)
+		return SR_OK;
+
+	return std_analog_batch_flush(batch);
+}
+
+/**
+ * Send all held readings as one packet.
+ *
+ * Drivers must call this before sending SR_DF_END.
+ *
+ * @param batch The batch state.
+ *
+ * @return SR_OK upon success, or a negative error code.
+ */
+SR_PRIV int std_analog_batch_flush(struct std_analog_batch *batch)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	int ret;
+
+	if (!batch->num_samples)
+		return SR_OK;
+
+	analog.probes = batch->probes;
+	analog.num_samples = batch->num_samples;
+	analog.mq = batch->mq;
+	analog.unit = batch->unit;
+	analog.mqflags = batch->mqflags;
+	analog.data = batch->data;
+	analog.timestamps = batch->timestamps;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	ret = sr_session_send(batch->sdi, &packet);
+
+	g_slist_free(batch->probes);
+	batch->probes = NULL;
+	batch->num_samples = 0;
+
+	return ret;
+}
+
+/**
+ * Free the buffers of a batch. Held readings are dropped.
+ *
+ * @param batch The batch state.
+ */
+SR_PRIV void std_analog_batch_free(struct std_analog_batch *batch)
+{
+	g_slist_free(batch->probes);
+	g_free(batch->data);
+	g_free(batch->timestamps);
+	memset(batch, 0, sizeof(struct std_analog_batch));
+}
@@ -0,0 +1,334 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Tests and fuzz harness for the DMM chip parsers.
+ *
+ * The parsers are private to libsigrok, so this is linked against the
+ * parser library directly rather than against libsigrok itself.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <check.h>
+#define NO_LOG_WRAPPERS
+#include "../libsigrok.h"
+#include "../libsigrok-internal.h"
+
+/* Random data fed to the validators. */
+#define FUZZ_SIZE (1024 * 1024)
+
+/* Largest number of bytes a validator looks at. */
+#define MAX_PACKET_SIZE ES519XX_11B_PACKET_SIZE
+
+struct parser {
+	const char *name;
+	size_t packet_size;
+	gboolean (*packet_valid)(const uint8_t *);
+	int (*packet_parse)(const uint8_t *, float *,
+			struct sr_datafeed_analog *, void *);
+};
+
+static const struct parser parsers[] = {
+	{ "fs9721", FS9721_PACKET_SIZE,
+		sr_fs9721_packet_valid, sr_fs9721_parse },
+	{ "fs9922", FS9922_PACKET_SIZE,
+		sr_fs9922_packet_valid, sr_fs9922_parse },
+	{ "es519xx-2400-11b", ES519XX_11B_PACKET_SIZE,
+		sr_es519xx_2400_11b_packet_valid,
+		sr_es519xx_2400_11b_parse },
+	{ "es519xx-19200-11b", ES519XX_11B_PACKET_SIZE,
+		sr_es519xx_19200_11b_packet_valid,
+		sr_es519xx_19200_11b_parse },
+	{ "es519xx-19200-11b-5digits", ES519XX_11B_PACKET_SIZE,
+		sr_es519xx_19200_11b_5digits_packet_valid,
+		sr_es519xx_19200_11b_5digits_parse },
+	{ "es519xx-19200-11b-clamp", ES519XX_11B_PACKET_SIZE,
+		sr_es519xx_19200_11b_clamp_packet_valid,
+		sr_es519xx_19200_11b_clamp_parse },
+	{ "es519xx-19200-14b", ES519XX_14B_PACKET_SIZE,
+		sr_es519xx_19200_14b_packet_valid,
+		sr_es519xx_19200_14b_parse },
+	{ "es519xx-19200-14b-sel-lpf", ES519XX_14B_PACKET_SIZE,
+		sr_es519xx_19200_14b_sel_lpf_packet_valid,
+		sr_es519xx_19200_14b_sel_lpf_parse },
+	{ "metex14", METEX14_PACKET_SIZE,
+		sr_metex14_packet_valid, sr_metex14_parse },
+	{ "rs9lcd", RS9LCD_PACKET_SIZE,
+		sr_rs9lcd_packet_valid, sr_rs9lcd_parse },
+	{ "m2110", BBCGM_M2110_PACKET_SIZE,
+		sr_m2110_packet_valid, sr_m2110_parse },
+};
+
+/* Big enough for the info struct of any parser. */
+union parser_info {
+	struct es519xx_info es519xx;
+	struct fs9922_info fs9922;
+	struct fs9721_info fs9721;
+	struct metex14_info metex14;
+	struct rs9lcd_info rs9lcd;
+};
+
+/* A known good packet, and what it should parse to. */
+struct sample {
+	const struct parser *parser;
+	const uint8_t *packet;
+	float value;
+	int mq;
+	int unit;
+	uint64_t mqflags;
+};
+
+/* "1234", DC, volt, RS232. */
+static const uint8_t fs9721_packet[FS9721_PACKET_SIZE] = {
+	0x15, 0x20, 0x35, 0x45, 0x5b, 0x61, 0x7f,
+	0x82, 0x97, 0xa0, 0xb0, 0xc0, 0xd4, 0xe0,
+};
+
+/* "+1234", decimal point after the third digit, DC, volt. */
+static const uint8_t fs9922_packet[FS9922_PACKET_SIZE] = {
+	'+', '1', '2', '3', '4', ' ', '4',
+	0x10, 0x00, 0x00, 0x80, 0x00, '\r', '\n',
+};
+
+static const uint8_t metex14_packet[] = "DC 01.234   V\r";
+
+static const uint8_t m2110_packet[] = "  1.234\r\n";
+
+static const struct sample samples[] = {
+	{ &parsers[0], fs9721_packet, 1234, SR_MQ_VOLTAGE, SR_UNIT_VOLT,
+		SR_MQFLAG_DC },
+	{ &parsers[1], fs9922_packet, 123.4, SR_MQ_VOLTAGE, SR_UNIT_VOLT,
+		SR_MQFLAG_DC },
+	{ &parsers[8], metex14_packet, 1.234, SR_MQ_VOLTAGE, SR_UNIT_VOLT,
+		SR_MQFLAG_DC },
+	{ &parsers[10], m2110_packet, 1.234, SR_MQ_GAIN, SR_UNIT_UNITLESS,
+		0 },
+};
+
+/* The parsers log through these; keep the test output quiet. */
+SR_PRIV int sr_log(int loglevel, const char *format, ...)
+{
+	(void)loglevel;
+	(void)format;
+
+	return SR_OK;
+}
+
+#define LOG_STUB(name) \
+SR_PRIV int name(const char *format, ...) { (void)format; return SR_OK; }
+
+LOG_STUB(sr_spew)
+LOG_STUB(sr_dbg)
+LOG_STUB(sr_info)
+LOG_STUB(sr_warn)
+LOG_STUB(sr_err)
+
+#ifdef HAVE_LIBSERIALPORT
+/* Only used by sr_metex14_packet_request(). */
+SR_PRIV int serial_write(struct sr_serial_dev_inst *serial,
+		const void *buf, size_t count)
+{
+	(void)serial;
+	(void)buf;
+
+	return count;
+}
+#endif
+
+/* Random data, followed by enough zeroes for a validator to look at. */
+static uint8_t *random_data(GRand *rand, size_t len, gboolean no_eol)
+{
+	uint8_t *buf;
+	size_t i;
+
+	buf = g_malloc0(len + MAX_PACKET_SIZE);
+	for (i = 0; i < len; i++) {
+		do {
+			buf[i] = g_rand_int_range(rand, 0, 256);
+		} while (no_eol && (buf[i] == '\r' || buf[i] == '\n'));
+	}
+
+	return buf;
+}
+
+/*
+ * Find the next valid packet at or after offset, like the serial receive
+ * path does while resyncing.
+ */
+static size_t find_packet(const struct parser *parser, const uint8_t *buf,
+		size_t len, size_t offset)
+{
+	for (; offset + parser->packet_size <= len; offset++) {
+		if (parser->packet_valid(buf + offset))
+			return offset;
+	}
+
+	return len;
+}
+
+START_TEST(test_parse_known)
+{
+	const struct sample *sample;
+	struct sr_datafeed_analog analog;
+	union parser_info info;
+	unsigned int i;
+	float value;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(samples); i++) {
+		sample = &samples[i];
+		fail_unless(sample->parser->packet_valid(sample->packet),
+			    "%s: valid packet rejected.", sample->parser->name);
+
+		memset(&analog, 0, sizeof(analog));
+		memset(&info, 0, sizeof(info));
+		analog.mq = -1;
+		ret = sample->parser->packet_parse(sample->packet, &value,
+				&analog, &info);
+		fail_unless(ret == SR_OK, "%s: parse failed: %d.",
+			    sample->parser->name, ret);
+		fail_unless(fabsf(value - sample->value) < 1e-3,
+			    "%s: got %f, expected %f.", sample->parser->name,
+			    value, sample->value);
+		fail_unless(analog.mq == sample->mq && analog.unit == sample->unit,
+			    "%s: wrong quantity or unit.", sample->parser->name);
+		fail_unless(analog.mqflags == sample->mqflags,
+			    "%s: wrong flags.", sample->parser->name);
+	}
+}
+END_TEST
+
+/*
+ * Bury known good packets in line noise, and check the sliding search finds
+ * each of them right where it starts, and nothing else.
+ */
+START_TEST(test_resync)
+{
+	const struct sample *sample;
+	GRand *rand;
+	uint8_t *noise, *stream;
+	size_t offsets[64], len, pos, size, found;
+	unsigned int i, j, n;
+
+	rand = g_rand_new_with_seed(4242);
+
+	for (i = 0; i < ARRAY_SIZE(samples); i++) {
+		sample = &samples[i];
+		size = sample->parser->packet_size;
+		noise = random_data(rand, 64 * 256, TRUE);
+		stream = g_malloc(64 * (256 + size) + MAX_PACKET_SIZE);
+
+		/* Noise bursts of 0-255 bytes, each followed by a packet. */
+		len = 0;
+		pos = 0;
+		for (n = 0; n < ARRAY_SIZE(offsets); n++) {
+			j = g_rand_int_range(rand, 0, 256);
+			memcpy(stream + len, noise + pos, j);
+			len += j;
+			pos += j;
+			offsets[n] = len;
+			memcpy(stream + len, sample->packet, size);
+			len += size;
+		}
+		memset(stream + len, 0, MAX_PACKET_SIZE);
+
+		pos = 0;
+		for (n = 0; n < ARRAY_SIZE(offsets); n++) {
+			found = find_packet(sample->parser, stream, len, pos);
+			fail_unless(found == offsets[n],
+				    "%s: packet %u found at %zu, expected %zu.",
+				    sample->parser->name, n, found, offsets[n]);
+			pos = found + size;
+		}
+		fail_unless(find_packet(sample->parser, stream, len, pos) == len,
+			    "%s: found a packet in trailing data.",
+			    sample->parser->name);
+
+		g_free(stream);
+		g_free(noise);
+	}
+
+	g_rand_free(rand);
+}
+END_TEST
+
+/*
+ * Run every validator over random data at every offset, and parse whatever
+ * it accepts. This must not crash.
+ */
+START_TEST(test_fuzz)
+{
+	const struct parser *parser;
+	struct sr_datafeed_analog analog;
+	union parser_info info;
+	GRand *rand;
+	uint8_t *buf;
+	unsigned int i;
+	size_t pos;
+	float value;
+
+	rand = g_rand_new_with_seed(2323);
+	buf = random_data(rand, FUZZ_SIZE, FALSE);
+
+	for (i = 0; i < ARRAY_SIZE(parsers); i++) {
+		parser = &parsers[i];
+		for (pos = 0; pos < FUZZ_SIZE; pos++) {
+			if (!parser->packet_valid(buf + pos))
+				continue;
+			memset(&analog, 0, sizeof(analog));
+			memset(&info, 0, sizeof(info));
+			parser->packet_parse(buf + pos, &value, &analog, &info);
+		}
+	}
+
+	g_free(buf);
+	g_rand_free(rand);
+}
+END_TEST
+
+static Suite *suite_dmm(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("dmm");
+
+	tc = tcase_create("parsers");
+	tcase_add_test(tc, test_parse_known);
+	tcase_add_test(tc, test_resync);
+	tcase_add_test(tc, test_fuzz);
+	tcase_set_timeout(tc, 60);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
+
+int main(void)
+{
+	int ret;
+	SRunner *srunner;
+
+	srunner = srunner_create(suite_dmm());
+	srunner_run_all(srunner, CK_VERBOSE);
+	ret = srunner_ntests_failed(srunner);
+	srunner_free(srunner);
+
+	return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -19,6 +19,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include "../libsigrok.h"
 #include "lib.h"
@@ -58,6 +59,171 @@ START_TEST(test_driver_init_all)
 }
 END_TEST
 
+/* Check whether a parallel scan finds the demo device. */
+START_TEST(test_driver_scan_all)
+{
+	struct sr_dev_driver *drivers[2];
+	GSList *devices;
+
+	drivers[0] = srtest_driver_get("demo");
+	drivers[1] = NULL;
+	srtest_driver_init(sr_ctx, drivers[0]);
+
+	devices = sr_driver_scan_all(sr_ctx, drivers, NULL, 5000);
+	fail_unless(devices != NULL, "No devices found.");
+	g_slist_free(devices);
+}
+END_TEST
+
+/* Check whether config keys can be looked up by key and by name. */
+START_TEST(test_config_info_lookup)
+{
+	const struct sr_config_info *info;
+
+	info = sr_config_info_get(SR_CONF_SAMPLERATE);
+	fail_unless(info != NULL && !strcmp(info->id, "samplerate"));
+	fail_unless(sr_config_info_name_get("samplerate") == info);
+
+	info = sr_config_info_name_get("conn");
+	fail_unless(info != NULL && info->key == SR_CONF_CONN);
+	fail_unless(sr_config_info_get(SR_CONF_CONN) == info);
+
+	fail_unless(sr_config_info_get(0) == NULL);
+	fail_unless(sr_config_info_name_get("no_such_option") == NULL);
+}
+END_TEST
+
+/* Check whether repeated config lists are served from the cache. */
+START_TEST(test_config_list_cached)
+{
+	struct sr_dev_driver *driver;
+	GVariant *gvar1, *gvar2;
+	int ret;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(sr_ctx, driver);
+
+	ret = sr_config_list(driver, NULL, NULL, SR_CONF_SCAN_OPTIONS, &gvar1);
+	fail_unless(ret == SR_OK, "sr_config_list() failed: %d.", ret);
+	ret = sr_config_list(driver, NULL, NULL, SR_CONF_SCAN_OPTIONS, &gvar2);
+	fail_unless(ret == SR_OK, "sr_config_list() failed: %d.", ret);
+	fail_unless(gvar1 == gvar2, "List was not cached.");
+
+	g_variant_unref(gvar1);
+	g_variant_unref(gvar2);
+}
+END_TEST
+
+static void hotplug_cb(const struct sr_hotplug_event *event, void *cb_data)
+{
+	(void)event;
+	(void)cb_data;
+}
+
+/* Check whether the hotplug monitor rejects bad arguments. */
+START_TEST(test_hotplug_monitor_args)
+{
+	struct sr_dev_driver **drivers;
+	int ret;
+
+	drivers = sr_driver_list();
+
+	ret = sr_hotplug_monitor_start(NULL, drivers, hotplug_cb, NULL);
+	fail_unless(ret == SR_ERR_ARG, "No context accepted: %d.", ret);
+	ret = sr_hotplug_monitor_start(sr_ctx, NULL, hotplug_cb, NULL);
+	fail_unless(ret == SR_ERR_ARG, "No drivers accepted: %d.", ret);
+	ret = sr_hotplug_monitor_start(sr_ctx, drivers, NULL, NULL);
+	fail_unless(ret == SR_ERR_ARG, "No callback accepted: %d.", ret);
+	ret = sr_hotplug_monitor_start(sr_ctx, drivers, hotplug_cb, NULL);
+	fail_unless(ret == SR_ERR_BUG, "Started without a session: %d.", ret);
+
+	/* Stopping a monitor that isn't running is fine. */
+	ret = sr_hotplug_monitor_stop(sr_ctx);
+	fail_unless(ret == SR_OK, "sr_hotplug_monitor_stop() failed: %d.", ret);
+}
+END_TEST
+
+struct hotplug_scan {
+	int events;
+	int num_devices;
+	gint64 deadline;
+};
+
+static void hotplug_scan_cb(const struct sr_hotplug_event *event,
+		void *cb_data)
+{
+	struct hotplug_scan *hs;
+
+	hs = cb_data;
+	fail_unless(event->type == SR_HOTPLUG_ARRIVED);
+	fail_unless(!strcmp(event->conn, "demo"));
+	hs->events++;
+	hs->num_devices += g_slist_length(event->devices);
+}
+
+/* Stop the monitor, and with it the session loop, once the event is in. */
+static int hotplug_scan_poll(int fd, int revents, void *cb_data)
+{
+	struct hotplug_scan *hs;
+
+	(void)fd;
+	(void)revents;
+
+	hs = cb_data;
+	if (!hs->events && g_get_monotonic_time() < hs->deadline)
+		return TRUE;
+
+	sr_hotplug_monitor_stop(sr_ctx);
+	sr_session_source_remove(-1);
+
+	return TRUE;
+}
+
+/*
+ * Check whether a scan through the hotplug monitor reports the devices it
+ * found from within the session loop.
+ */
+START_TEST(test_hotplug_monitor_scan)
+{
+	struct sr_dev_driver *drivers[2];
+	struct hotplug_scan hs;
+	GSList *devices;
+	int ret;
+
+	drivers[0] = srtest_driver_get("demo");
+	drivers[1] = NULL;
+	srtest_driver_init(sr_ctx, drivers[0]);
+	devices = sr_driver_scan(drivers[0], NULL);
+	fail_unless(devices != NULL, "No demo device found.");
+
+	sr_session_new();
+	sr_session_dev_add(devices->data);
+	g_slist_free(devices);
+
+	memset(&hs, 0, sizeof(hs));
+	ret = sr_hotplug_monitor_start(sr_ctx, drivers, hotplug_scan_cb, &hs);
+	if (ret == SR_ERR_NA) {
+		/* No hotplug support on this platform. */
+		sr_session_destroy();
+		return;
+	}
+	fail_unless(ret == SR_OK, "sr_hotplug_monitor_start() failed: %d.",
+			ret);
+
+	ret = sr_hotplug_monitor_scan(sr_ctx, drivers[0], SR_INST_USB, "demo");
+	fail_unless(ret == SR_OK, "sr_hotplug_monitor_scan() failed: %d.", ret);
+
+	hs.deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+	sr_session_source_add(-1, 0, 10, hotplug_scan_poll, &hs);
+	sr_session_run();
+	sr_session_destroy();
+
+	fail_unless(hs.events == 1, "Got %d hotplug events.", hs.events);
+	fail_unless(hs.num_devices == 1, "Scan found %d devices.",
+			hs.num_devices);
+}
+END_TEST
+
 /*
  * Check whether setting a samplerate works.
  *
@@ -88,6 +254,11 @@ Suite *suite_driver_all(void)
 	tcase_add_checked_fixture(tc, setup, teardown);
 	tcase_add_test(tc, test_driver_available);
 	tcase_add_test(tc, test_driver_init_all);
+	tcase_add_test(tc, test_driver_scan_all);
+	tcase_add_test(tc, test_config_info_lookup);
+	tcase_add_test(tc, test_config_list_cached);
+	tcase_add_test(tc, test_hotplug_monitor_args);
+	tcase_add_test(tc, test_hotplug_monitor_scan);
 	// TODO: Currently broken.
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
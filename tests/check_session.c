@@ -0,0 +1,437 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include "../libsigrok.h"
+#include "lib.h"
+
+static struct sr_context *sr_ctx;
+
+static uint16_t rle_values[] = { 0x1234, 0xffff, 0x0000, 0x5a5a };
+static uint64_t rle_lengths[] = { 3, 0, 1000, 1 };
+
+static const struct sr_datafeed_logic_rle rle = {
+	.num_runs = 4,
+	.unitsize = 2,
+	.values = rle_values,
+	.lengths = rle_lengths,
+};
+
+/* Check that expanding a whole packet at once yields every sample. */
+START_TEST(test_rle_expand_all)
+{
+	uint16_t buf[1100];
+	uint64_t run, offset, num, i;
+
+	run = offset = 0;
+	num = sr_datafeed_logic_rle_expand(&rle, &run, &offset, buf, 1100);
+	fail_unless(num == 1004, "Expanded %" PRIu64 " samples.", num);
+	for (i = 0; i < 3; i++)
+		fail_unless(buf[i] == 0x1234, "Wrong sample %" PRIu64 ".", i);
+	for (i = 3; i < 1003; i++)
+		fail_unless(buf[i] == 0x0000, "Wrong sample %" PRIu64 ".", i);
+	fail_unless(buf[1003] == 0x5a5a, "Wrong last sample.");
+
+	/* Nothing left after that. */
+	num = sr_datafeed_logic_rle_expand(&rle, &run, &offset, buf, 1100);
+	fail_unless(num == 0, "Expanded %" PRIu64 " extra samples.", num);
+}
+END_TEST
+
+/* Check that expanding in small pieces gives the same result. */
+START_TEST(test_rle_expand_chunked)
+{
+	uint16_t whole[1004], piece[7];
+	uint64_t run, offset, num, total;
+
+	run = offset = 0;
+	sr_datafeed_logic_rle_expand(&rle, &run, &offset, whole, 1004);
+
+	run = offset = 0;
+	total = 0;
+	while ((num = sr_datafeed_logic_rle_expand(&rle, &run, &offset,
+			piece, 7)) > 0) {
+		fail_unless(total + num <= 1004, "Too many samples.");
+		fail_unless(!memcmp(piece, whole + total, num * 2),
+			"Chunk at %" PRIu64 " differs.", total);
+		total += num;
+	}
+	fail_unless(total == 1004, "Expanded %" PRIu64 " samples.", total);
+}
+END_TEST
+
+/* Check raw analog conversion with per-probe scale and offset. */
+START_TEST(test_analog_raw_convert)
+{
+	int16_t data[] = { 0, 100, -100, 200, 32767, -32768 };
+	float scale[] = { 0.5, 2 };
+	float offset[] = { 1, -1 };
+	float buf[6];
+	struct sr_datafeed_analog_raw raw;
+	GSList *probes;
+	int ret;
+
+	probes = g_slist_append(NULL, "CH1");
+	probes = g_slist_append(probes, "CH2");
+
+	raw.probes = probes;
+	raw.num_samples = 3;
+	raw.encoding = SR_ANALOG_RAW_INT16;
+	raw.bits = 16;
+	raw.scale = scale;
+	raw.offset = offset;
+	raw.data = data;
+
+	ret = sr_datafeed_analog_raw_convert(&raw, 0, 3, buf);
+	fail_unless(ret == SR_OK, "Conversion failed: %d.", ret);
+	fail_unless(buf[0] == 1 && buf[1] == 199, "Wrong first sample.");
+	fail_unless(buf[2] == -49 && buf[3] == 399, "Wrong second sample.");
+	fail_unless(buf[4] == 16384.5 && buf[5] == -65537, "Wrong last sample.");
+
+	/* Part of the packet, starting at the second sample. */
+	ret = sr_datafeed_analog_raw_convert(&raw, 1, 1, buf);
+	fail_unless(ret == SR_OK, "Partial conversion failed: %d.", ret);
+	fail_unless(buf[0] == -49 && buf[1] == 399, "Wrong partial sample.");
+
+	/* Reading beyond the end of the packet is an error. */
+	ret = sr_datafeed_analog_raw_convert(&raw, 2, 2, buf);
+	fail_unless(ret == SR_ERR_ARG, "Overrun not rejected.");
+
+	g_slist_free(probes);
+}
+END_TEST
+
+static void setup(void)
+{
+	int ret;
+
+	ret = sr_init(&sr_ctx);
+	fail_unless(ret == SR_OK, "sr_init() failed: %d.", ret);
+}
+
+static void teardown(void)
+{
+	int ret;
+
+	ret = sr_exit(sr_ctx);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+}
+
+#define MERGE_LIMIT_SAMPLES 10000
+
+struct merge_count {
+	const struct sr_dev_inst *sdi;
+	uint64_t samples;
+	gboolean contiguous;
+	gboolean header, end;
+};
+
+static void merge_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct merge_count *count;
+	const struct sr_datafeed_logic *logic;
+
+	count = cb_data;
+	if (sdi != count->sdi)
+		return;
+
+	if (packet->type == SR_DF_HEADER) {
+		count->header = TRUE;
+	} else if (packet->type == SR_DF_END) {
+		count->end = TRUE;
+	} else if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		fail_unless(logic->unitsize == 2, "Wrong merged unitsize.");
+		if (packet->sample_offset != count->samples)
+			count->contiguous = FALSE;
+		count->samples += logic->length / logic->unitsize;
+	}
+}
+
+/* Check whether two demo devices merge into one 16 probe device. */
+START_TEST(test_session_merge_logic)
+{
+	struct sr_dev_inst *merged;
+	struct sr_probe *probe;
+	struct sr_config num_analog;
+	struct merge_count count;
+	GSList *options, *devices;
+	int ret;
+
+	num_analog.key = SR_CONF_NUM_ANALOG_PROBES;
+	num_analog.data = g_variant_new_int32(0);
+	options = g_slist_append(NULL, &num_analog);
+	devices = srtest_demo_session_new(sr_ctx, 2, options,
+			MERGE_LIMIT_SAMPLES);
+	g_slist_free(options);
+
+	fail_unless(sr_session_merge_logic(devices->next, FALSE) == NULL,
+		    "Merged a single device.");
+	merged = sr_session_merge_logic(devices, FALSE);
+	fail_unless(merged != NULL, "sr_session_merge_logic() failed.");
+	fail_unless(g_slist_length(merged->probes) == 16, "Wrong probe count.");
+	probe = merged->probes->data;
+	fail_unless(!strcmp(probe->name, "1:D0"), "Wrong probe name '%s'.",
+		    probe->name);
+	fail_unless(sr_session_merge_logic(devices, FALSE) == NULL,
+		    "Merged devices twice.");
+
+	memset(&count, 0, sizeof(count));
+	count.sdi = merged;
+	count.contiguous = TRUE;
+	sr_session_datafeed_callback_add(merge_datafeed, &count);
+
+	ret = sr_session_start();
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	sr_session_run();
+	sr_session_destroy();
+
+	fail_unless(count.header && count.end, "Missing header or end.");
+	fail_unless(count.contiguous, "Sample offsets not contiguous.");
+	fail_unless(count.samples == MERGE_LIMIT_SAMPLES,
+		    "Merged %" PRIu64 " samples.", count.samples);
+
+	g_slist_free(devices);
+}
+END_TEST
+
+#define DECIMATE_LIMIT_SAMPLES 10000
+#define DECIMATE_RATE 1000
+
+struct decimate_count {
+	uint64_t logic_samples;
+	uint64_t logic_buckets;
+	gboolean full_rate;
+};
+
+static void decimate_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct decimate_count *count;
+	const struct sr_datafeed_logic_summary *summary;
+
+	(void)sdi;
+
+	count = cb_data;
+	if (packet->type == SR_DF_LOGIC || packet->type == SR_DF_ANALOG) {
+		count->full_rate = TRUE;
+	} else if (packet->type == SR_DF_LOGIC_SUMMARY) {
+		summary = packet->payload;
+		fail_unless(packet->sample_offset == count->logic_samples,
+			    "Summary offsets not contiguous.");
+		count->logic_buckets += summary->num_buckets;
+		count->logic_samples += summary->num_buckets
+				* summary->bucket_samples;
+	}
+}
+
+/* Check whether a decimating callback gets summaries instead of samples. */
+START_TEST(test_session_decimate)
+{
+	struct sr_dev_inst *sdi;
+	struct decimate_count count;
+	GSList *devices;
+	GVariant *gvar;
+	uint64_t samplerate;
+	int ret;
+
+	devices = srtest_demo_session_new(sr_ctx, 1, NULL,
+			DECIMATE_LIMIT_SAMPLES);
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	ret = sr_config_get(sdi->driver, sdi, NULL, SR_CONF_SAMPLERATE, &gvar);
+	fail_unless(ret == SR_OK, "sr_config_get() failed: %d.", ret);
+	samplerate = g_variant_get_uint64(gvar);
+	g_variant_unref(gvar);
+
+	ret = sr_session_datafeed_callback_decimate_add(decimate_datafeed,
+			&count, 0);
+	fail_unless(ret == SR_ERR_ARG, "Rate 0 accepted: %d.", ret);
+
+	memset(&count, 0, sizeof(count));
+	ret = sr_session_datafeed_callback_decimate_add(decimate_datafeed,
+			&count, DECIMATE_RATE);
+	fail_unless(ret == SR_OK, "Adding the callback failed: %d.", ret);
+
+	ret = sr_session_start();
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	sr_session_run();
+	sr_session_destroy();
+
+	fail_unless(!count.full_rate, "Got full rate data.");
+	fail_unless(count.logic_samples == DECIMATE_LIMIT_SAMPLES,
+		    "Summed up %" PRIu64 " samples.", count.logic_samples);
+	fail_unless(count.logic_buckets == DECIMATE_LIMIT_SAMPLES
+		    / (samplerate / DECIMATE_RATE), "Wrong number of buckets.");
+}
+END_TEST
+
+/* Not a whole number of buckets, so the last one is only flushed at the end. */
+#define DECIMATE_PARTIAL_SAMPLES 10050
+
+/*
+ * Check whether a decimating callback which didn't subscribe to SR_DF_END
+ * still gets its last, partial bucket, and none of the end packets.
+ */
+START_TEST(test_session_decimate_subscribed)
+{
+	struct decimate_count count;
+	int ret;
+
+	g_slist_free(srtest_demo_session_new(sr_ctx, 1, NULL,
+			DECIMATE_PARTIAL_SAMPLES));
+
+	memset(&count, 0, sizeof(count));
+	sr_session_datafeed_callback_decimate_add(decimate_datafeed, &count,
+			DECIMATE_RATE);
+	ret = sr_session_datafeed_callback_subscribe(decimate_datafeed, &count,
+			SR_DF_MASK(SR_DF_LOGIC_SUMMARY), NULL, NULL);
+	fail_unless(ret == SR_OK, "Subscribing failed: %d.", ret);
+
+	ret = sr_session_start();
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	sr_session_run();
+	sr_session_destroy();
+
+	fail_unless(count.logic_samples == DECIMATE_PARTIAL_SAMPLES,
+		    "Summed up %" PRIu64 " samples.", count.logic_samples);
+}
+END_TEST
+
+struct subscribe_count {
+	const struct sr_dev_inst *sdi;
+	int packets;
+	int ends;
+};
+
+static void subscribe_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct subscribe_count *count;
+
+	count = cb_data;
+	fail_unless(sdi == count->sdi, "Got a packet from another device.");
+	count->packets++;
+	if (packet->type == SR_DF_END)
+		count->ends++;
+}
+
+/* Check whether a callback only gets the packets it subscribed to. */
+START_TEST(test_session_subscribe)
+{
+	struct subscribe_count count;
+	GSList *devices, *l;
+	int ret;
+
+	devices = srtest_demo_session_new(sr_ctx, 2, NULL, 1000);
+
+	memset(&count, 0, sizeof(count));
+	count.sdi = devices->next->data;
+	ret = sr_session_datafeed_callback_subscribe(subscribe_datafeed,
+			&count, SR_DF_MASK(SR_DF_END), NULL, NULL);
+	fail_unless(ret == SR_ERR_ARG, "Unknown callback accepted: %d.", ret);
+
+	sr_session_datafeed_callback_add(subscribe_datafeed, &count);
+	l = g_slist_append(NULL, devices->next->data);
+	ret = sr_session_datafeed_callback_subscribe(subscribe_datafeed,
+			&count, SR_DF_MASK(SR_DF_END), l, NULL);
+	g_slist_free(l);
+	fail_unless(ret == SR_OK, "Subscribing failed: %d.", ret);
+
+	ret = sr_session_start();
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	sr_session_run();
+	sr_session_destroy();
+
+	fail_unless(count.ends == 1 && count.packets == 1,
+		    "Got %d packets, %d of them SR_DF_END.", count.packets,
+		    count.ends);
+
+	g_slist_free(devices);
+}
+END_TEST
+
+static void late_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+
+	if (packet->type == SR_DF_END)
+		(*(int *)cb_data)++;
+}
+
+static void adding_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+
+	/* Changes the callbacks while the header is being dispatched. */
+	if (packet->type == SR_DF_HEADER)
+		sr_session_datafeed_callback_add(late_datafeed, cb_data);
+}
+
+/* Check whether a callback can add callbacks from within the datafeed. */
+START_TEST(test_session_callback_add_in_datafeed)
+{
+	int ends, ret;
+
+	g_slist_free(srtest_demo_session_new(sr_ctx, 1, NULL, 1000));
+
+	ends = 0;
+	sr_session_datafeed_callback_add(adding_datafeed, &ends);
+
+	ret = sr_session_start();
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	sr_session_run();
+	sr_session_destroy();
+
+	fail_unless(ends == 1, "Added callback got %d end packets.", ends);
+}
+END_TEST
+
+Suite *suite_session(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("session");
+
+	tc = tcase_create("logic_rle");
+	tcase_add_test(tc, test_rle_expand_all);
+	tcase_add_test(tc, test_rle_expand_chunked);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("analog_raw");
+	tcase_add_test(tc, test_analog_raw_convert);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("datafeed");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_session_merge_logic);
+	tcase_add_test(tc, test_session_decimate);
+	tcase_add_test(tc, test_session_decimate_subscribed);
+	tcase_add_test(tc, test_session_subscribe);
+	tcase_add_test(tc, test_session_callback_add_in_datafeed);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
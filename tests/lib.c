@@ -109,6 +109,41 @@ void srtest_driver_init_all(struct sr_context *sr_ctx)
 	}
 }
 
+/*
+ * Scan for num_devices demo devices, using the extra scan options if any,
+ * and add them to a new session, unthrottled and limited to limit_samples
+ * each. Returns the devices, the list is the caller's to free.
+ */
+GSList *srtest_demo_session_new(struct sr_context *sr_ctx, int num_devices,
+		GSList *options, uint64_t limit_samples)
+{
+	struct sr_dev_driver *driver;
+	struct sr_config num;
+	GSList *devices, *l;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(sr_ctx, driver);
+
+	num.key = SR_CONF_NUM_DEVICES;
+	num.data = g_variant_new_int32(num_devices);
+	options = g_slist_prepend(g_slist_copy(options), &num);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	fail_unless(g_slist_length(devices) == (guint)num_devices,
+		    "Expected %d demo devices.", num_devices);
+
+	sr_session_new();
+	for (l = devices; l; l = l->next) {
+		sr_config_set(l->data, NULL, SR_CONF_THROTTLE,
+				g_variant_new_boolean(FALSE));
+		sr_config_set(l->data, NULL, SR_CONF_LIMIT_SAMPLES,
+				g_variant_new_uint64(limit_samples));
+		sr_session_dev_add(l->data);
+	}
+
+	return devices;
+}
+
 /* Initialize a libsigrok input module. */
 void srtest_input_init(struct sr_context *sr_ctx, struct sr_input_format *input)
 {
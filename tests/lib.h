@@ -29,6 +29,8 @@ struct sr_output_format *srtest_output_get(const char *id);
 
 void srtest_driver_init(struct sr_context *sr_ctx, struct sr_dev_driver *driver);
 void srtest_driver_init_all(struct sr_context *sr_ctx);
+GSList *srtest_demo_session_new(struct sr_context *sr_ctx, int num_devices,
+		GSList *options, uint64_t limit_samples);
 
 void srtest_input_init(struct sr_context *sr_ctx, struct sr_input_format *input);
 void srtest_input_init_all(struct sr_context *sr_ctx);